@@ -0,0 +1,109 @@
+// Стоимость GET /feed/new?count_only=1 без HTTP:
+// PostMetaStore::publishedSince при разном отставании клиента (сколько
+// постов вышло после его курсора). Читатели крутятся в нескольких
+// потоках, параллельно идёт поток вставок, как createPost в живом
+// сервисе.
+// Печатает вызовы в секунду и сколько ядер уходит на опрос раз в 10 с
+// от заданного числа клиентов.
+// Запуск: ./feed_new_count_bench [постов] [потоков] [клиентов]
+//         [вставок в секунду]
+#include "services/PostMetaStore.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using services::PostMetaStore;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char **argv) {
+  size_t posts = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  unsigned threads = argc > 2 ? std::atoi(argv[2])
+                              : std::max(1u, std::thread::hardware_concurrency());
+  double clients = argc > 3 ? std::atof(argv[3]) : 1000000;
+  double insertsPerSecond = argc > 4 ? std::atof(argv[4]) : 200;
+
+  auto &store = PostMetaStore::instance();
+  store.reserve(posts * 2);
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> authorDist(1, 1000000);
+  int64_t createdAt = 1700000000000;
+  for (size_t i = 1; i <= posts; ++i) {
+    createdAt += rng() % 50;
+    store.upsert(static_cast<int64_t>(i), authorDist(rng), createdAt,
+                 rng() % 10 == 0 ? PostMetaStore::kPrivate
+                                 : PostMetaStore::kPublic);
+  }
+  std::atomic<int64_t> lastId{static_cast<int64_t>(posts)};
+  std::atomic<uint64_t> lastSequence{store.publishedSequence()};
+
+  // Новые посты во время замера: upsert берёт эксклюзивную блокировку
+  std::atomic<bool> stop{false};
+  std::thread writer([&]() {
+    if (insertsPerSecond <= 0) {
+      return;
+    }
+    std::mt19937_64 writerRng(7);
+    auto interval = std::chrono::duration<double>(1 / insertsPerSecond);
+    auto next = Clock::now();
+    int64_t at = createdAt;
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto id = lastId.load(std::memory_order_relaxed) + 1;
+      at += 1;
+      store.upsert(id, authorDist(writerRng), at, PostMetaStore::kPublic);
+      lastId.store(id, std::memory_order_relaxed);
+      lastSequence.fetch_add(1, std::memory_order_relaxed);
+      next += std::chrono::duration_cast<Clock::duration>(interval);
+      std::this_thread::sleep_until(next);
+    }
+  });
+
+  std::printf("posts=%zu threads=%u writer=%.0f/s\n", store.size(), threads,
+              insertsPerSecond);
+
+  // 100000 больше журнала: курсор устарел, ответ сразу has_more
+  for (int64_t lag : {0L, 10L, 100L, 1000L, 10000L, 100000L}) {
+    std::atomic<int64_t> calls{0};
+    std::atomic<int64_t> checksum{0};
+    auto deadline = Clock::now() + std::chrono::seconds(2);
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < threads; ++t) {
+      readers.emplace_back([&, t]() {
+        std::mt19937_64 readerRng(t);
+        int64_t local = 0;
+        size_t sum = 0;
+        while (Clock::now() < deadline) {
+          for (int i = 0; i < 256; ++i) {
+            auto since =
+                lastSequence.load(std::memory_order_relaxed) - lag;
+            // Как в контроллере: больше 99 не считаем
+            sum += store.publishedSince(since, authorDist(readerRng), 100)
+                       .ids.size();
+          }
+          local += 256;
+        }
+        calls.fetch_add(local);
+        checksum.fetch_add(static_cast<int64_t>(sum));
+      });
+    }
+    for (auto &reader : readers) {
+      reader.join();
+    }
+    double perSecond = calls.load() / 2.0;
+    double needed = clients / 10.0;
+    std::printf("lag %-7ld %10.0f calls/s %8.0f ns/call/thread  "
+                "cores for %.0f clients@10s: %.3f  (sum %ld)\n",
+                static_cast<long>(lag), perSecond,
+                threads * 1e9 / perSecond, clients,
+                needed / (perSecond / threads),
+                static_cast<long>(checksum.load()));
+  }
+
+  stop = true;
+  writer.join();
+  return 0;
+}
@@ -0,0 +1,314 @@
+// Бэкенды MediaIo на локальном диске в духе fio: фиксированное число
+// операций в полёте (iodepth), блоки bs, последовательный или случайный
+// доступ. Печатает IOPS, пропускную способность и задержки завершения.
+//
+// Запуск: ./media_io_bench --file=/data/bench.bin [--rw=randread]
+//         [--bs=4k] [--iodepth=32] [--size=1g] [--runtime=10]
+//         [--direct=0] [--backend=both]
+//
+//   rw:      read | write | randread | randwrite
+//   backend: io_uring | threads | both
+//   direct:  1 — O_DIRECT, мимо page cache (нужна поддержка ФС)
+#include "services/MediaIo.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using services::MediaIo;
+
+namespace {
+
+uint64_t parseSize(const std::string &value) {
+  char *end = nullptr;
+  double number = std::strtod(value.c_str(), &end);
+  switch (end && *end ? *end | 0x20 : 0) {
+  case 'k':
+    return static_cast<uint64_t>(number * 1024);
+  case 'm':
+    return static_cast<uint64_t>(number * 1024 * 1024);
+  case 'g':
+    return static_cast<uint64_t>(number * 1024 * 1024 * 1024);
+  default:
+    return static_cast<uint64_t>(number);
+  }
+}
+
+// Файл нужного размера с ненулевыми данными
+bool prepareFile(const std::string &path, uint64_t size) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) == 0 &&
+      static_cast<uint64_t>(st.st_size) >= size) {
+    return true;
+  }
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  std::vector<char> block(1 << 20);
+  std::mt19937_64 rng(1);
+  for (auto &byte : block) {
+    byte = static_cast<char>(rng());
+  }
+  for (uint64_t offset = 0; offset < size; offset += block.size()) {
+    size_t length = std::min<uint64_t>(block.size(), size - offset);
+    if (::pwrite(fd, block.data(), length, offset) !=
+        static_cast<ssize_t>(length)) {
+      ::close(fd);
+      return false;
+    }
+  }
+  ::fsync(fd);
+  ::close(fd);
+  return true;
+}
+
+struct Options {
+  std::string file;
+  std::string rw = "randread";
+  uint64_t bs = 4096;
+  unsigned iodepth = 32;
+  uint64_t size = 1ULL << 30;
+  double runtime = 10;
+  bool direct = false;
+  std::string backend = "both";
+};
+
+class Job {
+public:
+  Job(MediaIo &io, int fd, const Options &options)
+      : io_(io), fd_(fd), options_(options),
+        write_(options.rw.find("write") != std::string::npos),
+        random_(options.rw.rfind("rand", 0) == 0),
+        blocks_(options.size / options.bs), slots_(options.iodepth) {
+    for (auto &slot : slots_) {
+      slot.buffer = io_.acquireBuffer();
+      if (!slot.buffer) {
+        void *memory = nullptr;
+        ::posix_memalign(&memory, 4096, options.bs);
+        slot.own = static_cast<char *>(memory);
+        std::memset(slot.own, 0x5a, options.bs);
+      }
+      slot.latencies.reserve(1 << 16);
+    }
+  }
+
+  ~Job() {
+    for (auto &slot : slots_) {
+      std::free(slot.own);
+    }
+  }
+
+  void run() {
+    start_ = Clock::now();
+    inFlight_ = slots_.size();
+    // Первые iodepth операций — одним пакетом
+    std::vector<MediaIo::Op> ops;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      ops.push_back(makeOp(i));
+    }
+    io_.submit(std::move(ops));
+
+    std::this_thread::sleep_for(
+        std::chrono::duration<double>(options_.runtime));
+    stop_.store(true, std::memory_order_relaxed);
+
+    std::unique_lock lock(mutex_);
+    drained_.wait(lock, [this]() { return inFlight_ == 0; });
+    elapsed_ = std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+  void report(const char *backend) const {
+    std::vector<uint32_t> all;
+    for (const auto &slot : slots_) {
+      all.insert(all.end(), slot.latencies.begin(), slot.latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) {
+      return all.empty() ? 0u
+                         : all[std::min(all.size() - 1,
+                                        static_cast<size_t>(p * all.size()))];
+    };
+    double iops = all.size() / elapsed_;
+    std::printf("%-9s %-9s bs=%-8llu iodepth=%-4u %10.0f IOPS %9.1f MiB/s  "
+                "clat p50=%uus p99=%uus p99.9=%uus max=%uus errors=%llu\n",
+                backend, options_.rw.c_str(),
+                static_cast<unsigned long long>(options_.bs),
+                options_.iodepth, iops, iops * options_.bs / (1 << 20),
+                percentile(0.50), percentile(0.99), percentile(0.999),
+                all.empty() ? 0u : all.back(),
+                static_cast<unsigned long long>(errors_.load()));
+  }
+
+private:
+  struct Slot {
+    MediaIo::Buffer buffer;
+    char *own = nullptr;
+    Clock::time_point issuedAt;
+    std::vector<uint32_t> latencies;
+  };
+
+  uint64_t nextOffset() {
+    if (random_) {
+      std::lock_guard lock(rngMutex_);
+      return (rng_() % blocks_) * options_.bs;
+    }
+    return (sequence_.fetch_add(1, std::memory_order_relaxed) % blocks_) *
+           options_.bs;
+  }
+
+  MediaIo::Op makeOp(size_t index) {
+    auto &slot = slots_[index];
+    MediaIo::Op op;
+    op.kind = write_ ? MediaIo::Op::Kind::kWrite : MediaIo::Op::Kind::kRead;
+    op.fd = fd_;
+    op.data = slot.buffer ? slot.buffer.data() : slot.own;
+    op.length = options_.bs;
+    op.offset = nextOffset();
+    op.bufferIndex = slot.buffer ? slot.buffer.index() : -1;
+    op.done = [this, index](int64_t result) { completed(index, result); };
+    slot.issuedAt = Clock::now();
+    return op;
+  }
+
+  void completed(size_t index, int64_t result) {
+    auto &slot = slots_[index];
+    slot.latencies.push_back(static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - slot.issuedAt)
+            .count()));
+    if (result != static_cast<int64_t>(options_.bs)) {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!stop_.load(std::memory_order_relaxed)) {
+      std::vector<MediaIo::Op> ops;
+      ops.push_back(makeOp(index));
+      io_.submit(std::move(ops));
+      return;
+    }
+    std::lock_guard lock(mutex_);
+    if (--inFlight_ == 0) {
+      drained_.notify_all();
+    }
+  }
+
+  MediaIo &io_;
+  int fd_;
+  const Options &options_;
+  bool write_;
+  bool random_;
+  uint64_t blocks_;
+  std::vector<Slot> slots_;
+
+  std::mutex rngMutex_;
+  std::mt19937_64 rng_{42};
+  std::atomic<uint64_t> sequence_{0};
+  std::atomic<bool> stop_{false};
+  std::atomic<uint64_t> errors_{0};
+
+  std::mutex mutex_;
+  std::condition_variable drained_;
+  size_t inFlight_ = 0;
+  Clock::time_point start_;
+  double elapsed_ = 0;
+};
+
+bool runBackend(const std::string &backend, const Options &options) {
+  MediaIo io;
+  MediaIo::Config config;
+  config.backend = backend;
+  config.queueDepth = std::max(options.iodepth + 1, 8u);
+  // Как у fio с psync: один поток на операцию в полёте
+  config.threads = options.iodepth;
+  config.fixedBuffers = options.iodepth;
+  config.bufferSize = options.bs;
+  io.configure(config);
+  if (backend != io.backendName()) {
+    std::printf("%-9s unavailable on this kernel, skipped\n",
+                backend.c_str());
+    return false;
+  }
+
+  int flags = O_CLOEXEC | (options.direct ? O_DIRECT : 0) |
+              (options.rw.find("write") != std::string::npos ? O_RDWR
+                                                             : O_RDONLY);
+  int fd = ::open(options.file.c_str(), flags);
+  if (fd < 0) {
+    std::perror("open");
+    return false;
+  }
+  {
+    Job job(io, fd, options);
+    job.run();
+    job.report(backend.c_str());
+  }
+  ::close(fd);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  std::map<std::string, std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+      std::fprintf(stderr, "unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+    args[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+  }
+  if (args.count("file") == 0) {
+    std::fprintf(stderr,
+                 "usage: %s --file=<path> [--rw=randread] [--bs=4k] "
+                 "[--iodepth=32] [--size=1g] [--runtime=10] [--direct=0] "
+                 "[--backend=both]\n",
+                 argv[0]);
+    return 1;
+  }
+  options.file = args["file"];
+  if (args.count("rw")) options.rw = args["rw"];
+  if (args.count("bs")) options.bs = parseSize(args["bs"]);
+  if (args.count("iodepth")) options.iodepth = std::stoul(args["iodepth"]);
+  if (args.count("size")) options.size = parseSize(args["size"]);
+  if (args.count("runtime")) options.runtime = std::stod(args["runtime"]);
+  if (args.count("direct")) options.direct = args["direct"] == "1";
+  if (args.count("backend")) options.backend = args["backend"];
+
+  if (options.bs == 0 || options.iodepth == 0 ||
+      options.size < options.bs) {
+    std::fprintf(stderr, "bs, iodepth and size must be positive, "
+                         "size >= bs\n");
+    return 1;
+  }
+  if (!prepareFile(options.file, options.size)) {
+    std::perror("prepare file");
+    return 1;
+  }
+
+  std::vector<std::string> backends;
+  if (options.backend == "both") {
+    backends = {"io_uring", "threads"};
+  } else {
+    backends = {options.backend};
+  }
+  for (const auto &backend : backends) {
+    runBackend(backend, options);
+  }
+  return 0;
+}
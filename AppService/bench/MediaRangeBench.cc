@@ -0,0 +1,206 @@
+// N клиентов с keep-alive читают случайные диапазоны одного файла через
+// GET /media/... (как перемотка видео). Печатает пропускную способность
+// и задержки.
+// Запуск: ./media_range_bench <host> <port> <path> [клиентов] [секунд]
+//         [байт в диапазоне]
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Target {
+  std::string host;
+  std::string port;
+  std::string path;
+};
+
+int connectTo(const Target &target) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addrs = nullptr;
+  if (getaddrinfo(target.host.c_str(), target.port.c_str(), &hints, &addrs) !=
+      0) {
+    return -1;
+  }
+  int fd = -1;
+  for (auto *a = addrs; a; a = a->ai_next) {
+    fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      break;
+    }
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  return fd;
+}
+
+// Отправляет запрос и читает ответ целиком. Возвращает статус, тело
+// не сохраняется — только считается его размер и заголовки.
+int request(int fd, const Target &target, const std::string &range,
+            std::string &headers, uint64_t &bodyBytes) {
+  std::string req = "GET " + target.path + " HTTP/1.1\r\nHost: " +
+                    target.host + "\r\n";
+  if (!range.empty()) {
+    req += "Range: bytes=" + range + "\r\n";
+  }
+  req += "\r\n";
+  if (::send(fd, req.data(), req.size(), MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(req.size())) {
+    return -1;
+  }
+
+  static thread_local std::vector<char> buffer(1 << 16);
+  headers.clear();
+  size_t headerEnd = std::string::npos;
+  while (headerEnd == std::string::npos) {
+    auto n = ::recv(fd, buffer.data(), buffer.size(), 0);
+    if (n <= 0) {
+      return -1;
+    }
+    headers.append(buffer.data(), n);
+    headerEnd = headers.find("\r\n\r\n");
+  }
+
+  uint64_t contentLength = 0;
+  auto lower = headers.substr(0, headerEnd);
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  auto cl = lower.find("content-length:");
+  if (cl != std::string::npos) {
+    contentLength = std::strtoull(lower.c_str() + cl + 15, nullptr, 10);
+  }
+
+  uint64_t have = headers.size() - headerEnd - 4;
+  while (have < contentLength) {
+    auto n = ::recv(fd, buffer.data(),
+                    std::min<uint64_t>(buffer.size(), contentLength - have),
+                    0);
+    if (n <= 0) {
+      return -1;
+    }
+    have += n;
+  }
+  bodyBytes = have;
+  headers.resize(headerEnd);
+  return std::atoi(headers.c_str() + 9);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    std::fprintf(stderr,
+                 "usage: %s <host> <port> <path> [clients] [seconds] "
+                 "[range bytes]\n",
+                 argv[0]);
+    return 1;
+  }
+  Target target{argv[1], argv[2], argv[3]};
+  int clients = argc > 4 ? std::atoi(argv[4]) : 1000;
+  int seconds = argc > 5 ? std::atoi(argv[5]) : 10;
+  uint64_t rangeBytes =
+      argc > 6 ? std::strtoull(argv[6], nullptr, 10) : (1 << 20);
+
+  // Размер файла из Content-Range ответа на bytes=0-0
+  uint64_t fileSize = 0;
+  {
+    int fd = connectTo(target);
+    std::string headers;
+    uint64_t body = 0;
+    if (fd < 0 || request(fd, target, "0-0", headers, body) != 206) {
+      std::fprintf(stderr, "range probe failed\n");
+      return 1;
+    }
+    ::close(fd);
+    auto slash = headers.find('/', headers.find("ontent-Range"));
+    fileSize = std::strtoull(headers.c_str() + slash + 1, nullptr, 10);
+  }
+  rangeBytes = std::min(rangeBytes, fileSize);
+  std::printf("file %llu bytes, %d clients, %llu-byte ranges, %d s\n",
+              static_cast<unsigned long long>(fileSize), clients,
+              static_cast<unsigned long long>(rangeBytes), seconds);
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> errors{0};
+  std::vector<std::vector<double>> latencies(clients);
+  std::vector<std::thread> threads;
+  threads.reserve(clients);
+
+  for (int i = 0; i < clients; ++i) {
+    threads.emplace_back([&, i]() {
+      std::mt19937_64 rng(i);
+      int fd = connectTo(target);
+      std::string headers;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (fd < 0) {
+          errors.fetch_add(1);
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+          fd = connectTo(target);
+          continue;
+        }
+        uint64_t offset = rng() % (fileSize - rangeBytes + 1);
+        auto range = std::to_string(offset) + "-" +
+                     std::to_string(offset + rangeBytes - 1);
+        auto start = Clock::now();
+        uint64_t body = 0;
+        if (request(fd, target, range, headers, body) != 206 ||
+            body != rangeBytes) {
+          errors.fetch_add(1);
+          ::close(fd);
+          fd = connectTo(target);
+          continue;
+        }
+        latencies[i].push_back(
+            std::chrono::duration<double, std::milli>(Clock::now() - start)
+                .count());
+        bytes.fetch_add(body, std::memory_order_relaxed);
+      }
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  std::vector<double> all;
+  for (auto &l : latencies) {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) {
+    return all.empty() ? 0.0 : all[static_cast<size_t>(p * (all.size() - 1))];
+  };
+  std::printf("requests %zu (%.0f/s), %.1f MB/s, errors %llu\n", all.size(),
+              all.size() / double(seconds), bytes / 1e6 / seconds,
+              static_cast<unsigned long long>(errors.load()));
+  std::printf("latency ms: p50 %.2f  p99 %.2f  max %.2f\n", pct(0.5),
+              pct(0.99), all.empty() ? 0.0 : all.back());
+  return 0;
+}
@@ -0,0 +1,121 @@
+// Поиск файла в uploads/: плоский каталог против двухуровневого
+// шардирования по дайджесту (ab/cd/<digest>), плюс скорость BLAKE3.
+// Запуск: ./media_store_bench <каталог> [файлов] [поисков]
+// По умолчанию 10M файлов — нужно ~10M inode на файловой системе.
+#include "services/Blake3.h"
+#include "services/MediaStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::string digestFor(uint64_t i) {
+  services::Blake3 hasher;
+  hasher.update(&i, sizeof(i));
+  return services::Blake3::toHex(hasher.finalize());
+}
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void touch(const std::string &path) {
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+void runLayout(const char *name, const std::string &root, size_t files,
+               size_t lookups, bool sharded) {
+  auto pathFor = [&](uint64_t i) {
+    auto digest = digestFor(i);
+    return root + "/" +
+           (sharded ? services::MediaStore::objectPath(digest, "jpg")
+                    : digest + ".jpg");
+  };
+
+  std::filesystem::create_directories(root);
+  if (sharded) {
+    char shard[8];
+    for (int a = 0; a < 256; ++a) {
+      for (int b = 0; b < 256; ++b) {
+        std::snprintf(shard, sizeof(shard), "%02x/%02x", a, b);
+        std::filesystem::create_directories(root + "/" + shard);
+      }
+    }
+  }
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < files; ++i) {
+    touch(pathFor(i));
+  }
+  double createSec = secondsSince(start);
+
+  std::mt19937_64 rng(7);
+  std::vector<std::string> hits(lookups), misses(lookups);
+  for (size_t i = 0; i < lookups; ++i) {
+    hits[i] = pathFor(rng() % files);
+    misses[i] = pathFor(files + rng() % files);
+  }
+
+  struct stat st;
+  size_t found = 0;
+  start = Clock::now();
+  for (const auto &path : hits) {
+    found += ::stat(path.c_str(), &st) == 0;
+  }
+  double hitSec = secondsSince(start);
+
+  start = Clock::now();
+  for (const auto &path : misses) {
+    found += ::stat(path.c_str(), &st) == 0;
+  }
+  double missSec = secondsSince(start);
+
+  std::printf("%-8s create %8.0f files/s  stat hit %6.2f us  stat miss %6.2f "
+              "us  (found %zu/%zu)\n",
+              name, files / createSec, hitSec * 1e6 / lookups,
+              missSec * 1e6 / lookups, found, lookups);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s <dir> [files] [lookups]\n", argv[0]);
+    return 1;
+  }
+  std::string dir = argv[1];
+  size_t files = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+  size_t lookups = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000000;
+
+  std::vector<char> buffer(64 << 20);
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    buffer[i] = static_cast<char>(i * 31);
+  }
+  auto start = Clock::now();
+  services::Blake3 hasher;
+  hasher.update(buffer.data(), buffer.size());
+  auto digest = hasher.finalize();
+  std::printf("blake3   %8.0f MB/s  (%02x...)\n",
+              buffer.size() / secondsSince(start) / 1e6, digest[0]);
+
+  runLayout("flat", dir + "/flat", files, lookups, false);
+  runLayout("sharded", dir + "/sharded", files, lookups, true);
+
+  std::filesystem::remove_all(dir + "/flat");
+  std::filesystem::remove_all(dir + "/sharded");
+  return 0;
+}
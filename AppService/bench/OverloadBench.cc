@@ -0,0 +1,463 @@
+// Goodput под нарастающей нагрузкой. Открытая модель: запросы уходят
+// по расписанию (rate в секунду) независимо от того, успевает ли сервис,
+// — как реальные клиенты. На каждой ступени печатает предложенную
+// нагрузку, goodput (2xx не дольше SLO), долю 503 от AdmissionControl,
+// прочие ошибки и задержки успешных ответов.
+//
+// Без отказа под перегрузкой goodput после точки насыщения падает
+// почти до нуля: очередь растёт, и все ответы опаздывают. С ним —
+// держится около пропускной способности. В конце каждой ступени из
+// /metrics берутся опоздание таймеров IO-циклов, по которому
+// AdmissionControl видит очередь, и число отключённых классов: пока
+// опоздание выше target, уровень должен расти, а goodput — держаться.
+//
+// Ограничитель частоты (rate_limit) для прогона нужно выключить: вся
+// нагрузка идёт с одного адреса и одного токена.
+//
+// Запуск: TOKEN=<jwt> ./overload_bench <ipv4> <port> <rate,rate,...>
+//         [секунд на ступень] [SLO, мс] [файл смеси]
+// Файл смеси: строки "<вес> <METHOD> <путь> [тело JSON]"; по умолчанию —
+// смесь чтения: поиск, первая страница и хвост ленты, пост.
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kMaxConnections = 8192;
+
+struct Route {
+  double weight = 1;
+  std::string request;
+};
+
+enum class State { Idle, Connecting, Busy };
+
+struct Connection {
+  int fd = -1;
+  State state = State::Idle;
+  std::string out;
+  std::string in;
+  Clock::time_point sentAt;
+};
+
+struct Step {
+  size_t sent = 0;
+  size_t ok = 0;
+  size_t good = 0;
+  size_t shed = 0;
+  size_t limited = 0;
+  size_t errors = 0;
+  size_t overflow = 0;
+  std::vector<double> latenciesMs;
+  // Из /metrics в конце ступени; -1 — не удалось получить
+  double loopLagMs = -1;
+  double shedLevel = -1;
+};
+
+std::string buildRequest(const std::string &method, const std::string &path,
+                         const std::string &body, const std::string &host,
+                         const char *token) {
+  std::string request = method + " " + path + " HTTP/1.1\r\nHost: " + host +
+                        "\r\n";
+  if (token) {
+    request += std::string("Authorization: Bearer ") + token + "\r\n";
+  }
+  if (!body.empty()) {
+    request += "Content-Type: application/json\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n";
+  }
+  return request + "\r\n" + body;
+}
+
+std::vector<Route> loadRoutes(const char *file, const std::string &host,
+                              const char *token) {
+  std::vector<Route> routes;
+  if (!file) {
+    routes.push_back({2, buildRequest("GET", "/posts/search?q=test", "",
+                                      host, token)});
+    routes.push_back({3, buildRequest("GET", "/feed?limit=20", "", host,
+                                      token)});
+    routes.push_back({2, buildRequest("GET", "/feed?limit=20&offset=40", "",
+                                      host, token)});
+    routes.push_back({3, buildRequest("GET", "/posts/1", "", host, token)});
+    return routes;
+  }
+  std::ifstream in(file);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    Route route;
+    std::string method, path, body;
+    if (!(fields >> route.weight >> method >> path)) {
+      continue;
+    }
+    std::getline(fields, body);
+    body.erase(0, body.find_first_not_of(' '));
+    route.request = buildRequest(method, path, body, host, token);
+    routes.push_back(std::move(route));
+  }
+  return routes;
+}
+
+// Полный ответ в буфере: длина ответа или 0, если ещё не весь
+size_t responseLength(const std::string &in) {
+  auto headerEnd = in.find("\r\n\r\n");
+  if (headerEnd == std::string::npos) {
+    return 0;
+  }
+  std::string headers = in.substr(0, headerEnd);
+  std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+  auto length = headers.find("content-length:");
+  if (length != std::string::npos) {
+    size_t total = headerEnd + 4 + std::strtoull(
+                                       headers.c_str() + length + 15, nullptr,
+                                       10);
+    return in.size() >= total ? total : 0;
+  }
+  if (headers.find("transfer-encoding: chunked") != std::string::npos) {
+    auto end = in.find("\r\n0\r\n\r\n", headerEnd);
+    return end == std::string::npos ? 0 : end + 7;
+  }
+  return headerEnd + 4;
+}
+
+// Значение метрики из текста /metrics; -1, если её нет
+double metricValue(const std::string &text, const std::string &name) {
+  auto at = text.find("\n" + name + " ");
+  if (at == std::string::npos) {
+    return -1;
+  }
+  return std::atof(text.c_str() + at + name.size() + 2);
+}
+
+// Отдельным соединением и с ожиданием: один раз за ступень
+void scrapeMetrics(const sockaddr_in &server, const std::string &host,
+                   Step &step) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  timeval timeout{2, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&server),
+              sizeof(server)) != 0) {
+    close(fd);
+    return;
+  }
+  auto request = "GET /metrics HTTP/1.1\r\nHost: " + host +
+                 "\r\nConnection: close\r\n\r\n";
+  ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+  std::string text;
+  char buffer[16384];
+  for (ssize_t n; (n = recv(fd, buffer, sizeof(buffer), 0)) > 0;) {
+    text.append(buffer, static_cast<size_t>(n));
+  }
+  close(fd);
+  step.loopLagMs = metricValue(text, "admission_loop_lag_milliseconds");
+  step.shedLevel = metricValue(text, "admission_shed_level");
+}
+
+double percentile(std::vector<double> &values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1,
+                         static_cast<size_t>(p * values.size()))];
+}
+
+class Runner {
+public:
+  Runner(const sockaddr_in &server, std::string host,
+         std::vector<Route> routes)
+      : server_(server), host_(std::move(host)), routes_(std::move(routes)),
+        epoll_(epoll_create1(0)) {
+    for (const auto &route : routes_) {
+      totalWeight_ += route.weight;
+    }
+  }
+
+  Step run(double rate, int seconds, double sloMs) {
+    Step step;
+    auto start = Clock::now();
+    auto stop = start + std::chrono::seconds(seconds);
+    auto interval = std::chrono::duration<double>(1 / rate);
+    auto next = start;
+    // После конца ступени ждём ответы ещё SLO: позже они всё равно не
+    // засчитываются
+    auto drainUntil =
+        stop + std::chrono::duration_cast<Clock::duration>(
+                   std::chrono::duration<double, std::milli>(sloMs));
+
+    bool scraped = false;
+    while (true) {
+      auto now = Clock::now();
+      while (next <= now && next < stop) {
+        send(step);
+        next += std::chrono::duration_cast<Clock::duration>(interval);
+      }
+      if (now >= stop && !scraped) {
+        // Пока очередь ступени ещё не разобрана
+        scrapeMetrics(server_, host_, step);
+        scraped = true;
+      }
+      if (now >= drainUntil || (now >= stop && busy_ == 0)) {
+        break;
+      }
+      poll(step, sloMs, 1);
+    }
+    // Не дождались — соединение закрываем, запрос считаем ошибкой
+    for (auto &conn : conns_) {
+      if (conn.state != State::Idle) {
+        closeConnection(conn);
+        ++step.errors;
+      }
+    }
+    busy_ = 0;
+    return step;
+  }
+
+private:
+  const Route &pickRoute() {
+    double point = std::uniform_real_distribution<double>(0, totalWeight_)(rng_);
+    for (const auto &route : routes_) {
+      point -= route.weight;
+      if (point <= 0) {
+        return route;
+      }
+    }
+    return routes_.back();
+  }
+
+  void send(Step &step) {
+    ++step.sent;
+    size_t index = conns_.size();
+    for (size_t i = 0; i < conns_.size(); ++i) {
+      if (conns_[i].state == State::Idle) {
+        index = i;
+        break;
+      }
+    }
+    if (index == conns_.size()) {
+      if (conns_.size() >= kMaxConnections) {
+        ++step.overflow;
+        return;
+      }
+      conns_.emplace_back();
+    }
+    auto &conn = conns_[index];
+    conn.out = pickRoute().request;
+    conn.in.clear();
+    conn.sentAt = Clock::now();
+    ++busy_;
+
+    if (conn.fd >= 0) {
+      conn.state = State::Busy;
+      flush(conn, index, step);
+      return;
+    }
+    conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int one = 1;
+    setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(conn.fd, reinterpret_cast<const sockaddr *>(&server_),
+                sizeof(server_)) != 0 &&
+        errno != EINPROGRESS) {
+      fail(conn, step);
+      return;
+    }
+    conn.state = State::Connecting;
+    epoll_event event{};
+    event.events = EPOLLOUT | EPOLLIN;
+    event.data.u32 = static_cast<uint32_t>(index);
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, conn.fd, &event);
+  }
+
+  void flush(Connection &conn, size_t, Step &step) {
+    while (!conn.out.empty()) {
+      auto n = ::send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno != EAGAIN) {
+          fail(conn, step);
+        }
+        return;
+      }
+      conn.out.erase(0, static_cast<size_t>(n));
+    }
+  }
+
+  void poll(Step &step, double sloMs, int timeoutMs) {
+    epoll_event events[256];
+    int ready = epoll_wait(epoll_, events, 256, timeoutMs);
+    for (int i = 0; i < ready; ++i) {
+      auto index = events[i].data.u32;
+      auto &conn = conns_[index];
+      if (conn.fd < 0) {
+        continue;
+      }
+      if (conn.state == State::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+          fail(conn, step);
+          continue;
+        }
+        conn.state = State::Busy;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = index;
+        epoll_ctl(epoll_, EPOLL_CTL_MOD, conn.fd, &event);
+      }
+      if (conn.state == State::Busy && !conn.out.empty()) {
+        flush(conn, index, step);
+      }
+      if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        continue;
+      }
+      char buffer[16384];
+      auto n = recv(conn.fd, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        if (n < 0 && errno == EAGAIN) {
+          continue;
+        }
+        if (conn.state == State::Busy) {
+          fail(conn, step);
+        } else {
+          closeConnection(conn);
+        }
+        continue;
+      }
+      conn.in.append(buffer, static_cast<size_t>(n));
+      if (conn.state != State::Busy) {
+        continue;
+      }
+      auto length = responseLength(conn.in);
+      if (length == 0) {
+        continue;
+      }
+      int status = conn.in.size() > 12 ? std::atoi(conn.in.c_str() + 9) : 0;
+      double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                            conn.sentAt)
+                      .count();
+      if (status >= 200 && status < 300) {
+        ++step.ok;
+        step.latenciesMs.push_back(ms);
+        step.good += ms <= sloMs;
+      } else if (status == 503) {
+        ++step.shed;
+      } else if (status == 429) {
+        ++step.limited;
+      } else {
+        ++step.errors;
+      }
+      conn.in.erase(0, length);
+      conn.state = State::Idle;
+      --busy_;
+    }
+  }
+
+  void fail(Connection &conn, Step &step) {
+    ++step.errors;
+    closeConnection(conn);
+  }
+
+  void closeConnection(Connection &conn) {
+    if (conn.state != State::Idle) {
+      --busy_;
+    }
+    if (conn.fd >= 0) {
+      close(conn.fd);
+      conn.fd = -1;
+    }
+    conn.state = State::Idle;
+    conn.out.clear();
+    conn.in.clear();
+  }
+
+  sockaddr_in server_;
+  std::string host_;
+  std::vector<Route> routes_;
+  double totalWeight_ = 0;
+  int epoll_;
+  std::vector<Connection> conns_;
+  size_t busy_ = 0;
+  std::mt19937_64 rng_{42};
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    std::fprintf(stderr,
+                 "usage: TOKEN=<jwt> %s <ipv4> <port> <rate,rate,...> "
+                 "[seconds per step] [SLO ms] [mix file]\n",
+                 argv[0]);
+    return 1;
+  }
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(static_cast<uint16_t>(std::atoi(argv[2])));
+  if (inet_pton(AF_INET, argv[1], &server.sin_addr) != 1) {
+    std::fprintf(stderr, "bad IPv4 address: %s\n", argv[1]);
+    return 1;
+  }
+  std::vector<double> rates;
+  std::stringstream list(argv[3]);
+  for (std::string rate; std::getline(list, rate, ',');) {
+    rates.push_back(std::atof(rate.c_str()));
+  }
+  int seconds = argc > 4 ? std::atoi(argv[4]) : 10;
+  double sloMs = argc > 5 ? std::atof(argv[5]) : 1000;
+
+  rlimit limit{};
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+
+  auto host = std::string(argv[1]) + ":" + argv[2];
+  auto routes =
+      loadRoutes(argc > 6 ? argv[6] : nullptr, host, std::getenv("TOKEN"));
+  if (routes.empty()) {
+    std::fprintf(stderr, "empty request mix\n");
+    return 1;
+  }
+
+  std::printf("%8s %8s %8s %8s %8s %8s %8s %9s %9s %8s %6s\n", "offered",
+              "goodput", "ok/s", "503/s", "429/s", "err/s", "overflow",
+              "p50 ms", "p99 ms", "lag ms", "level");
+  Runner runner(server, host, std::move(routes));
+  for (auto rate : rates) {
+    auto step = runner.run(rate, seconds, sloMs);
+    std::printf("%8.0f %8.1f %8.1f %8.1f %8.1f %8.1f %8zu %9.1f %9.1f "
+                "%8.1f %6.0f\n",
+                step.sent / static_cast<double>(seconds),
+                step.good / static_cast<double>(seconds),
+                step.ok / static_cast<double>(seconds),
+                step.shed / static_cast<double>(seconds),
+                step.limited / static_cast<double>(seconds),
+                step.errors / static_cast<double>(seconds), step.overflow,
+                percentile(step.latenciesMs, 0.5),
+                percentile(step.latenciesMs, 0.99), step.loopLagMs,
+                step.shedLevel);
+    std::fflush(stdout);
+    // Дать сервису разгрести очередь перед следующей ступенью
+    sleep(2);
+  }
+  return 0;
+}
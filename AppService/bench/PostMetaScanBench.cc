@@ -0,0 +1,69 @@
+// Бенчмарк пропускной способности скана PostMetaStore.
+// Запуск: ./post_meta_scan_bench [количество постов] [повторы]
+#include "services/PostMetaStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using services::PostMetaStore;
+
+int main(int argc, char **argv) {
+  size_t posts = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000000;
+  int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+
+  auto &store = PostMetaStore::instance();
+  store.reserve(posts);
+
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> authorDist(1, 1000000);
+  std::uniform_int_distribution<int> visDist(0, 9);
+  int64_t createdAt = 1700000000000;
+  for (size_t i = 1; i <= posts; ++i) {
+    createdAt += rng() % 50;
+    store.upsert(static_cast<int64_t>(i), authorDist(rng), createdAt,
+                 visDist(rng) == 0 ? PostMetaStore::kPrivate
+                                   : PostMetaStore::kPublic);
+  }
+
+  std::vector<int64_t> followed;
+  for (int i = 0; i < 300; ++i) {
+    followed.push_back(authorDist(rng));
+  }
+  std::sort(followed.begin(), followed.end());
+  followed.erase(std::unique(followed.begin(), followed.end()),
+                 followed.end());
+
+  std::printf("posts=%zu memory=%.1f MiB\n", store.size(),
+              store.memoryBytes() / (1024.0 * 1024.0));
+
+  auto run = [&](const char *name, const PostMetaStore::Filter &filter) {
+    size_t matched = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+      matched = store.count(filter);
+    }
+    auto elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count() /
+                   repeats;
+    std::printf("%-28s matched=%-10zu %8.2f ms  %8.1f Mrows/s\n", name,
+                matched, elapsed * 1e3, posts / elapsed / 1e6);
+  };
+
+  PostMetaStore::Filter publicNotMine;
+  publicNotMine.excludeAuthor = 12345;
+  run("public, not mine", publicNotMine);
+
+  PostMetaStore::Filter followedFilter = publicNotMine;
+  followedFilter.authorsIn = &followed;
+  run("public, followed", followedFilter);
+
+  PostMetaStore::Filter recent = publicNotMine;
+  recent.newerThanMs = createdAt - 3600 * 1000;
+  run("public, last hour", recent);
+
+  return 0;
+}
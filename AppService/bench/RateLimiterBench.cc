@@ -0,0 +1,157 @@
+// Накладные расходы RateLimiter::admit на запрос: поиск стоимости
+// маршрута, бакет пользователя и бакет IP (в сервисе они проверяются в
+// разных advice, здесь — одним вызовом). Сценарии:
+//   users    — запросы пользователей, 10 тысяч пользователей, лимит не
+//              достигается (обычный путь);
+//   ips      — анонимные запросы с миллиона адресов: ключей больше,
+//              чем слотов в таблице, простаивающие бакеты вытесняются;
+//   rejected — один клиент сверх лимита, каждый запрос получает 429;
+//   threads  — users из нескольких потоков, у каждого свои пользователи
+//              (только если ядер хватает).
+// Из времени вычитается проход, который лишь читает те же данные
+// запроса: в сервисе они уже в кэше после разбора запроса, а здесь
+// разбросаны по памяти бенча. Цель — меньше 200 нс на запрос.
+// Запуск: ./rate_limiter_bench [запросов на сценарий] [потоков]
+#include "services/RateLimiter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using services::RateLimiter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Sample {
+  std::string method;
+  std::string path;
+  int64_t userId;
+  uint64_t ipKey;
+};
+
+std::vector<Sample> makeSamples(size_t count, size_t users, bool withUsers,
+                                std::mt19937_64 &rng) {
+  static const std::pair<const char *, const char *> routes[] = {
+      {"GET", "/feed"},         {"GET", "/posts/123456"},
+      {"GET", "/posts/search"}, {"POST", "/posts/123456/like"},
+      {"GET", "/users/42"},     {"GET", "/feed/new"},
+      {"POST", "/posts"},       {"GET", "/posts/123456/comments"},
+  };
+  // Разным сценариям — разные пользователи
+  auto firstUser = static_cast<int64_t>(rng() >> 16);
+  std::vector<Sample> samples;
+  samples.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto user = rng() % users;
+    const auto &route = routes[rng() % 8];
+    samples.push_back({route.first, route.second,
+                       withUsers ? firstUser + static_cast<int64_t>(user)
+                                 : 0,
+                       RateLimiter::ipv4Key(static_cast<uint32_t>(
+                           0x0A000000 + user))});
+  }
+  return samples;
+}
+
+// Чтение тех же полей, что читает admit, без самого admit
+double touch(const std::vector<Sample> &samples) {
+  size_t sum = 0;
+  auto start = Clock::now();
+  for (const auto &sample : samples) {
+    sum += sample.method.size() + sample.path.back() + sample.ipKey +
+           sample.userId;
+  }
+  // Чтобы цикл не выбросил компилятор
+  if (sum == 42) {
+    std::puts("");
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() /
+         samples.size();
+}
+
+double run(RateLimiter &limiter, const std::vector<Sample> &samples,
+           size_t &rejected) {
+  auto start = Clock::now();
+  for (const auto &sample : samples) {
+    RateLimiter::Request request;
+    request.method = sample.method;
+    request.path = sample.path;
+    request.userId = sample.userId;
+    request.ipKey = sample.ipKey;
+    rejected += !limiter.admit(request).allowed;
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() /
+         samples.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+  unsigned threads =
+      argc > 2 ? std::atoi(argv[2])
+               : std::min(4u, std::thread::hardware_concurrency());
+
+  RateLimiter::Config config;
+  config.user = {1000, 2000};
+  config.ip = {1000, 2000};
+  config.maxBuckets = 262144;
+  config.routes = {{"GET", "/posts/search", 10}, {"POST", "/posts/*/like", 3},
+                   {"DELETE", "/posts/*/like", 3}, {"POST", "/posts", 5},
+                   {"POST", "/media/upload", 5},   {"POST", "/batch", 5},
+                   {"GET", "/feed/stream", 5},     {"GET", "/metrics", 0}};
+  auto &limiter = RateLimiter::instance();
+  limiter.configure(config);
+
+  std::mt19937_64 rng(1);
+  auto users = makeSamples(requests, 10000, true, rng);
+  auto ips = makeSamples(requests, 1000000, false, rng);
+  auto flood = makeSamples(requests, 1, true, rng);
+  std::vector<std::vector<Sample>> perThreadSamples;
+  for (unsigned t = 0; t < threads; ++t) {
+    perThreadSamples.push_back(makeSamples(requests, 10000, true, rng));
+  }
+
+  auto report = [&](const char *name, const std::vector<Sample> &samples) {
+    size_t rejected = 0;
+    auto ns = run(limiter, samples, rejected);
+    auto base = touch(samples);
+    std::printf("%-8s %6.1f ns/request (%6.1f raw - %5.1f data)  "
+                "rejected %zu\n",
+                name, ns - base, ns, base, rejected);
+  };
+  size_t warmup = 0;
+  run(limiter, users, warmup);
+  report("users", users);
+  report("ips", ips);
+  report("rejected", flood);
+
+  if (threads < 2) {
+    return 0;
+  }
+  std::vector<std::thread> workers;
+  std::vector<double> perThread(threads);
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      size_t ignored = 0;
+      perThread[t] = run(limiter, perThreadSamples[t], ignored);
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  double worst = 0;
+  for (unsigned t = 0; t < threads; ++t) {
+    worst = std::max(worst, perThread[t] - touch(perThreadSamples[t]));
+  }
+  std::printf("threads  %6.1f ns/request  (%u threads, slowest)\n", worst,
+              threads);
+  return 0;
+}
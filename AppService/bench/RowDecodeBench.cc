@@ -0,0 +1,152 @@
+// Разбор строк постов из результата libpq: поиск колонки по имени на
+// каждое поле (как row["text"].as<std::string>() в Drogon) против
+// RowDecoder, который сопоставляет колонки один раз на результат.
+// Результат собирается в памяти, база не нужна.
+// Запуск: ./row_decode_bench [строк] [повторы]
+#include "storage/Rows.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <libpq-fe.h>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using storage::Post;
+using storage::PostView;
+using storage::RowDecoder;
+
+namespace {
+
+// Колонки ленты: как в PgPostRepository::feed, с лишней колонкой
+// сортировки
+const char *const kColumns[] = {"id",         "author_user_id",
+                                "text",       "visibility",
+                                "created_at", "updated_at",
+                                "follow_priority"};
+constexpr int kColumnCount = sizeof(kColumns) / sizeof(kColumns[0]);
+
+PGresult *makeResult(int rows) {
+  PGresult *result = PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK);
+  PGresAttDesc attributes[kColumnCount] = {};
+  for (int i = 0; i < kColumnCount; ++i) {
+    attributes[i].name = const_cast<char *>(kColumns[i]);
+    attributes[i].typlen = -1;
+    attributes[i].atttypmod = -1;
+  }
+  PQsetResultAttrs(result, kColumnCount, attributes);
+
+  std::string text =
+      "Короткий пост средней длины: пара предложений про погоду, "
+      "ссылка и немного эмодзи, как в типичной ленте.";
+  for (int row = 0; row < rows; ++row) {
+    std::string values[kColumnCount] = {
+        std::to_string(1000000 + row),
+        std::to_string(1 + row % 10000),
+        text,
+        row % 10 == 0 ? "private" : "public",
+        "2026-01-31 12:00:00.123456",
+        "2026-01-31 12:00:00.123456",
+        std::to_string(row % 2)};
+    for (int i = 0; i < kColumnCount; ++i) {
+      PQsetvalue(result, row, i, values[i].data(),
+                 static_cast<int>(values[i].size()));
+    }
+  }
+  return result;
+}
+
+std::string textByName(const PGresult *result, int row, const char *name) {
+  int column = PQfnumber(result, name);
+  return std::string(PQgetvalue(result, row, column),
+                     PQgetlength(result, row, column));
+}
+
+int64_t int64ByName(const PGresult *result, int row, const char *name) {
+  return std::stoll(textByName(result, row, name));
+}
+
+Post postByName(const PGresult *result, int row) {
+  Post post;
+  post.id = int64ByName(result, row, "id");
+  post.authorUserId = int64ByName(result, row, "author_user_id");
+  post.text = textByName(result, row, "text");
+  post.visibility = textByName(result, row, "visibility");
+  post.createdAt = textByName(result, row, "created_at");
+  post.updatedAt = textByName(result, row, "updated_at");
+  return post;
+}
+
+template <typename Row> RowDecoder<Row> decoderFor(const PGresult *result) {
+  return RowDecoder<Row>(PQnfields(result), [result](size_t i) {
+    return std::string_view(PQfname(result, static_cast<int>(i)));
+  });
+}
+
+template <typename Row>
+Row decodeRow(const RowDecoder<Row> &decoder, const PGresult *result,
+              int row) {
+  return decoder.decode([result, row](int i)
+                            -> std::optional<std::string_view> {
+    if (PQgetisnull(result, row, i)) {
+      return std::nullopt;
+    }
+    return std::string_view(PQgetvalue(result, row, i),
+                            PQgetlength(result, row, i));
+  });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int rows = argc > 1 ? std::atoi(argv[1]) : 100000;
+  int repeats = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  PGresult *result = makeResult(rows);
+
+  auto run = [&](const char *name, auto &&decodeAll) {
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+      checksum += decodeAll();
+    }
+    auto elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count() /
+                   repeats;
+    std::printf("%-24s %8.1f ns/row  %8.2f ms/result  (checksum %zu)\n",
+                name, elapsed * 1e9 / rows, elapsed * 1e3, checksum);
+  };
+
+  run("by name, std::string", [&] {
+    size_t sum = 0;
+    for (int row = 0; row < rows; ++row) {
+      auto post = postByName(result, row);
+      sum += post.id + post.text.size();
+    }
+    return sum;
+  });
+
+  run("positional, std::string", [&] {
+    size_t sum = 0;
+    auto decoder = decoderFor<Post>(result);
+    for (int row = 0; row < rows; ++row) {
+      auto post = decodeRow(decoder, result, row);
+      sum += post.id + post.text.size();
+    }
+    return sum;
+  });
+
+  run("positional, string_view", [&] {
+    size_t sum = 0;
+    auto decoder = decoderFor<PostView>(result);
+    for (int row = 0; row < rows; ++row) {
+      auto post = decodeRow(decoder, result, row);
+      sum += post.id + post.text.size();
+    }
+    return sum;
+  });
+
+  PQclear(result);
+  return 0;
+}
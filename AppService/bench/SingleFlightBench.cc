@@ -0,0 +1,70 @@
+// Thundering herd: N одновременных запросов одного ключа при медленной
+// загрузке. Сравнивает число реальных загрузок и задержку с/без склейки.
+// Запуск: ./single_flight_bench [потоков] [задержка загрузки, мс]
+#include "services/Metrics.h"
+#include "services/SingleFlight.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char **argv) {
+  int clients = argc > 1 ? std::atoi(argv[1]) : 1000;
+  int loadMs = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  // Имитация БД с ограниченным пулом соединений: загрузки
+  // выполняются по одной, как при number_of_connections = 1
+  std::mutex dbConnection;
+  std::atomic<int> loads{0};
+  auto load = [&]() {
+    std::lock_guard lock(dbConnection);
+    loads.fetch_add(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(loadMs));
+    return 42;
+  };
+
+  auto runHerd = [&](const char *name, bool coalesce) {
+    services::SingleFlight<int> flight("bench");
+    loads = 0;
+    std::vector<double> latencies(clients);
+    std::vector<std::thread> threads;
+    std::atomic<bool> go{false};
+
+    for (int i = 0; i < clients; ++i) {
+      threads.emplace_back([&, i]() {
+        while (!go.load()) {
+          std::this_thread::yield();
+        }
+        auto start = Clock::now();
+        if (coalesce) {
+          flight.run("post:1", std::chrono::seconds(60), load);
+        } else {
+          load();
+        }
+        latencies[i] =
+            std::chrono::duration<double, std::milli>(Clock::now() - start)
+                .count();
+      });
+    }
+    go = true;
+    for (auto &t : threads) {
+      t.join();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%-14s loads=%-5d p50=%8.1f ms  p99=%8.1f ms  max=%8.1f ms\n",
+                name, loads.load(), latencies[clients / 2],
+                latencies[clients * 99 / 100], latencies.back());
+  };
+
+  std::printf("clients=%d load=%d ms\n", clients, loadMs);
+  runHerd("no coalescing", false);
+  runHerd("single-flight", true);
+  return 0;
+}
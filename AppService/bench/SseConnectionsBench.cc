@@ -0,0 +1,250 @@
+// Память сервиса на одно открытое GET /feed/stream. Открывает N
+// SSE-соединений, дожидается "retry:" в каждом и сравнивает VmRSS
+// процесса сервиса до и после; затем держит соединения hold секунд
+// (пинги продолжают читаться) и закрывает их.
+//
+// Для IPv4 loopback исходные адреса перебираются по 127.0.0.1..254:
+// на один адрес — не больше ~28 тысяч эфемерных портов. Нужны
+// ulimit -n на N с запасом и у бенча, и у сервиса.
+// Запуск: TOKEN=<jwt> ./sse_connections_bench <ipv4> <port> <pid сервиса>
+//         [соединений] [hold, секунд] [одновременных подключений]
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kPerSourceAddress = 25000;
+
+enum class State { Idle, Connecting, Reading, Open, Failed };
+
+struct Connection {
+  int fd = -1;
+  State state = State::Idle;
+  std::string head;
+};
+
+long rssKb(int pid) {
+  std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmRSS:", 0) == 0) {
+      return std::strtol(line.c_str() + 6, nullptr, 10);
+    }
+  }
+  return -1;
+}
+
+void raiseFileLimit(size_t connections) {
+  rlimit limit{};
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  if (limit.rlim_cur < connections + 16) {
+    std::fprintf(stderr, "warning: RLIMIT_NOFILE %llu < %zu connections\n",
+                 static_cast<unsigned long long>(limit.rlim_cur),
+                 connections);
+  }
+}
+
+// Неблокирующий connect; false — ошибка сразу
+bool startConnect(Connection &conn, const sockaddr_in &server, size_t index,
+                  bool loopback) {
+  conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (conn.fd < 0) {
+    return false;
+  }
+  if (loopback) {
+    sockaddr_in source{};
+    source.sin_family = AF_INET;
+    source.sin_addr.s_addr =
+        htonl((127u << 24) | (1 + index / kPerSourceAddress % 254));
+    if (bind(conn.fd, reinterpret_cast<const sockaddr *>(&source),
+             sizeof(source)) != 0) {
+      return false;
+    }
+  }
+  if (connect(conn.fd, reinterpret_cast<const sockaddr *>(&server),
+              sizeof(server)) != 0 &&
+      errno != EINPROGRESS) {
+    return false;
+  }
+  conn.state = State::Connecting;
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 4 || !std::getenv("TOKEN")) {
+    std::fprintf(stderr,
+                 "usage: TOKEN=<jwt> %s <ipv4> <port> <server pid> "
+                 "[connections] [hold seconds] [concurrent connects]\n",
+                 argv[0]);
+    return 1;
+  }
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(static_cast<uint16_t>(std::atoi(argv[2])));
+  if (inet_pton(AF_INET, argv[1], &server.sin_addr) != 1) {
+    std::fprintf(stderr, "bad IPv4 address: %s\n", argv[1]);
+    return 1;
+  }
+  int pid = std::atoi(argv[3]);
+  size_t total = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 10000;
+  int holdSeconds = argc > 5 ? std::atoi(argv[5]) : 0;
+  size_t concurrency = argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 256;
+  bool loopback = (ntohl(server.sin_addr.s_addr) >> 24) == 127;
+
+  std::string request = std::string("GET /feed/stream HTTP/1.1\r\nHost: ") +
+                        argv[1] + "\r\nAccept: text/event-stream\r\n" +
+                        "Authorization: Bearer " + std::getenv("TOKEN") +
+                        "\r\n\r\n";
+
+  raiseFileLimit(total);
+  long before = rssKb(pid);
+  if (before < 0) {
+    std::fprintf(stderr, "cannot read /proc/%d/status\n", pid);
+    return 1;
+  }
+
+  int epoll = epoll_create1(0);
+  std::vector<Connection> conns(total);
+  std::vector<epoll_event> events(1024);
+  size_t next = 0, inFlight = 0, open = 0, failed = 0;
+  char buffer[4096];
+
+  auto fail = [&](Connection &conn) {
+    if (conn.fd >= 0) {
+      close(conn.fd);
+      conn.fd = -1;
+    }
+    conn.state = State::Failed;
+    conn.head.clear();
+    conn.head.shrink_to_fit();
+    --inFlight;
+    ++failed;
+  };
+
+  auto started = Clock::now();
+  // Подключение и ожидание первого события; дальше — только чтение пингов
+  auto pump = [&](int timeoutMs) {
+    int ready = epoll_wait(epoll, events.data(),
+                           static_cast<int>(events.size()), timeoutMs);
+    for (int i = 0; i < ready; ++i) {
+      auto &conn = conns[events[i].data.u32];
+      if (conn.state == State::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0 || send(conn.fd, request.data(), request.size(),
+                               MSG_NOSIGNAL) !=
+                              static_cast<ssize_t>(request.size())) {
+          fail(conn);
+          continue;
+        }
+        conn.state = State::Reading;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = events[i].data.u32;
+        epoll_ctl(epoll, EPOLL_CTL_MOD, conn.fd, &event);
+        continue;
+      }
+      ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        if (conn.state == State::Open) {
+          close(conn.fd);
+          conn.fd = -1;
+          conn.state = State::Failed;
+          --open;
+          ++failed;
+        } else {
+          fail(conn);
+        }
+        continue;
+      }
+      if (conn.state != State::Reading) {
+        continue;
+      }
+      conn.head.append(buffer, static_cast<size_t>(n));
+      if (conn.head.rfind("HTTP/1.1 200", 0) != 0 &&
+          conn.head.size() >= 12) {
+        fail(conn);
+      } else if (conn.head.find("retry:") != std::string::npos) {
+        conn.state = State::Open;
+        conn.head.clear();
+        conn.head.shrink_to_fit();
+        --inFlight;
+        ++open;
+      }
+    }
+  };
+
+  while (open + failed < total) {
+    while (next < total && inFlight < concurrency) {
+      auto &conn = conns[next];
+      if (!startConnect(conn, server, next, loopback)) {
+        ++inFlight;
+        fail(conn);
+      } else {
+        epoll_event event{};
+        event.events = EPOLLOUT;
+        event.data.u32 = static_cast<uint32_t>(next);
+        epoll_ctl(epoll, EPOLL_CTL_ADD, conn.fd, &event);
+        ++inFlight;
+      }
+      ++next;
+    }
+    pump(100);
+  }
+  double connectSeconds =
+      std::chrono::duration<double>(Clock::now() - started).count();
+
+  // Сервис дописывает буферы и метрики не мгновенно
+  for (int i = 0; i < 20; ++i) {
+    pump(100);
+  }
+  long after = rssKb(pid);
+
+  std::printf("connections: %zu open, %zu failed in %.1fs\n", open, failed,
+              connectSeconds);
+  std::printf("server RSS: %ld KiB -> %ld KiB\n", before, after);
+  if (open > 0) {
+    std::printf("per connection: %.0f bytes\n",
+                static_cast<double>(after - before) * 1024 / open);
+  }
+
+  auto holdUntil = Clock::now() + std::chrono::seconds(holdSeconds);
+  while (Clock::now() < holdUntil) {
+    pump(1000);
+  }
+  if (holdSeconds > 0) {
+    std::printf("after %ds hold: %zu open, server RSS %ld KiB\n", holdSeconds,
+                open, rssKb(pid));
+  }
+
+  for (auto &conn : conns) {
+    if (conn.fd >= 0) {
+      close(conn.fd);
+    }
+  }
+  close(epoll);
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+  std::printf("after close: server RSS %ld KiB\n", rssKb(pid));
+  return 0;
+}
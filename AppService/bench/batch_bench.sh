@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+# Задержка набора GET-запросов «домашнего экрана» при большом RTT:
+#   sequential — по одному через одно keep-alive соединение (N × RTT);
+#   parallel   — все сразу, каждый в своём соединении (curl --parallel);
+#   batch      — один POST /batch.
+#
+# RTT эмулируется netem на loopback (нужен root и локальный сервис):
+#   sudo TOKEN=<jwt> RTT_MS=100 bash bench/batch_bench.sh <user_id> [раундов]
+# Без RTT_MS замеряется как есть (например, до удалённого BASE_URL).
+set -euo pipefail
+
+BASE_URL="${BASE_URL:-http://localhost:3001}"
+USER_ID="${1:?user id is required}"
+ROUNDS="${2:-20}"
+RTT_MS="${RTT_MS:-0}"
+TOKEN="${TOKEN:?TOKEN with a valid JWT is required}"
+
+paths=(
+  "/feed?limit=20"
+  "/users/${USER_ID}"
+  "/users/${USER_ID}/followers"
+  "/users/${USER_ID}/following"
+  "/users/${USER_ID}/profile-page"
+)
+
+workdir=$(mktemp -d)
+cleanup() {
+  if [ "${RTT_MS}" != "0" ]; then
+    tc qdisc del dev lo root 2>/dev/null || true
+  fi
+  rm -rf "${workdir}"
+}
+trap cleanup EXIT
+
+if [ "${RTT_MS}" != "0" ]; then
+  # Задержка в обе стороны: половина RTT на каждый пакет
+  tc qdisc add dev lo root netem delay "$((RTT_MS / 2))ms"
+fi
+
+urls=()
+items=()
+for path in "${paths[@]}"; do
+  urls+=("${BASE_URL}${path}")
+  items+=("{\"method\":\"GET\",\"path\":\"${path}\"}")
+done
+batch="{\"requests\":[$(IFS=,; echo "${items[*]}")]}"
+
+load_sequential() {
+  curl -sf -H "Authorization: Bearer ${TOKEN}" "${urls[@]}" > /dev/null
+}
+
+load_parallel() {
+  curl -sf --no-progress-meter --parallel --parallel-immediate \
+    -H "Authorization: Bearer ${TOKEN}" "${urls[@]}" > /dev/null
+}
+
+load_batch() {
+  curl -sf -o /dev/null -H "Authorization: Bearer ${TOKEN}" \
+    -H 'Content-Type: application/json' -d "${batch}" "${BASE_URL}/batch"
+}
+
+run() {
+  local name=$1 timings="${workdir}/${1}.txt"
+  : > "${timings}"
+  for _ in $(seq 1 "${ROUNDS}"); do
+    local start end
+    start=$(date +%s%N)
+    "load_${name}"
+    end=$(date +%s%N)
+    echo $(((end - start) / 1000)) >> "${timings}"
+  done
+  sort -n "${timings}" -o "${timings}"
+  local p50 p95
+  p50=$(sed -n "$(((ROUNDS + 1) / 2))p" "${timings}")
+  p95=$(sed -n "$(((ROUNDS * 95 + 99) / 100))p" "${timings}")
+  awk -v name="${name}" -v p50="${p50}" -v p95="${p95}" \
+    'BEGIN { printf "%-10s p50=%7.1fms p95=%7.1fms\n", name, p50 / 1000, p95 / 1000 }'
+}
+
+echo "${#paths[@]} GETs, RTT ${RTT_MS}ms, ${ROUNDS} rounds, ${BASE_URL}"
+# Прогрев кэшей
+load_batch
+run sequential
+run parallel
+run batch
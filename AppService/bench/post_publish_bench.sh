@@ -0,0 +1,99 @@
+#!/usr/bin/env bash
+# Публикация поста с 10 фотографиями: старая схема (POST /posts, затем
+# на каждое фото /media/upload и /posts/{id}/attach — 21 запрос подряд)
+# против новой (один /media/upload со всеми файлами и POST /posts с
+# attachments — 2 запроса). Печатает число запросов и задержку
+# публикации p50/p95 по раундам.
+#
+#   TOKEN=<jwt> bash bench/post_publish_bench.sh [раундов] [фото] [размер, KB]
+set -euo pipefail
+
+BASE_URL="${BASE_URL:-http://localhost:3001}"
+ROUNDS="${1:-20}"
+PHOTOS="${2:-10}"
+SIZE_KB="${3:-200}"
+TOKEN="${TOKEN:?TOKEN with a valid JWT is required}"
+
+workdir=$(mktemp -d)
+trap 'rm -rf "${workdir}"' EXIT
+
+# Сигнатура JPEG, дальше — случайные данные: каждый файл уникален,
+# дедупликация не срабатывает
+make_photos() {
+  for i in $(seq 1 "${PHOTOS}"); do
+    local file="${workdir}/photo_${i}.jpg"
+    printf '\xff\xd8\xff\xe0' > "${file}"
+    head -c $((SIZE_KB * 1024 - 4)) /dev/urandom >> "${file}"
+  done
+}
+
+# curl с подсчётом запросов (через файл: call часто идёт в $(...));
+# тело ответа — в stdout
+call() {
+  echo >> "${workdir}/requests"
+  curl -sf -H "Authorization: Bearer ${TOKEN}" "$@"
+}
+
+# Поля ответа без внешних процессов, чтобы не мерить запуск парсера
+json_field() {
+  local pattern="\"$1\" *: *\"?([^\",}]+)"
+  [[ $2 =~ $pattern ]] && echo "${BASH_REMATCH[1]}"
+}
+
+publish_legacy() {
+  local post_id response
+  response=$(call -H 'Content-Type: application/json' \
+    -d '{"content":"bench legacy"}' "${BASE_URL}/posts")
+  post_id=$(json_field id "${response}")
+  for i in $(seq 1 "${PHOTOS}"); do
+    local path
+    response=$(call -F "file=@${workdir}/photo_${i}.jpg" \
+      "${BASE_URL}/media/upload")
+    path=$(json_field file_path "${response}")
+    call -o /dev/null -H 'Content-Type: application/json' \
+      -d "{\"file_path\":\"${path}\",\"type\":\"photo\"}" \
+      "${BASE_URL}/posts/${post_id}/attach"
+  done
+}
+
+publish_batched() {
+  local form=() response attachments="" files path
+  for i in $(seq 1 "${PHOTOS}"); do
+    form+=(-F "file=@${workdir}/photo_${i}.jpg")
+  done
+  response=$(call "${form[@]}" "${BASE_URL}/media/upload")
+  # Пути из массива files, по порядку
+  files=${response#*\"files\"}
+  while path=$(json_field file_path "${files}"); do
+    attachments+="${attachments:+,}{\"file_path\":\"${path}\",\"type\":\"photo\"}"
+    files=${files#*\"file_path\"*\"${path}\"}
+  done
+  call -o /dev/null -H 'Content-Type: application/json' \
+    -d "{\"content\":\"bench batched\",\"attachments\":[${attachments}]}" \
+    "${BASE_URL}/posts"
+}
+
+run() {
+  local name=$1 timings="${workdir}/${1}.txt"
+  : > "${workdir}/requests"
+  : > "${timings}"
+  for _ in $(seq 1 "${ROUNDS}"); do
+    make_photos
+    local start end
+    start=$(date +%s%N)
+    "publish_${name}"
+    end=$(date +%s%N)
+    echo $(((end - start) / 1000000)) >> "${timings}"
+  done
+  sort -n "${timings}" -o "${timings}"
+  local p50 p95 requests
+  requests=$(wc -l < "${workdir}/requests")
+  p50=$(sed -n "$(((ROUNDS + 1) / 2))p" "${timings}")
+  p95=$(sed -n "$(((ROUNDS * 95 + 99) / 100))p" "${timings}")
+  printf "%-8s requests/post=%-3d p50=%sms p95=%sms\n" "${name}" \
+    $((requests / ROUNDS)) "${p50}" "${p95}"
+}
+
+echo "${ROUNDS} posts x ${PHOTOS} photos x ${SIZE_KB} KB, ${BASE_URL}"
+run legacy
+run batched
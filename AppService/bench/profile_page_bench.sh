@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+# Загрузка страницы профиля: три параллельных запроса, как раньше делал
+# фронтенд (/users/{id}, /users/{id}/posts, /users/{id}/followers),
+# против одного /users/{id}/profile-page. Время страницы — до последнего
+# ответа; печатает p50/p95 и объём ответов.
+#
+#   TOKEN=<jwt> bash bench/profile_page_bench.sh <user_id> [раундов]
+set -euo pipefail
+
+BASE_URL="${BASE_URL:-http://localhost:3001}"
+USER_ID="${1:?user id is required}"
+ROUNDS="${2:-50}"
+TOKEN="${TOKEN:?TOKEN with a valid JWT is required}"
+
+workdir=$(mktemp -d)
+trap 'rm -rf "${workdir}"' EXIT
+
+fetch() {
+  curl -sf -o /dev/null -w "%{size_download}\n" \
+    -H "Authorization: Bearer ${TOKEN}" "${BASE_URL}$1"
+}
+
+load_three_calls() {
+  fetch "/users/${USER_ID}" > "${workdir}/b1" &
+  fetch "/users/${USER_ID}/posts" > "${workdir}/b2" &
+  fetch "/users/${USER_ID}/followers" > "${workdir}/b3" &
+  wait
+  echo $(($(< "${workdir}/b1") + $(< "${workdir}/b2") + $(< "${workdir}/b3")))
+}
+
+load_profile_page() {
+  fetch "/users/${USER_ID}/profile-page"
+}
+
+run() {
+  local name=$1 timings="${workdir}/${1}.txt" bytes=0
+  : > "${timings}"
+  for _ in $(seq 1 "${ROUNDS}"); do
+    local start end
+    start=$(date +%s%N)
+    bytes=$("load_${name}")
+    end=$(date +%s%N)
+    echo $(((end - start) / 1000)) >> "${timings}"
+  done
+  sort -n "${timings}" -o "${timings}"
+  local p50 p95
+  p50=$(sed -n "$(((ROUNDS + 1) / 2))p" "${timings}")
+  p95=$(sed -n "$(((ROUNDS * 95 + 99) / 100))p" "${timings}")
+  awk -v name="${name}" -v p50="${p50}" -v p95="${p95}" -v bytes="${bytes}" \
+    'BEGIN { printf "%-13s p50=%6.1fms p95=%6.1fms bytes=%s\n", name, p50 / 1000, p95 / 1000, bytes }'
+}
+
+echo "user ${USER_ID}, ${ROUNDS} page loads, ${BASE_URL}"
+# Прогрев кэшей профилей и пула соединений
+load_profile_page > /dev/null
+run three_calls
+run profile_page
@@ -0,0 +1,44 @@
+#!/usr/bin/env bash
+# Параллельные загрузки 20 MB видео в /media/upload: пропускная способность
+# и пиковый RSS процесса app_service (VmHWM).
+#
+#   TOKEN=<jwt> bash bench/upload_bench.sh [параллельных загрузок] [размер, MB]
+set -euo pipefail
+
+BASE_URL="${BASE_URL:-http://localhost:3001}"
+CLIENTS="${1:-16}"
+SIZE_MB="${2:-20}"
+TOKEN="${TOKEN:?TOKEN with a valid JWT is required}"
+
+workdir=$(mktemp -d)
+trap 'rm -rf "${workdir}"' EXIT
+
+# Минимальная сигнатура mp4 (атом ftyp), дальше — случайные данные
+file="${workdir}/bench.mp4"
+printf '\x00\x00\x00\x18ftypmp42' > "${file}"
+head -c $((SIZE_MB * 1024 * 1024 - 12)) /dev/urandom >> "${file}"
+
+pid=$(pgrep -x app_service | head -n1 || true)
+
+start=$(date +%s.%N)
+for i in $(seq 1 "${CLIENTS}"); do
+  curl -s -o "${workdir}/resp_${i}" -w "%{http_code}\n" \
+    -H "Authorization: Bearer ${TOKEN}" \
+    -F "file=@${file};filename=bench_${i}.mp4" \
+    "${BASE_URL}/media/upload" > "${workdir}/status_${i}" &
+done
+wait
+end=$(date +%s.%N)
+
+ok=$(cat "${workdir}"/status_* | grep -c '^201$' || true)
+elapsed=$(echo "${end} - ${start}" | bc -l)
+total_mb=$((CLIENTS * SIZE_MB))
+
+echo "uploads: ${ok}/${CLIENTS} succeeded"
+printf "elapsed: %.2f s, throughput: %.1f MB/s\n" "${elapsed}" \
+  "$(echo "${total_mb} / ${elapsed}" | bc -l)"
+if [ -n "${pid}" ]; then
+  grep -E 'VmHWM|VmRSS' "/proc/${pid}/status"
+else
+  echo "app_service process not found locally, RSS not measured"
+fi
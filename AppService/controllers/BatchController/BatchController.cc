@@ -0,0 +1,328 @@
+#include "BatchController.h"
+#include "services/Metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <json/value.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace api;
+
+namespace {
+
+struct Limits {
+  size_t maxRequests = 20;
+  size_t maxBodyBytes = 256 * 1024;
+  size_t maxResponseBytes = 4 << 20;
+  double timeoutSeconds = 5;
+};
+
+const Limits &limits() {
+  static const Limits loaded = []() {
+    auto config = drogon::app().getCustomConfig()["batch"];
+    Limits limits;
+    limits.maxRequests = config.get("max_requests", 20).asUInt64();
+    limits.maxBodyBytes = config.get("max_body_bytes", 262144).asUInt64();
+    limits.maxResponseBytes =
+        config.get("max_response_bytes", 4194304).asUInt64();
+    limits.timeoutSeconds = config.get("timeout_ms", 5000).asDouble() / 1000;
+    return limits;
+  }();
+  return loaded;
+}
+
+HttpResponsePtr batchError(const std::string &message, HttpStatusCode code) {
+  Json::Value response;
+  response["error"] = message;
+  auto resp = HttpResponse::newHttpJsonResponse(response);
+  resp->setStatusCode(code);
+  return resp;
+}
+
+Json::Value subResult(int status, const std::string &error) {
+  Json::Value result;
+  result["status"] = status;
+  result["body"]["error"] = error;
+  return result;
+}
+
+bool parseMethod(const std::string &name, HttpMethod &method) {
+  if (name == "GET") {
+    method = Get;
+  } else if (name == "POST") {
+    method = Post;
+  } else if (name == "PUT") {
+    method = Put;
+  } else if (name == "PATCH") {
+    method = Patch;
+  } else if (name == "DELETE") {
+    method = Delete;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Подзапрос из элемента "requests"; пустая строка — успех, иначе ошибка
+std::string buildRequest(const Json::Value &item, int64_t userId,
+                         const std::string &authorization,
+                         HttpRequestPtr &request) {
+  if (!item.isObject() || !item["path"].isString()) {
+    return "Each request needs a path";
+  }
+  HttpMethod method;
+  if (!parseMethod(item.get("method", "GET").asString(), method)) {
+    return "Unsupported method";
+  }
+
+  auto target = item["path"].asString();
+  auto query = target.find('?');
+  auto path = target.substr(0, query);
+  if (path.empty() || path.front() != '/') {
+    return "Path must start with /";
+  }
+  if (path == "/batch" || path.rfind("/batch/", 0) == 0) {
+    return "Nested batch requests are not allowed";
+  }
+
+  const auto &body = item["body"];
+  request = body.isNull() || body.isString()
+                ? HttpRequest::newHttpRequest()
+                : HttpRequest::newHttpJsonRequest(body);
+  if (body.isString()) {
+    request->setBody(body.asString());
+  }
+  request->setMethod(method);
+  request->setPath(path);
+  if (query != std::string::npos) {
+    auto params = target.substr(query + 1);
+    size_t start = 0;
+    while (start <= params.size()) {
+      auto end = params.find('&', start);
+      if (end == std::string::npos) {
+        end = params.size();
+      }
+      auto pair = params.substr(start, end - start);
+      if (!pair.empty()) {
+        auto eq = pair.find('=');
+        request->setParameter(
+            drogon::utils::urlDecode(pair.substr(0, eq)),
+            eq == std::string::npos
+                ? ""
+                : drogon::utils::urlDecode(pair.substr(eq + 1)));
+      }
+      start = end + 1;
+    }
+  }
+
+  // Токен уже проверен AuthFilter'ом для /batch: подзапросы несут
+  // user_id в атрибутах, и фильтр их пропускает без повторной проверки.
+  // Заголовок остаётся для обработчиков, которые читают его сами
+  request->addHeader("Authorization", authorization);
+  request->attributes()->insert("user_id", userId);
+  return "";
+}
+
+// Выполнение одного /batch. Колбэки подзапросов приходят из разных
+// IO-потоков, поэтому всё состояние под mutex
+class Batch : public std::enable_shared_from_this<Batch> {
+public:
+  Batch(std::vector<HttpRequestPtr> requests, Json::Value results,
+        std::function<void(const HttpResponsePtr &)> &&callback)
+      : requests_(std::move(requests)), results_(std::move(results)),
+        callback_(std::move(callback)) {}
+
+  void start(double timeoutSeconds) {
+    std::weak_ptr<Batch> weak = shared_from_this();
+    trantor::EventLoop::getEventLoopOfCurrentThread()->runAfter(
+        timeoutSeconds, [weak]() {
+          if (auto self = weak.lock()) {
+            self->expire();
+          }
+        });
+    HttpResponsePtr reply;
+    {
+      std::lock_guard lock(mutex_);
+      reply = dispatch();
+    }
+    if (reply) {
+      callback_(reply);
+    }
+  }
+
+private:
+  // Запускает следующую группу: подряд идущие GET или один запрос
+  // с другим методом. Вызывается под mutex_; возвращает готовый ответ,
+  // если запускать больше нечего
+  HttpResponsePtr dispatch() {
+    if (done_ || running_ > 0) {
+      return nullptr;
+    }
+    while (next_ < requests_.size() && !requests_[next_]) {
+      ++next_;
+    }
+    if (next_ == requests_.size()) {
+      return finish();
+    }
+
+    bool reads = requests_[next_]->method() == Get;
+    do {
+      if (requests_[next_]) {
+        launch(next_);
+      }
+      ++next_;
+    } while (reads && next_ < requests_.size() &&
+             (!requests_[next_] || requests_[next_]->method() == Get));
+    return nullptr;
+  }
+
+  void launch(size_t index) {
+    static std::atomic<size_t> roundRobin{0};
+    static auto &subrequests = services::Metrics::instance().counter(
+        "batch_subrequests_total", "Sub-requests dispatched by POST /batch");
+    subrequests.fetch_add(1, std::memory_order_relaxed);
+
+    ++running_;
+    auto self = shared_from_this();
+    auto loop = drogon::app().getIOLoop(
+        roundRobin.fetch_add(1, std::memory_order_relaxed) %
+        drogon::app().getThreadNum());
+    loop->queueInLoop([self, index]() {
+      drogon::app().forward(self->requests_[index],
+                            [self, index](const HttpResponsePtr &resp) {
+                              self->complete(index, resp);
+                            });
+    });
+  }
+
+  void complete(size_t index, const HttpResponsePtr &resp) {
+    HttpResponsePtr reply;
+    {
+      std::lock_guard lock(mutex_);
+      if (done_) {
+        return;
+      }
+      --running_;
+
+      Json::Value result;
+      result["status"] = static_cast<int>(resp->getStatusCode());
+      auto json = resp->getJsonObject();
+      std::string body(resp->getBody());
+      responseBytes_ += body.size();
+      if (responseBytes_ > limits().maxResponseBytes) {
+        result = subResult(k413RequestEntityTooLarge,
+                           "Batch response size budget exceeded");
+      } else if (json) {
+        result["body"] = *json;
+      } else if (!body.empty()) {
+        result["body"] = body;
+      }
+      results_[static_cast<Json::ArrayIndex>(index)] = result;
+      reply = dispatch();
+    }
+    if (reply) {
+      callback_(reply);
+    }
+  }
+
+  // Бюджет времени исчерпан: незавершённые и не начатые подзапросы
+  // получают 504, поздние ответы игнорируются
+  void expire() {
+    static auto &timeouts = services::Metrics::instance().counter(
+        "batch_timeouts_total", "POST /batch requests cut by the time budget");
+    HttpResponsePtr reply;
+    {
+      std::lock_guard lock(mutex_);
+      if (done_) {
+        return;
+      }
+      timeouts.fetch_add(1, std::memory_order_relaxed);
+      for (auto &result : results_) {
+        if (result.isNull()) {
+          result = subResult(k504GatewayTimeout,
+                             "Batch time budget exceeded");
+        }
+      }
+      reply = finish();
+    }
+    callback_(reply);
+  }
+
+  HttpResponsePtr finish() {
+    done_ = true;
+    Json::Value response;
+    response["responses"] = results_;
+    return HttpResponse::newHttpJsonResponse(response);
+  }
+
+  std::mutex mutex_;
+  std::vector<HttpRequestPtr> requests_;
+  // null — ещё нет ответа
+  Json::Value results_;
+  std::function<void(const HttpResponsePtr &)> callback_;
+  size_t next_ = 0;
+  size_t running_ = 0;
+  size_t responseBytes_ = 0;
+  bool done_ = false;
+};
+
+} // namespace
+
+void BatchController::batch(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback) const {
+
+  static auto &batches = services::Metrics::instance().counter(
+      "batch_requests_total", "POST /batch requests");
+  batches.fetch_add(1, std::memory_order_relaxed);
+
+  if (req->body().size() > limits().maxBodyBytes) {
+    callback(batchError("Batch body exceeds " +
+                            std::to_string(limits().maxBodyBytes) + " bytes",
+                        k413RequestEntityTooLarge));
+    return;
+  }
+
+  auto json = req->getJsonObject();
+  if (!json || !(*json)["requests"].isArray() ||
+      (*json)["requests"].empty()) {
+    callback(batchError("Missing required field: requests", k400BadRequest));
+    return;
+  }
+  const auto &items = (*json)["requests"];
+  if (items.size() > limits().maxRequests) {
+    callback(batchError("Too many requests in batch (max " +
+                            std::to_string(limits().maxRequests) + ")",
+                        k400BadRequest));
+    return;
+  }
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+  auto authorization = req->getHeader("Authorization");
+
+  // Ошибочные элементы получают 400 сразу и не мешают остальным
+  std::vector<HttpRequestPtr> requests(items.size());
+  Json::Value results(Json::arrayValue);
+  results.resize(items.size());
+  for (Json::ArrayIndex i = 0; i < items.size(); ++i) {
+    auto error = buildRequest(items[i], userId, authorization, requests[i]);
+    if (!error.empty()) {
+      requests[i] = nullptr;
+      results[i] = subResult(k400BadRequest, error);
+    }
+  }
+
+  // Не дольше дедлайна самого /batch (AdmissionControl), если он есть
+  auto timeoutSeconds = limits().timeoutSeconds;
+  if (req->attributes()->find("deadline_us")) {
+    auto remainingUs = req->attributes()->get<int64_t>("deadline_us") -
+                       trantor::Date::now().microSecondsSinceEpoch();
+    timeoutSeconds =
+        std::clamp(remainingUs / 1e6, 0.001, limits().timeoutSeconds);
+  }
+
+  std::make_shared<Batch>(std::move(requests), std::move(results),
+                          std::move(callback))
+      ->start(timeoutSeconds);
+}
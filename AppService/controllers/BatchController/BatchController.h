@@ -0,0 +1,25 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+using namespace drogon;
+
+namespace api {
+class BatchController : public drogon::HttpController<BatchController> {
+public:
+  METHOD_LIST_BEGIN
+
+  ADD_METHOD_TO(BatchController::batch, "/batch", Post, "AuthFilter");
+
+  METHOD_LIST_END
+
+  // {"requests": [{"method", "path", "body"}, ...]} ->
+  // {"responses": [{"status", "body"}, ...]} в том же порядке.
+  // Подзапросы проходят через роутер Drogon внутри процесса, токен
+  // проверяется один раз. Подряд идущие GET выполняются одновременно
+  // на разных IO-потоках; остальные методы — по одному, по порядку,
+  // после завершения всего, что было до них. Лимиты — custom_config.batch
+  void batch(const HttpRequestPtr &req,
+             std::function<void(const HttpResponsePtr &)> &&callback) const;
+};
+}
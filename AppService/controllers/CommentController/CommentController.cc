@@ -1,4 +1,9 @@
 #include "CommentController.h"
+#include "services/ExistenceCache.h"
+#include "services/ProfileCache.h"
+#include "services/RowJson.h"
+#include "services/SingleFlight.h"
+#include "storage/Repositories.h"
 #include <json/value.h>
 
 using namespace api;
@@ -8,43 +13,27 @@ void CommentController::getComments(
     std::function<void(const HttpResponsePtr &)> &&callback,
     int64_t postId) const {
 
-  auto db = drogon::app().getDbClient();
-
   try {
-    auto result =
-        db->execSqlSync("SELECT c.id, c.author_user_id, c.text, c.created_at, "
-                        "       u.username "
-                        "FROM comments c "
-                        "LEFT JOIN users u ON u.user_id = c.author_user_id "
-                        "WHERE c.post_id = $1 ORDER BY c.created_at ASC",
-                        postId);
-
-    Json::Value comments(Json::arrayValue);
-    for (const auto &row : result) {
-      Json::Value comment;
-      comment["id"] = (Json::Int64)row["id"].as<int64_t>();
-      comment["post_id"] = (Json::Int64)postId;
-      comment["author_user_id"] =
-          (Json::Int64)row["author_user_id"].as<int64_t>();
-
-      std::string text = row["text"].as<std::string>();
-      comment["text"] = text;
-      // Фронтенд ожидает поле `content`
-      comment["content"] = text;
-
-      comment["created_at"] = row["created_at"].as<std::string>();
-
-      if (!row["username"].isNull()) {
-        comment["author_username"] = row["username"].as<std::string>();
-      } else {
-        comment["author_username"] = "";
-      }
-
-      comments.append(comment);
-    }
+    static services::SingleFlight<Json::Value> commentLoads("comments");
+    auto comments = commentLoads.run(
+        "comments:" + std::to_string(postId), [&]() {
+          auto rows =
+              storage::Repositories::instance().comments().byPost(postId);
+
+          Json::Value comments(Json::arrayValue);
+          for (const auto &row : rows) {
+            auto comment = services::rowJson(row);
+            // Фронтенд ожидает поле `content`
+            comment["content"] = row.text;
+            comments.append(comment);
+          }
+
+          services::ProfileCache::instance().fillAuthors(comments, false);
+          return comments;
+        });
 
     Json::Value response;
-    response["comments"] = comments;
+    response["comments"] = *comments;
 
     auto resp = HttpResponse::newHttpJsonResponse(response);
     callback(resp);
@@ -83,13 +72,21 @@ void CommentController::createComment(
   } else {
     text = (*json)["content"].asString();
   }
-  auto db = drogon::app().getDbClient();
+  if (services::ExistenceCache::posts().definitelyMissing(postId)) {
+    Json::Value response;
+    response["error"] = "Post not found";
+    auto resp = HttpResponse::newHttpJsonResponse(response);
+    resp->setStatusCode(k404NotFound);
+    callback(resp);
+    return;
+  }
+  auto generation = services::ExistenceCache::posts().generation(postId);
 
-  try {
-    auto postResult =
-        db->execSqlSync("SELECT id FROM posts WHERE id = $1", postId);
+  auto &repositories = storage::Repositories::instance();
 
-    if (postResult.empty()) {
+  try {
+    if (!repositories.posts().author(postId)) {
+      services::ExistenceCache::posts().markMissing(postId, generation);
       Json::Value response;
       response["error"] = "Post not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -98,31 +95,22 @@ void CommentController::createComment(
       return;
     }
 
-    auto result =
-        db->execSqlSync("INSERT INTO comments (post_id, author_user_id, text) "
-                        "VALUES ($1, $2, $3) RETURNING id, created_at",
-                        postId, userId, text);
+    auto comment = repositories.comments().create(postId, userId, text);
 
     // Попробуем получить username автора, если он есть в таблице users
     std::string authorUsername;
     try {
-      auto userRow = db->execSqlSync(
-          "SELECT username FROM users WHERE user_id = $1", userId);
-      if (!userRow.empty() && !userRow[0]["username"].isNull()) {
-        authorUsername = userRow[0]["username"].as<std::string>();
+      auto profile = services::ProfileCache::instance().get(userId);
+      if (profile && profile->exists) {
+        authorUsername = profile->username;
       }
     } catch (const std::exception &e) {
       // Не критично, если не нашли профиль
       LOG_DEBUG << "No user profile for comment author: " << e.what();
     }
 
-    Json::Value response;
-    response["id"] = (Json::Int64)result[0]["id"].as<int64_t>();
-    response["post_id"] = (Json::Int64)postId;
-    response["author_user_id"] = (Json::Int64)userId;
-    response["text"] = text;
-    response["content"] = text;
-    response["created_at"] = result[0]["created_at"].as<std::string>();
+    auto response = services::rowJson(comment);
+    response["content"] = comment.text;
     response["author_username"] = authorUsername;
 
     auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -145,13 +133,12 @@ void CommentController::deleteComment(
     int64_t commentId) const {
 
   auto userId = req->attributes()->get<int64_t>("user_id");
-  auto db = drogon::app().getDbClient();
+  auto &comments = storage::Repositories::instance().comments();
 
   try {
-    auto commentResult = db->execSqlSync(
-        "SELECT author_user_id FROM comments WHERE id = $1", commentId);
+    auto comment = comments.find(commentId);
 
-    if (commentResult.empty()) {
+    if (!comment) {
       Json::Value response;
       response["error"] = "Comment not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -160,7 +147,7 @@ void CommentController::deleteComment(
       return;
     }
 
-    if (commentResult[0]["author_user_id"].as<int64_t>() != userId) {
+    if (comment->authorUserId != userId) {
       Json::Value response;
       response["error"] = "Forbidden";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -169,7 +156,7 @@ void CommentController::deleteComment(
       return;
     }
 
-    db->execSqlSync("DELETE FROM comments WHERE id = $1", commentId);
+    comments.remove(commentId);
 
     Json::Value response;
     response["success"] = true;
@@ -1,16 +1,98 @@
 #include "FeedController.h"
+#include "services/Attachments.h"
+#include "services/FeedHub.h"
+#include "services/PostHydration.h"
+#include "services/PostMetaStore.h"
+#include "services/ProfileCache.h"
+#include "services/Metrics.h"
+#include "storage/Repositories.h"
+#include <algorithm>
+#include <chrono>
 #include <json/value.h>
+#include <unordered_map>
 
 using namespace api;
 
+namespace {
+
+Json::Value feedPost(const storage::Post &row, int64_t userId) {
+  auto &repositories = storage::Repositories::instance();
+  auto post = services::postJson(row);
+
+  Json::Value attachments(Json::arrayValue);
+  for (const auto &attachment : repositories.attachments().byPost(row.id)) {
+    attachments.append(services::attachmentJson(attachment));
+  }
+  post["attachments"] = attachments;
+
+  auto likes = repositories.likes().summary(row.id, userId);
+  post["likes_count"] = (Json::Int64)likes.count;
+  post["is_liked"] = likes.likedByViewer;
+
+  post["comments_count"] =
+      (Json::Int64)repositories.comments().count(row.id);
+
+  return post;
+}
+
+// Страница ленты через колоночный индекс: сначала посты подписок,
+// затем остальные публичные, внутри групп — от новых к старым
+// (тот же порядок, что ORDER BY follow_priority, created_at DESC).
+std::vector<int64_t> feedPageFromStore(int64_t userId, int offset,
+                                       int limit) {
+  auto followed =
+      storage::Repositories::instance().follows().following(userId);
+  std::sort(followed.begin(), followed.end());
+
+  auto &store = services::PostMetaStore::instance();
+  services::PostMetaStore::Filter filter;
+  filter.excludeAuthor = userId;
+
+  filter.authorsIn = &followed;
+  auto page = store.scan(filter, offset, limit);
+  if (page.ids.size() == static_cast<size_t>(limit)) {
+    return page.ids;
+  }
+
+  // Подписки закончились: добираем страницу остальными авторами
+  size_t skip = static_cast<size_t>(offset) > page.matched
+                    ? offset - page.matched
+                    : 0;
+  filter.authorsIn = nullptr;
+  filter.authorsNotIn = &followed;
+  auto rest = store.scan(filter, skip, limit - page.ids.size());
+  page.ids.insert(page.ids.end(), rest.ids.begin(), rest.ids.end());
+  return page.ids;
+}
+
+// Больше этого счётчик /feed/new не считает: клиенту достаточно "99+"
+constexpr size_t kMaxNewCount = 99;
+constexpr int kMaxNewPosts = 50;
+
+HttpResponsePtr feedError(const std::string &message, HttpStatusCode code) {
+  Json::Value response;
+  response["error"] = message;
+  auto resp = HttpResponse::newHttpJsonResponse(response);
+  resp->setStatusCode(code);
+  return resp;
+}
+
+} // namespace
+
 void FeedController::getFeed(
     const HttpRequestPtr &req,
     std::function<void(const HttpResponsePtr &)> &&callback) const {
-  
+
+  static auto &feedRequests = services::Metrics::instance().counter(
+      "feed_requests_total", "GET /feed requests served");
+  static auto &feedMicros = services::Metrics::instance().counter(
+      "feed_request_microseconds_total", "Time spent building GET /feed");
+  auto startedAt = std::chrono::steady_clock::now();
+
   auto userId = req->attributes()->get<int64_t>("user_id");
   int offset = 0;
   int limit = 20;
-  
+
   auto params = req->getParameters();
   if (params.find("offset") != params.end()) {
     offset = std::stoi(params.at("offset"));
@@ -20,89 +102,52 @@ void FeedController::getFeed(
     if (limit > 100) limit = 100;
   }
 
-  auto db = drogon::app().getDbClient();
+  auto &posts = storage::Repositories::instance().posts();
 
   try {
-    std::string sql =
-        "SELECT p.id, p.author_user_id, p.text, p.visibility, p.created_at, p.updated_at, "
-        "       u.username, u.avatar_path, "
-        "       CASE WHEN p.author_user_id IN ( "
-        "            SELECT following_user_id FROM follows WHERE follower_user_id = $1 "
-        "       ) THEN 0 ELSE 1 END AS follow_priority "
-        "FROM posts p "
-        "LEFT JOIN users u ON u.user_id = p.author_user_id "
-        "WHERE p.visibility = 'public' "
-        "  AND p.author_user_id <> $1 "
-        "ORDER BY follow_priority ASC, p.created_at DESC "
-        "LIMIT " +
-        std::to_string(limit) + " OFFSET " + std::to_string(offset);
-
-    auto result = db->execSqlSync(sql, userId);
-
+    // Курсор для /feed/new берётся до страницы: пост, вышедший между
+    // ними, придёт дважды (клиент отбросит повтор), но не потеряется
+    auto newPostsCursor =
+        services::PostMetaStore::instance().publishedSequence();
     Json::Value feed(Json::arrayValue);
-    for (const auto &row : result) {
-      Json::Value post;
-      post["id"] = (Json::Int64)row["id"].as<int64_t>();
-      post["author_user_id"] = (Json::Int64)row["author_user_id"].as<int64_t>();
-      post["text"] = row["text"].as<std::string>();
-      if (!row["username"].isNull()) {
-        post["author_username"] = row["username"].as<std::string>();
-      } else {
-        post["author_username"] = "";
-      }
-      if (!row["avatar_path"].isNull()) {
-        post["author_avatar_path"] = row["avatar_path"].as<std::string>();
-      } else {
-        post["author_avatar_path"] = "";
+
+    if (services::PostMetaStore::instance().loaded()) {
+      auto ids = feedPageFromStore(userId, offset, limit);
+
+      if (!ids.empty()) {
+        std::unordered_map<int64_t, storage::Post> postById;
+        for (auto &post : posts.findMany(ids)) {
+          auto id = post.id;
+          postById.emplace(id, std::move(post));
+        }
+        for (auto id : ids) {
+          auto it = postById.find(id);
+          if (it != postById.end()) {
+            feed.append(feedPost(it->second, userId));
+          }
+        }
       }
-      post["visibility"] = row["visibility"].as<std::string>();
-      post["created_at"] = row["created_at"].as<std::string>();
-      post["updated_at"] = row["updated_at"].as<std::string>();
-
-      int64_t postId = row["id"].as<int64_t>();
-      
-      auto attachmentsResult = db->execSqlSync(
-        "SELECT id, type, file_path FROM attachments WHERE post_id = $1",
-        postId
-      );
-
-      Json::Value attachments(Json::arrayValue);
-      for (const auto &attRow : attachmentsResult) {
-        Json::Value attachment;
-        attachment["id"] = (Json::Int64)attRow["id"].as<int64_t>();
-        attachment["type"] = attRow["type"].as<std::string>();
-        attachment["file_path"] = attRow["file_path"].as<std::string>();
-        attachments.append(attachment);
+    } else {
+      for (const auto &post : posts.feed(userId, limit, offset)) {
+        feed.append(feedPost(post, userId));
       }
-      post["attachments"] = attachments;
-
-      auto likesResult = db->execSqlSync(
-        "SELECT COUNT(*) as count, "
-        "       SUM(CASE WHEN user_id = $1 THEN 1 ELSE 0 END) as liked_by_me "
-        "FROM likes WHERE post_id = $2",
-        userId,
-        postId
-      );
-      post["likes_count"] = (Json::Int64)likesResult[0]["count"].as<int64_t>();
-      int64_t likedByMe = likesResult[0]["liked_by_me"].isNull()
-                              ? 0
-                              : likesResult[0]["liked_by_me"].as<int64_t>();
-      post["is_liked"] = likedByMe > 0;
-
-      auto commentsResult = db->execSqlSync(
-        "SELECT COUNT(*) as count FROM comments WHERE post_id = $1",
-        postId
-      );
-      post["comments_count"] = (Json::Int64)commentsResult[0]["count"].as<int64_t>();
-
-      feed.append(post);
     }
 
+    services::ProfileCache::instance().fillAuthors(feed);
+
     Json::Value response;
     response["posts"] = feed;
     response["offset"] = offset;
     response["limit"] = limit;
     response["has_more"] = feed.size() == limit;
+    response["new_posts_cursor"] = (Json::UInt64)newPostsCursor;
+
+    feedRequests.fetch_add(1, std::memory_order_relaxed);
+    feedMicros.fetch_add(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startedAt)
+            .count(),
+        std::memory_order_relaxed);
 
     auto resp = HttpResponse::newHttpJsonResponse(response);
     callback(resp);
@@ -116,3 +161,131 @@ void FeedController::getFeed(
     callback(resp);
   }
 }
+
+void FeedController::streamFeed(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback) const {
+
+  if (!services::FeedHub::instance().enabled()) {
+    Json::Value error;
+    error["error"] = "Feed stream is disabled";
+    auto resp = HttpResponse::newHttpJsonResponse(error);
+    resp->setStatusCode(k404NotFound);
+    callback(resp);
+    return;
+  }
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+
+  // Колбэк вызывается в IO-потоке соединения, когда заголовки ушли.
+  // Второй аргумент отключает таймаут ожидания первого send()
+  auto resp = HttpResponse::newAsyncStreamResponse(
+      [userId, connection = req->getConnectionPtr()](
+          ResponseStreamPtr stream) {
+        services::FeedHub::instance().subscribe(userId, std::move(stream),
+                                                connection);
+      },
+      true);
+  resp->setContentTypeString("text/event-stream; charset=utf-8");
+  resp->addHeader("Cache-Control", "no-cache");
+  // nginx не должен буферизовать поток
+  resp->addHeader("X-Accel-Buffering", "no");
+  callback(resp);
+}
+
+void FeedController::getNewPosts(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback) const {
+
+  static auto &newRequests = services::Metrics::instance().counter(
+      "feed_new_requests_total", "GET /feed/new requests served");
+  static auto &newCountOnly = services::Metrics::instance().counter(
+      "feed_new_count_only_total", "GET /feed/new?count_only=1 requests");
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+
+  // Курсор — номер публикации из PostMetaStore (new_posts_cursor у
+  // /feed или cursor прошлого ответа), а не id поста
+  uint64_t since = 0;
+  bool sinceValid = false;
+  try {
+    size_t parsed = 0;
+    auto param = req->getParameter("since");
+    since = std::stoull(param, &parsed);
+    sinceValid = parsed == param.size() && param[0] != '-';
+  } catch (...) {
+  }
+  if (!sinceValid) {
+    callback(feedError("Invalid since cursor", k400BadRequest));
+    return;
+  }
+
+  auto countOnlyParam = req->getParameter("count_only");
+  bool countOnly = countOnlyParam == "1" || countOnlyParam == "true";
+
+  int limit = 20;
+  auto limitParam = req->getParameter("limit");
+  if (!limitParam.empty()) {
+    try {
+      limit = std::clamp(std::stoi(limitParam), 1, kMaxNewPosts);
+    } catch (...) {
+    }
+  }
+
+  newRequests.fetch_add(1, std::memory_order_relaxed);
+  auto &store = services::PostMetaStore::instance();
+
+  try {
+    // Тот же набор, что у ленты: публичные посты, кроме своих. Журнал
+    // публикаций упорядочен по моменту COMMIT, поэтому пост с меньшим
+    // id, закоммиченный после выдачи курсора, тоже попадёт в ответ.
+    // БД не нужна: журнал пишется и до окончания загрузки хранилища
+    if (countOnly) {
+      newCountOnly.fetch_add(1, std::memory_order_relaxed);
+      auto published = store.publishedSince(since, userId, kMaxNewCount + 1);
+
+      Json::Value response;
+      response["count"] =
+          (Json::UInt64)std::min(published.ids.size(), kMaxNewCount);
+      response["has_more"] =
+          !published.complete || published.ids.size() > kMaxNewCount;
+      callback(HttpResponse::newHttpJsonResponse(response));
+      return;
+    }
+
+    // limit + 1: лишний пост только сообщает, что новых больше limit.
+    // Если курсор старше журнала, клиенту остаётся перезагрузить ленту
+    auto published = store.publishedSince(since, userId, limit + 1);
+    auto &ids = published.ids;
+    bool hasMore = !published.complete ||
+                   ids.size() > static_cast<size_t>(limit);
+    if (ids.size() > static_cast<size_t>(limit)) {
+      ids.pop_back();
+    }
+
+    Json::Value posts(Json::arrayValue);
+    if (!ids.empty()) {
+      auto rows = storage::Repositories::instance().posts().findMany(ids);
+      std::sort(rows.begin(), rows.end(),
+                [](const storage::Post &a, const storage::Post &b) {
+                  return a.id > b.id;
+                });
+      for (const auto &row : rows) {
+        posts.append(services::postJson(row));
+      }
+    }
+
+    services::hydratePosts(posts, userId);
+
+    Json::Value response;
+    response["posts"] = posts;
+    response["count"] = posts.size();
+    response["has_more"] = hasMore;
+    response["cursor"] = (Json::UInt64)published.sequence;
+    callback(HttpResponse::newHttpJsonResponse(response));
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error getting new feed posts: " << e.what();
+    callback(feedError("Internal server error", k500InternalServerError));
+  }
+}
@@ -10,10 +10,26 @@ public:
   METHOD_LIST_BEGIN
   
   ADD_METHOD_TO(FeedController::getFeed, "/feed", Get, "AuthFilter");
+  ADD_METHOD_TO(FeedController::getNewPosts, "/feed/new", Get, "AuthFilter");
+  ADD_METHOD_TO(FeedController::streamFeed, "/feed/stream", Get, "AuthFilter");
   
   METHOD_LIST_END
 
   void getFeed(const HttpRequestPtr &req,
                std::function<void(const HttpResponsePtr &)> &&callback) const;
+
+  // Публичные посты других авторов, опубликованные после since, от
+  // новых к старым: {posts, count, has_more, cursor}. count_only=1 —
+  // только {count, has_more}, без гидрации; рассчитан на опрос раз в
+  // несколько секунд. since — new_posts_cursor из GET /feed или cursor
+  // прошлого ответа (номер публикации, см. PostMetaStore)
+  void getNewPosts(const HttpRequestPtr &req,
+                   std::function<void(const HttpResponsePtr &)> &&callback) const;
+
+  // text/event-stream: событие "post" с кратким описанием каждого
+  // нового публичного поста тех, на кого подписан пользователь.
+  // Соединение держит services::FeedHub
+  void streamFeed(const HttpRequestPtr &req,
+                  std::function<void(const HttpResponsePtr &)> &&callback) const;
 };
 }
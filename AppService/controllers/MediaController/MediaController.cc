@@ -1,104 +1,775 @@
 #include "MediaController.h"
-#include <chrono>
-#include <filesystem>
-#include <fstream>
+#include "services/MediaSniffer.h"
+#include "services/ByteRanges.h"
+#include "services/HotFileCache.h"
+#include "services/MediaIo.h"
+#include "services/MediaStore.h"
+#include "services/Metrics.h"
+#include "services/SqlArrays.h"
+#include "services/ThumbnailPipeline.h"
+#include "services/UploadSessions.h"
+#include "storage/Repositories.h"
+#include <atomic>
+#include <cstdio>
 #include <json/value.h>
+#include <memory>
+#include <sys/stat.h>
+#include <trantor/net/TcpConnection.h>
+#include <unistd.h>
 #include <vector>
 
 using namespace api;
 
-void MediaController::uploadMedia(
-    const HttpRequestPtr &req,
-    std::function<void(const HttpResponsePtr &)> &&callback) const {
+namespace {
 
-  MultiPartParser fileUpload;
-  if (fileUpload.parse(req) != 0) {
-    Json::Value response;
-    response["error"] = "Invalid multipart data";
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    resp->setStatusCode(k400BadRequest);
-    callback(resp);
-    return;
+HttpResponsePtr uploadError(const std::string &message, HttpStatusCode code) {
+  Json::Value response;
+  response["error"] = message;
+  auto resp = HttpResponse::newHttpJsonResponse(response);
+  resp->setStatusCode(code);
+  return resp;
+}
+
+// Сессии tus хранятся только в Postgres
+HttpResponsePtr uploadSessionsUnavailable() {
+  return uploadError("Resumable uploads need Postgres storage",
+                     k501NotImplemented);
+}
+
+// Файлов в одном запросе /media/upload — столько же, сколько вложений
+// у поста
+constexpr size_t kMaxFilesPerUpload = 20;
+
+struct UploadedFile {
+  services::MediaStore::Object object;
+  services::MediaKind kind = services::MediaKind::kUnknown;
+};
+
+Json::Value uploadedFileJson(const UploadedFile &file) {
+  Json::Value json;
+  json["file_path"] = "uploads/" + file.object.path;
+  json["type"] = services::mediaKindName(file.kind);
+  json["filename"] = file.object.path;
+  json["deduplicated"] = file.object.deduplicated;
+  return json;
+}
+
+// Поля верхнего уровня, как и раньше, описывают первый файл;
+// files — все файлы запроса в порядке частей
+HttpResponsePtr uploadCreated(const std::vector<UploadedFile> &files) {
+  Json::Value response = uploadedFileJson(files.front());
+  Json::Value list(Json::arrayValue);
+  for (const auto &file : files) {
+    list.append(uploadedFileJson(file));
   }
+  response["files"] = list;
 
-  auto files = fileUpload.getFiles();
-  if (files.empty()) {
-    Json::Value response;
-    response["error"] = "No file uploaded";
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    resp->setStatusCode(k400BadRequest);
-    callback(resp);
+  auto resp = HttpResponse::newHttpJsonResponse(response);
+  resp->setStatusCode(k201Created);
+  return resp;
+}
+
+// Учёт объектов в media_objects одним INSERT; ответ уходит после записи,
+// чтобы createPost и attachToPost уже могли увеличить ref_count. Сам
+// счётчик ссылок ведут они и deletePost. Новые фотографии уходят в
+// очередь превью. Без Postgres учитывать негде: файл просто лежит на
+// диске, а превью не строятся
+void recordMediaObjects(
+    std::vector<UploadedFile> files,
+    std::function<void(const HttpResponsePtr &)> callback) {
+  if (storage::kInMemory) {
+    callback(uploadCreated(files));
     return;
   }
 
-  auto &file = files[0];
-  // file.getFileType() возвращает enum FileType, он нам здесь не нужен,
-  // нам достаточно расширения файла для проверки.
-  auto fileExtensionView = file.getFileExtension();
-  std::string fileExtension(fileExtensionView.data(), fileExtensionView.size());
+  std::vector<std::string> paths, digests, sizes;
+  for (const auto &file : files) {
+    paths.push_back("uploads/" + file.object.path);
+    digests.push_back(file.object.digest);
+    sizes.push_back(std::to_string(file.object.size));
+  }
 
-  std::vector<std::string> allowedImages = {"jpg", "jpeg", "png", "gif"};
+  auto db = drogon::app().getDbClient();
+  db->execSqlAsync(
+      "INSERT INTO media_objects (file_path, digest, size_bytes) "
+      "SELECT * FROM unnest($1::text[], $2::text[], $3::bigint[]) "
+      "ON CONFLICT (file_path) DO NOTHING RETURNING file_path",
+      [files = std::move(files), callback](const orm::Result &result) {
+        for (const auto &row : result) {
+          auto path = row["file_path"].as<std::string>().substr(
+              sizeof("uploads/") - 1);
+          if (services::ThumbnailPipeline::accepts(
+                  services::lowercaseExtension(path))) {
+            services::ThumbnailPipeline::instance().enqueue(path);
+          }
+        }
+        callback(uploadCreated(files));
+      },
+      [callback](const orm::DrogonDbException &e) {
+        LOG_ERROR << "Error recording media objects: " << e.base().what();
+        callback(uploadError("File upload failed", k500InternalServerError));
+      },
+      services::textArray(paths), services::textArray(digests),
+      services::textArray(sizes));
+}
 
-  std::vector<std::string> allowedVideos = {"mp4", "webm", "mov"};
+// Колбэки MediaIo приходят из его потока; ответ собирается в потоке
+// соединения
+void onLoop(trantor::EventLoop *loop, std::function<void()> task) {
+  if (loop) {
+    loop->queueInLoop(std::move(task));
+  } else {
+    task();
+  }
+}
 
-  std::string mediaType;
-  bool isAllowed = false;
+// Состояние потоковой загрузки. Колбэки разбора приходят из IO-потока
+// соединения последовательно, завершения записи MediaIo возвращаются в
+// него же через onLoop, поэтому синхронизация не нужна.
+//
+// IO-поток не ждёт диска. Пока оба буфера файла в записи, чтение
+// соединения приостановлено; хвост файла дописывается, пока
+// принимается следующий, и файл кладётся в хранилище по завершении
+// записи. Ответ уходит, когда разобрано всё тело и легли все файлы.
+struct StreamUpload : std::enable_shared_from_this<StreamUpload> {
+  using Ingest = services::MediaStore::Ingest;
 
-  for (const auto &ext : allowedImages) {
-    if (fileExtension == ext) {
-      mediaType = "photo";
-      isAllowed = true;
-      break;
+  std::function<void(const HttpResponsePtr &)> callback;
+  trantor::EventLoop *loop = nullptr;
+  std::weak_ptr<trantor::TcpConnection> connection;
+  bool responded = false;
+  bool inFile = false;
+  bool bodyDone = false;
+  bool paused = false;
+  size_t fileCount = 0;
+  services::MediaKind kind = services::MediaKind::kUnknown;
+  std::string extension;
+  // Первые байты файла копятся здесь, пока их не хватит для проверки
+  // сигнатуры; до этого файл на диске не создаётся
+  std::string head;
+  std::shared_ptr<Ingest> ingest;
+  // Файлы, хвост которых ещё пишется
+  size_t settling = 0;
+  // В порядке частей; место занимается при конце части
+  std::vector<UploadedFile> files;
+
+  void respond(const HttpResponsePtr &resp) {
+    if (!responded) {
+      responded = true;
+      callback(resp);
+    }
+  }
+
+  void reject(const std::string &message, HttpStatusCode code) {
+    if (ingest) {
+      ingest->abort();
+    }
+    inFile = false;
+    // Остаток тела дочитывается и отбрасывается
+    setReading(true);
+    respond(uploadError(message, code));
+  }
+
+  void setReading(bool reading) {
+    if (paused != reading) {
+      return;
+    }
+    auto conn = connection.lock();
+    if (!conn) {
+      return;
+    }
+    if (reading) {
+      conn->startRead();
+    } else {
+      conn->stopRead();
+    }
+    paused = !reading;
+  }
+
+  // Оба буфера в записи: ждём диска, не читая соединение
+  void waitForDisk() {
+    setReading(false);
+    ingest->whenDrained([self = shared_from_this()]() {
+      onLoop(self->loop, [self]() { self->onDrained(); });
+    });
+  }
+
+  void onDrained() {
+    if (responded) {
+      return;
     }
+    if (ingest && ingest->backlogged()) {
+      if (!ingest->resume()) {
+        LOG_ERROR << "Error writing upload " << ingest->tempPath();
+        reject("File upload failed", k500InternalServerError);
+        return;
+      }
+      if (ingest->backlogged()) {
+        waitForDisk();
+        return;
+      }
+    }
+    setReading(true);
   }
 
-  if (!isAllowed) {
-    for (const auto &ext : allowedVideos) {
-      if (fileExtension == ext) {
-        mediaType = "video";
-        isAllowed = true;
-        break;
+  void onHeader(const MultipartHeader &header) {
+    if (responded) {
+      return;
+    }
+    if (inFile) {
+      finishFile();
+      if (responded) {
+        return;
       }
     }
+    if (header.filename.empty()) {
+      return;
+    }
+    if (++fileCount > kMaxFilesPerUpload) {
+      reject("Too many files (max " + std::to_string(kMaxFilesPerUpload) +
+                 ")",
+             k400BadRequest);
+      return;
+    }
+
+    extension = services::lowercaseExtension(header.filename);
+    kind = services::mediaKindForExtension(extension);
+    if (kind == services::MediaKind::kUnknown) {
+      reject("Invalid file type", k400BadRequest);
+      return;
+    }
+    ingest = std::make_shared<Ingest>(services::MediaStore::instance());
+    inFile = true;
   }
 
-  if (!isAllowed) {
-    Json::Value response;
-    response["error"] = "Invalid file type";
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    resp->setStatusCode(k400BadRequest);
-    callback(resp);
+  void onData(const char *data, size_t length) {
+    if (responded || !inFile) {
+      return;
+    }
+    if (length == 0) {
+      finishFile();
+      return;
+    }
+
+    if (!ingest->isOpen()) {
+      head.append(data, length);
+      if (head.size() >= services::kMediaSniffBytes) {
+        openFile();
+      }
+      return;
+    }
+
+    if (!ingest->write(data, length)) {
+      LOG_ERROR << "Error writing upload " << ingest->tempPath();
+      reject("File upload failed", k500InternalServerError);
+      return;
+    }
+    if (ingest->backlogged() && !paused) {
+      waitForDisk();
+    }
+  }
+
+  // Проверка содержимого по первым байтам и создание временного файла
+  bool openFile() {
+    if (services::sniffMediaKind(head) != kind) {
+      reject("File content does not match its type", k400BadRequest);
+      return false;
+    }
+
+    if (!ingest->open(extension) || !ingest->write(head.data(), head.size())) {
+      LOG_ERROR << "Error creating upload file " << ingest->tempPath();
+      reject("File upload failed", k500InternalServerError);
+      return false;
+    }
+    std::string().swap(head);
+    return true;
+  }
+
+  void finishFile() {
+    if (!inFile) {
+      return;
+    }
+    if (!ingest->isOpen()) {
+      // Файл короче kMediaSniffBytes
+      if (head.empty()) {
+        reject("Empty file", k400BadRequest);
+        return;
+      }
+      if (!openFile()) {
+        return;
+      }
+    }
+    inFile = false;
+    size_t index = files.size();
+    files.emplace_back();
+    files[index].kind = kind;
+    ++settling;
+    std::shared_ptr<Ingest> ending = std::move(ingest);
+    ending->end([self = shared_from_this(), ending, index](bool ok) {
+      onLoop(self->loop,
+             [self, ending, index, ok]() { self->settle(*ending, index, ok); });
+    });
+    // Накопленное ушло вместе с хвостом
+    setReading(true);
+  }
+
+  // Файл записан: кладём его в хранилище
+  void settle(Ingest &ending, size_t index, bool ok) {
+    --settling;
+    if (responded) {
+      if (ok) {
+        services::MediaIo::instance().unlink(ending.tempPath());
+      }
+      return;
+    }
+    if (!ok || !ending.place(files[index].object)) {
+      LOG_ERROR << "Error finishing upload " << ending.tempPath();
+      reject("File upload failed", k500InternalServerError);
+      return;
+    }
+    complete();
+  }
+
+  void onFinish(const std::exception_ptr &ex) {
+    if (responded) {
+      return;
+    }
+    if (ex) {
+      reject("Invalid multipart data", k400BadRequest);
+      return;
+    }
+    finishFile();
+    if (responded) {
+      return;
+    }
+    bodyDone = true;
+    complete();
+  }
+
+  void complete() {
+    if (!bodyDone || settling > 0) {
+      return;
+    }
+    if (files.empty()) {
+      respond(uploadError("No file uploaded", k400BadRequest));
+      return;
+    }
+    responded = true;
+    recordMediaObjects(std::move(files), std::move(callback));
+  }
+};
+
+// Загрузка без потока запроса: тело уже в памяти. Файлы пишутся по
+// очереди тем же неблокирующим Ingest, что и потоковая загрузка: IO-поток
+// отдаёт данные порциями по буферу, пока оба буфера не в записи, и
+// продолжает из завершения MediaIo через onLoop.
+struct BufferedUpload : std::enable_shared_from_this<BufferedUpload> {
+  using Ingest = services::MediaStore::Ingest;
+
+  // Держит тело запроса, в которое смотрят файлы parser
+  HttpRequestPtr req;
+  MultiPartParser parser;
+  std::function<void(const HttpResponsePtr &)> callback;
+  trantor::EventLoop *loop = nullptr;
+  std::vector<std::string> extensions;
+  std::vector<UploadedFile> uploaded;
+  // Файл, который пишется, и сколько его байт отдано Ingest
+  size_t current = 0;
+  size_t offset = 0;
+  std::shared_ptr<Ingest> ingest;
+
+  const HttpFile &file() const { return parser.getFiles()[current]; }
+
+  void fail() {
+    LOG_ERROR << "Error uploading file " << file().getFileName();
+    if (ingest) {
+      ingest->abort();
+    }
+    callback(uploadError("File upload failed", k500InternalServerError));
+  }
+
+  void next() {
+    if (current == uploaded.size()) {
+      recordMediaObjects(std::move(uploaded), std::move(callback));
+      return;
+    }
+    if (!ingest) {
+      ingest = std::make_shared<Ingest>(services::MediaStore::instance());
+      offset = 0;
+      if (!ingest->open(extensions[current])) {
+        fail();
+        return;
+      }
+    }
+
+    const auto &data = file();
+    while (offset < data.fileLength()) {
+      size_t chunk = std::min(data.fileLength() - offset,
+                              services::UploadWriter::kBufferSize);
+      if (!ingest->write(data.fileData() + offset, chunk)) {
+        fail();
+        return;
+      }
+      offset += chunk;
+      if (ingest->backlogged()) {
+        ingest->whenDrained([self = shared_from_this()]() {
+          onLoop(self->loop, [self]() { self->onDrained(); });
+        });
+        return;
+      }
+    }
+
+    std::shared_ptr<Ingest> ending = std::move(ingest);
+    ending->end([self = shared_from_this(), ending](bool ok) {
+      onLoop(self->loop, [self, ending, ok]() { self->settle(*ending, ok); });
+    });
+  }
+
+  void onDrained() {
+    if (!ingest->resume()) {
+      fail();
+      return;
+    }
+    if (ingest->backlogged()) {
+      ingest->whenDrained([self = shared_from_this()]() {
+        onLoop(self->loop, [self]() { self->onDrained(); });
+      });
+      return;
+    }
+    next();
+  }
+
+  void settle(Ingest &ending, bool ok) {
+    if (!ok || !ending.place(uploaded[current].object)) {
+      fail();
+      return;
+    }
+    ++current;
+    next();
+  }
+};
+
+void uploadBuffered(const HttpRequestPtr &req,
+                    std::function<void(const HttpResponsePtr &)> &&callback) {
+  auto upload = std::make_shared<BufferedUpload>();
+  if (upload->parser.parse(req) != 0) {
+    callback(uploadError("Invalid multipart data", k400BadRequest));
     return;
   }
 
+  const auto &files = upload->parser.getFiles();
+  if (files.empty()) {
+    callback(uploadError("No file uploaded", k400BadRequest));
+    return;
+  }
+  if (files.size() > kMaxFilesPerUpload) {
+    callback(uploadError("Too many files (max " +
+                             std::to_string(kMaxFilesPerUpload) + ")",
+                         k400BadRequest));
+    return;
+  }
+
+  upload->uploaded.resize(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    const auto &file = files[i];
+    upload->extensions.push_back(
+        services::lowercaseExtension(file.getFileName()));
+    auto &uploaded = upload->uploaded[i];
+    uploaded.kind = services::mediaKindForExtension(upload->extensions[i]);
+    if (uploaded.kind == services::MediaKind::kUnknown) {
+      callback(uploadError("Invalid file type", k400BadRequest));
+      return;
+    }
+    if (services::sniffMediaKind(std::string_view(
+            file.fileData(), file.fileLength())) != uploaded.kind) {
+      callback(uploadError("File content does not match its type",
+                           k400BadRequest));
+      return;
+    }
+  }
+
+  upload->req = req;
+  upload->callback = std::move(callback);
+  upload->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+  upload->next();
+}
+
+// multipart/byteranges собирается в памяти; больше — отдаём файл целиком
+constexpr uint64_t kMaxMultipartRangeBytes = 8 << 20;
+
+// <digest> или <digest>_w<ширина> (варианты превью)
+bool isDigestName(const std::string &stem) {
+  if (stem.size() < 64) {
+    return false;
+  }
+  if (stem.size() > 64) {
+    auto suffix = stem.substr(64);
+    if (suffix.size() < 3 || suffix.compare(0, 2, "_w") != 0 ||
+        suffix.find_first_not_of("0123456789", 2) != std::string::npos) {
+      return false;
+    }
+  }
+  for (auto c : stem.substr(0, 64)) {
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Путь внутри uploads/ без выхода наружу и без служебных каталогов
+// (.incoming и т.п.)
+bool isSafeMediaPath(const std::string &path) {
+  return !path.empty() && path.front() != '.' && path.front() != '/' &&
+         path.find("/.") == std::string::npos &&
+         path.find('\\') == std::string::npos;
+}
+
+void setMediaHeaders(const HttpResponsePtr &resp, const std::string &etag,
+                     bool immutable) {
+  resp->addHeader("Accept-Ranges", "bytes");
+  resp->addHeader("ETag", etag);
+  resp->addHeader("Cache-Control", immutable
+                                       ? "public, max-age=31536000, immutable"
+                                       : "public, max-age=86400");
+}
+
+std::string contentRange(uint64_t offset, uint64_t length, uint64_t size) {
+  return "bytes " + std::to_string(offset) + "-" +
+         std::to_string(offset + length - 1) + "/" + std::to_string(size);
+}
+
+std::string multipartBoundary() {
+  static std::atomic<uint64_t> seq{0};
+  char boundary[48];
+  std::snprintf(boundary, sizeof(boundary), "media_range_%016llx_%llu",
+                static_cast<unsigned long long>(::getpid()),
+                static_cast<unsigned long long>(
+                    seq.fetch_add(1, std::memory_order_relaxed)));
+  return boundary;
+}
+
+// Всё, что нужно для ответа на GET /media после асинхронного чтения
+struct MediaReply {
+  std::function<void(const HttpResponsePtr &)> callback;
+  trantor::EventLoop *loop = nullptr;
+  std::string fullPath;
+  const char *contentType = "";
+  uint64_t size = 0;
+  std::string etag;
+  bool immutable = false;
+  services::RangeRequest range;
+};
+
+void sendMultipart(const std::shared_ptr<MediaReply> &reply,
+                   const std::vector<std::string> &parts) {
+  auto boundary = multipartBoundary();
+  std::string body;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    const auto &r = reply->range.ranges[i];
+    body += "--" + boundary + "\r\nContent-Type: " + reply->contentType +
+            "\r\nContent-Range: " +
+            contentRange(r.offset, r.length, reply->size) + "\r\n\r\n";
+    body += parts[i];
+    body += "\r\n";
+  }
+  body += "--" + boundary + "--\r\n";
+
+  auto resp = HttpResponse::newHttpResponse();
+  resp->setBody(std::move(body));
+  resp->setContentTypeString("multipart/byteranges; boundary=" + boundary);
+  resp->setStatusCode(k206PartialContent);
+  setMediaHeaders(resp, reply->etag, reply->immutable);
+  reply->callback(resp);
+}
+
+// content — файл целиком из HotFileCache или nullptr для больших файлов
+void sendMedia(const std::shared_ptr<MediaReply> &reply,
+               const services::HotFileCache::Content &content) {
+  static auto &rangeRequests = services::Metrics::instance().counter(
+      "media_range_requests_total", "Media requests answered with 206");
+
+  const auto &ranges = reply->range.ranges;
+  HttpResponsePtr resp;
+  if (reply->range.status == services::RangeRequest::Status::kIgnored) {
+    if (content) {
+      resp = HttpResponse::newHttpResponse();
+      resp->setBody(*content);
+      resp->setContentTypeString(reply->contentType);
+    } else {
+      // Большие файлы — через sendfile (use_sendfile в config.json)
+      resp = HttpResponse::newFileResponse(reply->fullPath);
+    }
+  } else if (ranges.size() == 1) {
+    rangeRequests.fetch_add(1, std::memory_order_relaxed);
+    const auto &r = ranges.front();
+    if (content) {
+      resp = HttpResponse::newHttpResponse();
+      resp->setBody(content->substr(r.offset, r.length));
+      resp->setContentTypeString(reply->contentType);
+      resp->setStatusCode(k206PartialContent);
+      resp->addHeader("Content-Range",
+                      contentRange(r.offset, r.length, reply->size));
+    } else {
+      resp = HttpResponse::newFileResponse(reply->fullPath, r.offset,
+                                           r.length, true);
+    }
+  } else {
+    rangeRequests.fetch_add(1, std::memory_order_relaxed);
+    if (content) {
+      std::vector<std::string> parts;
+      for (const auto &r : ranges) {
+        parts.push_back(content->substr(r.offset, r.length));
+      }
+      sendMultipart(reply, parts);
+      return;
+    }
+    // Все диапазоны читаются одним пакетом MediaIo
+    std::vector<std::pair<uint64_t, uint64_t>> spans;
+    for (const auto &r : ranges) {
+      spans.emplace_back(r.offset, r.length);
+    }
+    services::MediaIo::instance().readRanges(
+        reply->fullPath, spans, [reply](std::vector<std::string> parts) {
+          onLoop(reply->loop, [reply, parts = std::move(parts)]() {
+            if (parts.empty()) {
+              reply->callback(uploadError("File not found", k404NotFound));
+              return;
+            }
+            sendMultipart(reply, parts);
+          });
+        });
+    return;
+  }
+
+  setMediaHeaders(resp, reply->etag, reply->immutable);
+  reply->callback(resp);
+}
+
+// Состояние сессии возобновляемой загрузки: заголовки tus + JSON
+HttpResponsePtr uploadSessionResponse(
+    const services::UploadSessions::Session &session, HttpStatusCode code) {
+  Json::Value response;
+  response["upload_id"] = session.id;
+  response["upload_offset"] = (Json::Int64)session.offset;
+  response["upload_length"] = (Json::Int64)session.length;
+  response["expires_at"] = session.expiresAt;
+
+  auto resp = HttpResponse::newHttpJsonResponse(response);
+  resp->setStatusCode(code);
+  resp->addHeader("Tus-Resumable", "1.0.0");
+  resp->addHeader("Upload-Offset", std::to_string(session.offset));
+  resp->addHeader("Upload-Length", std::to_string(session.length));
+  resp->addHeader("Cache-Control", "no-store");
+  return resp;
+}
+
+HttpResponsePtr uploadSessionError(
+    services::UploadSessions::Status status,
+    const services::UploadSessions::Session &session) {
+  using Status = services::UploadSessions::Status;
+  switch (status) {
+  case Status::kNotFound:
+    return uploadError("Upload not found", k404NotFound);
+  case Status::kBadType:
+    return uploadError("Invalid file type", k400BadRequest);
+  case Status::kTooLarge:
+    return uploadError("Upload exceeds its declared or allowed length",
+                       k413RequestEntityTooLarge);
+  case Status::kTooManySessions:
+    return uploadError("Too many unfinished uploads", k429TooManyRequests);
+  case Status::kOffsetMismatch: {
+    auto resp = uploadError("Upload-Offset does not match", k409Conflict);
+    resp->addHeader("Upload-Offset", std::to_string(session.offset));
+    return resp;
+  }
+  case Status::kBadChecksum:
+    return uploadError("Unsupported checksum algorithm", k400BadRequest);
+  case Status::kChecksumMismatch: {
+    auto resp = uploadError("Checksum mismatch", k400BadRequest);
+    resp->setCustomStatusCode(460, "Checksum Mismatch");
+    return resp;
+  }
+  case Status::kContentMismatch:
+    return uploadError("File content does not match its type",
+                       k400BadRequest);
+  case Status::kIncomplete:
+    return uploadError("Upload is not complete", k409Conflict);
+  case Status::kBusy:
+    return uploadError("Upload is being written by another request",
+                       k423Locked);
+  default:
+    return uploadError("File upload failed", k500InternalServerError);
+  }
+}
+
+// filename из Upload-Metadata: "key base64,key base64"
+std::string uploadMetadataFilename(const std::string &metadata) {
+  size_t start = 0;
+  while (start < metadata.size()) {
+    auto end = metadata.find(',', start);
+    auto pair = metadata.substr(start, end == std::string::npos
+                                           ? std::string::npos
+                                           : end - start);
+    auto first = pair.find_first_not_of(' ');
+    if (first != std::string::npos) {
+      pair = pair.substr(first);
+    }
+    auto space = pair.find(' ');
+    if (pair.substr(0, space) == "filename" && space != std::string::npos) {
+      return drogon::utils::base64Decode(pair.substr(space + 1));
+    }
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+  return "";
+}
+
+bool parseInt64(const std::string &text, int64_t &value) {
+  if (text.empty()) {
+    return false;
+  }
   try {
-    std::filesystem::create_directories("uploads");
+    size_t used = 0;
+    value = std::stoll(text, &used);
+    return used == text.size() && value >= 0;
+  } catch (const std::exception &) {
+    return false;
+  }
+}
 
-    std::string timestamp = std::to_string(
-        std::chrono::system_clock::now().time_since_epoch().count());
-    std::string filename = timestamp + "_" + file.getFileName();
-    std::string filepath = "uploads/" + filename;
+} // namespace
 
-    // saveAs без префикса upload_path, чтобы не получить uploads/uploads
-    file.saveAs(filename);
+void MediaController::uploadMedia(
+    const HttpRequestPtr &req, RequestStreamPtr &&stream,
+    std::function<void(const HttpResponsePtr &)> &&callback) const {
 
-    Json::Value response;
-    response["file_path"] = filepath;
-    response["type"] = mediaType;
-    response["filename"] = filename;
+  if (!stream) {
+    uploadBuffered(req, std::move(callback));
+    return;
+  }
 
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    resp->setStatusCode(k201Created);
-    callback(resp);
+  auto upload = std::make_shared<StreamUpload>();
+  upload->callback = std::move(callback);
+  upload->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+  upload->connection = req->getConnectionPtr();
 
-  } catch (const std::exception &e) {
-    LOG_ERROR << "Error uploading file: " << e.what();
-    Json::Value response;
-    response["error"] = "File upload failed";
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    resp->setStatusCode(k500InternalServerError);
-    callback(resp);
+  auto reader = RequestStreamReader::newMultipartReader(
+      req,
+      [upload](MultipartHeader header) { upload->onHeader(header); },
+      [upload](const char *data, size_t length) {
+        upload->onData(data, length);
+      },
+      [upload](std::exception_ptr ex) { upload->onFinish(ex); });
+
+  if (!reader) {
+    upload->respond(uploadError("Invalid multipart data", k400BadRequest));
+    stream->setStreamReader(RequestStreamReader::newNullReader());
+    return;
   }
+  stream->setStreamReader(std::move(reader));
 }
 
 void MediaController::attachToPost(
@@ -121,13 +792,12 @@ void MediaController::attachToPost(
   std::string filePath = (*json)["file_path"].asString();
   std::string type = (*json)["type"].asString();
 
-  auto db = drogon::app().getDbClient();
+  auto &repositories = storage::Repositories::instance();
 
   try {
-    auto postResult = db->execSqlSync(
-        "SELECT author_user_id FROM posts WHERE id = $1", postId);
+    auto author = repositories.posts().author(postId);
 
-    if (postResult.empty()) {
+    if (!author) {
       Json::Value response;
       response["error"] = "Post not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -136,7 +806,7 @@ void MediaController::attachToPost(
       return;
     }
 
-    if (postResult[0]["author_user_id"].as<int64_t>() != userId) {
+    if (*author != userId) {
       Json::Value response;
       response["error"] = "Forbidden";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -145,17 +815,14 @@ void MediaController::attachToPost(
       return;
     }
 
-    auto result =
-        db->execSqlSync("INSERT INTO attachments (post_id, type, file_path) "
-                        "VALUES ($1, $2, $3) RETURNING id, created_at",
-                        postId, type, filePath);
+    auto attachment = repositories.attachments().add(postId, type, filePath);
 
     Json::Value response;
-    response["id"] = (Json::Int64)result[0]["id"].as<int64_t>();
+    response["id"] = (Json::Int64)attachment.id;
     response["post_id"] = (Json::Int64)postId;
     response["type"] = type;
     response["file_path"] = filePath;
-    response["created_at"] = result[0]["created_at"].as<std::string>();
+    response["created_at"] = attachment.createdAt;
 
     auto resp = HttpResponse::newHttpJsonResponse(response);
     resp->setStatusCode(k201Created);
@@ -170,3 +837,269 @@ void MediaController::attachToPost(
     callback(resp);
   }
 }
+
+void MediaController::createUpload(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback) const {
+
+  if (storage::kInMemory) {
+    callback(uploadSessionsUnavailable());
+    return;
+  }
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+  int64_t length = 0;
+  auto filename = uploadMetadataFilename(req->getHeader("upload-metadata"));
+  if (!parseInt64(req->getHeader("upload-length"), length) ||
+      filename.empty()) {
+    callback(uploadError("Missing Upload-Length or filename in "
+                         "Upload-Metadata",
+                         k400BadRequest));
+    return;
+  }
+
+  auto db = drogon::app().getDbClient();
+  try {
+    services::UploadSessions::Session session;
+    auto status = services::UploadSessions::instance().create(
+        db, userId, filename, length, session);
+    if (status != services::UploadSessions::Status::kOk) {
+      callback(uploadSessionError(status, session));
+      return;
+    }
+
+    auto resp = uploadSessionResponse(session, k201Created);
+    resp->addHeader("Location", "/media/uploads/" + session.id);
+    callback(resp);
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error creating upload session: " << e.what();
+    callback(uploadError("Internal server error", k500InternalServerError));
+  }
+}
+
+void MediaController::uploadStatus(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback,
+    std::string uploadId) const {
+
+  if (storage::kInMemory) {
+    callback(uploadSessionsUnavailable());
+    return;
+  }
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+  auto db = drogon::app().getDbClient();
+  try {
+    auto session =
+        services::UploadSessions::instance().find(db, uploadId, userId);
+    if (!session) {
+      callback(uploadError("Upload not found", k404NotFound));
+      return;
+    }
+    callback(uploadSessionResponse(*session, k200OK));
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error reading upload session: " << e.what();
+    callback(uploadError("Internal server error", k500InternalServerError));
+  }
+}
+
+void MediaController::appendUpload(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback,
+    std::string uploadId) const {
+
+  if (storage::kInMemory) {
+    callback(uploadSessionsUnavailable());
+    return;
+  }
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+  int64_t offset = 0;
+  if (!parseInt64(req->getHeader("upload-offset"), offset)) {
+    callback(uploadError("Missing Upload-Offset", k400BadRequest));
+    return;
+  }
+
+  auto db = drogon::app().getDbClient();
+  try {
+    // Тело живёт в req, пока идёт запись
+    services::UploadSessions::instance().append(
+        db, uploadId, userId, offset, req->body(),
+        req->getHeader("upload-checksum"),
+        trantor::EventLoop::getEventLoopOfCurrentThread(),
+        [req, callback](services::UploadSessions::Status status,
+                        const services::UploadSessions::Session &session) {
+          if (status != services::UploadSessions::Status::kOk) {
+            callback(uploadSessionError(status, session));
+            return;
+          }
+          auto resp = uploadSessionResponse(session, k200OK);
+          resp->addHeader("Upload-Expires", session.expiresAt);
+          callback(resp);
+        });
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error appending to upload session: " << e.what();
+    callback(uploadError("Internal server error", k500InternalServerError));
+  }
+}
+
+void MediaController::cancelUpload(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback,
+    std::string uploadId) const {
+
+  if (storage::kInMemory) {
+    callback(uploadSessionsUnavailable());
+    return;
+  }
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+  auto db = drogon::app().getDbClient();
+  try {
+    auto status =
+        services::UploadSessions::instance().cancel(db, uploadId, userId);
+    if (status != services::UploadSessions::Status::kOk) {
+      callback(uploadSessionError(status, {}));
+      return;
+    }
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k204NoContent);
+    resp->addHeader("Tus-Resumable", "1.0.0");
+    callback(resp);
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error cancelling upload session: " << e.what();
+    callback(uploadError("Internal server error", k500InternalServerError));
+  }
+}
+
+void MediaController::completeUpload(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback,
+    std::string uploadId) const {
+
+  if (storage::kInMemory) {
+    callback(uploadSessionsUnavailable());
+    return;
+  }
+
+  auto userId = req->attributes()->get<int64_t>("user_id");
+  auto db = drogon::app().getDbClient();
+  try {
+    services::MediaStore::Object object;
+    auto status = services::UploadSessions::instance().complete(
+        db, uploadId, userId, object);
+    if (status != services::UploadSessions::Status::kOk) {
+      callback(uploadSessionError(status, {}));
+      return;
+    }
+    auto kind = services::mediaKindForExtension(
+        services::lowercaseExtension(object.path));
+    recordMediaObjects({{object, kind}}, std::move(callback));
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error completing upload session: " << e.what();
+    callback(uploadError("Internal server error", k500InternalServerError));
+  }
+}
+
+void MediaController::serveMedia(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback,
+    std::string path) const {
+
+  static auto &served = services::Metrics::instance().counter(
+      "media_requests_total", "Media files served by GET /media");
+  static auto &notModified = services::Metrics::instance().counter(
+      "media_not_modified_total", "Media requests answered with 304");
+
+  auto extension = services::lowercaseExtension(path);
+  const char *contentType = services::mediaContentType(extension);
+  auto fullPath = services::MediaStore::instance().root() + "/" + path;
+
+  struct stat st;
+  if (!isSafeMediaPath(path) || *contentType == '\0' ||
+      ::stat(fullPath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    callback(uploadError("File not found", k404NotFound));
+    return;
+  }
+  uint64_t size = static_cast<uint64_t>(st.st_size);
+  served.fetch_add(1, std::memory_order_relaxed);
+
+  // Имя контентно-адресуемого файла — его BLAKE3: это и есть ETag,
+  // а содержимое по такому пути никогда не меняется
+  auto slash = path.rfind('/');
+  auto name = slash == std::string::npos ? path : path.substr(slash + 1);
+  auto stem = name.substr(0, name.rfind('.'));
+  bool immutable = isDigestName(stem);
+  std::string etag =
+      immutable ? "\"" + stem + "\""
+                : "\"" + std::to_string(size) + "-" +
+                      std::to_string(static_cast<int64_t>(st.st_mtime)) + "\"";
+
+  const auto &ifNoneMatch = req->getHeader("if-none-match");
+  if (!ifNoneMatch.empty() &&
+      (ifNoneMatch == "*" || ifNoneMatch.find(etag) != std::string::npos)) {
+    notModified.fetch_add(1, std::memory_order_relaxed);
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k304NotModified);
+    setMediaHeaders(resp, etag, immutable);
+    callback(resp);
+    return;
+  }
+
+  services::RangeRequest range;
+  const auto &ifRange = req->getHeader("if-range");
+  if (ifRange.empty() || ifRange == etag) {
+    range = services::parseRangeHeader(req->getHeader("range"), size);
+  }
+
+  if (range.status == services::RangeRequest::Status::kUnsatisfiable) {
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k416RequestedRangeNotSatisfiable);
+    resp->addHeader("Content-Range", "bytes */" + std::to_string(size));
+    setMediaHeaders(resp, etag, immutable);
+    callback(resp);
+    return;
+  }
+
+  if (range.ranges.size() > 1) {
+    uint64_t total = 0;
+    for (const auto &r : range.ranges) {
+      total += r.length;
+    }
+    if (total > kMaxMultipartRangeBytes) {
+      range.status = services::RangeRequest::Status::kIgnored;
+    }
+  }
+
+  auto reply = std::make_shared<MediaReply>();
+  reply->callback = std::move(callback);
+  reply->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+  reply->fullPath = std::move(fullPath);
+  reply->contentType = contentType;
+  reply->size = size;
+  reply->etag = std::move(etag);
+  reply->immutable = immutable;
+  reply->range = std::move(range);
+
+  // Небольшие файлы — из памяти; промах читается через MediaIo, и ответ
+  // уходит из колбэка, не занимая IO-поток ожиданием диска
+  auto &hotCache = services::HotFileCache::instance();
+  if (size <= hotCache.maxFileBytes()) {
+    if (auto content = hotCache.get(reply->fullPath)) {
+      sendMedia(reply, content);
+      return;
+    }
+    hotCache.load(reply->fullPath, size,
+                  [reply](services::HotFileCache::Content content) {
+                    onLoop(reply->loop,
+                           [reply, content]() { sendMedia(reply, content); });
+                  });
+    return;
+  }
+  sendMedia(reply, nullptr);
+}
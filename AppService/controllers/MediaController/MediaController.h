@@ -1,6 +1,7 @@
 #pragma once
 
 #include <drogon/HttpController.h>
+#include <drogon/RequestStream.h>
 
 using namespace drogon;
 
@@ -11,14 +12,57 @@ public:
   
   ADD_METHOD_TO(MediaController::uploadMedia, "/media/upload", Post, "AuthFilter");
   ADD_METHOD_TO(MediaController::attachToPost, "/posts/{1}/attach", Post, "AuthFilter");
+  // Возобновляемая загрузка (tus-подобный протокол). Маршруты
+  // /media/uploads/... должны идти до общего /media/(.+)
+  ADD_METHOD_TO(MediaController::createUpload, "/media/uploads", Post, "AuthFilter");
+  ADD_METHOD_TO(MediaController::uploadStatus, "/media/uploads/{1}", Head, Get, "AuthFilter");
+  ADD_METHOD_TO(MediaController::appendUpload, "/media/uploads/{1}", Patch, "AuthFilter");
+  ADD_METHOD_TO(MediaController::cancelUpload, "/media/uploads/{1}", Delete, "AuthFilter");
+  ADD_METHOD_TO(MediaController::completeUpload, "/media/uploads/{1}/complete", Post, "AuthFilter");
+  // Отдача загруженных файлов; /uploads/... — старые ссылки вида file_path
+  ADD_METHOD_VIA_REGEX(MediaController::serveMedia, "/(?:media|uploads)/(.+)", Get);
   
   METHOD_LIST_END
 
-  void uploadMedia(const HttpRequestPtr &req,
+  // Тело запроса читается потоком (enable_request_stream): файл пишется
+  // на диск по мере прихода частей. Если поток недоступен, запрос уже
+  // буферизован Drogon'ом и разбирается через MultiPartParser.
+  // Файлов в запросе может быть несколько: в ответе files со всеми,
+  // поля верхнего уровня — первый файл.
+  void uploadMedia(const HttpRequestPtr &req, RequestStreamPtr &&stream,
                    std::function<void(const HttpResponsePtr &)> &&callback) const;
 
   void attachToPost(const HttpRequestPtr &req,
                     std::function<void(const HttpResponsePtr &)> &&callback,
                     int64_t postId) const;
+
+  // Upload-Length и Upload-Metadata: filename <base64>
+  void createUpload(const HttpRequestPtr &req,
+                    std::function<void(const HttpResponsePtr &)> &&callback) const;
+
+  void uploadStatus(const HttpRequestPtr &req,
+                    std::function<void(const HttpResponsePtr &)> &&callback,
+                    std::string uploadId) const;
+
+  // Тело — очередная часть файла с позиции Upload-Offset,
+  // Upload-Checksum: sha256|blake3 <base64>
+  void appendUpload(const HttpRequestPtr &req,
+                    std::function<void(const HttpResponsePtr &)> &&callback,
+                    std::string uploadId) const;
+
+  void cancelUpload(const HttpRequestPtr &req,
+                    std::function<void(const HttpResponsePtr &)> &&callback,
+                    std::string uploadId) const;
+
+  // Ответ такой же, как у /media/upload
+  void completeUpload(const HttpRequestPtr &req,
+                      std::function<void(const HttpResponsePtr &)> &&callback,
+                      std::string uploadId) const;
+
+  // sendfile для больших файлов, Range (в т.ч. multipart/byteranges),
+  // ETag из дайджеста, небольшие файлы — из HotFileCache
+  void serveMedia(const HttpRequestPtr &req,
+                  std::function<void(const HttpResponsePtr &)> &&callback,
+                  std::string path) const;
 };
 }
@@ -0,0 +1,14 @@
+#include "MetricsController.h"
+#include "services/Metrics.h"
+
+using namespace api;
+
+void MetricsController::getMetrics(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback) const {
+
+  auto resp = HttpResponse::newHttpResponse();
+  resp->setContentTypeString("text/plain; version=0.0.4");
+  resp->setBody(services::Metrics::instance().render());
+  callback(resp);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+using namespace drogon;
+
+namespace api {
+class MetricsController : public drogon::HttpController<MetricsController> {
+public:
+  METHOD_LIST_BEGIN
+  
+  ADD_METHOD_TO(MetricsController::getMetrics, "/metrics", Get);
+  
+  METHOD_LIST_END
+
+  void getMetrics(const HttpRequestPtr &req,
+                  std::function<void(const HttpResponsePtr &)> &&callback) const;
+};
+}
@@ -1,8 +1,98 @@
 #include "PostController.h"
+#include "services/Attachments.h"
+#include "services/ExistenceCache.h"
+#include "services/FeedHub.h"
+#include "services/PostHydration.h"
+#include "services/PostMetaStore.h"
+#include "services/ProfileCache.h"
+#include "services/SingleFlight.h"
+#include "storage/Repositories.h"
+#include <algorithm>
 #include <json/value.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 using namespace api;
 
+namespace {
+
+// Как и kMaxFilesPerUpload в MediaController: пост из одного запроса
+// /media/upload
+constexpr Json::ArrayIndex kMaxAttachmentsPerPost = 20;
+
+constexpr size_t kMaxPostIds = 200;
+
+// Длина текста в событии /feed/stream
+constexpr size_t kStreamPreviewBytes = 280;
+
+// Первые maxBytes байт без разрезанного UTF-8 символа
+std::string textPreview(const std::string &text, size_t maxBytes) {
+  if (text.size() <= maxBytes) {
+    return text;
+  }
+  auto end = maxBytes;
+  while (end > 0 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+    --end;
+  }
+  return text.substr(0, end);
+}
+
+// "1,2,3" -> id без повторов в порядке появления; false при мусоре
+bool parsePostIds(const std::string &list, std::vector<int64_t> &ids) {
+  std::unordered_set<int64_t> seen;
+  size_t start = 0;
+  while (start <= list.size()) {
+    auto end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    auto item = list.substr(start, end - start);
+    if (item.empty() ||
+        item.find_first_not_of("0123456789") != std::string::npos ||
+        item.size() > 18) {
+      return false;
+    }
+    auto id = std::stoll(item);
+    if (seen.insert(id).second) {
+      ids.push_back(id);
+    }
+    start = end + 1;
+  }
+  return true;
+}
+
+// Пост с лайками, комментариями и вложениями — по запросу на каждое;
+// viewerId 0 — аноним
+Json::Value detailedPost(const storage::Post &row, int64_t viewerId) {
+  auto &repositories = storage::Repositories::instance();
+  auto post = services::postJson(row);
+
+  auto likes = repositories.likes().summary(row.id, viewerId);
+  post["likes_count"] = (Json::Int64)likes.count;
+  post["is_liked"] = likes.likedByViewer;
+
+  post["comments_count"] =
+      (Json::Int64)repositories.comments().count(row.id);
+
+  Json::Value attachments(Json::arrayValue);
+  for (const auto &attachment : repositories.attachments().byPost(row.id)) {
+    attachments.append(services::attachmentJson(attachment));
+  }
+  post["attachments"] = attachments;
+  return post;
+}
+
+HttpResponsePtr postError(const std::string &message, HttpStatusCode code) {
+  Json::Value response;
+  response["error"] = message;
+  auto resp = HttpResponse::newHttpJsonResponse(response);
+  resp->setStatusCode(code);
+  return resp;
+}
+
+} // namespace
+
 void PostController::createPost(
     const HttpRequestPtr &req,
     std::function<void(const HttpResponsePtr &)> &&callback) const {
@@ -12,11 +102,8 @@ void PostController::createPost(
 
   // Accept both legacy "text" field and frontend "content" field
   if (!json || (!json->isMember("text") && !json->isMember("content"))) {
-    Json::Value response;
-    response["error"] = "Missing required field: text or content";
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    resp->setStatusCode(k400BadRequest);
-    callback(resp);
+    callback(postError("Missing required field: text or content",
+                       k400BadRequest));
     return;
   }
 
@@ -29,37 +116,189 @@ void PostController::createPost(
   }
   std::string visibility = json->get("visibility", "public").asString();
 
-  auto db = drogon::app().getDbClient();
+  // Вложения создаются вместе с постом: [{"file_path", "type"}, ...]
+  std::vector<storage::NewAttachment> newAttachments;
+  if (json->isMember("attachments")) {
+    const auto &attachments = (*json)["attachments"];
+    if (!attachments.isArray() ||
+        attachments.size() > kMaxAttachmentsPerPost) {
+      callback(postError("attachments must be an array of at most " +
+                             std::to_string(kMaxAttachmentsPerPost) +
+                             " items",
+                         k400BadRequest));
+      return;
+    }
+    for (const auto &attachment : attachments) {
+      if (!attachment.isObject() || !attachment["file_path"].isString() ||
+          !attachment["type"].isString()) {
+        callback(postError("Each attachment needs file_path and type",
+                           k400BadRequest));
+        return;
+      }
+      auto type = attachment["type"].asString();
+      if (type != "photo" && type != "video") {
+        callback(postError("Invalid attachment type", k400BadRequest));
+        return;
+      }
+      newAttachments.push_back(
+          {attachment["file_path"].asString(), std::move(type)});
+    }
+  }
 
   try {
-    auto result = db->execSqlSync(
-        "INSERT INTO posts (author_user_id, text, visibility) VALUES ($1, $2, "
-        "$3) RETURNING id, created_at, updated_at",
-        userId, text, visibility);
-
-    Json::Value response;
-    response["id"] = (Json::Int64)result[0]["id"].as<int64_t>();
-    response["author_user_id"] = (Json::Int64)userId;
-    response["text"] = text;
-    response["visibility"] = visibility;
-    response["created_at"] = result[0]["created_at"].as<std::string>();
-    response["updated_at"] = result[0]["updated_at"].as<std::string>();
+    // Пост и вложения создаются одной транзакцией; create возвращает
+    // управление после COMMIT, поэтому кэши и ответ ниже не опередят
+    // базу
+    std::vector<storage::Attachment> attachments;
+    auto post = storage::Repositories::instance().posts().create(
+        userId, text, visibility, newAttachments, attachments);
+
+    auto response = services::postJson(post);
     response["attachments"] = Json::Value(Json::arrayValue);
+    for (const auto &attachment : attachments) {
+      response["attachments"].append(services::attachmentJson(attachment));
+    }
     response["likes_count"] = 0;
     response["comments_count"] = 0;
     response["is_liked"] = false;
 
+    services::ExistenceCache::posts().added(post.id);
+    services::PostMetaStore::instance().upsert(
+        post.id, userId, post.createdMs,
+        services::PostMetaStore::parseVisibility(visibility));
+
     auto resp = HttpResponse::newHttpJsonResponse(response);
     resp->setStatusCode(k201Created);
     callback(resp);
 
+    if (visibility == "public") {
+      Json::Value summary;
+      summary["id"] = (Json::Int64)post.id;
+      summary["author_user_id"] = (Json::Int64)userId;
+      summary["text"] = textPreview(text, kStreamPreviewBytes);
+      summary["created_at"] = post.createdAt;
+      summary["attachments_count"] = response["attachments"].size();
+      services::FeedHub::instance().publishPost(userId, summary);
+    }
+
   } catch (const std::exception &e) {
     LOG_ERROR << "Error creating post: " << e.what();
+    callback(postError("Internal server error", k500InternalServerError));
+  }
+}
+
+void PostController::getPosts(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback) const {
+
+  auto &repository = storage::Repositories::instance().posts();
+  int64_t currentUserId = 0;
+
+  try {
+    currentUserId = req->attributes()->get<int64_t>("user_id");
+  } catch (...) {
+  }
+
+  auto idsParam = req->getParameter("ids");
+
+  try {
+    if (idsParam.empty()) {
+      // Последние публичные посты
+      int offset = 0;
+      int limit = 20;
+      // Нечисловые offset и limit — как отсутствующие, как в /feed/new
+      auto offsetParam = req->getParameter("offset");
+      if (!offsetParam.empty()) {
+        try {
+          offset = std::max(0, std::stoi(offsetParam));
+        } catch (...) {
+        }
+      }
+      auto limitParam = req->getParameter("limit");
+      if (!limitParam.empty()) {
+        try {
+          limit = std::clamp(std::stoi(limitParam), 1, 100);
+        } catch (...) {
+        }
+      }
+
+      Json::Value posts(Json::arrayValue);
+      for (const auto &post : repository.latestPublic(limit, offset)) {
+        posts.append(services::postJson(post));
+      }
+      services::hydratePosts(posts, currentUserId);
+
+      Json::Value response;
+      response["posts"] = posts;
+      response["offset"] = offset;
+      response["limit"] = limit;
+      response["has_more"] = posts.size() == static_cast<Json::ArrayIndex>(limit);
+      callback(HttpResponse::newHttpJsonResponse(response));
+      return;
+    }
+
+    std::vector<int64_t> ids;
+    if (!parsePostIds(idsParam, ids)) {
+      callback(postError("ids must be a comma-separated list of post ids",
+                         k400BadRequest));
+      return;
+    }
+    if (ids.size() > kMaxPostIds) {
+      callback(postError("Too many ids (max " + std::to_string(kMaxPostIds) +
+                             ")",
+                         k400BadRequest));
+      return;
+    }
+
+    // Заведомо отсутствующие отсекает ExistenceCache, остальные —
+    // один запрос по ANY и одна общая гидрация
+    auto &existence = services::ExistenceCache::posts();
+    std::vector<int64_t> lookup;
+    std::unordered_map<int64_t, uint64_t> generations;
+    for (auto id : ids) {
+      if (!existence.definitelyMissing(id)) {
+        lookup.push_back(id);
+        generations[id] = existence.generation(id);
+      }
+    }
+
+    Json::Value found(Json::arrayValue);
+    if (!lookup.empty()) {
+      for (const auto &post : repository.findMany(lookup)) {
+        found.append(services::postJson(post));
+      }
+      services::hydratePosts(found, currentUserId);
+    }
+
+    std::unordered_map<int64_t, Json::ArrayIndex> foundById;
+    for (Json::ArrayIndex i = 0; i < found.size(); ++i) {
+      foundById[found[i]["id"].asInt64()] = i;
+    }
+    Json::Value posts(Json::arrayValue);
+    for (auto id : ids) {
+      auto it = foundById.find(id);
+      if (it != foundById.end()) {
+        posts.append(found[it->second]);
+        continue;
+      }
+      // Отсеянные ExistenceCache он и так знает
+      auto generation = generations.find(id);
+      if (generation != generations.end()) {
+        existence.markMissing(id, generation->second);
+      }
+      Json::Value missing;
+      missing["id"] = (Json::Int64)id;
+      missing["missing"] = true;
+      posts.append(missing);
+    }
+
     Json::Value response;
-    response["error"] = "Internal server error";
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    resp->setStatusCode(k500InternalServerError);
-    callback(resp);
+    response["posts"] = posts;
+    callback(HttpResponse::newHttpJsonResponse(response));
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error getting posts: " << e.what();
+    callback(postError("Internal server error", k500InternalServerError));
   }
 }
 
@@ -68,7 +307,7 @@ void PostController::getPost(
     std::function<void(const HttpResponsePtr &)> &&callback,
     int64_t postId) const {
 
-  auto db = drogon::app().getDbClient();
+  auto &repositories = storage::Repositories::instance();
   int64_t currentUserId = 0;
   bool hasCurrentUser = false;
 
@@ -78,13 +317,44 @@ void PostController::getPost(
   } catch (...) {
   }
 
-  try {
-    auto postResult =
-        db->execSqlSync("SELECT id, author_user_id, text, visibility, "
-                        "created_at, updated_at FROM posts WHERE id = $1",
-                        postId);
+  if (services::ExistenceCache::posts().definitelyMissing(postId)) {
+    Json::Value response;
+    response["error"] = "Post not found";
+    auto resp = HttpResponse::newHttpJsonResponse(response);
+    resp->setStatusCode(k404NotFound);
+    callback(resp);
+    return;
+  }
+  auto generation = services::ExistenceCache::posts().generation(postId);
 
-    if (postResult.empty()) {
+  try {
+    // Общая для всех зрителей часть поста грузится один раз на всех
+    // одновременных читателей; is_liked досчитывается отдельно
+    static services::SingleFlight<Json::Value> postLoads("post");
+    auto shared =
+        postLoads.run("post:" + std::to_string(postId), [&]() {
+          auto row = repositories.posts().find(postId);
+
+          if (!row) {
+            return Json::Value();
+          }
+
+          auto post = services::postJson(*row);
+
+          Json::Value attachments(Json::arrayValue);
+          for (const auto &attachment :
+               repositories.attachments().byPost(postId)) {
+            attachments.append(services::attachmentJson(attachment));
+          }
+          post["attachments"] = attachments;
+
+          post["likes_count"] =
+              (Json::Int64)repositories.likes().count(postId);
+          return post;
+        });
+
+    if (shared->isNull()) {
+      services::ExistenceCache::posts().markMissing(postId, generation);
       Json::Value response;
       response["error"] = "Post not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -93,44 +363,11 @@ void PostController::getPost(
       return;
     }
 
-    auto row = postResult[0];
-    Json::Value post;
-    post["id"] = (Json::Int64)row["id"].as<int64_t>();
-    post["author_user_id"] = (Json::Int64)row["author_user_id"].as<int64_t>();
-    post["text"] = row["text"].as<std::string>();
-    post["visibility"] = row["visibility"].as<std::string>();
-    post["created_at"] = row["created_at"].as<std::string>();
-    post["updated_at"] = row["updated_at"].as<std::string>();
-
-    auto attachmentsResult = db->execSqlSync(
-        "SELECT id, type, file_path FROM attachments WHERE post_id = $1",
-        postId);
-
-    Json::Value attachments(Json::arrayValue);
-    for (const auto &attRow : attachmentsResult) {
-      Json::Value attachment;
-      attachment["id"] = (Json::Int64)attRow["id"].as<int64_t>();
-      attachment["type"] = attRow["type"].as<std::string>();
-      attachment["file_path"] = attRow["file_path"].as<std::string>();
-      attachments.append(attachment);
+    Json::Value post = *shared;
+    post["is_liked"] = false;
+    if (hasCurrentUser) {
+      post["is_liked"] = repositories.likes().isLiked(postId, currentUserId);
     }
-    post["attachments"] = attachments;
-
-    auto likesResult =
-        hasCurrentUser
-            ? db->execSqlSync("SELECT COUNT(*) as count, "
-                              "       SUM(CASE WHEN user_id = $1 THEN 1 ELSE 0 "
-                              "END) as liked_by_me "
-                              "FROM likes WHERE post_id = $2",
-                              currentUserId, postId)
-            : db->execSqlSync("SELECT COUNT(*) as count, 0 as liked_by_me "
-                              "FROM likes WHERE post_id = $1",
-                              postId);
-    post["likes_count"] = (Json::Int64)likesResult[0]["count"].as<int64_t>();
-    int64_t likedByMe = likesResult[0]["liked_by_me"].isNull()
-                            ? 0
-                            : likesResult[0]["liked_by_me"].as<int64_t>();
-    post["is_liked"] = likedByMe > 0;
 
     auto resp = HttpResponse::newHttpJsonResponse(post);
     callback(resp);
@@ -162,13 +399,12 @@ void PostController::updatePost(
     return;
   }
 
-  auto db = drogon::app().getDbClient();
+  auto &posts = storage::Repositories::instance().posts();
 
   try {
-    auto postResult = db->execSqlSync(
-        "SELECT author_user_id FROM posts WHERE id = $1", postId);
+    auto author = posts.author(postId);
 
-    if (postResult.empty()) {
+    if (!author) {
       Json::Value response;
       response["error"] = "Post not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -177,7 +413,7 @@ void PostController::updatePost(
       return;
     }
 
-    if (postResult[0]["author_user_id"].as<int64_t>() != userId) {
+    if (*author != userId) {
       Json::Value response;
       response["error"] = "Forbidden";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -186,34 +422,21 @@ void PostController::updatePost(
       return;
     }
 
-    std::vector<std::string> updates;
-    std::vector<std::string> params;
-    int paramIndex = 1;
-
+    storage::PostUpdate update;
     if (json->isMember("text")) {
-      updates.push_back("text = $" + std::to_string(paramIndex++));
-      params.push_back((*json)["text"].asString());
+      update.text = (*json)["text"].asString();
     }
     if (json->isMember("visibility")) {
-      updates.push_back("visibility = $" + std::to_string(paramIndex++));
-      params.push_back((*json)["visibility"].asString());
+      update.visibility = (*json)["visibility"].asString();
     }
 
-    if (!updates.empty()) {
-      updates.push_back("updated_at = now()");
+    if (update.text || update.visibility) {
+      posts.update(postId, update);
 
-      std::string sql = "UPDATE posts SET ";
-      for (size_t i = 0; i < updates.size(); ++i) {
-        sql += updates[i];
-        if (i < updates.size() - 1)
-          sql += ", ";
-      }
-      sql += " WHERE id = $" + std::to_string(paramIndex);
-
-      if (params.size() == 1) {
-        db->execSqlSync(sql, params[0], postId);
-      } else if (params.size() == 2) {
-        db->execSqlSync(sql, params[0], params[1], postId);
+      if (json->isMember("visibility")) {
+        services::PostMetaStore::instance().setVisibility(
+            postId, services::PostMetaStore::parseVisibility(
+                        (*json)["visibility"].asString()));
       }
     }
 
@@ -238,13 +461,12 @@ void PostController::deletePost(
     int64_t postId) const {
 
   auto userId = req->attributes()->get<int64_t>("user_id");
-  auto db = drogon::app().getDbClient();
+  auto &posts = storage::Repositories::instance().posts();
 
   try {
-    auto postResult = db->execSqlSync(
-        "SELECT author_user_id FROM posts WHERE id = $1", postId);
+    auto author = posts.author(postId);
 
-    if (postResult.empty()) {
+    if (!author) {
       Json::Value response;
       response["error"] = "Post not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -253,7 +475,7 @@ void PostController::deletePost(
       return;
     }
 
-    if (postResult[0]["author_user_id"].as<int64_t>() != userId) {
+    if (*author != userId) {
       Json::Value response;
       response["error"] = "Forbidden";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -262,10 +484,9 @@ void PostController::deletePost(
       return;
     }
 
-    db->execSqlSync("DELETE FROM attachments WHERE post_id = $1", postId);
-    db->execSqlSync("DELETE FROM likes WHERE post_id = $1", postId);
-    db->execSqlSync("DELETE FROM comments WHERE post_id = $1", postId);
-    db->execSqlSync("DELETE FROM posts WHERE id = $1", postId);
+    posts.remove(postId);
+    services::PostMetaStore::instance().erase(postId);
+    services::ExistenceCache::posts().removed(postId);
 
     Json::Value response;
     response["success"] = true;
@@ -287,87 +508,22 @@ void PostController::getUserPosts(
     std::function<void(const HttpResponsePtr &)> &&callback,
     int64_t userId) const {
 
-  auto db = drogon::app().getDbClient();
   int64_t currentUserId = 0;
-  bool hasCurrentUser = false;
 
   try {
     currentUserId = req->attributes()->get<int64_t>("user_id");
-    hasCurrentUser = true;
   } catch (...) {
   }
 
   try {
-    auto result =
-        db->execSqlSync("SELECT p.id, p.author_user_id, p.text, p.visibility, "
-                        "p.created_at, p.updated_at, "
-                        "       u.username, u.avatar_path "
-                        "FROM posts p "
-                        "LEFT JOIN users u ON u.user_id = p.author_user_id "
-                        "WHERE p.author_user_id = $1 "
-                        "ORDER BY p.created_at DESC",
-                        userId);
-
     Json::Value posts(Json::arrayValue);
-    for (const auto &row : result) {
-      Json::Value post;
-      post["id"] = (Json::Int64)row["id"].as<int64_t>();
-      post["author_user_id"] = (Json::Int64)row["author_user_id"].as<int64_t>();
-      post["text"] = row["text"].as<std::string>();
-      post["visibility"] = row["visibility"].as<std::string>();
-      post["created_at"] = row["created_at"].as<std::string>();
-      post["updated_at"] = row["updated_at"].as<std::string>();
-
-      if (!row["username"].isNull()) {
-        post["author_username"] = row["username"].as<std::string>();
-      } else {
-        post["author_username"] = "";
-      }
-      if (!row["avatar_path"].isNull()) {
-        post["author_avatar_path"] = row["avatar_path"].as<std::string>();
-      } else {
-        post["author_avatar_path"] = "";
-      }
-
-      int64_t postId = row["id"].as<int64_t>();
-      auto likesResult =
-          hasCurrentUser
-              ? db->execSqlSync("SELECT COUNT(*) as count, "
-                                "       SUM(CASE WHEN user_id = $1 THEN 1 ELSE "
-                                "0 END) as liked_by_me "
-                                "FROM likes WHERE post_id = $2",
-                                currentUserId, postId)
-              : db->execSqlSync("SELECT COUNT(*) as count, 0 as liked_by_me "
-                                "FROM likes WHERE post_id = $1",
-                                postId);
-      post["likes_count"] = (Json::Int64)likesResult[0]["count"].as<int64_t>();
-      int64_t likedByMe = likesResult[0]["liked_by_me"].isNull()
-                              ? 0
-                              : likesResult[0]["liked_by_me"].as<int64_t>();
-      post["is_liked"] = likedByMe > 0;
-
-      auto commentsResult = db->execSqlSync(
-          "SELECT COUNT(*) as count FROM comments WHERE post_id = $1", postId);
-      post["comments_count"] =
-          (Json::Int64)commentsResult[0]["count"].as<int64_t>();
-
-      auto attachmentsResult = db->execSqlSync(
-          "SELECT id, type, file_path FROM attachments WHERE post_id = $1",
-          postId);
-
-      Json::Value attachments(Json::arrayValue);
-      for (const auto &attRow : attachmentsResult) {
-        Json::Value attachment;
-        attachment["id"] = (Json::Int64)attRow["id"].as<int64_t>();
-        attachment["type"] = attRow["type"].as<std::string>();
-        attachment["file_path"] = attRow["file_path"].as<std::string>();
-        attachments.append(attachment);
-      }
-      post["attachments"] = attachments;
-
-      posts.append(post);
+    for (const auto &row :
+         storage::Repositories::instance().posts().byAuthor(userId, 0)) {
+      posts.append(detailedPost(row, currentUserId));
     }
 
+    services::ProfileCache::instance().fillAuthors(posts);
+
     auto resp = HttpResponse::newHttpJsonResponse(posts);
     callback(resp);
 
@@ -387,13 +543,21 @@ void PostController::likePost(
     int64_t postId) const {
 
   auto userId = req->attributes()->get<int64_t>("user_id");
-  auto db = drogon::app().getDbClient();
+  auto &repositories = storage::Repositories::instance();
 
-  try {
-    auto postResult =
-        db->execSqlSync("SELECT id FROM posts WHERE id = $1", postId);
+  if (services::ExistenceCache::posts().definitelyMissing(postId)) {
+    Json::Value response;
+    response["error"] = "Post not found";
+    auto resp = HttpResponse::newHttpJsonResponse(response);
+    resp->setStatusCode(k404NotFound);
+    callback(resp);
+    return;
+  }
+  auto generation = services::ExistenceCache::posts().generation(postId);
 
-    if (postResult.empty()) {
+  try {
+    if (!repositories.posts().author(postId)) {
+      services::ExistenceCache::posts().markMissing(postId, generation);
       Json::Value response;
       response["error"] = "Post not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -402,9 +566,7 @@ void PostController::likePost(
       return;
     }
 
-    db->execSqlSync("INSERT INTO likes (post_id, user_id) VALUES ($1, $2) ON "
-                    "CONFLICT DO NOTHING",
-                    postId, userId);
+    repositories.likes().like(postId, userId);
 
     Json::Value response;
     response["success"] = true;
@@ -427,11 +589,9 @@ void PostController::unlikePost(
     int64_t postId) const {
 
   auto userId = req->attributes()->get<int64_t>("user_id");
-  auto db = drogon::app().getDbClient();
 
   try {
-    db->execSqlSync("DELETE FROM likes WHERE post_id = $1 AND user_id = $2",
-                    postId, userId);
+    storage::Repositories::instance().likes().unlike(postId, userId);
 
     Json::Value response;
     response["success"] = true;
@@ -480,100 +640,25 @@ void PostController::searchPosts(
       limit = 100;
   }
 
-  auto db = drogon::app().getDbClient();
   int64_t currentUserId = 0;
-  bool hasCurrentUser = false;
 
   try {
     currentUserId = req->attributes()->get<int64_t>("user_id");
-    hasCurrentUser = true;
   } catch (...) {
   }
 
   try {
-    std::string sql =
-        "SELECT p.id, p.author_user_id, p.text, p.visibility, p.created_at, "
-        "p.updated_at, "
-        "       u.username, u.avatar_path, "
-        "       ts_rank(to_tsvector('russian', coalesce(p.text, '')), "
-        "               websearch_to_tsquery('russian', $2)) as rank, "
-        "       CASE WHEN p.author_user_id IN ( "
-        "            SELECT following_user_id FROM follows WHERE "
-        "follower_user_id = $1 "
-        "       ) THEN 0 ELSE 1 END AS follow_priority "
-        "FROM posts p "
-        "LEFT JOIN users u ON u.user_id = p.author_user_id "
-        "WHERE p.visibility = 'public' "
-        "  AND to_tsvector('russian', coalesce(p.text, '')) @@ "
-        "websearch_to_tsquery('russian', $2) "
-        "ORDER BY follow_priority ASC, rank DESC, p.created_at DESC "
-        "LIMIT " +
-        std::to_string(limit) + " OFFSET " + std::to_string(offset);
-
-    int64_t userForPriority = hasCurrentUser ? currentUserId : 0;
-
-    auto result = db->execSqlSync(sql, userForPriority, query);
+    // Без пользователя приоритет подписок ни на что не влияет
+    auto rows = storage::Repositories::instance().posts().search(
+        query, currentUserId, limit, offset);
 
     Json::Value posts(Json::arrayValue);
-    for (const auto &row : result) {
-      Json::Value post;
-      post["id"] = (Json::Int64)row["id"].as<int64_t>();
-      post["author_user_id"] = (Json::Int64)row["author_user_id"].as<int64_t>();
-      post["text"] = row["text"].as<std::string>();
-      post["visibility"] = row["visibility"].as<std::string>();
-      post["created_at"] = row["created_at"].as<std::string>();
-      post["updated_at"] = row["updated_at"].as<std::string>();
-
-      if (!row["username"].isNull()) {
-        post["author_username"] = row["username"].as<std::string>();
-      } else {
-        post["author_username"] = "";
-      }
-      if (!row["avatar_path"].isNull()) {
-        post["author_avatar_path"] = row["avatar_path"].as<std::string>();
-      } else {
-        post["author_avatar_path"] = "";
-      }
-
-      int64_t postId = row["id"].as<int64_t>();
-      auto likesResult =
-          hasCurrentUser
-              ? db->execSqlSync("SELECT COUNT(*) as count, "
-                                "       SUM(CASE WHEN user_id = $1 THEN 1 ELSE "
-                                "0 END) as liked_by_me "
-                                "FROM likes WHERE post_id = $2",
-                                currentUserId, postId)
-              : db->execSqlSync("SELECT COUNT(*) as count, 0 as liked_by_me "
-                                "FROM likes WHERE post_id = $1",
-                                postId);
-      post["likes_count"] = (Json::Int64)likesResult[0]["count"].as<int64_t>();
-      int64_t likedByMe = likesResult[0]["liked_by_me"].isNull()
-                              ? 0
-                              : likesResult[0]["liked_by_me"].as<int64_t>();
-      post["is_liked"] = likedByMe > 0;
-
-      auto commentsResult = db->execSqlSync(
-          "SELECT COUNT(*) as count FROM comments WHERE post_id = $1", postId);
-      post["comments_count"] =
-          (Json::Int64)commentsResult[0]["count"].as<int64_t>();
-
-      auto attachmentsResult = db->execSqlSync(
-          "SELECT id, type, file_path FROM attachments WHERE post_id = $1",
-          postId);
-
-      Json::Value attachments(Json::arrayValue);
-      for (const auto &attRow : attachmentsResult) {
-        Json::Value attachment;
-        attachment["id"] = (Json::Int64)attRow["id"].as<int64_t>();
-        attachment["type"] = attRow["type"].as<std::string>();
-        attachment["file_path"] = attRow["file_path"].as<std::string>();
-        attachments.append(attachment);
-      }
-      post["attachments"] = attachments;
-
-      posts.append(post);
+    for (const auto &row : rows) {
+      posts.append(detailedPost(row, currentUserId));
     }
 
+    services::ProfileCache::instance().fillAuthors(posts);
+
     Json::Value response;
     response["posts"] = posts;
     response["offset"] = offset;
@@ -10,6 +10,7 @@ public:
   METHOD_LIST_BEGIN
   
   ADD_METHOD_TO(PostController::createPost, "/posts", Post, "AuthFilter");
+  ADD_METHOD_TO(PostController::getPosts, "/posts", Get);
   ADD_METHOD_TO(PostController::getPost, "/posts/{1}", Get);
   ADD_METHOD_TO(PostController::updatePost, "/posts/{1}", Put, "AuthFilter");
   ADD_METHOD_TO(PostController::deletePost, "/posts/{1}", Delete, "AuthFilter");
@@ -23,6 +24,12 @@ public:
   void createPost(const HttpRequestPtr &req,
                   std::function<void(const HttpResponsePtr &)> &&callback) const;
 
+  // ?ids=1,2,3 (до 200) — посты в порядке запроса, отсутствующие как
+  // {"id", "missing": true}; видимость и is_liked как у getPost.
+  // Без ids — последние публичные посты (offset, limit до 100)
+  void getPosts(const HttpRequestPtr &req,
+                std::function<void(const HttpResponsePtr &)> &&callback) const;
+
   void getPost(const HttpRequestPtr &req,
                std::function<void(const HttpResponsePtr &)> &&callback,
                int64_t postId) const;
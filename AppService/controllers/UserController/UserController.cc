@@ -1,24 +1,84 @@
 #include "UserController.h"
+#include "services/ExistenceCache.h"
+#include "services/PostHydration.h"
+#include "services/ProfileCache.h"
+#include "services/SingleFlight.h"
+#include "storage/Repositories.h"
+#include <algorithm>
 #include <json/value.h>
-#include <drogon/orm/Mapper.h>
 
 using namespace api;
 
+namespace {
+
+Json::Value userJson(const services::ProfileCache::Profile &profile,
+                     const services::ProfileCache::FollowCounts &counts) {
+  Json::Value user;
+  user["user_id"] = (Json::Int64)profile.userId;
+  user["username"] = profile.username;
+  user["display_name"] = profile.displayName;
+  user["bio"] = profile.bio;
+  user["avatar_path"] = profile.avatarPath;
+  user["created_at"] = profile.createdAt;
+  user["followers_count"] = (Json::Int64)counts.followers;
+  user["following_count"] = (Json::Int64)counts.following;
+  return user;
+}
+
+// Элемент списков подписчиков и подписок
+Json::Value userSummaryJson(const storage::User &row) {
+  Json::Value user;
+  user["user_id"] = (Json::Int64)row.userId;
+  user["username"] = row.username;
+  user["display_name"] = row.displayName;
+  user["avatar_path"] = row.avatarPath;
+  return user;
+}
+
+int limitParameter(const HttpRequestPtr &req, const std::string &name,
+                   int defaultValue, int maxValue) {
+  auto value = req->getParameter(name);
+  if (value.empty()) {
+    return defaultValue;
+  }
+  try {
+    return std::clamp(std::stoi(value), 1, maxValue);
+  } catch (const std::exception &) {
+    return defaultValue;
+  }
+}
+
+} // namespace
+
 void UserController::getUser(
     const HttpRequestPtr &req,
     std::function<void(const HttpResponsePtr &)> &&callback,
     int64_t userId) const {
   
-  auto db = drogon::app().getDbClient();
-  
+  if (services::ExistenceCache::users().definitelyMissing(userId)) {
+    Json::Value response;
+    response["error"] = "User not found";
+    auto resp = HttpResponse::newHttpJsonResponse(response);
+    resp->setStatusCode(k404NotFound);
+    callback(resp);
+    return;
+  }
+  auto generation = services::ExistenceCache::users().generation(userId);
+
   try {
-    auto result = db->execSqlSync(
-      "SELECT user_id, username, display_name, bio, avatar_path, created_at "
-      "FROM users WHERE user_id = $1",
-      userId
-    );
+    static services::SingleFlight<Json::Value> userLoads("user");
+    auto loaded = userLoads.run("user:" + std::to_string(userId), [&]() {
+      auto &cache = services::ProfileCache::instance();
+      auto profile = cache.get(userId);
+      if (!profile || !profile->exists) {
+        return Json::Value();
+      }
 
-    if (result.empty()) {
+      return userJson(*profile, cache.getCounts(userId));
+    });
+
+    if (loaded->isNull()) {
+      services::ExistenceCache::users().markMissing(userId, generation);
       Json::Value response;
       response["error"] = "User not found";
       auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -27,27 +87,7 @@ void UserController::getUser(
       return;
     }
 
-    auto row = result[0];
-    Json::Value user;
-    user["user_id"] = (Json::Int64)row["user_id"].as<int64_t>();
-    user["username"] = row["username"].as<std::string>();
-    user["display_name"] = row["display_name"].isNull() ? "" : row["display_name"].as<std::string>();
-    user["bio"] = row["bio"].isNull() ? "" : row["bio"].as<std::string>();
-    user["avatar_path"] = row["avatar_path"].isNull() ? "" : row["avatar_path"].as<std::string>();
-    user["created_at"] = row["created_at"].as<std::string>();
-
-    auto followersCount = db->execSqlSync(
-      "SELECT COUNT(*) as count FROM follows WHERE following_user_id = $1",
-      userId
-    );
-    user["followers_count"] = (Json::Int64)followersCount[0]["count"].as<int64_t>();
-
-    auto followingCount = db->execSqlSync(
-      "SELECT COUNT(*) as count FROM follows WHERE follower_user_id = $1",
-      userId
-    );
-    user["following_count"] = (Json::Int64)followingCount[0]["count"].as<int64_t>();
-
+    const auto &user = *loaded;
     auto resp = HttpResponse::newHttpJsonResponse(user);
     callback(resp);
 
@@ -77,59 +117,35 @@ void UserController::updateProfile(
     return;
   }
 
-  auto db = drogon::app().getDbClient();
+  auto &users = storage::Repositories::instance().users();
 
   try {
-    auto existingUser = db->execSqlSync(
-      "SELECT id FROM users WHERE user_id = $1",
-      userId
-    );
-
-    if (existingUser.empty()) {
-      std::string username = json->get("username", "").asString();
-      std::string displayName = json->get("display_name", "").asString();
-      std::string bio = json->get("bio", "").asString();
-      
-      db->execSqlSync(
-        "INSERT INTO users (user_id, username, display_name, bio) VALUES ($1, $2, $3, $4)",
-        userId, username, displayName, bio
-      );
+    if (!users.exists(userId)) {
+      storage::User user;
+      user.userId = userId;
+      user.username = json->get("username", "").asString();
+      user.displayName = json->get("display_name", "").asString();
+      user.bio = json->get("bio", "").asString();
+
+      users.create(user);
+      services::ExistenceCache::users().added(userId);
     } else {
-      std::vector<std::string> updates;
-      std::vector<std::string> params;
-      int paramIndex = 1;
-
+      storage::ProfileUpdate update;
       if (json->isMember("display_name")) {
-        updates.push_back("display_name = $" + std::to_string(paramIndex++));
-        params.push_back((*json)["display_name"].asString());
+        update.displayName = (*json)["display_name"].asString();
       }
       if (json->isMember("bio")) {
-        updates.push_back("bio = $" + std::to_string(paramIndex++));
-        params.push_back((*json)["bio"].asString());
+        update.bio = (*json)["bio"].asString();
       }
       if (json->isMember("avatar_path")) {
-        updates.push_back("avatar_path = $" + std::to_string(paramIndex++));
-        params.push_back((*json)["avatar_path"].asString());
+        update.avatarPath = (*json)["avatar_path"].asString();
       }
 
-      if (!updates.empty()) {
-        std::string sql = "UPDATE users SET ";
-        for (size_t i = 0; i < updates.size(); ++i) {
-          sql += updates[i];
-          if (i < updates.size() - 1) sql += ", ";
-        }
-        sql += " WHERE user_id = $" + std::to_string(paramIndex);
-
-        if (params.size() == 1) {
-          db->execSqlSync(sql, params[0], userId);
-        } else if (params.size() == 2) {
-          db->execSqlSync(sql, params[0], params[1], userId);
-        } else if (params.size() == 3) {
-          db->execSqlSync(sql, params[0], params[1], params[2], userId);
-        }
-      }
+      users.update(userId, update);
     }
 
+    services::ProfileCache::instance().invalidate(userId);
+
     Json::Value response;
     response["success"] = true;
     auto resp = HttpResponse::newHttpJsonResponse(response);
@@ -161,13 +177,11 @@ void UserController::followUser(
     return;
   }
 
-  auto db = drogon::app().getDbClient();
-
   try {
-    db->execSqlSync(
-      "INSERT INTO follows (follower_user_id, following_user_id) VALUES ($1, $2) ON CONFLICT DO NOTHING",
-      currentUserId, targetUserId
-    );
+    storage::Repositories::instance().follows().follow(currentUserId,
+                                                       targetUserId);
+    services::ProfileCache::instance().invalidateCounts(currentUserId);
+    services::ProfileCache::instance().invalidateCounts(targetUserId);
 
     Json::Value response;
     response["success"] = true;
@@ -190,13 +204,12 @@ void UserController::unfollowUser(
     int64_t targetUserId) const {
   
   auto currentUserId = req->attributes()->get<int64_t>("user_id");
-  auto db = drogon::app().getDbClient();
 
   try {
-    db->execSqlSync(
-      "DELETE FROM follows WHERE follower_user_id = $1 AND following_user_id = $2",
-      currentUserId, targetUserId
-    );
+    storage::Repositories::instance().follows().unfollow(currentUserId,
+                                                         targetUserId);
+    services::ProfileCache::instance().invalidateCounts(currentUserId);
+    services::ProfileCache::instance().invalidateCounts(targetUserId);
 
     Json::Value response;
     response["success"] = true;
@@ -217,28 +230,20 @@ void UserController::getFollowers(
     const HttpRequestPtr &req,
     std::function<void(const HttpResponsePtr &)> &&callback,
     int64_t userId) const {
-  
-  auto db = drogon::app().getDbClient();
 
   try {
-    auto result = db->execSqlSync(
-      "SELECT u.user_id, u.username, u.display_name, u.avatar_path "
-      "FROM users u "
-      "INNER JOIN follows f ON f.follower_user_id = u.user_id "
-      "WHERE f.following_user_id = $1 "
-      "ORDER BY f.created_at DESC",
-      userId
-    );
-
-    Json::Value followers(Json::arrayValue);
-    for (const auto &row : result) {
-      Json::Value user;
-      user["user_id"] = (Json::Int64)row["user_id"].as<int64_t>();
-      user["username"] = row["username"].as<std::string>();
-      user["display_name"] = row["display_name"].isNull() ? "" : row["display_name"].as<std::string>();
-      user["avatar_path"] = row["avatar_path"].isNull() ? "" : row["avatar_path"].as<std::string>();
-      followers.append(user);
-    }
+    static services::SingleFlight<Json::Value> followersLoads("followers");
+    auto loaded = followersLoads.run("followers:" + std::to_string(userId), [&]() {
+      auto &follows = storage::Repositories::instance().follows();
+      auto users = follows.followerProfiles(userId, 0);
+
+      Json::Value followers(Json::arrayValue);
+      for (const auto &user : users) {
+        followers.append(userSummaryJson(user));
+      }
+      return followers;
+    });
+    const auto &followers = *loaded;
 
     auto resp = HttpResponse::newHttpJsonResponse(followers);
     callback(resp);
@@ -257,28 +262,20 @@ void UserController::getFollowing(
     const HttpRequestPtr &req,
     std::function<void(const HttpResponsePtr &)> &&callback,
     int64_t userId) const {
-  
-  auto db = drogon::app().getDbClient();
 
   try {
-    auto result = db->execSqlSync(
-      "SELECT u.user_id, u.username, u.display_name, u.avatar_path "
-      "FROM users u "
-      "INNER JOIN follows f ON f.following_user_id = u.user_id "
-      "WHERE f.follower_user_id = $1 "
-      "ORDER BY f.created_at DESC",
-      userId
-    );
-
-    Json::Value following(Json::arrayValue);
-    for (const auto &row : result) {
-      Json::Value user;
-      user["user_id"] = (Json::Int64)row["user_id"].as<int64_t>();
-      user["username"] = row["username"].as<std::string>();
-      user["display_name"] = row["display_name"].isNull() ? "" : row["display_name"].as<std::string>();
-      user["avatar_path"] = row["avatar_path"].isNull() ? "" : row["avatar_path"].as<std::string>();
-      following.append(user);
-    }
+    static services::SingleFlight<Json::Value> followingLoads("following");
+    auto loaded = followingLoads.run("following:" + std::to_string(userId), [&]() {
+      auto &follows = storage::Repositories::instance().follows();
+      auto users = follows.followingProfiles(userId);
+
+      Json::Value following(Json::arrayValue);
+      for (const auto &user : users) {
+        following.append(userSummaryJson(user));
+      }
+      return following;
+    });
+    const auto &following = *loaded;
 
     auto resp = HttpResponse::newHttpJsonResponse(following);
     callback(resp);
@@ -292,3 +289,75 @@ void UserController::getFollowing(
     callback(resp);
   }
 }
+
+void UserController::getProfilePage(
+    const HttpRequestPtr &req,
+    std::function<void(const HttpResponsePtr &)> &&callback,
+    int64_t userId) const {
+
+  auto viewerId = req->attributes()->get<int64_t>("user_id");
+  int postsLimit = limitParameter(req, "posts_limit", 20, 100);
+  int followersLimit = limitParameter(req, "followers_limit", 10, 50);
+
+  if (services::ExistenceCache::users().definitelyMissing(userId)) {
+    Json::Value response;
+    response["error"] = "User not found";
+    auto resp = HttpResponse::newHttpJsonResponse(response);
+    resp->setStatusCode(k404NotFound);
+    callback(resp);
+    return;
+  }
+  auto generation = services::ExistenceCache::users().generation(userId);
+
+  try {
+    auto &cache = services::ProfileCache::instance();
+    auto profile = cache.get(userId);
+    if (!profile || !profile->exists) {
+      services::ExistenceCache::users().markMissing(userId, generation);
+      Json::Value response;
+      response["error"] = "User not found";
+      auto resp = HttpResponse::newHttpJsonResponse(response);
+      resp->setStatusCode(k404NotFound);
+      callback(resp);
+      return;
+    }
+
+    Json::Value response;
+    response["user"] = userJson(*profile, cache.getCounts(userId));
+
+    // Посты, подписчики и подписка зрителя — одно составное чтение:
+    // в Postgres его части идут в базу одновременно. Лишний пост
+    // только сообщает, что есть ещё
+    auto slice = storage::Repositories::instance().profileSlice(
+        userId, viewerId, postsLimit + 1, followersLimit);
+    Json::Value posts(Json::arrayValue);
+    for (const auto &post : slice.posts) {
+      if (posts.size() == static_cast<Json::ArrayIndex>(postsLimit)) {
+        break;
+      }
+      posts.append(services::postJson(post));
+    }
+    services::hydratePosts(posts, viewerId);
+    response["posts"] = posts;
+    response["has_more_posts"] =
+        slice.posts.size() > static_cast<size_t>(postsLimit);
+
+    Json::Value followers(Json::arrayValue);
+    for (const auto &user : slice.followers) {
+      followers.append(userSummaryJson(user));
+    }
+    response["followers"] = followers;
+    response["is_following"] = slice.isFollowing;
+
+    auto resp = HttpResponse::newHttpJsonResponse(response);
+    callback(resp);
+
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Error getting profile page: " << e.what();
+    Json::Value response;
+    response["error"] = "Internal server error";
+    auto resp = HttpResponse::newHttpJsonResponse(response);
+    resp->setStatusCode(k500InternalServerError);
+    callback(resp);
+  }
+}
@@ -15,6 +15,7 @@ public:
   ADD_METHOD_TO(UserController::unfollowUser, "/users/{1}/follow", Delete, "AuthFilter");
   ADD_METHOD_TO(UserController::getFollowers, "/users/{1}/followers", Get);
   ADD_METHOD_TO(UserController::getFollowing, "/users/{1}/following", Get);
+  ADD_METHOD_TO(UserController::getProfilePage, "/users/{1}/profile-page", Get, "AuthFilter");
   
   METHOD_LIST_END
 
@@ -40,5 +41,12 @@ public:
   void getFollowing(const HttpRequestPtr &req,
                     std::function<void(const HttpResponsePtr &)> &&callback,
                     int64_t userId) const;
+
+  // Всё для страницы профиля одним ответом: профиль со счётчиками,
+  // первая страница постов (posts_limit, до 100), превью подписчиков
+  // (followers_limit, до 50) и is_following для текущего пользователя
+  void getProfilePage(const HttpRequestPtr &req,
+                      std::function<void(const HttpResponsePtr &)> &&callback,
+                      int64_t userId) const;
 };
 }
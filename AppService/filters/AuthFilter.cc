@@ -7,6 +7,13 @@
 void AuthFilter::doFilter(const HttpRequestPtr &req,
                           FilterCallback &&fcb,
                           FilterChainCallback &&fccb) {
+  // Подзапросы POST /batch: токен проверен при входе в /batch, user_id
+  // уже в атрибутах (снаружи атрибуты задать нельзя)
+  if (req->attributes()->find("user_id")) {
+    fccb();
+    return;
+  }
+
   auto authHeader = req->getHeader("Authorization");
   
   if (authHeader.empty()) {
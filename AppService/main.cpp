@@ -1,8 +1,73 @@
+#include "capture/CaptureAdvice.h"
+#include "capture/TrafficCapture.h"
+#include "services/AdmissionControl.h"
+#include "services/ExistenceCache.h"
+#include "services/FeedHub.h"
+#include "services/HotFileCache.h"
+#include "services/MediaGc.h"
+#include "services/MediaIo.h"
+#include "services/Metrics.h"
+#include "services/PostMetaStore.h"
+#include "services/ProfileCache.h"
+#include "services/RateLimiter.h"
+#include "services/SingleFlight.h"
+#include "services/ThumbnailPipeline.h"
+#include "services/UploadSessions.h"
+#include "storage/Deadline.h"
+#include "storage/Repositories.h"
 #include <drogon/drogon.h>
+#include <fstream>
+#include <thread>
 
 int main() {
   LOG_DEBUG << "Load config file";
-  drogon::app().loadConfigFile("config.json");
+  Json::Value config;
+  {
+    std::ifstream file("config.json");
+    Json::CharReaderBuilder reader;
+    std::string errors;
+    if (!Json::parseFromStream(reader, file, &config, &errors)) {
+      LOG_FATAL << "Invalid config.json: " << errors;
+      return 1;
+    }
+  }
+  if (storage::kInMemory) {
+    // Без пула Postgres: Drogon не пытается подключиться к базе
+    config.removeMember("db_clients");
+  }
+  drogon::app().loadConfigJson(config);
+
+  if (storage::kInMemory) {
+    // Данные живут только в процессе: заполняем их до загрузки
+    // индексов, которые читают хранилище при старте
+    auto memoryConfig = drogon::app().getCustomConfig()["memory_storage"];
+    storage::SeedOptions seed;
+    seed.users = memoryConfig.get("users", 0).asUInt64();
+    seed.postsPerUser = memoryConfig.get("posts_per_user", 0).asUInt64();
+    seed.followsPerUser =
+        memoryConfig.get("follows_per_user", 0).asUInt64();
+    storage::Repositories::instance().seed(seed);
+    LOG_INFO << "In-memory storage seeded: " << seed.users << " users";
+  }
+
+  // Запись выборки трафика для tools/replay. Регистрируется первой,
+  // чтобы видеть и preflight, и то, что отклонят лимиты
+  if (services::startTrafficCapture(
+          drogon::app().getCustomConfig()["traffic_capture"],
+          "app_service")) {
+    // Счётчики растут монотонно, но живут в TrafficCapture: тот же
+    // класс собирается в AuthService, где реестра метрик нет
+    auto &traffic = services::TrafficCapture::instance();
+    auto &metrics = services::Metrics::instance();
+    metrics.gauge("traffic_capture_records",
+                  "Requests written to the capture log",
+                  [&traffic]() { return double(traffic.captured()); });
+    metrics.gauge("traffic_capture_dropped",
+                  "Sampled requests dropped because the writer lagged",
+                  [&traffic]() { return double(traffic.dropped()); });
+    metrics.gauge("traffic_capture_bytes", "Capture log size",
+                  [&traffic]() { return double(traffic.bytesWritten()); });
+  }
 
   // Add CORS support for frontend
   drogon::app().registerPreRoutingAdvice([](const drogon::HttpRequestPtr &req,
@@ -12,8 +77,10 @@ int main() {
     if (req->method() == drogon::HttpMethod::Options) {
       auto resp = drogon::HttpResponse::newHttpResponse();
       resp->addHeader("Access-Control-Allow-Origin", "*");
-      resp->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-      resp->addHeader("Access-Control-Allow-Headers", "Content-Type, Authorization");
+      resp->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, PATCH, DELETE, HEAD, OPTIONS");
+      resp->addHeader("Access-Control-Allow-Headers",
+                      "Content-Type, Authorization, Upload-Offset, Upload-Length, "
+                      "Upload-Metadata, Upload-Checksum, Tus-Resumable");
       resp->addHeader("Access-Control-Max-Age", "86400");
       acb(resp);
       return;
@@ -25,10 +92,325 @@ int main() {
   drogon::app().registerPostHandlingAdvice([](const drogon::HttpRequestPtr &,
                                              const drogon::HttpResponsePtr &resp) {
     resp->addHeader("Access-Control-Allow-Origin", "*");
-    resp->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-    resp->addHeader("Access-Control-Allow-Headers", "Content-Type, Authorization");
+    resp->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, PATCH, DELETE, HEAD, OPTIONS");
+    resp->addHeader("Access-Control-Allow-Headers",
+                    "Content-Type, Authorization, Upload-Offset, Upload-Length, "
+                    "Upload-Metadata, Upload-Checksum, Tus-Resumable");
+    resp->addHeader("Access-Control-Expose-Headers",
+                    "Location, Upload-Offset, Upload-Length, Upload-Expires, "
+                    "Retry-After");
   });
 
+  // Ограничение частоты: бакеты по IP и по пользователю, стоимость
+  // маршрутов из конфига. Регистрируется после CORS, чтобы preflight не
+  // тратил лимит
+  auto rateLimitConfig = drogon::app().getCustomConfig()["rate_limit"];
+  if (rateLimitConfig.get("enabled", true).asBool()) {
+    services::RateLimiter::Config rateLimit;
+    rateLimit.user.ratePerSecond =
+        rateLimitConfig["user"].get("rate_per_second", 20).asDouble();
+    rateLimit.user.burst = rateLimitConfig["user"].get("burst", 60).asDouble();
+    rateLimit.ip.ratePerSecond =
+        rateLimitConfig["ip"].get("rate_per_second", 100).asDouble();
+    rateLimit.ip.burst = rateLimitConfig["ip"].get("burst", 300).asDouble();
+    rateLimit.maxBuckets =
+        rateLimitConfig.get("max_buckets", 262144).asUInt64();
+    for (const auto &route : rateLimitConfig["routes"]) {
+      rateLimit.routes.push_back({route.get("method", "").asString(),
+                                  route["path"].asString(),
+                                  route.get("cost", 1).asUInt()});
+    }
+    services::RateLimiter::instance().configure(rateLimit);
+
+    // Ответ 429 или продолжение цепочки advice
+    auto admit = [](const services::RateLimiter::Request &request,
+                    drogon::AdviceCallback &acb,
+                    drogon::AdviceChainCallback &accb) {
+      auto decision = services::RateLimiter::instance().admit(request);
+      if (decision.allowed) {
+        accb();
+        return;
+      }
+      Json::Value body;
+      body["error"] = "Too many requests";
+      auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
+      resp->setStatusCode(drogon::k429TooManyRequests);
+      resp->addHeader("Retry-After",
+                      std::to_string(decision.retryAfterSeconds));
+      resp->addHeader("Access-Control-Allow-Origin", "*");
+      resp->addHeader("Access-Control-Expose-Headers", "Retry-After");
+      acb(resp);
+    };
+
+    // Уровень IP до роутинга. Подзапросы POST /batch (app().forward)
+    // приходят без адреса клиента и уже с user_id: сам /batch IP
+    // оплатил, их ограничивает уровень пользователя
+    drogon::app().registerPreRoutingAdvice(
+        [admit](const drogon::HttpRequestPtr &req,
+                drogon::AdviceCallback &&acb,
+                drogon::AdviceChainCallback &&accb) {
+          if (req->attributes()->find("user_id")) {
+            accb();
+            return;
+          }
+          services::RateLimiter::Request request;
+          request.method = req->methodString();
+          request.path = req->path();
+          const auto &peer = req->peerAddr();
+          request.ipKey =
+              peer.isIpV6()
+                  ? services::RateLimiter::ipv6Key(peer.ip6NetEndian())
+                  : services::RateLimiter::ipv4Key(peer.ipNetEndian());
+          admit(request, acb, accb);
+        });
+
+    // Уровень пользователя после AuthFilter, по проверенному user_id
+    drogon::app().registerPreHandlingAdvice(
+        [admit](const drogon::HttpRequestPtr &req,
+                drogon::AdviceCallback &&acb,
+                drogon::AdviceChainCallback &&accb) {
+          if (!req->attributes()->find("user_id")) {
+            accb();
+            return;
+          }
+          services::RateLimiter::Request request;
+          request.method = req->methodString();
+          request.path = req->path();
+          request.userId = req->attributes()->get<int64_t>("user_id");
+          admit(request, acb, accb);
+        });
+  }
+
+  // Отказ под перегрузкой и дедлайны запросов. Очередь меряется
+  // опозданием пробных таймеров IO-циклов и задержкой от разбора
+  // запроса (creationDate) до входа в обработчик
+  auto admissionConfig = drogon::app().getCustomConfig()["admission"];
+  if (admissionConfig.get("enabled", true).asBool()) {
+    services::AdmissionControl::Config admission;
+    admission.target = std::chrono::milliseconds(
+        admissionConfig.get("target_ms", 20).asInt64());
+    admission.interval = std::chrono::milliseconds(
+        admissionConfig.get("interval_ms", 100).asInt64());
+    admission.recoverIntervals =
+        admissionConfig.get("recover_intervals", 10).asInt();
+    const auto &deadlines = admissionConfig["deadline_ms"];
+    const char *classNames[] = {"critical", "write", "feed_tail", "search"};
+    for (size_t i = 0; i < services::AdmissionControl::kClassCount; ++i) {
+      admission.deadline[i] = std::chrono::milliseconds(
+          deadlines.get(classNames[i], admission.deadline[i].count())
+              .asInt64());
+    }
+    services::AdmissionControl::instance().configure(admission);
+
+    drogon::app().registerPreHandlingAdvice(
+        [](const drogon::HttpRequestPtr &req, drogon::AdviceCallback &&acb,
+           drogon::AdviceChainCallback &&accb) {
+          auto &control = services::AdmissionControl::instance();
+          auto routeClass = control.classify(req->methodString(), req->path(),
+                                             req->getParameter("offset"));
+          auto createdUs = req->creationDate().microSecondsSinceEpoch();
+          auto sojourn = std::chrono::microseconds(
+              trantor::Date::now().microSecondsSinceEpoch() - createdUs);
+          // Обработчики, которые сами ждут (POST /batch), урезают по
+          // нему свои таймауты
+          auto deadlineUs = static_cast<int64_t>(
+              createdUs +
+              std::chrono::microseconds(control.deadline(routeClass))
+                  .count());
+          req->attributes()->insert("deadline_us", deadlineUs);
+
+          auto verdict = control.admit(routeClass, sojourn);
+          if (verdict == services::AdmissionControl::Verdict::kAdmit) {
+            // Синхронная часть обработчика выполняется внутри accb():
+            // запросы репозиториев к базе ждут не дольше дедлайна, а
+            // после него в пул не уходят
+            storage::DeadlineScope scope(deadlineUs);
+            accb();
+            return;
+          }
+          Json::Value body;
+          body["error"] =
+              verdict == services::AdmissionControl::Verdict::kShed
+                  ? "Server overloaded"
+                  : "Request deadline exceeded";
+          auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
+          resp->setStatusCode(drogon::k503ServiceUnavailable);
+          resp->addHeader("Retry-After", "1");
+          acb(resp);
+        });
+
+    // Запрос к базе, брошенный по дедлайну (storage::DeadlineExceeded),
+    // обработчики отдают как 500; для клиента это перегрузка, а не
+    // ошибка сервера
+    drogon::app().registerPostHandlingAdvice(
+        [](const drogon::HttpRequestPtr &req,
+           const drogon::HttpResponsePtr &resp) {
+          if (resp->statusCode() != drogon::k500InternalServerError ||
+              !req->attributes()->find("deadline_us") ||
+              req->attributes()->get<int64_t>("deadline_us") >
+                  trantor::Date::now().microSecondsSinceEpoch()) {
+            return;
+          }
+          resp->setStatusCode(drogon::k503ServiceUnavailable);
+          resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+          resp->setBody(R"({"error":"Request deadline exceeded"})");
+          resp->addHeader("Retry-After", "1");
+        });
+
+    auto interval = static_cast<double>(admission.interval.count()) / 1000;
+    drogon::app().registerBeginningAdvice([interval]() {
+      drogon::app().getLoop()->runEvery(
+          interval, []() { services::AdmissionControl::instance().tick(); });
+      for (size_t i = 0; i < drogon::app().getThreadNum(); ++i) {
+        services::AdmissionControl::instance().watchLoop(
+            drogon::app().getIOLoop(i));
+      }
+    });
+  }
+
+  // Колоночный индекс метаданных постов для фильтрации ленты.
+  // Загружается в фоне: пока он не готов, лента читает из хранилища.
+  auto postMetaConfig = drogon::app().getCustomConfig()["post_meta_store"];
+  if (postMetaConfig.get("enabled", true).asBool()) {
+    services::PostMetaStore::instance().reserve(
+        postMetaConfig.get("expected_posts", 50000000).asUInt64());
+    drogon::app().registerBeginningAdvice([]() {
+      std::thread([]() {
+        try {
+          services::PostMetaStore::instance().load();
+        } catch (const std::exception &e) {
+          LOG_ERROR << "Error loading post metadata store: " << e.what();
+        }
+      }).detach();
+    });
+  }
+
+  auto profileCacheConfig = drogon::app().getCustomConfig()["profile_cache"];
+  services::ProfileCache::instance().configure(
+      profileCacheConfig.get("enabled", true).asBool(),
+      profileCacheConfig.get("max_entries", 1000000).asUInt64());
+
+  // Фильтры существования постов и пользователей для быстрых 404
+  auto existenceConfig = drogon::app().getCustomConfig()["existence_cache"];
+  if (existenceConfig.get("enabled", true).asBool()) {
+    drogon::app().registerBeginningAdvice([]() {
+      std::thread([]() {
+        auto &repositories = storage::Repositories::instance();
+        try {
+          services::ExistenceCache::posts().load([&](int64_t afterId) {
+            return repositories.posts().scanIds(afterId, 100000);
+          });
+          services::ExistenceCache::users().load([&](int64_t afterId) {
+            return repositories.users().scanIds(afterId, 100000);
+          });
+        } catch (const std::exception &e) {
+          LOG_ERROR << "Error loading existence filters: " << e.what();
+        }
+      }).detach();
+    });
+  }
+
+  services::singleFlightTimeoutMs() =
+      drogon::app().getCustomConfig()["single_flight"]
+          .get("timeout_ms", 5000)
+          .asInt64();
+
+  // Файловый ввод-вывод медиа: io_uring, если ядро и seccomp позволяют,
+  // иначе пул потоков
+  auto mediaIoConfig = drogon::app().getCustomConfig()["media_io"];
+  services::MediaIo::Config mediaIo;
+  mediaIo.backend = mediaIoConfig.get("backend", "auto").asString();
+  mediaIo.queueDepth = mediaIoConfig.get("queue_depth", 256).asUInt();
+  mediaIo.threads = mediaIoConfig.get("threads", 4).asUInt64();
+  mediaIo.fixedBuffers = mediaIoConfig.get("fixed_buffers", 16).asUInt64();
+  mediaIo.bufferSize = mediaIoConfig.get("buffer_size", 1048576).asUInt64();
+  services::MediaIo::instance().configure(mediaIo);
+  LOG_INFO << "Media I/O backend: "
+           << services::MediaIo::instance().backendName()
+           << (services::MediaIo::instance().buffersRegistered()
+                   ? ", registered buffers"
+                   : "");
+
+  // Кэш небольших медиафайлов для GET /media
+  auto mediaCacheConfig = drogon::app().getCustomConfig()["media_cache"];
+  services::HotFileCache::instance().configure(
+      mediaCacheConfig.get("max_bytes", 67108864).asUInt64(),
+      mediaCacheConfig.get("max_file_bytes", 262144).asUInt64());
+
+  // Превью фотографий: пул потоков с ограниченной очередью. Очередь
+  // и результаты — в media_objects, поэтому только с Postgres
+  auto thumbnailConfig = drogon::app().getCustomConfig()["thumbnails"];
+  if (!storage::kInMemory && thumbnailConfig.get("enabled", true).asBool()) {
+    std::vector<int> widths;
+    for (const auto &width : thumbnailConfig["widths"]) {
+      widths.push_back(width.asInt());
+    }
+    if (widths.empty()) {
+      widths = {320, 640, 1280};
+    }
+    services::ThumbnailPipeline::instance().start(
+        thumbnailConfig.get("workers", 2).asUInt(),
+        thumbnailConfig.get("queue_size", 256).asUInt(), std::move(widths),
+        thumbnailConfig.get("quality", 80).asInt());
+  }
+
+  // Возобновляемые загрузки: лимиты и периодическое удаление брошенных
+  auto uploadSessionsConfig = drogon::app().getCustomConfig()["upload_sessions"];
+  services::UploadSessions::instance().configure(
+      uploadSessionsConfig.get("max_upload_bytes", 2147483648LL).asInt64(),
+      std::chrono::seconds(
+          uploadSessionsConfig.get("ttl_seconds", 86400).asInt64()),
+      uploadSessionsConfig.get("max_active_per_user", 5).asUInt64());
+  auto sweepInterval =
+      uploadSessionsConfig.get("sweep_interval_seconds", 300).asDouble();
+  if (!storage::kInMemory) {
+    drogon::app().registerBeginningAdvice([sweepInterval]() {
+      drogon::app().getLoop()->runEvery(sweepInterval, []() {
+        services::UploadSessions::instance().expire(
+            drogon::app().getDbClient());
+      });
+    });
+  }
+
+  // Сборка мусора в uploads/: файлы без ссылок старше grace
+  auto mediaGcConfig = drogon::app().getCustomConfig()["media_gc"];
+  if (!storage::kInMemory && mediaGcConfig.get("enabled", true).asBool()) {
+    services::MediaGc::Config mediaGc;
+    mediaGc.grace = std::chrono::seconds(
+        mediaGcConfig.get("grace_seconds", 86400).asInt64());
+    mediaGc.batchSize = mediaGcConfig.get("batch_size", 500).asUInt64();
+    mediaGc.maxDeletesPerSecond =
+        mediaGcConfig.get("max_deletes_per_second", 200).asDouble();
+    mediaGc.dryRun = mediaGcConfig.get("dry_run", false).asBool();
+    services::MediaGc::instance().configure(mediaGc);
+    auto gcInterval = std::chrono::seconds(
+        mediaGcConfig.get("interval_seconds", 3600).asInt64());
+    drogon::app().registerBeginningAdvice([gcInterval]() {
+      services::MediaGc::instance().start(gcInterval);
+    });
+  }
+
+  // Push новых постов по SSE (GET /feed/stream)
+  auto feedStreamConfig = drogon::app().getCustomConfig()["feed_stream"];
+  services::FeedHub::Config feedStream;
+  feedStream.enabled = feedStreamConfig.get("enabled", true).asBool();
+  feedStream.queueSize = feedStreamConfig.get("queue_size", 64).asUInt64();
+  feedStream.heartbeat = std::chrono::seconds(
+      feedStreamConfig.get("heartbeat_seconds", 25).asInt64());
+  feedStream.idleTimeout = std::chrono::seconds(
+      feedStreamConfig.get("idle_timeout_seconds", 1800).asInt64());
+  feedStream.maxStreamsPerUser =
+      feedStreamConfig.get("max_streams_per_user", 8).asUInt64();
+  feedStream.sendBufferBytes =
+      feedStreamConfig.get("send_buffer_bytes", 262144).asUInt64();
+  feedStream.stallTimeout = std::chrono::seconds(
+      feedStreamConfig.get("stall_timeout_seconds", 30).asInt64());
+  services::FeedHub::instance().configure(feedStream);
+  if (feedStream.enabled) {
+    drogon::app().registerBeginningAdvice(
+        []() { services::FeedHub::instance().start(); });
+  }
+
   LOG_DEBUG << "running on localhost:3001";
   drogon::app().run();
   return 0;
@@ -0,0 +1,12 @@
+-- Контентно-адресуемые загрузки: один файл на уникальное содержимое
+-- (и расширение). ref_count — число строк attachments с этим file_path.
+CREATE TABLE IF NOT EXISTS media_objects (
+  file_path VARCHAR(512) PRIMARY KEY,
+  digest CHAR(64) NOT NULL,
+  size_bytes BIGINT NOT NULL,
+  ref_count INT NOT NULL DEFAULT 0,
+  created_at TIMESTAMP NOT NULL DEFAULT now()
+);
+
+CREATE INDEX IF NOT EXISTS idx_media_digest ON media_objects(digest);
+CREATE INDEX IF NOT EXISTS idx_attachments_file_path ON attachments(file_path);
@@ -0,0 +1,7 @@
+-- Метаданные фотографий, которые заполняет ThumbnailPipeline:
+-- исходные размеры, BlurHash и уменьшенные JPEG-варианты
+-- ([{"width": 320, "height": 240, "file_path": "uploads/..."}]).
+ALTER TABLE media_objects ADD COLUMN IF NOT EXISTS width INT;
+ALTER TABLE media_objects ADD COLUMN IF NOT EXISTS height INT;
+ALTER TABLE media_objects ADD COLUMN IF NOT EXISTS blurhash VARCHAR(64);
+ALTER TABLE media_objects ADD COLUMN IF NOT EXISTS variants JSONB;
@@ -0,0 +1,14 @@
+-- Сессии возобновляемых загрузок. Данные лежат в
+-- uploads/.incoming/<id>.upload, upload_offset — подтверждённые байты.
+CREATE TABLE IF NOT EXISTS upload_sessions (
+  id VARCHAR(64) PRIMARY KEY,
+  user_id BIGINT NOT NULL,
+  filename VARCHAR(255) NOT NULL,
+  upload_length BIGINT NOT NULL,
+  upload_offset BIGINT NOT NULL DEFAULT 0,
+  created_at TIMESTAMP NOT NULL DEFAULT now(),
+  expires_at TIMESTAMP NOT NULL
+);
+
+CREATE INDEX IF NOT EXISTS idx_upload_sessions_user ON upload_sessions(user_id);
+CREATE INDEX IF NOT EXISTS idx_upload_sessions_expires ON upload_sessions(expires_at);
@@ -0,0 +1,3 @@
+-- Сборщик мусора в uploads/ проверяет, не используется ли файл как
+-- аватар; без индекса это полный проход по users на каждую пачку.
+CREATE INDEX IF NOT EXISTS idx_users_avatar_path ON users(avatar_path);
@@ -0,0 +1,175 @@
+#include "AdmissionControl.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <string>
+#include <trantor/net/EventLoop.h>
+
+using namespace services;
+
+namespace {
+
+const char *const kClassNames[AdmissionControl::kClassCount] = {
+    "critical", "write", "feed_tail", "search"};
+
+// Период пробного таймера: за интервал набирается два десятка замеров
+constexpr auto kProbePeriod = std::chrono::milliseconds(5);
+
+// Последнее опоздание таймера цикла, в потоке которого идёт вызов
+thread_local int64_t currentLoopLagUs = 0;
+
+} // namespace
+
+AdmissionControl &AdmissionControl::instance() {
+  static AdmissionControl control;
+  return control;
+}
+
+AdmissionControl::AdmissionControl() {
+  auto &metrics = Metrics::instance();
+  for (size_t i = 0; i < kClassCount; ++i) {
+    std::string name = kClassNames[i];
+    classes_[i].shed = &metrics.counter(
+        "admission_shed_" + name + "_total",
+        "Requests of class " + name + " refused under overload");
+    classes_[i].expired = &metrics.counter(
+        "admission_expired_" + name + "_total",
+        "Requests of class " + name + " whose deadline passed in the queue");
+    metrics.gauge("admission_min_sojourn_" + name + "_milliseconds",
+                  "Minimum queueing delay of class " + name +
+                      " over the last interval",
+                  [this, i]() {
+                    return classes_[i].lastMinSojournUs.load(
+                               std::memory_order_relaxed) /
+                           1000.0;
+                  });
+  }
+  metrics.gauge("admission_shed_level", "Route classes currently shed",
+                [this]() { return static_cast<double>(level()); });
+  metrics.gauge("admission_loop_lag_milliseconds",
+                "Minimum IO loop timer lag over the last interval, worst loop",
+                [this]() {
+                  return lastLoopLagUs_.load(std::memory_order_relaxed) /
+                         1000.0;
+                });
+}
+
+void AdmissionControl::configure(const Config &config) { config_ = config; }
+
+AdmissionControl::RouteClass
+AdmissionControl::classify(std::string_view method, std::string_view path,
+                           std::string_view offset) {
+  if (path.size() > 1 && path.back() == '/') {
+    path.remove_suffix(1);
+  }
+  if (method == "GET" || method == "HEAD") {
+    if (path == "/posts/search") {
+      return kSearch;
+    }
+    // Первую страницу ленты видят все, дальше листают немногие
+    if ((path == "/feed" || path == "/posts") && !offset.empty() &&
+        offset.find_first_not_of('0') != std::string_view::npos) {
+      return kFeedTail;
+    }
+    return kCritical;
+  }
+  return kWrite;
+}
+
+AdmissionControl::Verdict
+AdmissionControl::admit(RouteClass routeClass,
+                        std::chrono::microseconds sojourn) {
+  auto &state = classes_[routeClass];
+  // Сколько запрос мог пролежать непрочитанным, пока цикл был занят
+  sojourn += std::chrono::microseconds(currentLoopLagUs);
+  auto us = sojourn.count();
+  auto current = state.minSojournUs.load(std::memory_order_relaxed);
+  while (us < current && !state.minSojournUs.compare_exchange_weak(
+                             current, us, std::memory_order_relaxed)) {
+  }
+
+  if (sojourn > config_.deadline[routeClass]) {
+    state.expired->fetch_add(1, std::memory_order_relaxed);
+    return Verdict::kExpired;
+  }
+  // level 1 — search, 2 — ещё feed tail, 3 — ещё запись
+  if (routeClass != kCritical &&
+      routeClass + level_.load(std::memory_order_relaxed) >=
+          static_cast<int>(kClassCount)) {
+    state.shed->fetch_add(1, std::memory_order_relaxed);
+    return Verdict::kShed;
+  }
+  return Verdict::kAdmit;
+}
+
+void AdmissionControl::watchLoop(trantor::EventLoop *loop) {
+  auto index = loopCount_.load(std::memory_order_relaxed);
+  if (index >= kMaxLoops) {
+    return;
+  }
+  loopCount_.store(index + 1, std::memory_order_relaxed);
+  probe(loop, index);
+}
+
+void AdmissionControl::probe(trantor::EventLoop *loop, size_t index) {
+  // runEvery может переносить срок от фактического срабатывания,
+  // поэтому каждый замер — отдельный таймер со своим сроком
+  using std::chrono::microseconds;
+  auto due = std::chrono::steady_clock::now() + kProbePeriod;
+  loop->runAfter(std::chrono::duration<double>(kProbePeriod).count(),
+                 [this, loop, index, due]() {
+                   auto lag = std::chrono::duration_cast<microseconds>(
+                       std::chrono::steady_clock::now() - due);
+                   recordLag(index, std::max<int64_t>(lag.count(), 0));
+                   probe(loop, index);
+                 });
+}
+
+void AdmissionControl::recordLag(size_t index, int64_t lagUs) {
+  currentLoopLagUs = lagUs;
+  auto &minLagUs = loops_[index].minLagUs;
+  auto current = minLagUs.load(std::memory_order_relaxed);
+  while (lagUs < current && !minLagUs.compare_exchange_weak(
+                                current, lagUs, std::memory_order_relaxed)) {
+  }
+}
+
+void AdmissionControl::tick() {
+  auto targetUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(config_.target)
+          .count();
+  auto intervalUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(config_.interval)
+          .count();
+  int64_t loopLagUs = 0;
+  for (size_t i = 0; i < loopCount_.load(std::memory_order_relaxed); ++i) {
+    auto minUs =
+        loops_[i].minLagUs.exchange(INT64_MAX, std::memory_order_relaxed);
+    if (minUs == INT64_MAX) {
+      // Таймер за всё окно не сработал: цикл был занят целиком
+      minUs = intervalUs;
+    }
+    loopLagUs = std::max(loopLagUs, minUs);
+  }
+  lastLoopLagUs_.store(loopLagUs, std::memory_order_relaxed);
+  bool standing = loopLagUs > targetUs;
+  for (auto &state : classes_) {
+    auto minUs =
+        state.minSojournUs.exchange(INT64_MAX, std::memory_order_relaxed);
+    if (minUs == INT64_MAX) {
+      // Окно без запросов класса
+      minUs = 0;
+    }
+    state.lastMinSojournUs.store(minUs, std::memory_order_relaxed);
+    standing = standing || minUs > targetUs;
+  }
+
+  auto level = level_.load(std::memory_order_relaxed);
+  if (standing) {
+    calmIntervals_ = 0;
+    level_.store(std::min(level + 1, static_cast<int>(kClassCount) - 1),
+                 std::memory_order_relaxed);
+  } else if (level > 0 && ++calmIntervals_ >= config_.recoverIntervals) {
+    calmIntervals_ = 0;
+    level_.store(level - 1, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace trantor {
+class EventLoop;
+}
+
+namespace services {
+
+// Отказ в части запросов под перегрузкой; вызывается из pre-handling
+// advice (main.cpp), то есть уже после роутинга и фильтров.
+//
+// Задержка от разбора запроса (creationDate) до входа в обработчик не
+// видит главного: пока IO-поток стоит в execSqlSync или разбирает
+// накопившееся, новые запросы лежат непрочитанными в сокетах. Поэтому
+// очередь меряется опозданием пробного таймера каждого IO-цикла
+// (watchLoop): насколько позже срока цикл до него добрался. Как в
+// CoDel, перегрузка — не всплеск, а стоячая очередь: за интервал даже
+// самое малое опоздание таймера какого-то цикла больше target (или
+// таймер не сработал вовсе). Sojourn запроса — время от разбора плюс
+// последнее опоздание его цикла; его минимум по классу маршрутов за
+// интервал тоже больше target только при стоячей очереди.
+//
+// Пока очередь стоит, каждый интервал отключается ещё один класс:
+// сначала поиск, затем хвост ленты (offset > 0), затем запись;
+// остальное (kCritical) не отключается. После recoverIntervals
+// интервалов без стоячей очереди классы возвращаются по одному.
+//
+// Если дедлайн к входу в обработчик прошёл, запрос не выполняется
+// вовсе. Остаток дедлайна получают запросы репозиториев к базе
+// (storage/Deadline.h): после дедлайна они в пул не уходят, а ответа
+// ждут не дольше остатка. POST /batch урезает им свои ожидания.
+class AdmissionControl {
+public:
+  enum RouteClass : uint8_t {
+    kCritical = 0,
+    kWrite = 1,
+    kFeedTail = 2,
+    kSearch = 3,
+  };
+  static constexpr size_t kClassCount = 4;
+
+  enum class Verdict { kAdmit, kShed, kExpired };
+
+  struct Config {
+    std::chrono::milliseconds target{20};
+    std::chrono::milliseconds interval{100};
+    int recoverIntervals = 10;
+    std::array<std::chrono::milliseconds, kClassCount> deadline{
+        std::chrono::milliseconds(3000), std::chrono::milliseconds(5000),
+        std::chrono::milliseconds(2000), std::chrono::milliseconds(1500)};
+  };
+
+  static AdmissionControl &instance();
+
+  AdmissionControl();
+
+  void configure(const Config &config);
+
+  // offset — значение параметра offset (пусто, если нет)
+  static RouteClass classify(std::string_view method, std::string_view path,
+                             std::string_view offset);
+
+  // sojourn — от разбора запроса; вызывается из IO-потока запроса
+  Verdict admit(RouteClass routeClass, std::chrono::microseconds sojourn);
+
+  // Запускает пробный таймер IO-цикла; по разу на цикл, до нагрузки
+  void watchLoop(trantor::EventLoop *loop);
+
+  // Раз в interval (таймер в main.cpp): итог окна и смена уровня
+  void tick();
+
+  // Сколько классов отключено, 0..3
+  int level() const { return level_.load(std::memory_order_relaxed); }
+
+  std::chrono::milliseconds deadline(RouteClass routeClass) const {
+    return config_.deadline[routeClass];
+  }
+
+  const Config &config() const { return config_; }
+
+private:
+  struct ClassState {
+    // Минимум текущего окна и итог прошлого, мкс
+    std::atomic<int64_t> minSojournUs{INT64_MAX};
+    std::atomic<int64_t> lastMinSojournUs{0};
+    std::atomic<int64_t> *shed = nullptr;
+    std::atomic<int64_t> *expired = nullptr;
+  };
+
+  static constexpr size_t kMaxLoops = 64;
+
+  struct LoopState {
+    // Минимальное опоздание таймера в текущем окне, мкс
+    std::atomic<int64_t> minLagUs{INT64_MAX};
+  };
+
+  void probe(trantor::EventLoop *loop, size_t index);
+  void recordLag(size_t index, int64_t lagUs);
+
+  Config config_;
+  std::array<ClassState, kClassCount> classes_;
+  std::array<LoopState, kMaxLoops> loops_;
+  std::atomic<size_t> loopCount_{0};
+  // Итог прошлого окна по худшему циклу, мкс
+  std::atomic<int64_t> lastLoopLagUs_{0};
+  std::atomic<int> level_{0};
+  int calmIntervals_ = 0;
+};
+
+} // namespace services
@@ -0,0 +1,25 @@
+#include "Attachments.h"
+#include "RowJson.h"
+#include <json/reader.h>
+#include <memory>
+
+using namespace services;
+
+Json::Value services::attachmentJson(const storage::Attachment &attachment) {
+  auto json = rowJson(attachment);
+
+  Json::Value variants(Json::arrayValue);
+  if (!attachment.variants.empty()) {
+    static const Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    const auto &text = attachment.variants;
+    Json::Value parsed;
+    if (reader->parse(text.data(), text.data() + text.size(), &parsed,
+                      nullptr) &&
+        parsed.isArray()) {
+      variants = parsed;
+    }
+  }
+  json["variants"] = variants;
+  return json;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "storage/Repositories.h"
+#include <json/value.h>
+
+namespace services {
+
+// {id, type, file_path, variants[, width, height, blurhash]}: размеры,
+// BlurHash и уменьшенные варианты заполняет ThumbnailPipeline
+Json::Value attachmentJson(const storage::Attachment &attachment);
+
+} // namespace services
@@ -0,0 +1,223 @@
+#include "Blake3.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace services;
+
+namespace {
+
+constexpr uint32_t kIv[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372,
+                             0xA54FF53A, 0x510E527F, 0x9B05688C,
+                             0x1F83D9AB, 0x5BE0CD19};
+
+constexpr uint8_t kMsgSchedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+constexpr uint32_t kChunkStart = 1 << 0;
+constexpr uint32_t kChunkEnd = 1 << 1;
+constexpr uint32_t kParent = 1 << 2;
+constexpr uint32_t kRoot = 1 << 3;
+
+constexpr size_t kBlockLen = 64;
+constexpr size_t kChunkLen = 1024;
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline void g(uint32_t *s, int a, int b, int c, int d, uint32_t mx,
+              uint32_t my) {
+  s[a] = s[a] + s[b] + mx;
+  s[d] = rotr(s[d] ^ s[a], 16);
+  s[c] = s[c] + s[d];
+  s[b] = rotr(s[b] ^ s[c], 12);
+  s[a] = s[a] + s[b] + my;
+  s[d] = rotr(s[d] ^ s[a], 8);
+  s[c] = s[c] + s[d];
+  s[b] = rotr(s[b] ^ s[c], 7);
+}
+
+void loadWords(const uint8_t block[64], uint32_t words[16]) {
+  for (int i = 0; i < 16; ++i) {
+    words[i] = uint32_t{block[4 * i]} | uint32_t{block[4 * i + 1]} << 8 |
+               uint32_t{block[4 * i + 2]} << 16 |
+               uint32_t{block[4 * i + 3]} << 24;
+  }
+}
+
+void compress(const uint32_t cv[8], const uint32_t m[16], uint64_t counter,
+              uint32_t blockLen, uint32_t flags, uint32_t out[16]) {
+  uint32_t s[16] = {cv[0],
+                    cv[1],
+                    cv[2],
+                    cv[3],
+                    cv[4],
+                    cv[5],
+                    cv[6],
+                    cv[7],
+                    kIv[0],
+                    kIv[1],
+                    kIv[2],
+                    kIv[3],
+                    static_cast<uint32_t>(counter),
+                    static_cast<uint32_t>(counter >> 32),
+                    blockLen,
+                    flags};
+
+  for (const auto &schedule : kMsgSchedule) {
+    g(s, 0, 4, 8, 12, m[schedule[0]], m[schedule[1]]);
+    g(s, 1, 5, 9, 13, m[schedule[2]], m[schedule[3]]);
+    g(s, 2, 6, 10, 14, m[schedule[4]], m[schedule[5]]);
+    g(s, 3, 7, 11, 15, m[schedule[6]], m[schedule[7]]);
+    g(s, 0, 5, 10, 15, m[schedule[8]], m[schedule[9]]);
+    g(s, 1, 6, 11, 12, m[schedule[10]], m[schedule[11]]);
+    g(s, 2, 7, 8, 13, m[schedule[12]], m[schedule[13]]);
+    g(s, 3, 4, 9, 14, m[schedule[14]], m[schedule[15]]);
+  }
+
+  for (int i = 0; i < 8; ++i) {
+    out[i] = s[i] ^ s[i + 8];
+    out[i + 8] = s[i + 8] ^ cv[i];
+  }
+}
+
+// Вход последней compress-операции узла: нужен, чтобы получить либо
+// chaining value, либо (с флагом ROOT) итоговый дайджест
+struct Output {
+  uint32_t cv[8];
+  uint32_t block[16];
+  uint64_t counter;
+  uint32_t blockLen;
+  uint32_t flags;
+
+  void chainingValue(uint32_t out[8]) const {
+    uint32_t full[16];
+    compress(cv, block, counter, blockLen, flags, full);
+    std::memcpy(out, full, 8 * sizeof(uint32_t));
+  }
+
+  Blake3::Digest rootBytes() const {
+    uint32_t words[16];
+    compress(cv, block, 0, blockLen, flags | kRoot, words);
+    Blake3::Digest digest;
+    for (size_t i = 0; i < Blake3::kDigestSize / 4; ++i) {
+      digest[4 * i] = static_cast<uint8_t>(words[i]);
+      digest[4 * i + 1] = static_cast<uint8_t>(words[i] >> 8);
+      digest[4 * i + 2] = static_cast<uint8_t>(words[i] >> 16);
+      digest[4 * i + 3] = static_cast<uint8_t>(words[i] >> 24);
+    }
+    return digest;
+  }
+};
+
+Output parentOutput(const uint32_t left[8], const uint32_t right[8]) {
+  Output output;
+  std::memcpy(output.cv, kIv, sizeof(kIv));
+  std::memcpy(output.block, left, 8 * sizeof(uint32_t));
+  std::memcpy(output.block + 8, right, 8 * sizeof(uint32_t));
+  output.counter = 0;
+  output.blockLen = kBlockLen;
+  output.flags = kParent;
+  return output;
+}
+
+} // namespace
+
+Blake3::Blake3() { resetChunk(0); }
+
+void Blake3::resetChunk(uint64_t chunkCounter) {
+  std::memcpy(chunk_.cv, kIv, sizeof(kIv));
+  chunk_.chunkCounter = chunkCounter;
+  std::memset(chunk_.block, 0, sizeof(chunk_.block));
+  chunk_.blockLen = 0;
+  chunk_.blocksCompressed = 0;
+}
+
+void Blake3::pushChunkCv(const uint32_t cv[8], uint64_t totalChunks) {
+  // Сливаем поддеревья: столько раз, сколько нулевых младших бит
+  // у числа завершённых чанков
+  uint32_t merged[8];
+  std::memcpy(merged, cv, sizeof(merged));
+  while ((totalChunks & 1) == 0) {
+    --cvStackLen_;
+    parentOutput(cvStack_[cvStackLen_], merged).chainingValue(merged);
+    totalChunks >>= 1;
+  }
+  std::memcpy(cvStack_[cvStackLen_], merged, sizeof(merged));
+  ++cvStackLen_;
+}
+
+void Blake3::update(const void *data, size_t length) {
+  auto input = static_cast<const uint8_t *>(data);
+
+  while (length > 0) {
+    if (chunk_.length() == kChunkLen) {
+      Output output;
+      std::memcpy(output.cv, chunk_.cv, sizeof(chunk_.cv));
+      loadWords(chunk_.block, output.block);
+      output.counter = chunk_.chunkCounter;
+      output.blockLen = chunk_.blockLen;
+      output.flags =
+          (chunk_.blocksCompressed == 0 ? kChunkStart : 0) | kChunkEnd;
+
+      uint32_t chunkCv[8];
+      output.chainingValue(chunkCv);
+      uint64_t totalChunks = chunk_.chunkCounter + 1;
+      pushChunkCv(chunkCv, totalChunks);
+      resetChunk(totalChunks);
+    }
+
+    // Полный блок сжимаем только когда за ним есть ещё данные:
+    // последний блок чанка обрабатывается с флагом CHUNK_END
+    if (chunk_.blockLen == kBlockLen) {
+      uint32_t words[16];
+      loadWords(chunk_.block, words);
+      uint32_t out[16];
+      compress(chunk_.cv, words, chunk_.chunkCounter, kBlockLen,
+               chunk_.blocksCompressed == 0 ? kChunkStart : 0, out);
+      std::memcpy(chunk_.cv, out, sizeof(chunk_.cv));
+      ++chunk_.blocksCompressed;
+      std::memset(chunk_.block, 0, sizeof(chunk_.block));
+      chunk_.blockLen = 0;
+    }
+
+    size_t take = std::min(kBlockLen - chunk_.blockLen, length);
+    take = std::min(take, kChunkLen - chunk_.length());
+    std::memcpy(chunk_.block + chunk_.blockLen, input, take);
+    chunk_.blockLen += static_cast<uint8_t>(take);
+    input += take;
+    length -= take;
+  }
+}
+
+Blake3::Digest Blake3::finalize() const {
+  Output output;
+  std::memcpy(output.cv, chunk_.cv, sizeof(chunk_.cv));
+  loadWords(chunk_.block, output.block);
+  output.counter = chunk_.chunkCounter;
+  output.blockLen = chunk_.blockLen;
+  output.flags = (chunk_.blocksCompressed == 0 ? kChunkStart : 0) | kChunkEnd;
+
+  for (size_t i = cvStackLen_; i-- > 0;) {
+    uint32_t rightCv[8];
+    output.chainingValue(rightCv);
+    output = parentOutput(cvStack_[i], rightCv);
+  }
+  return output.rootBytes();
+}
+
+std::string Blake3::toHex(const Digest &digest) {
+  static const char *kHex = "0123456789abcdef";
+  std::string hex;
+  hex.reserve(digest.size() * 2);
+  for (auto byte : digest) {
+    hex.push_back(kHex[byte >> 4]);
+    hex.push_back(kHex[byte & 0x0F]);
+  }
+  return hex;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace services {
+
+// Потоковый BLAKE3 (режим hash, 256-битный дайджест).
+// Переносимая реализация по эталонной спецификации: дерево чанков по
+// 1 КиБ со стеком chaining value, без SIMD-параллелизма по чанкам.
+class Blake3 {
+public:
+  static constexpr size_t kDigestSize = 32;
+  using Digest = std::array<uint8_t, kDigestSize>;
+
+  Blake3();
+
+  void update(const void *data, size_t length);
+  Digest finalize() const;
+
+  static std::string toHex(const Digest &digest);
+
+private:
+  struct ChunkState {
+    uint32_t cv[8];
+    uint64_t chunkCounter = 0;
+    uint8_t block[64] = {};
+    uint8_t blockLen = 0;
+    uint8_t blocksCompressed = 0;
+
+    size_t length() const { return 64 * size_t{blocksCompressed} + blockLen; }
+  };
+
+  void resetChunk(uint64_t chunkCounter);
+  void pushChunkCv(const uint32_t cv[8], uint64_t totalChunks);
+
+  ChunkState chunk_;
+  uint32_t cvStack_[54][8];
+  uint8_t cvStackLen_ = 0;
+};
+
+} // namespace services
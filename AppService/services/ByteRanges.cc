@@ -0,0 +1,118 @@
+#include "ByteRanges.h"
+#include <algorithm>
+#include <charconv>
+
+using namespace services;
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+bool parseNumber(std::string_view s, uint64_t &value) {
+  if (s.empty()) {
+    return false;
+  }
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc() && end == s.data() + s.size();
+}
+
+} // namespace
+
+RangeRequest services::parseRangeHeader(std::string_view header,
+                                        uint64_t fileSize, size_t maxRanges) {
+  RangeRequest request;
+  header = trim(header);
+  constexpr std::string_view kUnit = "bytes=";
+  if (header.substr(0, kUnit.size()) != kUnit) {
+    return request;
+  }
+  header.remove_prefix(kUnit.size());
+
+  std::vector<ByteRange> ranges;
+  bool anySpec = false;
+  while (!header.empty()) {
+    auto comma = header.find(',');
+    auto spec = trim(header.substr(0, comma));
+    header = comma == std::string_view::npos ? std::string_view()
+                                             : header.substr(comma + 1);
+    if (spec.empty()) {
+      continue;
+    }
+
+    auto dash = spec.find('-');
+    if (dash == std::string_view::npos) {
+      return request;
+    }
+    auto first = trim(spec.substr(0, dash));
+    auto last = trim(spec.substr(dash + 1));
+    anySpec = true;
+
+    uint64_t start = 0;
+    uint64_t end = 0;
+    if (first.empty()) {
+      // bytes=-N: последние N байт
+      uint64_t suffix = 0;
+      if (!parseNumber(last, suffix)) {
+        return request;
+      }
+      if (suffix == 0 || fileSize == 0) {
+        continue;
+      }
+      start = suffix >= fileSize ? 0 : fileSize - suffix;
+      end = fileSize - 1;
+    } else {
+      if (!parseNumber(first, start)) {
+        return request;
+      }
+      if (last.empty()) {
+        end = fileSize == 0 ? 0 : fileSize - 1;
+      } else if (!parseNumber(last, end) || end < start) {
+        return request;
+      }
+      if (start >= fileSize) {
+        continue;
+      }
+      end = std::min(end, fileSize - 1);
+    }
+
+    ranges.push_back({start, end - start + 1});
+    if (ranges.size() > maxRanges) {
+      return request;
+    }
+  }
+
+  if (!anySpec) {
+    return request;
+  }
+  if (ranges.empty()) {
+    request.status = RangeRequest::Status::kUnsatisfiable;
+    return request;
+  }
+
+  std::sort(ranges.begin(), ranges.end(),
+            [](const ByteRange &a, const ByteRange &b) {
+              return a.offset < b.offset;
+            });
+  for (const auto &range : ranges) {
+    if (!request.ranges.empty()) {
+      auto &back = request.ranges.back();
+      if (range.offset <= back.offset + back.length) {
+        back.length = std::max(back.offset + back.length,
+                               range.offset + range.length) -
+                      back.offset;
+        continue;
+      }
+    }
+    request.ranges.push_back(range);
+  }
+  request.status = RangeRequest::Status::kSatisfiable;
+  return request;
+}
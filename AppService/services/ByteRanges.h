@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace services {
+
+// Разбор заголовка Range (RFC 9110, только единицы bytes)
+struct ByteRange {
+  uint64_t offset = 0;
+  uint64_t length = 0;
+};
+
+struct RangeRequest {
+  enum class Status {
+    // Заголовка нет или он некорректен — отдаём файл целиком (200)
+    kIgnored,
+    kSatisfiable,
+    // Ни один диапазон не попадает в файл — 416
+    kUnsatisfiable,
+  };
+
+  Status status = Status::kIgnored;
+  // Отсортированы по offset, пересекающиеся и смежные слиты
+  std::vector<ByteRange> ranges;
+};
+
+// maxRanges защищает от запросов с тысячами мелких диапазонов:
+// при превышении заголовок игнорируется
+RangeRequest parseRangeHeader(std::string_view header, uint64_t fileSize,
+                              size_t maxRanges = 16);
+
+} // namespace services
@@ -0,0 +1,75 @@
+#include "DirectoryStream.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace services;
+
+namespace {
+
+// Раскладка записи из getdents64(2); в glibc объявления нет
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+} // namespace
+
+DirectoryStream::DirectoryStream(int parentFd, const char *path)
+    : buffer_(static_cast<char *>(std::malloc(kBufferSize))) {
+  if (!buffer_) {
+    error_ = ENOMEM;
+    return;
+  }
+  fd_ = ::openat(parentFd, path,
+                 O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd_ < 0) {
+    error_ = errno;
+  }
+}
+
+DirectoryStream::~DirectoryStream() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  std::free(buffer_);
+}
+
+bool DirectoryStream::next(Entry &entry) {
+  while (fd_ >= 0) {
+    if (position_ >= length_) {
+      auto n = ::syscall(SYS_getdents64, fd_, buffer_, kBufferSize);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        error_ = errno;
+        return false;
+      }
+      if (n == 0) {
+        return false;
+      }
+      length_ = static_cast<size_t>(n);
+      position_ = 0;
+    }
+
+    auto *dirent = reinterpret_cast<LinuxDirent64 *>(buffer_ + position_);
+    position_ += dirent->d_reclen;
+    const char *name = dirent->d_name;
+    if (name[0] == '.' &&
+        (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+      continue;
+    }
+    entry.name = std::string_view(name, std::strlen(name));
+    entry.inode = dirent->d_ino;
+    entry.type = dirent->d_type;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace services {
+
+// Потоковое чтение каталога через getdents64: записи читаются из ядра
+// блоками по kBufferSize, поэтому каталог с миллионами файлов не
+// требует памяти больше одного блока. В отличие от readdir(),
+// дескриптор открывается относительно родителя (openat), и обход
+// дерева не строит полные пути.
+class DirectoryStream {
+public:
+  static constexpr size_t kBufferSize = 64 << 10;
+
+  struct Entry {
+    std::string_view name;
+    uint64_t inode = 0;
+    // DT_REG, DT_DIR, ... или DT_UNKNOWN — тогда нужен fstatat()
+    unsigned char type = 0;
+  };
+
+  // parentFd — дескриптор каталога или AT_FDCWD
+  DirectoryStream(int parentFd, const char *path);
+  ~DirectoryStream();
+
+  DirectoryStream(const DirectoryStream &) = delete;
+  DirectoryStream &operator=(const DirectoryStream &) = delete;
+
+  bool isOpen() const { return fd_ >= 0; }
+  int fd() const { return fd_; }
+  // Ошибка getdents64 (errno), 0 — если её не было
+  int error() const { return error_; }
+
+  // false — записи кончились или произошла ошибка. "." и ".."
+  // пропускаются. name действителен до следующего вызова.
+  bool next(Entry &entry);
+
+private:
+  int fd_ = -1;
+  int error_ = 0;
+  char *buffer_;
+  size_t length_ = 0;
+  size_t position_ = 0;
+};
+
+} // namespace services
@@ -0,0 +1,248 @@
+#include "ExistenceCache.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <drogon/drogon.h>
+
+using namespace services;
+
+namespace {
+
+uint64_t mix(uint64_t x) {
+  // splitmix64
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+ExistenceCache &configured(ExistenceCache &cache, const Json::Value &config) {
+  cache.configure(
+      std::chrono::milliseconds(
+          config.get("negative_ttl_ms", 30000).asInt64()),
+      config.get("max_negative_entries", 100000).asUInt64());
+  return cache;
+}
+
+} // namespace
+
+CountingBloomFilter::CountingBloomFilter(size_t expectedItems,
+                                         double falsePositiveRate) {
+  expectedItems = std::max<size_t>(expectedItems, 1024);
+  double ln2 = std::log(2.0);
+  double bits =
+      -static_cast<double>(expectedItems) * std::log(falsePositiveRate) /
+      (ln2 * ln2);
+  counters_ = static_cast<size_t>(bits);
+  hashes_ = std::max<uint32_t>(
+      1, static_cast<uint32_t>(std::round(bits / expectedItems * ln2)));
+  nibbles_.reset(new std::atomic<uint8_t>[(counters_ + 1) / 2]());
+}
+
+size_t CountingBloomFilter::slot(uint64_t key, uint32_t i) const {
+  // double hashing: h1 + i * h2
+  uint64_t h = mix(key);
+  uint64_t h1 = h & 0xFFFFFFFFULL;
+  uint64_t h2 = (h >> 32) | 1;
+  return (h1 + i * h2) % counters_;
+}
+
+uint8_t CountingBloomFilter::counterAt(size_t slot) const {
+  uint8_t byte = nibbles_[slot / 2].load(std::memory_order_relaxed);
+  return slot % 2 ? byte >> 4 : byte & 0x0F;
+}
+
+void CountingBloomFilter::increment(size_t slot) {
+  auto &cell = nibbles_[slot / 2];
+  int shift = slot % 2 ? 4 : 0;
+  uint8_t byte = cell.load(std::memory_order_relaxed);
+  while (true) {
+    uint8_t value = (byte >> shift) & 0x0F;
+    if (value == 0x0F) {
+      return;
+    }
+    uint8_t next = byte + (1 << shift);
+    if (cell.compare_exchange_weak(byte, next, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+void CountingBloomFilter::decrement(size_t slot) {
+  auto &cell = nibbles_[slot / 2];
+  int shift = slot % 2 ? 4 : 0;
+  uint8_t byte = cell.load(std::memory_order_relaxed);
+  while (true) {
+    uint8_t value = (byte >> shift) & 0x0F;
+    // 0 — защита от лишнего remove, 15 — счётчик насыщен и точное
+    // значение потеряно
+    if (value == 0 || value == 0x0F) {
+      return;
+    }
+    uint8_t next = byte - (1 << shift);
+    if (cell.compare_exchange_weak(byte, next, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+void CountingBloomFilter::add(uint64_t key) {
+  for (uint32_t i = 0; i < hashes_; ++i) {
+    increment(slot(key, i));
+  }
+  items_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountingBloomFilter::remove(uint64_t key) {
+  for (uint32_t i = 0; i < hashes_; ++i) {
+    decrement(slot(key, i));
+  }
+  items_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool CountingBloomFilter::mayContain(uint64_t key) const {
+  for (uint32_t i = 0; i < hashes_; ++i) {
+    if (counterAt(slot(key, i)) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double CountingBloomFilter::estimatedFalsePositiveRate() const {
+  double n = std::max<int64_t>(items_.load(std::memory_order_relaxed), 0);
+  double k = hashes_;
+  return std::pow(1.0 - std::exp(-k * n / counters_), k);
+}
+
+ExistenceCache &ExistenceCache::posts() {
+  static auto config = drogon::app().getCustomConfig()["existence_cache"];
+  static ExistenceCache cache(
+      "posts", config.get("expected_posts", 10000000).asUInt64());
+  static auto &ready = configured(cache, config);
+  return ready;
+}
+
+ExistenceCache &ExistenceCache::users() {
+  static auto config = drogon::app().getCustomConfig()["existence_cache"];
+  static ExistenceCache cache(
+      "users", config.get("expected_users", 1000000).asUInt64());
+  static auto &ready = configured(cache, config);
+  return ready;
+}
+
+ExistenceCache::ExistenceCache(std::string name, size_t expectedItems)
+    : name_(std::move(name)), bloom_(expectedItems, 0.01),
+      bloomRejects_(Metrics::instance().counter(
+          "existence_" + name_ + "_bloom_rejects_total",
+          "Lookups of missing " + name_ + " answered by the Bloom filter")),
+      negativeHits_(Metrics::instance().counter(
+          "existence_" + name_ + "_negative_hits_total",
+          "Lookups of missing " + name_ + " answered by the negative cache")),
+      falsePositives_(Metrics::instance().counter(
+          "existence_" + name_ + "_bloom_false_positives_total",
+          "Missing " + name_ + " that passed the Bloom filter")) {
+  Metrics::instance().gauge(
+      "existence_" + name_ + "_bloom_memory_bytes",
+      "Memory used by the " + name_ + " Bloom filter",
+      [this]() { return static_cast<double>(bloom_.memoryBytes()); });
+  Metrics::instance().gauge(
+      "existence_" + name_ + "_bloom_estimated_fp_rate",
+      "Estimated false-positive rate of the " + name_ + " Bloom filter",
+      [this]() { return bloom_.estimatedFalsePositiveRate(); });
+}
+
+void ExistenceCache::configure(std::chrono::milliseconds negativeTtl,
+                               size_t maxNegativeEntries) {
+  negativeTtl_ = negativeTtl;
+  maxNegativePerShard_ = std::max<size_t>(1, maxNegativeEntries / kShards);
+}
+
+bool ExistenceCache::definitelyMissing(int64_t id) {
+  if (loaded() && !bloom_.mayContain(static_cast<uint64_t>(id))) {
+    bloomRejects_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  auto &shard = shardFor(id);
+  std::lock_guard lock(shard.mutex);
+  auto it = shard.expiresAt.find(id);
+  if (it == shard.expiresAt.end()) {
+    return false;
+  }
+  if (it->second < std::chrono::steady_clock::now()) {
+    shard.expiresAt.erase(it);
+    return false;
+  }
+  negativeHits_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+uint64_t ExistenceCache::generation(int64_t id) {
+  auto &shard = shardFor(id);
+  std::lock_guard lock(shard.mutex);
+  return shard.generation;
+}
+
+void ExistenceCache::markMissing(int64_t id, uint64_t generation) {
+  if (loaded()) {
+    falsePositives_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  auto &shard = shardFor(id);
+  std::lock_guard lock(shard.mutex);
+  // Пост или пользователь создан, пока шёл запрос, не видевший его
+  if (shard.generation != generation) {
+    return;
+  }
+  if (shard.expiresAt.size() >= maxNegativePerShard_) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = shard.expiresAt.begin(); it != shard.expiresAt.end();) {
+      it = it->second < now ? shard.expiresAt.erase(it) : std::next(it);
+    }
+    if (shard.expiresAt.size() >= maxNegativePerShard_) {
+      shard.expiresAt.erase(shard.expiresAt.begin());
+    }
+  }
+  shard.expiresAt[id] = std::chrono::steady_clock::now() + negativeTtl_;
+}
+
+void ExistenceCache::added(int64_t id) {
+  bloom_.add(static_cast<uint64_t>(id));
+  auto &shard = shardFor(id);
+  std::lock_guard lock(shard.mutex);
+  ++shard.generation;
+  shard.expiresAt.erase(id);
+}
+
+void ExistenceCache::removed(int64_t id) {
+  // До окончания загрузки id мог ещё не попасть в фильтр: уменьшение
+  // чужих счётчиков дало бы ложноотрицательный ответ
+  if (loaded()) {
+    bloom_.remove(static_cast<uint64_t>(id));
+  }
+  auto &shard = shardFor(id);
+  std::lock_guard lock(shard.mutex);
+  shard.expiresAt[id] = std::chrono::steady_clock::now() + negativeTtl_;
+}
+
+void ExistenceCache::load(
+    const std::function<std::vector<int64_t>(int64_t)> &nextIds) {
+  int64_t lastId = 0;
+  size_t loadedRows = 0;
+  while (true) {
+    auto ids = nextIds(lastId);
+    for (auto id : ids) {
+      lastId = id;
+      bloom_.add(static_cast<uint64_t>(id));
+    }
+    loadedRows += ids.size();
+    if (ids.empty()) {
+      break;
+    }
+  }
+
+  loaded_.store(true, std::memory_order_release);
+  LOG_INFO << "Existence filter for " << name_ << " loaded: " << loadedRows
+           << " ids, " << bloom_.memoryBytes() / 1024 << " KiB";
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace services {
+
+// Считающий фильтр Блума с 4-битными счётчиками: поддерживает удаление.
+// Ложноотрицательных ответов не бывает, пока remove() вызывается только
+// для ранее добавленных ключей; насыщенный счётчик (15) не уменьшается.
+class CountingBloomFilter {
+public:
+  CountingBloomFilter(size_t expectedItems, double falsePositiveRate);
+
+  void add(uint64_t key);
+  void remove(uint64_t key);
+  bool mayContain(uint64_t key) const;
+
+  size_t memoryBytes() const { return (counters_ + 1) / 2; }
+  // Оценка доли ложноположительных при текущем числе элементов
+  double estimatedFalsePositiveRate() const;
+
+private:
+  size_t slot(uint64_t key, uint32_t i) const;
+  void increment(size_t slot);
+  void decrement(size_t slot);
+  uint8_t counterAt(size_t slot) const;
+
+  size_t counters_;
+  uint32_t hashes_;
+  std::unique_ptr<std::atomic<uint8_t>[]> nibbles_;
+  std::atomic<int64_t> items_{0};
+};
+
+// Отрицательный кэш и фильтр существования для id постов или
+// пользователей. definitelyMissing() == true означает гарантированный
+// 404 без запроса в Postgres: либо фильтр Блума (построенный на старте)
+// не знает id, либо недавно уже был промах в БД (TTL).
+class ExistenceCache {
+public:
+  static ExistenceCache &posts();
+  static ExistenceCache &users();
+
+  ExistenceCache(std::string name, size_t expectedItems);
+
+  void configure(std::chrono::milliseconds negativeTtl,
+                 size_t maxNegativeEntries);
+
+  bool definitelyMissing(int64_t id);
+
+  // Снимается до запроса в БД и передаётся в markMissing: если id за
+  // это время добавили, промах устарел и не запоминается
+  uint64_t generation(int64_t id);
+  // БД подтвердила отсутствие
+  void markMissing(int64_t id, uint64_t generation);
+  void added(int64_t id);
+  void removed(int64_t id);
+
+  // Заполняет фильтр id порциями: nextIds(afterId) возвращает
+  // следующие id по возрастанию (scanIds репозитория), пустая порция —
+  // конец
+  void load(const std::function<std::vector<int64_t>(int64_t)> &nextIds);
+
+  bool loaded() const { return loaded_.load(std::memory_order_acquire); }
+
+private:
+  static constexpr size_t kShards = 16;
+
+  struct NegativeShard {
+    std::mutex mutex;
+    std::unordered_map<int64_t, std::chrono::steady_clock::time_point>
+        expiresAt;
+    // Растёт при каждом added(), как в ProfileCache
+    uint64_t generation = 0;
+  };
+
+  NegativeShard &shardFor(int64_t id) {
+    return negative_[static_cast<uint64_t>(id) % kShards];
+  }
+
+  std::string name_;
+  CountingBloomFilter bloom_;
+  std::atomic<bool> loaded_{false};
+  std::array<NegativeShard, kShards> negative_;
+  std::chrono::milliseconds negativeTtl_{30000};
+  size_t maxNegativePerShard_ = 100000 / kShards;
+
+  std::atomic<int64_t> &bloomRejects_;
+  std::atomic<int64_t> &negativeHits_;
+  std::atomic<int64_t> &falsePositives_;
+};
+
+} // namespace services
@@ -0,0 +1,333 @@
+#include "FeedHub.h"
+#include "Metrics.h"
+#include "storage/Repositories.h"
+#include <algorithm>
+#include <drogon/drogon.h>
+#include <json/writer.h>
+#include <trantor/net/TcpConnection.h>
+
+using namespace services;
+
+namespace {
+
+int64_t nowMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+struct FeedHub::Subscriber {
+  int64_t userId = 0;
+  trantor::EventLoop *loop = nullptr;
+  // Только в потоке loop
+  drogon::ResponseStreamPtr stream;
+  std::weak_ptr<trantor::TcpConnection> connection;
+  // Только в потоке loop: в буфере отправки больше sendBufferBytes
+  bool backedUp = false;
+  int64_t backedUpSinceMs = 0;
+
+  std::mutex mutex;
+  // Под mutex. Событие общее для всех получателей, копируется указатель
+  std::vector<std::shared_ptr<const std::string>> queue;
+  bool flushQueued = false;
+  bool closed = false;
+
+  std::atomic<int64_t> lastDeliveryMs{0};
+};
+
+FeedHub &FeedHub::instance() {
+  static FeedHub hub;
+  return hub;
+}
+
+FeedHub::FeedHub()
+    : subscribed_(Metrics::instance().counter(
+          "feed_stream_subscriptions_total", "Accepted GET /feed/stream")),
+      rejected_(Metrics::instance().counter(
+          "feed_stream_rejected_total",
+          "GET /feed/stream refused by the per-user stream limit")),
+      delivered_(Metrics::instance().counter(
+          "feed_stream_events_delivered_total",
+          "Events written to feed streams")),
+      dropped_(Metrics::instance().counter(
+          "feed_stream_events_dropped_total",
+          "Oldest events dropped from full feed stream queues")),
+      evicted_(Metrics::instance().counter(
+          "feed_stream_evicted_total",
+          "Feed streams closed after idle timeout")),
+      stalled_(Metrics::instance().counter(
+          "feed_stream_stalled_total",
+          "Feed streams closed after their send buffer stayed full")) {
+  Metrics::instance().gauge(
+      "feed_stream_connections", "Open feed streams", [this]() {
+        return static_cast<double>(
+            connections_.load(std::memory_order_relaxed));
+      });
+}
+
+void FeedHub::configure(const Config &config) {
+  config_ = config;
+  config_.queueSize = std::max<size_t>(config_.queueSize, 1);
+  config_.maxStreamsPerUser = std::max<size_t>(config_.maxStreamsPerUser, 1);
+  config_.sendBufferBytes = std::max<size_t>(config_.sendBufferBytes, 4096);
+}
+
+void FeedHub::start() {
+  drogon::app().getLoop()->runEvery(
+      static_cast<double>(config_.heartbeat.count()), [this]() { sweep(); });
+}
+
+FeedHub::Shard &FeedHub::shardFor(int64_t userId) {
+  return shards_[static_cast<uint64_t>(userId) % kShards];
+}
+
+size_t FeedHub::connections() const {
+  return static_cast<size_t>(connections_.load(std::memory_order_relaxed));
+}
+
+std::string FeedHub::formatEvent(const std::string &event,
+                                 const std::string &id,
+                                 const std::string &data) {
+  std::string out;
+  out.reserve(event.size() + id.size() + data.size() + 24);
+  if (!id.empty()) {
+    out += "id: " + id + "\n";
+  }
+  out += "event: " + event + "\n";
+  out += "data: " + data + "\n\n";
+  return out;
+}
+
+bool FeedHub::subscribe(int64_t userId, drogon::ResponseStreamPtr stream,
+                        std::weak_ptr<trantor::TcpConnection> connection) {
+  auto subscriber = std::make_shared<Subscriber>();
+  subscriber->userId = userId;
+  subscriber->connection = std::move(connection);
+  subscriber->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+  subscriber->lastDeliveryMs = nowMillis();
+
+  {
+    auto &shard = shardFor(userId);
+    std::lock_guard lock(shard.mutex);
+    auto &list = shard.byUser[userId];
+    if (list.size() >= config_.maxStreamsPerUser) {
+      rejected_.fetch_add(1, std::memory_order_relaxed);
+      stream->send(formatEvent("error", "",
+                               "{\"error\":\"Too many open feed streams\"}"));
+      stream->close();
+      return false;
+    }
+    subscriber->stream = std::move(stream);
+    list.push_back(subscriber);
+  }
+  connections_.fetch_add(1, std::memory_order_relaxed);
+  subscribed_.fetch_add(1, std::memory_order_relaxed);
+
+  // Первые байты сразу: клиент видит, что подписка принята, и знает
+  // задержку переподключения
+  if (!subscriber->stream->send("retry: 5000\n\n")) {
+    remove(subscriber);
+    return false;
+  }
+  watchSendBuffer(subscriber);
+  return true;
+}
+
+// Колбэки соединения приходят в его потоке, то есть в потоке loop
+// подписчика. Drogon их у соединений HTTP не занимает
+void FeedHub::watchSendBuffer(const SubscriberPtr &subscriber) {
+  auto connection = subscriber->connection.lock();
+  if (!connection) {
+    return;
+  }
+  std::weak_ptr<Subscriber> weak = subscriber;
+  connection->setHighWaterMarkCallback(
+      [weak](const trantor::TcpConnectionPtr &, size_t) {
+        auto subscriber = weak.lock();
+        if (subscriber && !subscriber->backedUp) {
+          subscriber->backedUp = true;
+          subscriber->backedUpSinceMs = nowMillis();
+        }
+      },
+      config_.sendBufferBytes);
+  connection->setWriteCompleteCallback(
+      [this, weak](const trantor::TcpConnectionPtr &) {
+        auto subscriber = weak.lock();
+        if (subscriber && subscriber->backedUp) {
+          subscriber->backedUp = false;
+          flush(subscriber);
+        }
+      });
+}
+
+void FeedHub::publish(const std::vector<int64_t> &userIds,
+                      std::shared_ptr<const std::string> event) {
+  if (connections_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::vector<SubscriberPtr> targets;
+  for (auto userId : userIds) {
+    auto &shard = shardFor(userId);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.byUser.find(userId);
+    if (it != shard.byUser.end()) {
+      targets.insert(targets.end(), it->second.begin(), it->second.end());
+    }
+  }
+  for (const auto &subscriber : targets) {
+    enqueue(subscriber, event);
+  }
+}
+
+void FeedHub::enqueue(const SubscriberPtr &subscriber,
+                      const std::shared_ptr<const std::string> &event) {
+  bool schedule = false;
+  {
+    std::lock_guard lock(subscriber->mutex);
+    if (subscriber->closed) {
+      return;
+    }
+    if (subscriber->queue.size() >= config_.queueSize) {
+      subscriber->queue.erase(subscriber->queue.begin());
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    subscriber->queue.push_back(event);
+    if (!subscriber->flushQueued) {
+      subscriber->flushQueued = true;
+      schedule = true;
+    }
+  }
+  // Одна задача на пачку: пока она не выполнилась, новые события только
+  // копятся в очереди
+  if (schedule) {
+    subscriber->loop->queueInLoop(
+        [this, subscriber]() { flush(subscriber); });
+  }
+}
+
+void FeedHub::flush(const SubscriberPtr &subscriber) {
+  std::vector<std::shared_ptr<const std::string>> batch;
+  {
+    std::lock_guard lock(subscriber->mutex);
+    if (subscriber->closed) {
+      return;
+    }
+    subscriber->flushQueued = false;
+    // Буфер соединения забит: события ждут здесь до write-complete
+    if (subscriber->backedUp || subscriber->queue.empty()) {
+      return;
+    }
+    batch.swap(subscriber->queue);
+  }
+  std::string out;
+  for (const auto &event : batch) {
+    out += *event;
+  }
+  if (!subscriber->stream->send(out)) {
+    remove(subscriber);
+    return;
+  }
+  subscriber->lastDeliveryMs.store(nowMillis(), std::memory_order_relaxed);
+  delivered_.fetch_add(static_cast<int64_t>(batch.size()),
+                       std::memory_order_relaxed);
+}
+
+void FeedHub::ping(const SubscriberPtr &subscriber, int64_t nowMs) {
+  {
+    std::lock_guard lock(subscriber->mutex);
+    if (subscriber->closed) {
+      return;
+    }
+  }
+  if (subscriber->backedUp) {
+    // Пинг лёг бы в тот же забитый буфер
+    if (nowMs - subscriber->backedUpSinceMs >
+        config_.stallTimeout.count() * 1000) {
+      stalled_.fetch_add(1, std::memory_order_relaxed);
+      remove(subscriber);
+    }
+    return;
+  }
+  auto idleMs = nowMs - subscriber->lastDeliveryMs.load(
+                            std::memory_order_relaxed);
+  if (idleMs > config_.idleTimeout.count() * 1000) {
+    evicted_.fetch_add(1, std::memory_order_relaxed);
+    remove(subscriber);
+    return;
+  }
+  // Комментарий SSE: клиент его игнорирует
+  if (!subscriber->stream->send(": ping\n\n")) {
+    remove(subscriber);
+  }
+}
+
+// В потоке loop подписчика
+void FeedHub::remove(const SubscriberPtr &subscriber) {
+  {
+    std::lock_guard lock(subscriber->mutex);
+    if (subscriber->closed) {
+      return;
+    }
+    subscriber->closed = true;
+    subscriber->queue.clear();
+  }
+  {
+    auto &shard = shardFor(subscriber->userId);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.byUser.find(subscriber->userId);
+    if (it != shard.byUser.end()) {
+      auto &list = it->second;
+      list.erase(std::remove(list.begin(), list.end(), subscriber),
+                 list.end());
+      if (list.empty()) {
+        shard.byUser.erase(it);
+      }
+    }
+  }
+  connections_.fetch_sub(1, std::memory_order_relaxed);
+  subscriber->stream->close();
+  subscriber->stream.reset();
+}
+
+// Пинг и вытеснение: каждый подписчик обрабатывается в своём потоке
+void FeedHub::sweep() {
+  auto now = nowMillis();
+  std::vector<SubscriberPtr> all;
+  all.reserve(connections());
+  for (auto &shard : shards_) {
+    std::lock_guard lock(shard.mutex);
+    for (const auto &[userId, list] : shard.byUser) {
+      all.insert(all.end(), list.begin(), list.end());
+    }
+  }
+  for (const auto &subscriber : all) {
+    subscriber->loop->queueInLoop(
+        [this, subscriber, now]() { ping(subscriber, now); });
+  }
+}
+
+void FeedHub::publishPost(int64_t authorId, const Json::Value &summary) {
+  if (connections_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "";
+  auto event = std::make_shared<const std::string>(
+      formatEvent("post", std::to_string(summary["id"].asInt64()),
+                  Json::writeString(writer, summary)));
+
+  storage::Repositories::instance().follows().followerIds(
+      authorId,
+      [this, event, authorId](std::vector<int64_t> followers) {
+        // Автору тоже: пост появится в его других вкладках
+        std::vector<int64_t> userIds{authorId};
+        userIds.insert(userIds.end(), followers.begin(), followers.end());
+        publish(userIds, event);
+      },
+      [authorId](const std::exception &e) {
+        LOG_ERROR << "Error loading followers of " << authorId
+                  << " for feed stream: " << e.what();
+      });
+}
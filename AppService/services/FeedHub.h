@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Json {
+class Value;
+}
+
+namespace drogon {
+class ResponseStream;
+using ResponseStreamPtr = std::unique_ptr<ResponseStream>;
+} // namespace drogon
+
+namespace trantor {
+class EventLoop;
+class TcpConnection;
+} // namespace trantor
+
+namespace services {
+
+// Push новых постов по SSE (GET /feed/stream). Подписка — открытый
+// потоковый ответ Drogon, привязанный к IO-потоку своего соединения;
+// все записи в поток идут только из этого потока.
+//
+// Неотправленное ограничено на каждом соединении. Буфер отправки
+// соединения (trantor) следится колбэками high-water и write-complete:
+// когда в нём больше sendBufferBytes, соединение считается забитым, и
+// события ждут в очереди хаба, а не в буфере. Очередь хаба ограниченной
+// длины: если клиент не успевает, самые старые события выбрасываются.
+// Соединение, забитое дольше stallTimeout, закрывается — клиент
+// переподключится и получит свежие события.
+//
+// Пинг раз в heartbeat держит соединение живым для
+// idle_connection_timeout и прокси и заодно находит мёртвые
+// соединения: send() на закрытом возвращает false. Соединение, которому
+// дольше idleTimeout ничего не доставлялось, закрывается — клиент
+// переподключается и заново проходит проверку токена.
+class FeedHub {
+public:
+  struct Config {
+    bool enabled = true;
+    size_t queueSize = 64;
+    std::chrono::seconds heartbeat{25};
+    std::chrono::seconds idleTimeout{1800};
+    size_t maxStreamsPerUser = 8;
+    size_t sendBufferBytes = 256 << 10;
+    std::chrono::seconds stallTimeout{30};
+  };
+
+  static FeedHub &instance();
+
+  FeedHub();
+
+  void configure(const Config &config);
+
+  // Таймер пингов и вытеснения; после запуска event loop
+  void start();
+
+  // Вызывается в IO-потоке соединения (колбэк newAsyncStreamResponse).
+  // false — у пользователя уже maxStreamsPerUser соединений, поток
+  // закрыт с событием error
+  bool subscribe(int64_t userId, drogon::ResponseStreamPtr stream,
+                 std::weak_ptr<trantor::TcpConnection> connection);
+
+  // Готовое SSE-событие всем соединениям пользователей из списка;
+  // текст события один на всех
+  void publish(const std::vector<int64_t> &userIds,
+               std::shared_ptr<const std::string> event);
+
+  // Новый публичный пост: подписчики автора из follows, событие "post"
+  // с кратким описанием. Асинхронно, из любого потока
+  void publishPost(int64_t authorId, const Json::Value &summary);
+
+  bool enabled() const { return config_.enabled; }
+
+  size_t connections() const;
+
+  // "id: <id>\nevent: <event>\ndata: <data>\n\n"; data без переводов
+  // строк (JSON в одну строку)
+  static std::string formatEvent(const std::string &event,
+                                 const std::string &id,
+                                 const std::string &data);
+
+private:
+  struct Subscriber;
+  using SubscriberPtr = std::shared_ptr<Subscriber>;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<int64_t, std::vector<SubscriberPtr>> byUser;
+  };
+  static constexpr size_t kShards = 64;
+
+  Shard &shardFor(int64_t userId);
+  void enqueue(const SubscriberPtr &subscriber,
+               const std::shared_ptr<const std::string> &event);
+  void flush(const SubscriberPtr &subscriber);
+  void watchSendBuffer(const SubscriberPtr &subscriber);
+  void ping(const SubscriberPtr &subscriber, int64_t nowMs);
+  void remove(const SubscriberPtr &subscriber);
+  void sweep();
+
+  Config config_;
+  std::array<Shard, kShards> shards_;
+  std::atomic<int64_t> connections_{0};
+
+  std::atomic<int64_t> &subscribed_;
+  std::atomic<int64_t> &rejected_;
+  std::atomic<int64_t> &delivered_;
+  std::atomic<int64_t> &dropped_;
+  std::atomic<int64_t> &evicted_;
+  std::atomic<int64_t> &stalled_;
+};
+
+} // namespace services
@@ -0,0 +1,99 @@
+#include "HotFileCache.h"
+#include "MediaIo.h"
+#include "Metrics.h"
+
+using namespace services;
+
+HotFileCache &HotFileCache::instance() {
+  static HotFileCache cache;
+  return cache;
+}
+
+HotFileCache::HotFileCache()
+    : hits_(Metrics::instance().counter(
+          "media_hot_cache_hits_total", "Media responses served from memory")),
+      misses_(Metrics::instance().counter(
+          "media_hot_cache_misses_total",
+          "Small media files read from disk into the hot cache")) {
+  Metrics::instance().gauge(
+      "media_hot_cache_bytes", "Bytes held by the hot media cache",
+      [this]() { return static_cast<double>(bytes()); });
+}
+
+void HotFileCache::configure(size_t maxBytes, size_t maxFileBytes) {
+  std::lock_guard lock(mutex_);
+  maxBytes_ = maxBytes;
+  maxFileBytes_ = maxFileBytes;
+  evictLocked();
+}
+
+HotFileCache::Content HotFileCache::get(const std::string &path) {
+  std::lock_guard lock(mutex_);
+  auto it = index_.find(path);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return it->second->content;
+}
+
+void HotFileCache::load(const std::string &path, uint64_t size,
+                        std::function<void(Content)> done) {
+  if (size > maxFileBytes_ || size > maxBytes_) {
+    done(nullptr);
+    return;
+  }
+
+  MediaIo::instance().readFile(
+      path, size,
+      [this, path, size, done = std::move(done)](
+          std::shared_ptr<std::string> data) {
+        if (!data || data->size() != size) {
+          done(nullptr);
+          return;
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+
+        Content content = std::move(data);
+        {
+          std::lock_guard lock(mutex_);
+          auto it = index_.find(path);
+          if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            content = it->second->content;
+          } else {
+            lru_.push_front({path, content});
+            index_.emplace(path, lru_.begin());
+            bytes_ += content->size();
+            evictLocked();
+          }
+        }
+        done(std::move(content));
+      });
+}
+
+void HotFileCache::invalidate(const std::string &path) {
+  std::lock_guard lock(mutex_);
+  auto it = index_.find(path);
+  if (it == index_.end()) {
+    return;
+  }
+  bytes_ -= it->second->content->size();
+  lru_.erase(it->second);
+  index_.erase(it);
+}
+
+size_t HotFileCache::bytes() const {
+  std::lock_guard lock(mutex_);
+  return bytes_;
+}
+
+void HotFileCache::evictLocked() {
+  while (bytes_ > maxBytes_ && !lru_.empty()) {
+    auto &victim = lru_.back();
+    bytes_ -= victim.content->size();
+    index_.erase(victim.path);
+    lru_.pop_back();
+  }
+}
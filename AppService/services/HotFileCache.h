@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace services {
+
+// LRU-кэш содержимого небольших файлов (аватары, превью), ограниченный
+// суммарным размером. Файлы в uploads/ неизменяемы, поэтому инвалидация
+// нужна только при удалении.
+class HotFileCache {
+public:
+  using Content = std::shared_ptr<const std::string>;
+
+  static HotFileCache &instance();
+
+  HotFileCache();
+
+  void configure(size_t maxBytes, size_t maxFileBytes);
+
+  Content get(const std::string &path);
+  // Асинхронно читает файл с диска (MediaIo) и кладёт в кэш, если он не
+  // больше maxFileBytes. done вызывается в потоке завершений MediaIo,
+  // с nullptr — если файл не подходит или не прочитан
+  void load(const std::string &path, uint64_t size,
+            std::function<void(Content)> done);
+  void invalidate(const std::string &path);
+
+  size_t maxFileBytes() const { return maxFileBytes_; }
+  size_t bytes() const;
+
+private:
+  struct Entry {
+    std::string path;
+    Content content;
+  };
+
+  void evictLocked();
+
+  mutable std::mutex mutex_;
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  size_t bytes_ = 0;
+  size_t maxBytes_ = 64 << 20;
+  size_t maxFileBytes_ = 256 << 10;
+
+  std::atomic<int64_t> &hits_;
+  std::atomic<int64_t> &misses_;
+};
+
+} // namespace services
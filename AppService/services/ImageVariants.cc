@@ -0,0 +1,534 @@
+#include "ImageVariants.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <jpeglib.h>
+#include <memory>
+#include <png.h>
+#include <unistd.h>
+#include <webp/encode.h>
+
+using namespace services;
+
+namespace {
+
+// Защита от «бомб»: огромные размеры при маленьком файле
+constexpr int64_t kMaxPixels = 64LL * 1000 * 1000;
+
+struct FileCloser {
+  void operator()(FILE *f) const { std::fclose(f); }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+// libjpeg по умолчанию вызывает exit() при ошибке — возвращаемся
+// через longjmp
+struct JpegError {
+  jpeg_error_mgr mgr;
+  std::jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr cinfo) {
+  auto *error = reinterpret_cast<JpegError *>(cinfo->err);
+  std::longjmp(error->jump, 1);
+}
+
+void jpegSilence(j_common_ptr, int) {}
+
+// Тег Orientation (0x0112) из IFD0 блока EXIF в APP1; 1, если его нет
+// или блок повреждён
+int exifOrientation(const jpeg_decompress_struct &cinfo) {
+  for (auto *marker = cinfo.marker_list; marker; marker = marker->next) {
+    const uint8_t *data = marker->data;
+    size_t size = marker->data_length;
+    if (marker->marker != JPEG_APP0 + 1 || size < 14 ||
+        std::memcmp(data, "Exif\0\0", 6) != 0) {
+      continue;
+    }
+    const uint8_t *tiff = data + 6;
+    size -= 6;
+    bool little = tiff[0] == 'I' && tiff[1] == 'I';
+    if (!little && !(tiff[0] == 'M' && tiff[1] == 'M')) {
+      return 1;
+    }
+    auto read16 = [&](size_t at) -> uint32_t {
+      return little ? tiff[at] | tiff[at + 1] << 8
+                    : tiff[at] << 8 | tiff[at + 1];
+    };
+    auto read32 = [&](size_t at) -> uint32_t {
+      return little ? read16(at) | read16(at + 2) << 16
+                    : read16(at) << 16 | read16(at + 2);
+    };
+    size_t ifd = read32(4);
+    if (ifd + 2 > size) {
+      return 1;
+    }
+    size_t entries = read16(ifd);
+    for (size_t i = 0; i < entries; ++i) {
+      size_t entry = ifd + 2 + i * 12;
+      if (entry + 12 > size) {
+        return 1;
+      }
+      // Тип SHORT, одно значение — в первых двух байтах поля значения
+      if (read16(entry) == 0x0112 && read16(entry + 2) == 3) {
+        int orientation = static_cast<int>(read16(entry + 8));
+        return orientation >= 1 && orientation <= 8 ? orientation : 1;
+      }
+    }
+    return 1;
+  }
+  return 1;
+}
+
+// Поворачивает и отражает декодированный кадр так, как его показывает
+// браузер для данного значения EXIF Orientation
+Image orientImage(const Image &source, int orientation) {
+  bool swap = orientation >= 5;
+  Image result;
+  result.width = swap ? source.height : source.width;
+  result.height = swap ? source.width : source.height;
+  result.rgb.resize(source.rgb.size());
+  int w = source.width;
+  int h = source.height;
+  for (int y = 0; y < result.height; ++y) {
+    uint8_t *dst = result.rgb.data() + size_t(y) * result.width * 3;
+    for (int x = 0; x < result.width; ++x) {
+      int sx = x;
+      int sy = y;
+      switch (orientation) {
+      case 2:
+        sx = w - 1 - x;
+        break;
+      case 3:
+        sx = w - 1 - x;
+        sy = h - 1 - y;
+        break;
+      case 4:
+        sy = h - 1 - y;
+        break;
+      case 5:
+        sx = y;
+        sy = x;
+        break;
+      case 6:
+        sx = y;
+        sy = h - 1 - x;
+        break;
+      case 7:
+        sx = w - 1 - y;
+        sy = h - 1 - x;
+        break;
+      case 8:
+        sx = w - 1 - y;
+        sy = x;
+        break;
+      }
+      std::memcpy(dst + x * 3,
+                  source.rgb.data() + (size_t(sy) * w + sx) * 3, 3);
+    }
+  }
+  return result;
+}
+
+bool decodeJpeg(FILE *file, int minWidth, Image &image, int &originalWidth,
+                int &originalHeight) {
+  jpeg_decompress_struct cinfo;
+  JpegError error;
+  cinfo.err = jpeg_std_error(&error.mgr);
+  error.mgr.error_exit = jpegErrorExit;
+  error.mgr.emit_message = jpegSilence;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_stdio_src(&cinfo, file);
+  jpeg_save_markers(&cinfo, JPEG_APP0 + 1, 0xFFFF);
+  jpeg_read_header(&cinfo, TRUE);
+
+  // Телефоны пишут кадр как снимает сенсор и ставят Orientation;
+  // варианты и размеры — уже в том виде, в каком фото показывают
+  int orientation = exifOrientation(cinfo);
+  bool swap = orientation >= 5;
+  unsigned displayWidth = swap ? cinfo.image_height : cinfo.image_width;
+  originalWidth = static_cast<int>(displayWidth);
+  originalHeight =
+      static_cast<int>(swap ? cinfo.image_width : cinfo.image_height);
+  if (static_cast<int64_t>(originalWidth) * originalHeight > kMaxPixels) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  cinfo.out_color_space = JCS_RGB;
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = 1;
+  for (unsigned denom : {8u, 4u, 2u}) {
+    if (displayWidth / denom >= static_cast<unsigned>(minWidth)) {
+      cinfo.scale_denom = denom;
+      break;
+    }
+  }
+  cinfo.dct_method = JDCT_IFAST;
+
+  jpeg_start_decompress(&cinfo);
+  image.width = static_cast<int>(cinfo.output_width);
+  image.height = static_cast<int>(cinfo.output_height);
+  image.rgb.resize(size_t(image.width) * image.height * 3);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row =
+        image.rgb.data() + size_t(cinfo.output_scanline) * image.width * 3;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  if (orientation != 1) {
+    image = orientImage(image, orientation);
+  }
+  return true;
+}
+
+bool decodePng(FILE *file, Image &image, int &originalWidth,
+               int &originalHeight) {
+  png_structp png =
+      png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  if (!png) {
+    return false;
+  }
+  png_infop info = png_create_info_struct(png);
+  if (!info || setjmp(png_jmpbuf(png))) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    return false;
+  }
+
+  png_init_io(png, file);
+  png_read_info(png, info);
+  originalWidth = static_cast<int>(png_get_image_width(png, info));
+  originalHeight = static_cast<int>(png_get_image_height(png, info));
+  if (static_cast<int64_t>(originalWidth) * originalHeight > kMaxPixels) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    return false;
+  }
+
+  // Любой формат PNG -> 8-битный RGB, прозрачность — на белом фоне
+  png_set_strip_16(png);
+  png_set_packing(png);
+  png_set_expand(png);
+  png_set_gray_to_rgb(png);
+  png_color_16 white = {0, 255, 255, 255, 255};
+  png_set_background(png, &white, PNG_BACKGROUND_GAMMA_SCREEN, 0, 1.0);
+  png_set_strip_alpha(png);
+  png_set_interlace_handling(png);
+  png_read_update_info(png, info);
+
+  image.width = originalWidth;
+  image.height = originalHeight;
+  image.rgb.resize(size_t(image.width) * image.height * 3);
+  std::vector<png_bytep> rows(image.height);
+  for (int y = 0; y < image.height; ++y) {
+    rows[y] = image.rgb.data() + size_t(y) * image.width * 3;
+  }
+  png_read_image(png, rows.data());
+  png_read_end(png, nullptr);
+  png_destroy_read_struct(&png, &info, nullptr);
+  return true;
+}
+
+// Веса усреднения по площади для одной оси
+struct Tap {
+  int index;
+  float weight;
+};
+
+std::vector<std::vector<Tap>> areaTaps(int from, int to) {
+  std::vector<std::vector<Tap>> taps(to);
+  double scale = static_cast<double>(from) / to;
+  for (int o = 0; o < to; ++o) {
+    double start = o * scale;
+    double end = std::min<double>(from, (o + 1) * scale);
+    for (int s = static_cast<int>(start); s < end; ++s) {
+      double w = std::min<double>(end, s + 1) - std::max<double>(start, s);
+      if (w > 0) {
+        taps[o].push_back({s, static_cast<float>(w / scale)});
+      }
+    }
+  }
+  return taps;
+}
+
+const char kBase83[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrs"
+                       "tuvwxyz#$%*+,-.:;=?@[]^_{|}~";
+
+void encode83(int value, int length, std::string &out) {
+  int divisor = 1;
+  for (int i = 1; i < length; ++i) {
+    divisor *= 83;
+  }
+  for (int i = 0; i < length; ++i) {
+    out.push_back(kBase83[(value / divisor) % 83]);
+    divisor /= 83;
+  }
+}
+
+float srgbToLinear(uint8_t value) {
+  float v = value / 255.0f;
+  return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+int linearToSrgb(float value) {
+  float v = std::clamp(value, 0.0f, 1.0f);
+  return v <= 0.0031308f
+             ? static_cast<int>(v * 12.92f * 255 + 0.5f)
+             : static_cast<int>(
+                   (1.055f * std::pow(v, 1 / 2.4f) - 0.055f) * 255 + 0.5f);
+}
+
+float signPow(float value, float exp) {
+  return std::copysign(std::pow(std::fabs(value), exp), value);
+}
+
+} // namespace
+
+bool services::decodeImage(const std::string &path,
+                           const std::string &extension, int minWidth,
+                           Image &image, int &originalWidth,
+                           int &originalHeight) {
+  FilePtr file(std::fopen(path.c_str(), "rb"));
+  if (!file) {
+    return false;
+  }
+  if (extension == "jpg" || extension == "jpeg") {
+    return decodeJpeg(file.get(), minWidth, image, originalWidth,
+                      originalHeight);
+  }
+  if (extension == "png") {
+    return decodePng(file.get(), image, originalWidth, originalHeight);
+  }
+  return false;
+}
+
+Image services::resizeImage(const Image &source, int width, int height) {
+  auto xTaps = areaTaps(source.width, width);
+  auto yTaps = areaTaps(source.height, height);
+
+  // Сначала по горизонтали в float, затем по вертикали
+  std::vector<float> rows(size_t(source.height) * width * 3);
+  for (int y = 0; y < source.height; ++y) {
+    const uint8_t *src = source.rgb.data() + size_t(y) * source.width * 3;
+    float *dst = rows.data() + size_t(y) * width * 3;
+    for (int x = 0; x < width; ++x) {
+      float r = 0, g = 0, b = 0;
+      for (const auto &tap : xTaps[x]) {
+        const uint8_t *p = src + tap.index * 3;
+        r += p[0] * tap.weight;
+        g += p[1] * tap.weight;
+        b += p[2] * tap.weight;
+      }
+      dst[x * 3] = r;
+      dst[x * 3 + 1] = g;
+      dst[x * 3 + 2] = b;
+    }
+  }
+
+  Image result;
+  result.width = width;
+  result.height = height;
+  result.rgb.resize(size_t(width) * height * 3);
+  std::vector<float> acc(size_t(width) * 3);
+  for (int y = 0; y < height; ++y) {
+    std::fill(acc.begin(), acc.end(), 0.0f);
+    for (const auto &tap : yTaps[y]) {
+      const float *src = rows.data() + size_t(tap.index) * width * 3;
+      for (int i = 0; i < width * 3; ++i) {
+        acc[i] += src[i] * tap.weight;
+      }
+    }
+    uint8_t *dst = result.rgb.data() + size_t(y) * width * 3;
+    for (int i = 0; i < width * 3; ++i) {
+      dst[i] = static_cast<uint8_t>(std::clamp(acc[i] + 0.5f, 0.0f, 255.0f));
+    }
+  }
+  return result;
+}
+
+bool services::encodeJpeg(const Image &image, int quality,
+                          const std::string &path) {
+  FilePtr file(std::fopen(path.c_str(), "wb"));
+  if (!file) {
+    return false;
+  }
+
+  jpeg_compress_struct cinfo;
+  JpegError error;
+  cinfo.err = jpeg_std_error(&error.mgr);
+  error.mgr.error_exit = jpegErrorExit;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_compress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_compress(&cinfo);
+  jpeg_stdio_dest(&cinfo, file.get());
+  cinfo.image_width = image.width;
+  cinfo.image_height = image.height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  jpeg_simple_progression(&cinfo);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    auto row = const_cast<JSAMPROW>(image.rgb.data() +
+                                    size_t(cinfo.next_scanline) *
+                                        image.width * 3);
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return std::fflush(file.get()) == 0;
+}
+
+bool services::encodeWebp(const Image &image, int quality,
+                          const std::string &path) {
+  uint8_t *output = nullptr;
+  size_t size = WebPEncodeRGB(image.rgb.data(), image.width, image.height,
+                              image.width * 3, static_cast<float>(quality),
+                              &output);
+  if (size == 0) {
+    return false;
+  }
+  std::unique_ptr<uint8_t, void (*)(void *)> data(output, WebPFree);
+
+  FilePtr file(std::fopen(path.c_str(), "wb"));
+  return file && std::fwrite(data.get(), 1, size, file.get()) == size &&
+         std::fflush(file.get()) == 0;
+}
+
+std::string services::blurhash(const Image &image, int xComponents,
+                               int yComponents) {
+  std::vector<float> linear(image.rgb.size());
+  for (size_t i = 0; i < linear.size(); ++i) {
+    linear[i] = srgbToLinear(image.rgb[i]);
+  }
+
+  std::vector<std::array<float, 3>> factors;
+  for (int j = 0; j < yComponents; ++j) {
+    for (int i = 0; i < xComponents; ++i) {
+      float normalisation = (i == 0 && j == 0) ? 1.0f : 2.0f;
+      float r = 0, g = 0, b = 0;
+      for (int y = 0; y < image.height; ++y) {
+        float cy = std::cos(float(M_PI) * j * y / image.height);
+        for (int x = 0; x < image.width; ++x) {
+          float basis = cy * std::cos(float(M_PI) * i * x / image.width);
+          const float *p = linear.data() + (size_t(y) * image.width + x) * 3;
+          r += basis * p[0];
+          g += basis * p[1];
+          b += basis * p[2];
+        }
+      }
+      float scale = normalisation / (image.width * image.height);
+      factors.push_back({r * scale, g * scale, b * scale});
+    }
+  }
+
+  std::string hash;
+  encode83((xComponents - 1) + (yComponents - 1) * 9, 1, hash);
+
+  float maximumValue = 1.0f;
+  if (factors.size() > 1) {
+    float actualMax = 0;
+    for (size_t i = 1; i < factors.size(); ++i) {
+      for (float v : factors[i]) {
+        actualMax = std::max(actualMax, std::fabs(v));
+      }
+    }
+    int quantisedMax = std::clamp(
+        static_cast<int>(std::floor(actualMax * 166 - 0.5f)), 0, 82);
+    maximumValue = (quantisedMax + 1) / 166.0f;
+    encode83(quantisedMax, 1, hash);
+  } else {
+    encode83(0, 1, hash);
+  }
+
+  const auto &dc = factors[0];
+  encode83((linearToSrgb(dc[0]) << 16) + (linearToSrgb(dc[1]) << 8) +
+               linearToSrgb(dc[2]),
+           4, hash);
+
+  for (size_t i = 1; i < factors.size(); ++i) {
+    int q[3];
+    for (int c = 0; c < 3; ++c) {
+      q[c] = std::clamp(
+          static_cast<int>(std::floor(
+              signPow(factors[i][c] / maximumValue, 0.5f) * 9 + 9.5f)),
+          0, 18);
+    }
+    encode83(q[0] * 19 * 19 + q[1] * 19 + q[2], 2, hash);
+  }
+  return hash;
+}
+
+bool services::makeImageVariants(const std::string &root,
+                                 const std::string &path,
+                                 const std::vector<int> &widths, int quality,
+                                 ImageVariantSet &result) {
+  auto dot = path.rfind('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string extension = path.substr(dot + 1);
+  std::string stem = path.substr(0, dot);
+
+  int largest = widths.empty() ? 0
+                               : *std::max_element(widths.begin(), widths.end());
+  Image decoded;
+  if (!decodeImage(root + "/" + path, extension, largest, decoded,
+                   result.width, result.height) ||
+      decoded.width == 0 || decoded.height == 0) {
+    return false;
+  }
+
+  // Для BlurHash достаточно уменьшенной до 32 пикселей в ширину копии
+  int hashWidth = std::min(decoded.width, 32);
+  int hashHeight = std::max(1, decoded.height * hashWidth / decoded.width);
+  result.blurhash = blurhash(resizeImage(decoded, hashWidth, hashHeight));
+
+  result.variants.clear();
+  for (int width : widths) {
+    if (width >= result.width) {
+      continue;
+    }
+    int height = std::max(
+        1, static_cast<int>(int64_t(result.height) * width / result.width));
+    ImageVariant variant;
+    variant.width = width;
+    variant.height = height;
+    variant.path = stem + "_w" + std::to_string(width) + ".jpg";
+    variant.webpPath = stem + "_w" + std::to_string(width) + ".webp";
+
+    // Файл варианта однозначно определяется исходным дайджестом и
+    // шириной, поэтому уже существующий не пересоздаём
+    Image resized;
+    for (const auto *name : {&variant.path, &variant.webpPath}) {
+      std::string fullPath = root + "/" + *name;
+      if (::access(fullPath.c_str(), F_OK) == 0) {
+        continue;
+      }
+      if (resized.rgb.empty()) {
+        resized = resizeImage(decoded, width, height);
+      }
+      std::string tempPath = fullPath + ".tmp";
+      bool encoded = name == &variant.path
+                         ? encodeJpeg(resized, quality, tempPath)
+                         : encodeWebp(resized, quality, tempPath);
+      if (!encoded || std::rename(tempPath.c_str(), fullPath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+      }
+    }
+    result.variants.push_back(std::move(variant));
+  }
+  return true;
+}
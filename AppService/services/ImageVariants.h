@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace services {
+
+// Декодирование, уменьшение и кодирование фотографий для превью.
+// JPEG — libjpeg(-turbo), PNG — libpng, WebP — libwebp; всё выполняется
+// в процессе.
+struct Image {
+  int width = 0;
+  int height = 0;
+  // RGB, 3 байта на пиксель, построчно
+  std::vector<uint8_t> rgb;
+};
+
+// Декодирует jpg/jpeg/png. minWidth — подсказка для JPEG: декодер
+// сразу уменьшает изображение в 2/4/8 раз (DCT scaling), пока ширина
+// не меньше minWidth. originalWidth/Height — размеры до уменьшения.
+// JPEG поворачивается по EXIF Orientation: и image, и размеры — в том
+// виде, в каком фото показывает браузер.
+bool decodeImage(const std::string &path, const std::string &extension,
+                 int minWidth, Image &image, int &originalWidth,
+                 int &originalHeight);
+
+// Уменьшение усреднением по площади (box filter)
+Image resizeImage(const Image &source, int width, int height);
+
+bool encodeJpeg(const Image &image, int quality, const std::string &path);
+// Lossy WebP; quality — та же шкала 0..100
+bool encodeWebp(const Image &image, int quality, const std::string &path);
+
+// BlurHash (https://blurha.sh) с xComponents x yComponents компонентами
+std::string blurhash(const Image &image, int xComponents = 4,
+                     int yComponents = 3);
+
+struct ImageVariant {
+  int width = 0;
+  int height = 0;
+  // Относительно корня хранилища, как MediaStore::Object::path
+  std::string path;
+  // Тот же размер в WebP
+  std::string webpPath;
+};
+
+struct ImageVariantSet {
+  int width = 0;
+  int height = 0;
+  std::string blurhash;
+  std::vector<ImageVariant> variants;
+};
+
+// Строит варианты исходного файла root/path для каждой ширины из
+// widths, меньшей исходной: root/<path без расширения>_w<ширина>.jpg и
+// рядом .webp того же размера
+bool makeImageVariants(const std::string &root, const std::string &path,
+                       const std::vector<int> &widths, int quality,
+                       ImageVariantSet &result);
+
+} // namespace services
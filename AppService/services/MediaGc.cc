@@ -0,0 +1,319 @@
+#include "MediaGc.h"
+#include "DirectoryStream.h"
+#include "HotFileCache.h"
+#include "MediaIo.h"
+#include "MediaStore.h"
+#include "Metrics.h"
+#include "SqlArrays.h"
+#include <cstring>
+#include <drogon/drogon.h>
+#include <fcntl.h>
+#include <functional>
+#include <future>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_set>
+
+using namespace services;
+
+namespace {
+
+// Дайджест оригинала для имени превью "<64 hex>_w<ширина>.<ext>"
+std::string ownerDigest(const std::string &name) {
+  auto stem = name.substr(0, name.rfind('.'));
+  if (stem.size() < 67 || stem.compare(64, 2, "_w") != 0 ||
+      stem.find_first_not_of("0123456789", 66) != std::string::npos) {
+    return "";
+  }
+  if (stem.find_first_not_of("0123456789abcdef") < 64) {
+    return "";
+  }
+  return stem.substr(0, 64);
+}
+
+bool endsWith(const std::string &value, const std::string &suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(),
+                       suffix) == 0;
+}
+
+// Обход дерева: shard-каталоги ab/cd, плюс старые файлы в корне
+constexpr int kMaxDepth = 2;
+
+using FileVisitor = std::function<void(int dirFd, const std::string &path,
+                                       const std::string &name)>;
+
+void walk(int parentFd, const char *name, const std::string &prefix,
+          int depth, const FileVisitor &visit) {
+  DirectoryStream dir(parentFd, name);
+  if (!dir.isOpen()) {
+    return;
+  }
+  DirectoryStream::Entry entry;
+  while (dir.next(entry)) {
+    if (entry.name.front() == '.') {
+      continue;
+    }
+    std::string child(entry.name);
+    unsigned char type = entry.type;
+    if (type == DT_UNKNOWN) {
+      struct stat st;
+      if (::fstatat(dir.fd(), child.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        continue;
+      }
+      type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : 0;
+    }
+    if (type == DT_DIR && depth < kMaxDepth) {
+      walk(dir.fd(), child.c_str(), prefix + child + "/", depth + 1, visit);
+    } else if (type == DT_REG) {
+      visit(dir.fd(), prefix + child, child);
+    }
+  }
+  if (dir.error() != 0) {
+    LOG_WARN << "Media GC could not read " << prefix << ": "
+             << std::strerror(dir.error());
+  }
+}
+
+} // namespace
+
+MediaGc &MediaGc::instance() {
+  static MediaGc gc;
+  return gc;
+}
+
+MediaGc::MediaGc()
+    : sweeps_(Metrics::instance().counter("media_gc_sweeps_total",
+                                          "Completed media GC sweeps")),
+      scanned_(Metrics::instance().counter(
+          "media_gc_files_scanned_total", "Files examined by media GC")),
+      deleted_(Metrics::instance().counter(
+          "media_gc_files_deleted_total",
+          "Unreferenced media files deleted by GC")),
+      bytesReclaimed_(Metrics::instance().counter(
+          "media_gc_bytes_reclaimed_total",
+          "Bytes freed by deleting unreferenced media files")),
+      sweepMillis_(Metrics::instance().counter(
+          "media_gc_sweep_milliseconds_total", "Time spent in media GC")) {
+  Metrics::instance().gauge(
+      "media_gc_last_sweep_seconds", "Duration of the last media GC sweep",
+      [this]() {
+        return lastSweepMillis_.load(std::memory_order_relaxed) / 1000.0;
+      });
+}
+
+void MediaGc::configure(const Config &config) { config_ = config; }
+
+void MediaGc::start(std::chrono::seconds interval) {
+  std::thread([this, interval]() {
+    while (true) {
+      std::this_thread::sleep_for(interval);
+      try {
+        auto stats = sweep(drogon::app().getDbClient());
+        LOG_INFO << "Media GC: scanned " << stats.scanned << " files, "
+                 << (config_.dryRun ? "would delete " : "deleted ")
+                 << stats.deleted << " (" << stats.bytesReclaimed / 1024
+                 << " KiB) in " << stats.seconds << "s";
+      } catch (const std::exception &e) {
+        LOG_ERROR << "Media GC sweep failed: " << e.what();
+      }
+    }
+  }).detach();
+}
+
+MediaGc::SweepStats MediaGc::sweep(const drogon::orm::DbClientPtr &db) {
+  SweepStats stats;
+  if (running_.exchange(true)) {
+    return stats;
+  }
+  struct Release {
+    std::atomic<bool> &flag;
+    ~Release() { flag.store(false); }
+  } release{running_};
+
+  auto startedAt = std::chrono::steady_clock::now();
+  auto cutoff = std::chrono::system_clock::to_time_t(
+      std::chrono::system_clock::now() - config_.grace);
+  const auto &root = MediaStore::instance().root();
+  size_t batchSize = std::max<size_t>(config_.batchSize, 1);
+
+  std::vector<Candidate> batch;
+  auto visitor = [&](bool incoming) -> FileVisitor {
+    return [&, incoming](int dirFd, const std::string &path,
+                         const std::string &name) {
+      struct stat st;
+      if (::fstatat(dirFd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return;
+      }
+      ++stats.scanned;
+      scanned_.fetch_add(1, std::memory_order_relaxed);
+      // mtime: дедуплицированная повторная загрузка обновляет его
+      // (MediaStore::place), так что «старый» файл действительно давно
+      // никто не загружал
+      if (st.st_mtime >= cutoff) {
+        return;
+      }
+      batch.push_back({path, incoming ? "" : ownerDigest(name),
+                       static_cast<uint64_t>(st.st_size)});
+      if (batch.size() >= batchSize) {
+        if (incoming) {
+          collectIncoming(db, batch);
+        } else {
+          collectReferenced(db, batch);
+        }
+        remove(db, batch, stats);
+      }
+    };
+  };
+
+  walk(AT_FDCWD, root.c_str(), "", 0, visitor(false));
+  if (!batch.empty()) {
+    collectReferenced(db, batch);
+    remove(db, batch, stats);
+  }
+
+  walk(AT_FDCWD, MediaStore::instance().incomingDir().c_str(), ".incoming/",
+       kMaxDepth, visitor(true));
+  if (!batch.empty()) {
+    collectIncoming(db, batch);
+    remove(db, batch, stats);
+  }
+
+  auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startedAt)
+                    .count();
+  stats.seconds = millis / 1000.0;
+  lastSweepMillis_.store(millis, std::memory_order_relaxed);
+  sweepMillis_.fetch_add(millis, std::memory_order_relaxed);
+  sweeps_.fetch_add(1, std::memory_order_relaxed);
+  return stats;
+}
+
+void MediaGc::collectReferenced(const drogon::orm::DbClientPtr &db,
+                                std::vector<Candidate> &batch) {
+  const auto &root = MediaStore::instance().root();
+  std::vector<std::string> paths, owners;
+  for (const auto &candidate : batch) {
+    paths.push_back(root + "/" + candidate.path);
+    owners.push_back(candidate.ownerDigest);
+  }
+
+  // Превью проверяется через оригинал с тем же дайджестом
+  auto result = db->execSqlSync(
+      "SELECT c.path FROM unnest($1::text[], $2::text[]) AS c(path, owner) "
+      "WHERE NOT EXISTS (SELECT 1 FROM attachments a "
+      "                  WHERE a.file_path = c.path) "
+      "  AND NOT EXISTS (SELECT 1 FROM users u "
+      "                  WHERE u.avatar_path = c.path) "
+      "  AND NOT EXISTS ( "
+      "    SELECT 1 FROM media_objects m "
+      "    WHERE c.owner <> '' AND m.digest = c.owner "
+      "      AND (EXISTS (SELECT 1 FROM attachments a "
+      "                   WHERE a.file_path = m.file_path) "
+      "           OR EXISTS (SELECT 1 FROM users u "
+      "                      WHERE u.avatar_path = m.file_path)))",
+      textArray(paths), textArray(owners));
+
+  std::unordered_set<std::string> unreferenced;
+  for (const auto &row : result) {
+    unreferenced.insert(row["path"].as<std::string>());
+  }
+  std::erase_if(batch, [&](const Candidate &candidate) {
+    return unreferenced.count(root + "/" + candidate.path) == 0;
+  });
+}
+
+void MediaGc::collectIncoming(const drogon::orm::DbClientPtr &db,
+                              std::vector<Candidate> &batch) {
+  // *.part — недописанный поток, дольше grace он не живёт.
+  // *.upload — данные сессии, пока её строка есть в upload_sessions
+  std::vector<std::string> ids;
+  for (const auto &candidate : batch) {
+    if (endsWith(candidate.path, ".upload")) {
+      auto name = candidate.path.substr(candidate.path.rfind('/') + 1);
+      ids.push_back(name.substr(0, name.size() - 7));
+    }
+  }
+  std::unordered_set<std::string> live;
+  if (!ids.empty()) {
+    auto result = db->execSqlSync(
+        "SELECT id FROM upload_sessions WHERE id = ANY($1::text[])",
+        textArray(ids));
+    for (const auto &row : result) {
+      live.insert(".incoming/" + row["id"].as<std::string>() + ".upload");
+    }
+  }
+  std::erase_if(batch, [&](const Candidate &candidate) {
+    return !(endsWith(candidate.path, ".part") ||
+             (endsWith(candidate.path, ".upload") &&
+              live.count(candidate.path) == 0));
+  });
+}
+
+void MediaGc::remove(const drogon::orm::DbClientPtr &db,
+                     std::vector<Candidate> &batch, SweepStats &stats) {
+  if (batch.empty()) {
+    return;
+  }
+  auto startedAt = std::chrono::steady_clock::now();
+  const auto &root = MediaStore::instance().root();
+
+  if (config_.dryRun) {
+    for (const auto &candidate : batch) {
+      LOG_INFO << "Media GC (dry run) would delete " << candidate.path;
+      ++stats.deleted;
+      stats.bytesReclaimed += candidate.size;
+    }
+  } else {
+    // Удаления пачки уходят в MediaIo вместе, ждём все завершения
+    struct Pending {
+      std::atomic<size_t> remaining;
+      std::promise<void> done;
+      std::vector<char> removed;
+    };
+    auto pending = std::make_shared<Pending>();
+    pending->remaining = batch.size();
+    pending->removed.assign(batch.size(), 0);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      MediaIo::instance().unlink(root + "/" + batch[i].path,
+                                 [pending, i](int64_t result) {
+                                   pending->removed[i] = result == 0;
+                                   if (pending->remaining.fetch_sub(1) == 1) {
+                                     pending->done.set_value();
+                                   }
+                                 });
+    }
+    pending->done.get_future().wait();
+
+    std::vector<std::string> removedPaths;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      auto fullPath = root + "/" + batch[i].path;
+      HotFileCache::instance().invalidate(fullPath);
+      if (!pending->removed[i]) {
+        continue;
+      }
+      ++stats.deleted;
+      stats.bytesReclaimed += batch[i].size;
+      deleted_.fetch_add(1, std::memory_order_relaxed);
+      bytesReclaimed_.fetch_add(batch[i].size, std::memory_order_relaxed);
+      removedPaths.push_back(std::move(fullPath));
+    }
+    if (!removedPaths.empty()) {
+      db->execSqlSync(
+          "DELETE FROM media_objects WHERE file_path = ANY($1::text[])",
+          textArray(removedPaths));
+    }
+  }
+
+  // Не больше maxDeletesPerSecond: пачка занимает минимум
+  // size / rate секунд
+  if (config_.maxDeletesPerSecond > 0) {
+    auto budget = std::chrono::duration<double>(batch.size() /
+                                                config_.maxDeletesPerSecond);
+    auto elapsed = std::chrono::steady_clock::now() - startedAt;
+    if (elapsed < budget) {
+      std::this_thread::sleep_for(budget - elapsed);
+    }
+  }
+  batch.clear();
+}
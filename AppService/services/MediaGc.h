@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace drogon {
+namespace orm {
+class DbClient;
+using DbClientPtr = std::shared_ptr<DbClient>;
+} // namespace orm
+} // namespace drogon
+
+namespace services {
+
+// Сборка мусора в uploads/. Файл удаляется, если он старше grace и на
+// него не ссылаются ни attachments, ни users.avatar_path; превью
+// (<digest>_w<ширина>.jpg) живут, пока используется их оригинал.
+// В uploads/.incoming удаляются брошенные *.part и *.upload без
+// сессии.
+//
+// Обход идёт потоково (DirectoryStream, getdents64), кандидаты
+// проверяются в БД пачками, удаление ограничено по скорости.
+class MediaGc {
+public:
+  struct Config {
+    std::chrono::seconds grace{86400};
+    size_t batchSize = 500;
+    double maxDeletesPerSecond = 200;
+    // Только считать, ничего не удалять
+    bool dryRun = false;
+  };
+
+  struct SweepStats {
+    uint64_t scanned = 0;
+    uint64_t deleted = 0;
+    uint64_t bytesReclaimed = 0;
+    double seconds = 0;
+  };
+
+  static MediaGc &instance();
+
+  MediaGc();
+
+  void configure(const Config &config);
+
+  // Один полный проход; блокирующий, вызывается из фонового потока
+  SweepStats sweep(const drogon::orm::DbClientPtr &db);
+
+  // Фоновый поток: sweep() каждые interval
+  void start(std::chrono::seconds interval);
+
+private:
+  struct Candidate {
+    // Относительно корня хранилища
+    std::string path;
+    // Для превью — дайджест оригинала, иначе пусто
+    std::string ownerDigest;
+    uint64_t size = 0;
+  };
+
+  void collectReferenced(const drogon::orm::DbClientPtr &db,
+                         std::vector<Candidate> &batch);
+  void collectIncoming(const drogon::orm::DbClientPtr &db,
+                       std::vector<Candidate> &batch);
+  void remove(const drogon::orm::DbClientPtr &db,
+              std::vector<Candidate> &batch, SweepStats &stats);
+
+  Config config_;
+  std::atomic<bool> running_{false};
+  std::atomic<int64_t> lastSweepMillis_{0};
+
+  std::atomic<int64_t> &sweeps_;
+  std::atomic<int64_t> &scanned_;
+  std::atomic<int64_t> &deleted_;
+  std::atomic<int64_t> &bytesReclaimed_;
+  std::atomic<int64_t> &sweepMillis_;
+};
+
+} // namespace services
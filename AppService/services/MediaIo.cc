@@ -0,0 +1,872 @@
+#include "MediaIo.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <future>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace services;
+
+namespace {
+
+constexpr size_t kAlignment = 4096;
+// Поле len в SQE 32-битное; длинные передачи идут несколькими операциями
+constexpr size_t kMaxOpBytes = 1 << 30;
+
+using Op = MediaIo::Op;
+
+// Разбивает пакет на цепочки связанных операций
+std::vector<std::vector<Op>> splitChains(std::vector<Op> ops) {
+  std::vector<std::vector<Op>> chains;
+  bool continues = false;
+  for (auto &op : ops) {
+    if (!continues) {
+      chains.emplace_back();
+    }
+    continues = op.linked;
+    chains.back().push_back(std::move(op));
+  }
+  return chains;
+}
+
+bool completesChain(const Op &op, int64_t result) {
+  if (result < 0) {
+    return false;
+  }
+  if (op.kind == Op::Kind::kRead || op.kind == Op::Kind::kWrite) {
+    return static_cast<size_t>(result) == op.length;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------
+// io_uring без liburing: три системных вызова и разделяемые кольца
+
+int uringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+               unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+                                    minComplete, flags, nullptr, 0));
+}
+
+int uringRegister(int fd, unsigned opcode, const void *arg, unsigned count) {
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+class UringBackend : public MediaIo::Backend {
+public:
+  static std::unique_ptr<UringBackend> create(unsigned queueDepth);
+
+  ~UringBackend() override;
+
+  const char *name() const override { return "io_uring"; }
+  void submit(std::vector<Op> ops) override;
+  bool registerBuffers(char *base, size_t count, size_t size) override;
+
+private:
+  static constexpr uint64_t kWakeTag = ~0ULL;
+
+  UringBackend() = default;
+
+  bool map(const io_uring_params &params);
+  void wake();
+  void run();
+  void place(size_t slot);
+  void armWake();
+  io_uring_sqe *nextSqe();
+  void reap();
+
+  int ringFd_ = -1;
+  int wakeFd_ = -1;
+  uint64_t wakeValue_ = 0;
+  bool wakeArmed_ = false;
+
+  void *sqRing_ = nullptr;
+  size_t sqRingSize_ = 0;
+  void *cqRing_ = nullptr;
+  size_t cqRingSize_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sqesSize_ = 0;
+
+  unsigned *sqHead_ = nullptr;
+  unsigned *sqTail_ = nullptr;
+  unsigned sqMask_ = 0;
+  unsigned *sqArray_ = nullptr;
+  unsigned *cqHead_ = nullptr;
+  unsigned *cqTail_ = nullptr;
+  unsigned cqMask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+
+  // Очередь от вызывающих потоков
+  std::mutex mutex_;
+  std::deque<Op> queue_;
+  bool stopping_ = false;
+
+  // Дальше — только поток кольца
+  std::vector<Op> slots_;
+  std::vector<size_t> freeSlots_;
+  size_t capacity_ = 0;
+  unsigned sqTailLocal_ = 0;
+  unsigned unsubmitted_ = 0;
+
+  std::once_flag started_;
+  std::thread thread_;
+};
+
+std::unique_ptr<UringBackend> UringBackend::create(unsigned queueDepth) {
+  std::unique_ptr<UringBackend> backend(new UringBackend());
+
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  backend->ringFd_ = uringSetup(std::max(queueDepth, 8u), &params);
+  if (backend->ringFd_ < 0) {
+    return nullptr;
+  }
+
+  // Нужны операции не старше 5.11 (UNLINKAT)
+  std::vector<char> probeBuffer(sizeof(io_uring_probe) +
+                                256 * sizeof(io_uring_probe_op));
+  auto *probe = reinterpret_cast<io_uring_probe *>(probeBuffer.data());
+  if (uringRegister(backend->ringFd_, IORING_REGISTER_PROBE, probe, 256) < 0) {
+    return nullptr;
+  }
+  for (int op : {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED,
+                 IORING_OP_WRITE_FIXED, IORING_OP_FSYNC, IORING_OP_UNLINKAT}) {
+    if (op > probe->last_op ||
+        !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+      return nullptr;
+    }
+  }
+
+  if (!backend->map(params)) {
+    return nullptr;
+  }
+  backend->sqTailLocal_ = *backend->sqTail_;
+  backend->wakeFd_ = ::eventfd(0, EFD_CLOEXEC);
+  if (backend->wakeFd_ < 0) {
+    return nullptr;
+  }
+
+  // Одна запись SQ зарезервирована под чтение eventfd пробуждения.
+  // Не больше sq_entries операций в полёте — CQ (2x) не переполнится
+  backend->capacity_ = params.sq_entries - 1;
+  backend->slots_.resize(backend->capacity_);
+  for (size_t i = backend->capacity_; i > 0; --i) {
+    backend->freeSlots_.push_back(i - 1);
+  }
+  return backend;
+}
+
+bool UringBackend::map(const io_uring_params &params) {
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap) {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+
+  sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED) {
+    sqRing_ = nullptr;
+    return false;
+  }
+  if (singleMmap) {
+    cqRing_ = sqRing_;
+  } else {
+    cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+    if (cqRing_ == MAP_FAILED) {
+      cqRing_ = nullptr;
+      return false;
+    }
+  }
+  sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+  auto *sq = static_cast<char *>(sqRing_);
+  sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+  auto *cq = static_cast<char *>(cqRing_);
+  cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  return true;
+}
+
+UringBackend::~UringBackend() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    wake();
+    thread_.join();
+  }
+  if (sqes_) {
+    ::munmap(sqes_, sqesSize_);
+  }
+  if (cqRing_ && cqRing_ != sqRing_) {
+    ::munmap(cqRing_, cqRingSize_);
+  }
+  if (sqRing_) {
+    ::munmap(sqRing_, sqRingSize_);
+  }
+  if (wakeFd_ >= 0) {
+    ::close(wakeFd_);
+  }
+  if (ringFd_ >= 0) {
+    ::close(ringFd_);
+  }
+}
+
+bool UringBackend::registerBuffers(char *base, size_t count, size_t size) {
+  // Регистрация — до запуска потока кольца: на старых ядрах она ждёт,
+  // пока кольцо простаивает
+  std::vector<iovec> iovecs(count);
+  for (size_t i = 0; i < count; ++i) {
+    iovecs[i].iov_base = base + i * size;
+    iovecs[i].iov_len = size;
+  }
+  return uringRegister(ringFd_, IORING_REGISTER_BUFFERS, iovecs.data(),
+                       static_cast<unsigned>(count)) == 0;
+}
+
+void UringBackend::submit(std::vector<Op> ops) {
+  std::call_once(started_,
+                 [this]() { thread_ = std::thread([this]() { run(); }); });
+  {
+    std::lock_guard lock(mutex_);
+    for (auto &op : ops) {
+      queue_.push_back(std::move(op));
+    }
+  }
+  wake();
+}
+
+void UringBackend::wake() {
+  uint64_t one = 1;
+  while (::write(wakeFd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+}
+
+io_uring_sqe *UringBackend::nextSqe() {
+  // Хвост публикуется один раз перед io_uring_enter (см. run())
+  unsigned index = sqTailLocal_++ & sqMask_;
+  auto *sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqArray_[index] = index;
+  ++unsubmitted_;
+  return sqe;
+}
+
+void UringBackend::place(size_t slot) {
+  // Op остаётся в слоте до завершения: адреса data и path.c_str()
+  // стабильны, пока ядро с ними работает
+  const auto &op = slots_[slot];
+  auto *sqe = nextSqe();
+  switch (op.kind) {
+  case Op::Kind::kRead:
+  case Op::Kind::kWrite: {
+    bool read = op.kind == Op::Kind::kRead;
+    bool fixed = op.bufferIndex >= 0;
+    sqe->opcode = read ? (fixed ? IORING_OP_READ_FIXED : IORING_OP_READ)
+                       : (fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE);
+    sqe->fd = op.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(op.data);
+    sqe->len = static_cast<uint32_t>(op.length);
+    sqe->off = op.offset;
+    if (fixed) {
+      sqe->buf_index = static_cast<uint16_t>(op.bufferIndex);
+    }
+    break;
+  }
+  case Op::Kind::kDataSync:
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = op.fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    break;
+  case Op::Kind::kUnlink:
+    sqe->opcode = IORING_OP_UNLINKAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<uint64_t>(op.path.c_str());
+    break;
+  }
+  if (op.linked) {
+    sqe->flags |= IOSQE_IO_LINK;
+  }
+  sqe->user_data = slot;
+}
+
+void UringBackend::armWake() {
+  auto *sqe = nextSqe();
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = wakeFd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&wakeValue_);
+  sqe->len = sizeof(wakeValue_);
+  sqe->user_data = kWakeTag;
+  wakeArmed_ = true;
+}
+
+void UringBackend::run() {
+  static auto &enterCalls = Metrics::instance().counter(
+      "media_io_enter_calls_total",
+      "io_uring_enter calls made by the media I/O ring");
+
+  std::vector<Op> batch;
+  while (true) {
+    {
+      std::lock_guard lock(mutex_);
+      if (stopping_ && queue_.empty() &&
+          freeSlots_.size() == capacity_) {
+        break;
+      }
+      // Цепочка целиком или никак: связь работает только внутри
+      // одного пакета
+      size_t available = freeSlots_.size();
+      while (!queue_.empty()) {
+        size_t chain = 1;
+        while (chain <= queue_.size() && queue_[chain - 1].linked) {
+          ++chain;
+        }
+        chain = std::min(chain, queue_.size());
+        if (chain > available) {
+          break;
+        }
+        available -= chain;
+        for (size_t i = 0; i < chain; ++i) {
+          batch.push_back(std::move(queue_.front()));
+          queue_.pop_front();
+        }
+      }
+    }
+
+    for (auto &op : batch) {
+      size_t slot = freeSlots_.back();
+      freeSlots_.pop_back();
+      slots_[slot] = std::move(op);
+      place(slot);
+    }
+    batch.clear();
+    if (!wakeArmed_) {
+      armWake();
+    }
+
+    __atomic_store_n(sqTail_, sqTailLocal_, __ATOMIC_RELEASE);
+    enterCalls.fetch_add(1, std::memory_order_relaxed);
+    int submitted =
+        uringEnter(ringFd_, unsubmitted_, 1, IORING_ENTER_GETEVENTS);
+    if (submitted > 0) {
+      unsubmitted_ -= std::min<unsigned>(unsubmitted_, submitted);
+    }
+    // EINTR, EAGAIN, EBUSY: разбираем завершения и пробуем снова
+    reap();
+  }
+}
+
+void UringBackend::reap() {
+  std::vector<std::pair<Op, int64_t>> completed;
+  unsigned head = *cqHead_;
+  unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    const auto &cqe = cqes_[head & cqMask_];
+    ++head;
+    if (cqe.user_data == kWakeTag) {
+      wakeArmed_ = false;
+      continue;
+    }
+    size_t slot = static_cast<size_t>(cqe.user_data);
+    completed.emplace_back(std::move(slots_[slot]), cqe.res);
+    freeSlots_.push_back(slot);
+  }
+  __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+  for (auto &[op, result] : completed) {
+    if (op.done) {
+      op.done(result);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------
+// Запасной бэкенд: пул потоков с блокирующими pread/pwrite
+
+class ThreadPoolBackend : public MediaIo::Backend {
+public:
+  explicit ThreadPoolBackend(size_t threads) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+      workers_.emplace_back([this]() { run(); });
+    }
+  }
+
+  ~ThreadPoolBackend() override {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    ready_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  const char *name() const override { return "threads"; }
+
+  void submit(std::vector<Op> ops) override {
+    auto chains = splitChains(std::move(ops));
+    {
+      std::lock_guard lock(mutex_);
+      for (auto &chain : chains) {
+        queue_.push_back(std::move(chain));
+      }
+    }
+    ready_.notify_all();
+  }
+
+private:
+  static int64_t execute(const Op &op) {
+    while (true) {
+      int64_t result = 0;
+      switch (op.kind) {
+      case Op::Kind::kRead:
+        result = ::pread(op.fd, op.data, op.length, op.offset);
+        break;
+      case Op::Kind::kWrite:
+        result = ::pwrite(op.fd, op.data, op.length, op.offset);
+        break;
+      case Op::Kind::kDataSync:
+        result = ::fdatasync(op.fd);
+        break;
+      case Op::Kind::kUnlink:
+        result = ::unlink(op.path.c_str());
+        break;
+      }
+      if (result >= 0) {
+        return result;
+      }
+      if (errno != EINTR) {
+        return -errno;
+      }
+    }
+  }
+
+  void run() {
+    while (true) {
+      std::vector<Op> chain;
+      {
+        std::unique_lock lock(mutex_);
+        ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        chain = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      // Та же семантика, что у IOSQE_IO_LINK
+      bool broken = false;
+      for (auto &op : chain) {
+        int64_t result = broken ? -ECANCELED : execute(op);
+        broken = broken || !completesChain(op, result);
+        if (op.done) {
+          op.done(result);
+        }
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::vector<Op>> queue_;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace
+
+// ---------------------------------------------------------------------
+
+struct MediaIo::Transfer {
+  Op::Kind kind = Op::Kind::kRead;
+  int fd = -1;
+  char *data = nullptr;
+  size_t length = 0;
+  uint64_t offset = 0;
+  int bufferIndex = -1;
+  bool dataSync = false;
+  size_t transferred = 0;
+  int64_t lastResult = 0;
+  Callback done;
+
+  // Шаг передачи: остаток данных (+ связанный fdatasync для записи)
+  std::vector<Op> step(MediaIo &io, const std::shared_ptr<Transfer> &self);
+  // true, если передача завершена и done вызван
+  bool advance(int64_t result);
+  // Завершение связанного fdatasync
+  void synced(MediaIo &io, const std::shared_ptr<Transfer> &self,
+              int64_t result);
+};
+
+std::vector<Op> MediaIo::Transfer::step(MediaIo &io,
+                                        const std::shared_ptr<Transfer> &self) {
+  std::vector<Op> ops;
+  if (transferred < length) {
+    Op op;
+    op.kind = kind;
+    op.fd = fd;
+    op.data = data + transferred;
+    op.length = std::min(length - transferred, kMaxOpBytes);
+    op.offset = offset + transferred;
+    op.bufferIndex = bufferIndex;
+    op.linked = dataSync;
+    if (dataSync) {
+      op.done = [self](int64_t result) { self->lastResult = result; };
+    } else {
+      op.done = [&io, self](int64_t result) {
+        if (!self->advance(result)) {
+          io.continueTransfer(self);
+        }
+      };
+    }
+    ops.push_back(std::move(op));
+  }
+  if (dataSync) {
+    Op sync;
+    sync.kind = Op::Kind::kDataSync;
+    sync.fd = fd;
+    sync.done = [&io, self](int64_t result) { self->synced(io, self, result); };
+    ops.push_back(std::move(sync));
+  }
+  return ops;
+}
+
+void MediaIo::Transfer::synced(MediaIo &io,
+                               const std::shared_ptr<Transfer> &self,
+                               int64_t result) {
+  if (transferred < length) {
+    if (lastResult <= 0) {
+      done(lastResult < 0 ? lastResult : -EIO);
+      return;
+    }
+    transferred += static_cast<size_t>(lastResult);
+    // Короткая запись разорвала цепочку (fdatasync получил
+    // -ECANCELED) — дописываем остаток и синхронизируем снова
+    if (transferred < length) {
+      io.continueTransfer(self);
+      return;
+    }
+  }
+  done(result < 0 ? result : static_cast<int64_t>(transferred));
+}
+
+bool MediaIo::Transfer::advance(int64_t result) {
+  if (result < 0) {
+    done(result);
+    return true;
+  }
+  if (result == 0) {
+    // Конец файла при чтении; запись нулевой длины — ошибка устройства
+    done(kind == Op::Kind::kRead ? static_cast<int64_t>(transferred) : -EIO);
+    return true;
+  }
+  transferred += static_cast<size_t>(result);
+  if (transferred < length) {
+    return false;
+  }
+  done(static_cast<int64_t>(transferred));
+  return true;
+}
+
+void MediaIo::continueTransfer(const std::shared_ptr<Transfer> &transfer) {
+  submit(transfer->step(*this, transfer));
+}
+
+MediaIo &MediaIo::instance() {
+  static MediaIo io;
+  return io;
+}
+
+std::unique_ptr<MediaIo::Backend>
+MediaIo::makeUringBackend(unsigned queueDepth) {
+  return UringBackend::create(queueDepth);
+}
+
+std::unique_ptr<MediaIo::Backend>
+MediaIo::makeThreadPoolBackend(size_t threads) {
+  return std::make_unique<ThreadPoolBackend>(threads);
+}
+
+void MediaIo::FreeDeleter::operator()(char *p) const { std::free(p); }
+
+MediaIo::MediaIo()
+    : ops_(Metrics::instance().counter("media_io_ops_total",
+                                       "Media file operations submitted")),
+      errors_(Metrics::instance().counter(
+          "media_io_errors_total", "Media file operations that failed")),
+      bufferMisses_(Metrics::instance().counter(
+          "media_io_buffer_misses_total",
+          "Requests for a registered I/O buffer with the pool exhausted")) {}
+
+MediaIo::~MediaIo() {
+  // Бэкенд дожидается операций в полёте до освобождения пула
+  backend_.reset();
+}
+
+void MediaIo::configure(const Config &config) {
+  std::call_once(initialized_, [this, &config]() {
+    if (config.backend != "threads") {
+      backend_ = makeUringBackend(config.queueDepth);
+    }
+    if (!backend_) {
+      backend_ = makeThreadPoolBackend(config.threads);
+    }
+
+    bufferSize_ = (config.bufferSize + kAlignment - 1) / kAlignment * kAlignment;
+    if (config.fixedBuffers > 0 && bufferSize_ > 0) {
+      pool_.reset(static_cast<char *>(
+          std::aligned_alloc(kAlignment, config.fixedBuffers * bufferSize_)));
+    }
+    if (pool_) {
+      registered_ = backend_->registerBuffers(pool_.get(), config.fixedBuffers,
+                                              bufferSize_);
+      for (size_t i = config.fixedBuffers; i > 0; --i) {
+        freeBuffers_.push_back(static_cast<int>(i - 1));
+      }
+    }
+
+    Metrics::instance().gauge(
+        "media_io_uring_enabled", "1 when media I/O runs on io_uring",
+        [this]() { return backend_->name()[0] == 'i' ? 1.0 : 0.0; });
+  });
+}
+
+MediaIo::Backend &MediaIo::backend() {
+  configure(Config{});
+  return *backend_;
+}
+
+const char *MediaIo::backendName() { return backend().name(); }
+
+bool MediaIo::buffersRegistered() {
+  backend();
+  return registered_;
+}
+
+void MediaIo::submit(std::vector<Op> ops) {
+  auto &target = backend();
+  ops_.fetch_add(ops.size(), std::memory_order_relaxed);
+  for (auto &op : ops) {
+    if (!registered_) {
+      op.bufferIndex = -1;
+    }
+    if (op.done) {
+      op.done = [this, done = std::move(op.done)](int64_t result) {
+        if (result < 0 && result != -ECANCELED) {
+          errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+        done(result);
+      };
+    }
+  }
+  target.submit(std::move(ops));
+}
+
+void MediaIo::read(int fd, char *data, size_t length, uint64_t offset,
+                   int bufferIndex, Callback done) {
+  auto transfer = std::make_shared<Transfer>();
+  transfer->kind = Op::Kind::kRead;
+  transfer->fd = fd;
+  transfer->data = data;
+  transfer->length = length;
+  transfer->offset = offset;
+  transfer->bufferIndex = bufferIndex;
+  transfer->done = std::move(done);
+  if (length == 0) {
+    transfer->done(0);
+    return;
+  }
+  continueTransfer(transfer);
+}
+
+void MediaIo::write(int fd, const char *data, size_t length, uint64_t offset,
+                    int bufferIndex, bool dataSync, Callback done) {
+  auto transfer = std::make_shared<Transfer>();
+  transfer->kind = Op::Kind::kWrite;
+  transfer->fd = fd;
+  transfer->data = const_cast<char *>(data);
+  transfer->length = length;
+  transfer->offset = offset;
+  transfer->bufferIndex = bufferIndex;
+  transfer->dataSync = dataSync;
+  transfer->done = std::move(done);
+  if (length == 0 && !dataSync) {
+    transfer->done(0);
+    return;
+  }
+  continueTransfer(transfer);
+}
+
+void MediaIo::unlink(const std::string &path, Callback done) {
+  std::vector<Op> ops(1);
+  ops[0].kind = Op::Kind::kUnlink;
+  ops[0].path = path;
+  ops[0].done = std::move(done);
+  submit(std::move(ops));
+}
+
+int64_t MediaIo::readSync(int fd, char *data, size_t length, uint64_t offset,
+                          int bufferIndex) {
+  std::promise<int64_t> result;
+  read(fd, data, length, offset, bufferIndex,
+       [&result](int64_t n) { result.set_value(n); });
+  return result.get_future().get();
+}
+
+int64_t MediaIo::writeSync(int fd, const char *data, size_t length,
+                           uint64_t offset, bool dataSync, int bufferIndex) {
+  std::promise<int64_t> result;
+  write(fd, data, length, offset, bufferIndex, dataSync,
+        [&result](int64_t n) { result.set_value(n); });
+  return result.get_future().get();
+}
+
+void MediaIo::readFile(
+    const std::string &path, uint64_t size,
+    std::function<void(std::shared_ptr<std::string>)> done) {
+  readRanges(path, {{0, size}},
+             [done = std::move(done)](std::vector<std::string> parts) {
+               done(parts.empty() ? nullptr
+                                  : std::make_shared<std::string>(
+                                        std::move(parts.front())));
+             });
+}
+
+void MediaIo::readRanges(
+    const std::string &path,
+    const std::vector<std::pair<uint64_t, uint64_t>> &ranges,
+    std::function<void(std::vector<std::string>)> done) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0 || ranges.empty()) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    done({});
+    return;
+  }
+
+  struct Batch {
+    int fd;
+    std::vector<std::string> parts;
+    std::atomic<size_t> remaining;
+    std::atomic<bool> failed{false};
+    std::function<void(std::vector<std::string>)> done;
+  };
+  auto batch = std::make_shared<Batch>();
+  batch->fd = fd;
+  batch->remaining = ranges.size();
+  batch->done = std::move(done);
+  batch->parts.resize(ranges.size());
+
+  // Первые шаги всех диапазонов уходят одним пакетом
+  std::vector<Op> ops;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    auto &part = batch->parts[i];
+    part.resize(ranges[i].second);
+
+    auto transfer = std::make_shared<Transfer>();
+    transfer->kind = Op::Kind::kRead;
+    transfer->fd = fd;
+    transfer->data = part.data();
+    transfer->length = part.size();
+    transfer->offset = ranges[i].first;
+    transfer->done = [batch, length = part.size()](int64_t result) {
+      if (result < 0 || static_cast<size_t>(result) != length) {
+        batch->failed.store(true, std::memory_order_relaxed);
+      }
+      if (batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        ::close(batch->fd);
+        batch->done(batch->failed.load(std::memory_order_relaxed)
+                        ? std::vector<std::string>()
+                        : std::move(batch->parts));
+      }
+    };
+    if (transfer->length == 0) {
+      transfer->done(0);
+      continue;
+    }
+    auto step = transfer->step(*this, transfer);
+    for (auto &op : step) {
+      ops.push_back(std::move(op));
+    }
+  }
+  if (!ops.empty()) {
+    submit(std::move(ops));
+  }
+}
+
+MediaIo::Buffer MediaIo::acquireBuffer() {
+  backend();
+  Buffer buffer;
+  std::lock_guard lock(poolMutex_);
+  if (freeBuffers_.empty()) {
+    if (pool_) {
+      bufferMisses_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return buffer;
+  }
+  buffer.owner_ = this;
+  buffer.index_ = freeBuffers_.back();
+  buffer.data_ = pool_.get() + buffer.index_ * bufferSize_;
+  buffer.capacity_ = bufferSize_;
+  freeBuffers_.pop_back();
+  return buffer;
+}
+
+void MediaIo::releaseBuffer(int index) {
+  std::lock_guard lock(poolMutex_);
+  freeBuffers_.push_back(index);
+}
+
+MediaIo::Buffer &MediaIo::Buffer::operator=(Buffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    owner_ = std::exchange(other.owner_, nullptr);
+    data_ = std::exchange(other.data_, nullptr);
+    capacity_ = std::exchange(other.capacity_, 0);
+    index_ = std::exchange(other.index_, -1);
+  }
+  return *this;
+}
+
+void MediaIo::Buffer::release() {
+  if (owner_) {
+    owner_->releaseBuffer(index_);
+  }
+  owner_ = nullptr;
+  data_ = nullptr;
+  capacity_ = 0;
+  index_ = -1;
+}
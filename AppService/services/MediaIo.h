@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace services {
+
+// Асинхронный файловый ввод-вывод медиаподсистемы. Основной бэкенд —
+// io_uring: операции копятся в очереди и уходят в ядро пакетом за один
+// io_uring_enter, чтение и запись идут через зарегистрированные буферы
+// (READ_FIXED / WRITE_FIXED). Если io_uring недоступен (старое ядро,
+// seccomp-профиль Docker, kernel.io_uring_disabled), те же операции
+// выполняет пул потоков с pread/pwrite.
+//
+// Колбэки вызываются в потоке завершений бэкенда; код, которому нужен
+// поток event loop'а, перекладывает результат туда сам (queueInLoop).
+class MediaIo {
+public:
+  // Результат как у io_uring: >= 0 — число байт, < 0 — -errno
+  using Callback = std::function<void(int64_t result)>;
+
+  struct Op {
+    enum class Kind { kRead, kWrite, kDataSync, kUnlink };
+
+    Kind kind = Kind::kRead;
+    int fd = -1;
+    char *data = nullptr;
+    size_t length = 0;
+    uint64_t offset = 0;
+    // Для kUnlink
+    std::string path;
+    // Индекс зарегистрированного буфера, в котором лежит data, или -1
+    int bufferIndex = -1;
+    // Следующая операция пакета начнётся только после успешного
+    // завершения этой (IOSQE_IO_LINK); иначе она получит -ECANCELED.
+    // Короткое чтение или запись тоже разрывают цепочку.
+    bool linked = false;
+    Callback done;
+  };
+
+  class Backend {
+  public:
+    virtual ~Backend() = default;
+    virtual const char *name() const = 0;
+    // Операции одного вызова отправляются вместе; цепочки linked
+    // не разрываются между пакетами
+    virtual void submit(std::vector<Op> ops) = 0;
+    virtual bool registerBuffers(char * /*base*/, size_t /*count*/,
+                                 size_t /*size*/) {
+      return false;
+    }
+  };
+
+  // Буфер из зарегистрированного пула. Пустой, если пул исчерпан или
+  // не настроен — тогда вызывающий использует свою память.
+  class Buffer {
+  public:
+    Buffer() = default;
+    Buffer(Buffer &&other) noexcept { *this = std::move(other); }
+    Buffer &operator=(Buffer &&other) noexcept;
+    ~Buffer() { release(); }
+
+    explicit operator bool() const { return data_ != nullptr; }
+    char *data() const { return data_; }
+    size_t capacity() const { return capacity_; }
+    int index() const { return index_; }
+
+  private:
+    friend class MediaIo;
+    void release();
+
+    MediaIo *owner_ = nullptr;
+    char *data_ = nullptr;
+    size_t capacity_ = 0;
+    int index_ = -1;
+  };
+
+  struct Config {
+    // "auto", "io_uring" или "threads"
+    std::string backend = "auto";
+    unsigned queueDepth = 256;
+    size_t threads = 4;
+    size_t fixedBuffers = 16;
+    size_t bufferSize = 1 << 20;
+  };
+
+  static MediaIo &instance();
+
+  // nullptr, если ядро не поддерживает нужные операции io_uring
+  static std::unique_ptr<Backend> makeUringBackend(unsigned queueDepth);
+  static std::unique_ptr<Backend> makeThreadPoolBackend(size_t threads);
+
+  MediaIo();
+  ~MediaIo();
+
+  // Вызывается до первого использования; без него применяется Config{}
+  void configure(const Config &config);
+
+  const char *backendName();
+  bool buffersRegistered();
+
+  void submit(std::vector<Op> ops);
+
+  // Чтение/запись целиком: короткие операции дозапрашиваются.
+  // done получает число байт (при чтении меньше length — конец файла)
+  // или -errno. dataSync добавляет к записи связанный fdatasync.
+  void read(int fd, char *data, size_t length, uint64_t offset,
+            int bufferIndex, Callback done);
+  void write(int fd, const char *data, size_t length, uint64_t offset,
+             int bufferIndex, bool dataSync, Callback done);
+  void unlink(const std::string &path, Callback done = nullptr);
+
+  // Блокирующие обёртки для кода, который всё равно ждёт результата
+  // (обработчики на execSqlSync, рабочие потоки)
+  int64_t readSync(int fd, char *data, size_t length, uint64_t offset,
+                   int bufferIndex = -1);
+  int64_t writeSync(int fd, const char *data, size_t length, uint64_t offset,
+                    bool dataSync, int bufferIndex = -1);
+
+  // Чтение файла целиком или набора диапазонов одним пакетом.
+  // Колбэк получает nullptr / пустой вектор при ошибке.
+  void readFile(const std::string &path, uint64_t size,
+                std::function<void(std::shared_ptr<std::string>)> done);
+  void readRanges(
+      const std::string &path,
+      const std::vector<std::pair<uint64_t, uint64_t>> &ranges,
+      std::function<void(std::vector<std::string>)> done);
+
+  Buffer acquireBuffer();
+
+private:
+  struct Transfer;
+
+  Backend &backend();
+  void continueTransfer(const std::shared_ptr<Transfer> &transfer);
+  void releaseBuffer(int index);
+
+  std::once_flag initialized_;
+  std::unique_ptr<Backend> backend_;
+
+  // Пул зарегистрированных буферов
+  struct FreeDeleter {
+    void operator()(char *p) const;
+  };
+  std::unique_ptr<char, FreeDeleter> pool_;
+  size_t bufferSize_ = 0;
+  bool registered_ = false;
+  std::mutex poolMutex_;
+  std::vector<int> freeBuffers_;
+
+  std::atomic<int64_t> &ops_;
+  std::atomic<int64_t> &errors_;
+  std::atomic<int64_t> &bufferMisses_;
+};
+
+} // namespace services
@@ -0,0 +1,102 @@
+#include "MediaSniffer.h"
+#include <algorithm>
+#include <cctype>
+
+using namespace services;
+
+namespace {
+
+bool startsWith(std::string_view data, std::string_view prefix) {
+  return data.size() >= prefix.size() &&
+         data.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace
+
+MediaKind services::mediaKindForExtension(std::string_view extension) {
+  std::string ext(extension);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "gif") {
+    return MediaKind::kPhoto;
+  }
+  if (ext == "mp4" || ext == "webm" || ext == "mov") {
+    return MediaKind::kVideo;
+  }
+  return MediaKind::kUnknown;
+}
+
+MediaKind services::sniffMediaKind(std::string_view head) {
+  using namespace std::string_view_literals;
+
+  if (startsWith(head, "\xFF\xD8\xFF"sv) ||
+      startsWith(head, "\x89PNG\r\n\x1A\n"sv) || startsWith(head, "GIF87a"sv) ||
+      startsWith(head, "GIF89a"sv)) {
+    return MediaKind::kPhoto;
+  }
+
+  // WebM / Matroska: EBML header
+  if (startsWith(head, "\x1A\x45\xDF\xA3"sv)) {
+    return MediaKind::kVideo;
+  }
+
+  // ISO BMFF (mp4) и QuickTime (mov): размер атома + его тип
+  if (head.size() >= 8) {
+    auto atom = head.substr(4, 4);
+    if (atom == "ftyp" || atom == "moov" || atom == "mdat" ||
+        atom == "wide" || atom == "free" || atom == "skip") {
+      return MediaKind::kVideo;
+    }
+  }
+
+  return MediaKind::kUnknown;
+}
+
+std::string services::lowercaseExtension(std::string_view fileName) {
+  auto dot = fileName.rfind('.');
+  if (dot == std::string_view::npos) {
+    return "";
+  }
+  std::string ext(fileName.substr(dot + 1));
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return ext;
+}
+
+const char *services::mediaKindName(MediaKind kind) {
+  switch (kind) {
+  case MediaKind::kPhoto:
+    return "photo";
+  case MediaKind::kVideo:
+    return "video";
+  default:
+    return "";
+  }
+}
+
+const char *services::mediaContentType(std::string_view extension) {
+  if (extension == "jpg" || extension == "jpeg") {
+    return "image/jpeg";
+  }
+  if (extension == "png") {
+    return "image/png";
+  }
+  if (extension == "gif") {
+    return "image/gif";
+  }
+  // Только варианты превью: загружать WebP нельзя
+  if (extension == "webp") {
+    return "image/webp";
+  }
+  if (extension == "mp4") {
+    return "video/mp4";
+  }
+  if (extension == "webm") {
+    return "video/webm";
+  }
+  if (extension == "mov") {
+    return "video/quicktime";
+  }
+  return "";
+}
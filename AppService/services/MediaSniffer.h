@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace services {
+
+enum class MediaKind {
+  kUnknown,
+  kPhoto,
+  kVideo,
+};
+
+// Сколько первых байт файла достаточно для определения формата
+constexpr size_t kMediaSniffBytes = 12;
+
+// Тип медиа по расширению файла (регистр не важен)
+MediaKind mediaKindForExtension(std::string_view extension);
+
+// Тип медиа по сигнатуре в начале файла (JPEG, PNG, GIF, MP4/MOV, WebM)
+MediaKind sniffMediaKind(std::string_view head);
+
+// Расширение из имени файла в нижнем регистре, без точки
+std::string lowercaseExtension(std::string_view fileName);
+
+const char *mediaKindName(MediaKind kind);
+
+// MIME-тип для расширения медиафайла; пустая строка, если неизвестен
+const char *mediaContentType(std::string_view extension);
+
+} // namespace services
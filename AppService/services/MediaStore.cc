@@ -0,0 +1,159 @@
+#include "MediaStore.h"
+#include "Metrics.h"
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace services;
+
+MediaStore &MediaStore::instance() {
+  static MediaStore store("uploads");
+  return store;
+}
+
+MediaStore::MediaStore(std::string root)
+    : root_(std::move(root)),
+      uploads_(Metrics::instance().counter(
+          "media_uploads_total", "Files accepted by the media store")),
+      deduplicated_(Metrics::instance().counter(
+          "media_uploads_deduplicated_total",
+          "Uploads whose content was already stored")),
+      bytesStored_(Metrics::instance().counter(
+          "media_bytes_stored_total", "Bytes written as new media objects")),
+      bytesDeduplicated_(Metrics::instance().counter(
+          "media_bytes_deduplicated_total",
+          "Bytes not stored again thanks to deduplication")) {
+  Metrics::instance().gauge(
+      "media_dedupe_ratio", "Share of uploaded bytes that were duplicates",
+      [this]() {
+        double saved = bytesDeduplicated_.load(std::memory_order_relaxed);
+        double stored = bytesStored_.load(std::memory_order_relaxed);
+        return saved + stored > 0 ? saved / (saved + stored) : 0.0;
+      });
+}
+
+std::string MediaStore::objectPath(const std::string &digest,
+                                   const std::string &extension) {
+  std::string path;
+  path.reserve(digest.size() + extension.size() + 8);
+  path.append(digest, 0, 2).append("/");
+  path.append(digest, 2, 2).append("/");
+  path.append(digest);
+  if (!extension.empty()) {
+    path.append(".").append(extension);
+  }
+  return path;
+}
+
+std::string MediaStore::nextTempPath() {
+  auto now = std::chrono::system_clock::now().time_since_epoch().count();
+  return incomingDir() + "/" + std::to_string(now) + "_" +
+         std::to_string(::getpid()) + "_" +
+         std::to_string(tempSeq_.fetch_add(1, std::memory_order_relaxed)) +
+         ".part";
+}
+
+void MediaStore::account(const Object &object) {
+  uploads_.fetch_add(1, std::memory_order_relaxed);
+  if (object.deduplicated) {
+    deduplicated_.fetch_add(1, std::memory_order_relaxed);
+    bytesDeduplicated_.fetch_add(object.size, std::memory_order_relaxed);
+  } else {
+    bytesStored_.fetch_add(object.size, std::memory_order_relaxed);
+  }
+}
+
+bool MediaStore::Ingest::open(const std::string &extension) {
+  std::error_code ec;
+  std::filesystem::create_directories(store_.incomingDir(), ec);
+  extension_ = extension;
+  hasher_ = Blake3();
+  return writer_.open(store_.nextTempPath());
+}
+
+bool MediaStore::Ingest::write(const char *data, size_t length) {
+  hasher_.update(data, length);
+  return writer_.write(data, length);
+}
+
+void MediaStore::Ingest::end(UploadWriter::Done done) {
+  digest_ = Blake3::toHex(hasher_.finalize());
+  writer_.commit(std::move(done));
+}
+
+bool MediaStore::Ingest::place(Object &object) {
+  object.size = writer_.bytesWritten();
+  object.digest = digest_;
+  return store_.place(writer_.path(), extension_, object);
+}
+
+bool MediaStore::place(const std::string &tempPath,
+                       const std::string &extension, Object &object) {
+  object.path = objectPath(object.digest, extension);
+  std::string finalPath = root_ + "/" + object.path;
+
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(finalPath).parent_path(), ec);
+
+  // link() не перезаписывает существующий файл: при гонке двух
+  // одинаковых загрузок ровно одна создаёт объект, вторая видит EEXIST
+  object.deduplicated = false;
+  if (::link(tempPath.c_str(), finalPath.c_str()) != 0) {
+    if (errno != EEXIST) {
+      MediaIo::instance().unlink(tempPath);
+      return false;
+    }
+    object.deduplicated = true;
+    // mtime — время последней загрузки: MediaGc не удалит объект,
+    // который только что загрузили повторно и ещё не прикрепили
+    ::utimensat(AT_FDCWD, finalPath.c_str(), nullptr, 0);
+  }
+  // Временное имя больше не нужно; ответ его удаления не ждёт
+  MediaIo::instance().unlink(tempPath);
+
+  account(object);
+  return true;
+}
+
+bool MediaStore::adopt(const std::string &path, const std::string &extension,
+                       Object &object) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  auto &io = MediaIo::instance();
+  auto fixed = io.acquireBuffer();
+  std::vector<char> own;
+  char *buffer = fixed.data();
+  size_t capacity = fixed.capacity();
+  if (!fixed) {
+    own.resize(UploadWriter::kBufferSize);
+    buffer = own.data();
+    capacity = own.size();
+  }
+
+  Blake3 hasher;
+  uint64_t size = 0;
+  while (true) {
+    auto n = io.readSync(fd, buffer, capacity, size, fixed.index());
+    if (n < 0) {
+      ::close(fd);
+      return false;
+    }
+    hasher.update(buffer, static_cast<size_t>(n));
+    size += static_cast<uint64_t>(n);
+    if (static_cast<size_t>(n) < capacity) {
+      break;
+    }
+  }
+  ::close(fd);
+
+  object.size = size;
+  object.digest = Blake3::toHex(hasher.finalize());
+  return place(path, extension, object);
+}
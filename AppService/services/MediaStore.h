@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Blake3.h"
+#include "UploadWriter.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace services {
+
+// Контентно-адресуемое хранилище загрузок. Файл лежит по пути,
+// выведенному из BLAKE3 его содержимого:
+//
+//   uploads/ab/cd/abcd...ef.jpg
+//
+// Два уровня по 256 каталогов держат размер каталога небольшим даже
+// при десятках миллионов файлов. Одинаковое содержимое хранится один раз.
+class MediaStore {
+public:
+  struct Object {
+    std::string digest;
+    // Относительно корня хранилища: "ab/cd/<digest>.<ext>"
+    std::string path;
+    uint64_t size = 0;
+    bool deduplicated = false;
+  };
+
+  // Приём одного файла: данные пишутся во временный файл и
+  // одновременно хешируются, place() переносит файл на место
+  // (или удаляет, если такое содержимое уже есть). В IO-потоке диск не
+  // ждётся: при backlogged() чтение тела приостанавливается до
+  // whenDrained(), а end() сообщает о записи хвоста колбэком
+  class Ingest {
+  public:
+    explicit Ingest(MediaStore &store) : store_(store) {}
+
+    bool open(const std::string &extension);
+    bool write(const char *data, size_t length);
+    bool backlogged() const { return writer_.backlogged(); }
+    void whenDrained(std::function<void()> drained) {
+      writer_.whenDrained(std::move(drained));
+    }
+    bool resume() { return writer_.resume(); }
+    // Конец данных: done(ok) приходит из потока завершений MediaIo,
+    // когда файл записан и закрыт
+    void end(UploadWriter::Done done);
+    // После успешного end()
+    bool place(Object &object);
+    void abort() { writer_.abort(); }
+
+    bool isOpen() const { return writer_.isOpen(); }
+    const std::string &tempPath() const { return writer_.path(); }
+
+  private:
+    MediaStore &store_;
+    std::string extension_;
+    Blake3 hasher_;
+    std::string digest_;
+    UploadWriter writer_;
+  };
+
+  static MediaStore &instance();
+
+  explicit MediaStore(std::string root);
+
+  static std::string objectPath(const std::string &digest,
+                                const std::string &extension);
+
+  // Перенос готового файла (например, собранной по частям загрузки) в
+  // хранилище: файл читается один раз для хеширования, затем
+  // переименовывается на место или удаляется как дубликат
+  bool adopt(const std::string &path, const std::string &extension,
+             Object &object);
+
+  const std::string &root() const { return root_; }
+  // Каталог незавершённых загрузок внутри корня
+  std::string incomingDir() const { return root_ + "/.incoming"; }
+
+private:
+  std::string nextTempPath();
+  bool place(const std::string &tempPath, const std::string &extension,
+             Object &object);
+  void account(const Object &object);
+
+  std::string root_;
+  std::atomic<uint64_t> tempSeq_{0};
+
+  std::atomic<int64_t> &uploads_;
+  std::atomic<int64_t> &deduplicated_;
+  std::atomic<int64_t> &bytesStored_;
+  std::atomic<int64_t> &bytesDeduplicated_;
+};
+
+} // namespace services
@@ -0,0 +1,52 @@
+#include "Metrics.h"
+#include <sstream>
+
+using namespace services;
+
+Metrics &Metrics::instance() {
+  static Metrics metrics;
+  return metrics;
+}
+
+std::atomic<int64_t> &Metrics::counter(const std::string &name,
+                                       const std::string &help) {
+  std::lock_guard lock(mutex_);
+  for (auto &counter : counters_) {
+    if (counter.name == name) {
+      return counter.value;
+    }
+  }
+  auto &counter = counters_.emplace_back();
+  counter.name = name;
+  counter.help = help;
+  return counter.value;
+}
+
+void Metrics::gauge(const std::string &name, const std::string &help,
+                    std::function<double()> value) {
+  std::lock_guard lock(mutex_);
+  for (auto &gauge : gauges_) {
+    if (gauge.name == name) {
+      gauge.value = std::move(value);
+      return;
+    }
+  }
+  gauges_.push_back({name, help, std::move(value)});
+}
+
+std::string Metrics::render() const {
+  std::ostringstream out;
+  std::lock_guard lock(mutex_);
+  for (const auto &counter : counters_) {
+    out << "# HELP " << counter.name << " " << counter.help << "\n";
+    out << "# TYPE " << counter.name << " counter\n";
+    out << counter.name << " "
+        << counter.value.load(std::memory_order_relaxed) << "\n";
+  }
+  for (const auto &gauge : gauges_) {
+    out << "# HELP " << gauge.name << " " << gauge.help << "\n";
+    out << "# TYPE " << gauge.name << " gauge\n";
+    out << gauge.name << " " << gauge.value() << "\n";
+  }
+  return out.str();
+}
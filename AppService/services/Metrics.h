@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace services {
+
+// Простой реестр метрик в формате Prometheus text exposition.
+// Счётчики регистрируются один раз и дальше инкрементируются без
+// блокировок; ссылку удобно держать в static-переменной по месту:
+//
+//   static auto &hits = Metrics::instance().counter("x_total", "...");
+//   hits.fetch_add(1, std::memory_order_relaxed);
+class Metrics {
+public:
+  static Metrics &instance();
+
+  std::atomic<int64_t> &counter(const std::string &name,
+                                const std::string &help);
+
+  // Значение вычисляется в момент отдачи /metrics
+  void gauge(const std::string &name, const std::string &help,
+             std::function<double()> value);
+
+  std::string render() const;
+
+private:
+  struct Counter {
+    std::string name;
+    std::string help;
+    std::atomic<int64_t> value{0};
+  };
+  struct Gauge {
+    std::string name;
+    std::string help;
+    std::function<double()> value;
+  };
+
+  mutable std::mutex mutex_;
+  // deque: адреса элементов стабильны при добавлении
+  std::deque<Counter> counters_;
+  std::vector<Gauge> gauges_;
+};
+
+} // namespace services
@@ -0,0 +1,50 @@
+#include "PostHydration.h"
+#include "Attachments.h"
+#include "ProfileCache.h"
+#include "RowJson.h"
+#include <vector>
+
+using namespace services;
+
+Json::Value services::postJson(const storage::Post &post) {
+  return rowJson(post);
+}
+
+void services::hydratePosts(Json::Value &posts, int64_t viewerId) {
+  if (posts.empty()) {
+    return;
+  }
+
+  std::vector<int64_t> ids;
+  ids.reserve(posts.size());
+  for (const auto &post : posts) {
+    ids.push_back(post["id"].asInt64());
+  }
+
+  auto extras = storage::Repositories::instance().extras(ids, viewerId);
+
+  for (auto &post : posts) {
+    auto id = post["id"].asInt64();
+
+    Json::Value attachments(Json::arrayValue);
+    auto attachmentsIt = extras.attachments.find(id);
+    if (attachmentsIt != extras.attachments.end()) {
+      for (const auto &attachment : attachmentsIt->second) {
+        attachments.append(attachmentJson(attachment));
+      }
+    }
+    post["attachments"] = attachments;
+
+    auto likesIt = extras.likes.find(id);
+    bool liked = likesIt != extras.likes.end();
+    post["likes_count"] = (Json::Int64)(liked ? likesIt->second.count : 0);
+    post["is_liked"] = liked && likesIt->second.likedByViewer;
+
+    auto commentsIt = extras.comments.find(id);
+    post["comments_count"] =
+        (Json::Int64)(commentsIt != extras.comments.end() ? commentsIt->second
+                                                          : 0);
+  }
+
+  ProfileCache::instance().fillAuthors(posts);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "storage/Repositories.h"
+#include <cstdint>
+#include <json/value.h>
+
+namespace services {
+
+// id, author_user_id, text, visibility, created_at, updated_at
+Json::Value postJson(const storage::Post &post);
+
+// Дополняет массив постов (из postJson) вложениями, likes_count,
+// is_liked, comments_count и автором. Вместо трёх запросов на пост —
+// одно составное чтение на всю страницу (Repositories::extras);
+// авторы — из ProfileCache. viewerId 0 — аноним, is_liked всегда false.
+void hydratePosts(Json::Value &posts, int64_t viewerId);
+
+} // namespace services
@@ -0,0 +1,398 @@
+#include "PostMetaStore.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define POST_META_HAS_AVX2_PATH 1
+#endif
+
+using namespace services;
+
+namespace {
+
+constexpr size_t kBlock = 64;
+
+uint8_t visibilityMatchValue(const PostMetaStore::Filter &filter) {
+  return filter.publicOnly ? PostMetaStore::kPublic : PostMetaStore::kDeleted;
+}
+
+// Маска блока из 64 строк: бит i выставлен, если строка i прошла
+// фильтр по видимости, исключаемому автору и created_at.
+uint64_t blockMaskScalar(const int64_t *authors, const int64_t *createdAt,
+                         const uint8_t *visibility,
+                         const PostMetaStore::Filter &filter) {
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kBlock; ++i) {
+    bool ok = filter.publicOnly ? visibility[i] == PostMetaStore::kPublic
+                                : visibility[i] != PostMetaStore::kDeleted;
+    ok = ok && authors[i] != filter.excludeAuthor &&
+         createdAt[i] > filter.newerThanMs;
+    mask |= static_cast<uint64_t>(ok) << i;
+  }
+  return mask;
+}
+
+#ifdef POST_META_HAS_AVX2_PATH
+__attribute__((target("avx2"))) uint64_t
+blockMaskAvx2(const int64_t *authors, const int64_t *createdAt,
+              const uint8_t *visibility, const PostMetaStore::Filter &filter) {
+  const __m256i visValue = _mm256_set1_epi8(
+      static_cast<char>(visibilityMatchValue(filter)));
+  auto lo = _mm256_load_si256(reinterpret_cast<const __m256i *>(visibility));
+  auto hi =
+      _mm256_load_si256(reinterpret_cast<const __m256i *>(visibility + 32));
+  uint64_t visMask =
+      static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, visValue))) |
+      static_cast<uint64_t>(static_cast<uint32_t>(
+          _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, visValue))))
+          << 32;
+  if (!filter.publicOnly) {
+    // совпадение с kDeleted означает "строку отбросить"
+    visMask = ~visMask;
+  }
+
+  const __m256i excluded = _mm256_set1_epi64x(filter.excludeAuthor);
+  const __m256i newerThan = _mm256_set1_epi64x(filter.newerThanMs);
+  uint64_t rowMask = 0;
+  for (size_t i = 0; i < kBlock; i += 4) {
+    auto a = _mm256_load_si256(reinterpret_cast<const __m256i *>(authors + i));
+    auto c =
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(createdAt + i));
+    auto keep = _mm256_andnot_si256(_mm256_cmpeq_epi64(a, excluded),
+                                    _mm256_cmpgt_epi64(c, newerThan));
+    auto bits = static_cast<uint64_t>(
+        _mm256_movemask_pd(_mm256_castsi256_pd(keep)));
+    rowMask |= bits << i;
+  }
+  return visMask & rowMask;
+}
+
+bool cpuHasAvx2() {
+  static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+  return hasAvx2;
+}
+#endif
+
+uint64_t blockMask(const int64_t *authors, const int64_t *createdAt,
+                   const uint8_t *visibility,
+                   const PostMetaStore::Filter &filter) {
+#ifdef POST_META_HAS_AVX2_PATH
+  if (cpuHasAvx2()) {
+    return blockMaskAvx2(authors, createdAt, visibility, filter);
+  }
+#endif
+  return blockMaskScalar(authors, createdAt, visibility, filter);
+}
+
+// Проверка авторов по отсортированным спискам. Перед двоичным поиском
+// смотрим в 64К-битную хеш-маску: для ленты подписок почти все строки
+// отсекаются одним обращением к L1 вместо log2(N) сравнений.
+class AuthorMatcher {
+public:
+  explicit AuthorMatcher(const PostMetaStore::Filter &filter)
+      : in_(filter.authorsIn), notIn_(filter.authorsNotIn) {
+    if (in_) {
+      for (int64_t author : *in_) {
+        auto h = hash(author);
+        bits_[h / 64] |= uint64_t{1} << (h % 64);
+      }
+    }
+  }
+
+  bool active() const { return in_ || notIn_; }
+
+  bool allowed(int64_t author) const {
+    if (in_) {
+      auto h = hash(author);
+      if (!(bits_[h / 64] & (uint64_t{1} << (h % 64))) ||
+          !std::binary_search(in_->begin(), in_->end(), author)) {
+        return false;
+      }
+    }
+    if (notIn_ && std::binary_search(notIn_->begin(), notIn_->end(), author)) {
+      return false;
+    }
+    return true;
+  }
+
+private:
+  static uint32_t hash(int64_t author) {
+    return static_cast<uint32_t>(
+               (static_cast<uint64_t>(author) * 0x9E3779B97F4A7C15ULL) >>
+               48) &
+           0xFFFF;
+  }
+
+  const std::vector<int64_t> *in_;
+  const std::vector<int64_t> *notIn_;
+  uint64_t bits_[65536 / 64] = {};
+};
+
+} // namespace
+
+PostMetaStore::PostMetaStore() {
+  // Пока не наберётся миллион публикаций в секунду, номера нового
+  // процесса начинаются выше любого курсора, выданного старым
+  sequence_ = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::system_clock::now().time_since_epoch())
+                  .count();
+  firstSequence_ = sequence_ + 1;
+}
+
+PostMetaStore &PostMetaStore::instance() {
+  static PostMetaStore store;
+  return store;
+}
+
+PostMetaStore::Visibility
+PostMetaStore::parseVisibility(const std::string &visibility) {
+  return visibility == "public" ? kPublic : kPrivate;
+}
+
+void PostMetaStore::reserve(size_t posts) {
+  std::unique_lock lock(mutex_);
+  chunks_.reserve((posts + kChunkSize - 1) / kChunkSize);
+}
+
+void PostMetaStore::clear() {
+  std::unique_lock lock(mutex_);
+  chunks_.clear();
+  size_ = 0;
+  changedWhileLoading_.clear();
+}
+
+size_t PostMetaStore::lowerBound(int64_t id, size_t lo, size_t hi) const {
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (idAt(mid) < id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+size_t PostMetaStore::lowerBoundBefore(int64_t id, size_t hi) const {
+  size_t step = 1;
+  while (hi > 0 && idAt(hi - 1) >= id) {
+    size_t lo = hi > step ? hi - step : 0;
+    if (idAt(lo) < id) {
+      return lowerBound(id, lo + 1, hi);
+    }
+    hi = lo;
+    step *= 2;
+  }
+  return hi;
+}
+
+void PostMetaStore::appendSlot() {
+  if (size_ == chunks_.size() * kChunkSize) {
+    // value-initialization обнуляет хвост чанка, чтобы векторный скан
+    // не читал мусор за последней строкой
+    chunks_.emplace_back(new Chunk());
+  }
+  ++size_;
+}
+
+void PostMetaStore::copySlot(size_t from, size_t to) {
+  const Chunk &src = *chunks_[from / kChunkSize];
+  Chunk &dst = *chunks_[to / kChunkSize];
+  size_t f = from % kChunkSize;
+  size_t t = to % kChunkSize;
+  dst.ids[t] = src.ids[f];
+  dst.authors[t] = src.authors[f];
+  dst.createdAt[t] = src.createdAt[f];
+  dst.visibility[t] = src.visibility[f];
+}
+
+void PostMetaStore::upsert(int64_t id, int64_t authorUserId,
+                           int64_t createdAtMs, Visibility visibility) {
+  std::unique_lock lock(mutex_);
+  upsertLocked(id, authorUserId, createdAtMs, visibility);
+  published_[++sequence_ % kPublishedLog] = {id, authorUserId};
+}
+
+void PostMetaStore::insertLoaded(int64_t id, int64_t authorUserId,
+                                 int64_t createdAtMs, Visibility visibility) {
+  std::unique_lock lock(mutex_);
+  size_t slot = lowerBound(id);
+  if (slot < size_ && idAt(slot) == id) {
+    return;
+  }
+  auto changed = changedWhileLoading_.find(id);
+  if (changed != changedWhileLoading_.end()) {
+    visibility = changed->second;
+    changedWhileLoading_.erase(changed);
+  }
+  upsertLocked(id, authorUserId, createdAtMs, visibility);
+}
+
+void PostMetaStore::upsertLocked(int64_t id, int64_t authorUserId,
+                                 int64_t createdAtMs, Visibility visibility) {
+  size_t slot = size_;
+  if (size_ == 0 || idAt(size_ - 1) < id) {
+    appendSlot();
+  } else {
+    slot = lowerBound(id);
+    if (idAt(slot) != id) {
+      // Вставки не по порядку случаются только между параллельными
+      // INSERT'ами, поэтому сдвигать приходится лишь короткий хвост
+      appendSlot();
+      for (size_t i = size_ - 1; i > slot; --i) {
+        copySlot(i - 1, i);
+      }
+    }
+  }
+
+  Chunk &chunk = *chunks_[slot / kChunkSize];
+  size_t i = slot % kChunkSize;
+  chunk.ids[i] = id;
+  chunk.authors[i] = authorUserId;
+  chunk.createdAt[i] = createdAtMs;
+  chunk.visibility[i] = visibility;
+}
+
+void PostMetaStore::setVisibility(int64_t id, Visibility visibility) {
+  std::unique_lock lock(mutex_);
+  size_t slot = lowerBound(id);
+  if (slot < size_ && idAt(slot) == id) {
+    chunks_[slot / kChunkSize]->visibility[slot % kChunkSize] = visibility;
+  } else if (!loaded()) {
+    // Загрузчик мог уже прочитать старую строку, но ещё не вставить её
+    changedWhileLoading_[id] = visibility;
+  }
+}
+
+void PostMetaStore::erase(int64_t id) { setVisibility(id, kDeleted); }
+
+template <typename Visitor>
+void PostMetaStore::scanBlocks(const Filter &filter, Visitor &&visitor) const {
+  for (size_t c = chunks_.size(); c-- > 0;) {
+    const Chunk &chunk = *chunks_[c];
+    size_t rows = std::min(kChunkSize, size_ - c * kChunkSize);
+
+    // Все строки чанка не новее порога — значит, и более старые чанки тоже
+    if (chunk.createdAt[rows - 1] <= filter.newerThanMs) {
+      return;
+    }
+
+    for (size_t b = (rows + kBlock - 1) / kBlock; b-- > 0;) {
+      size_t base = b * kBlock;
+      uint64_t mask = blockMask(chunk.authors + base, chunk.createdAt + base,
+                                chunk.visibility + base, filter);
+      if (rows - base < kBlock) {
+        mask &= (uint64_t{1} << (rows - base)) - 1;
+      }
+      if (mask != 0 && !visitor(chunk, base, mask)) {
+        return;
+      }
+    }
+  }
+}
+
+PostMetaStore::ScanResult PostMetaStore::scan(const Filter &filter,
+                                              size_t skip,
+                                              size_t limit) const {
+  ScanResult result;
+  if (limit == 0) {
+    return result;
+  }
+  result.ids.reserve(limit);
+
+  AuthorMatcher authors(filter);
+  std::shared_lock lock(mutex_);
+  scanBlocks(filter, [&](const Chunk &chunk, size_t base, uint64_t mask) {
+    while (mask != 0) {
+      // старший бит — самая новая строка блока
+      size_t bit = 63 - __builtin_clzll(mask);
+      mask &= ~(uint64_t{1} << bit);
+
+      size_t i = base + bit;
+      if (!authors.allowed(chunk.authors[i])) {
+        continue;
+      }
+      if (result.matched++ < skip) {
+        continue;
+      }
+      result.ids.push_back(chunk.ids[i]);
+      if (result.ids.size() == limit) {
+        return false;
+      }
+    }
+    return true;
+  });
+  return result;
+}
+
+size_t PostMetaStore::count(const Filter &filter) const {
+  size_t total = 0;
+  AuthorMatcher authors(filter);
+
+  std::shared_lock lock(mutex_);
+  scanBlocks(filter, [&](const Chunk &chunk, size_t base, uint64_t mask) {
+    if (!authors.active()) {
+      total += __builtin_popcountll(mask);
+      return true;
+    }
+    while (mask != 0) {
+      size_t bit = __builtin_ctzll(mask);
+      mask &= mask - 1;
+      total += authors.allowed(chunk.authors[base + bit]);
+    }
+    return true;
+  });
+  return total;
+}
+
+uint64_t PostMetaStore::publishedSequence() const {
+  std::shared_lock lock(mutex_);
+  return sequence_;
+}
+
+PostMetaStore::PublishedResult
+PostMetaStore::publishedSince(uint64_t after, int64_t excludeAuthor,
+                              size_t limit) const {
+  PublishedResult result;
+  std::shared_lock lock(mutex_);
+  result.sequence = sequence_;
+  // Номера старше кольца уже перезаписаны
+  uint64_t oldest = std::max(firstSequence_, sequence_ + 1 - kPublishedLog);
+  if (after + 1 < oldest || after > sequence_) {
+    result.complete = false;
+    return result;
+  }
+
+  size_t hint = size_;
+  for (uint64_t n = sequence_; n > after && result.ids.size() < limit; --n) {
+    const Published &entry = published_[n % kPublishedLog];
+    if (entry.author == excludeAuthor) {
+      continue;
+    }
+    if (hint < size_ && idAt(hint) < entry.id) {
+      hint = size_;
+    }
+    // Видимость берётся из строки: пост могли удалить или скрыть
+    size_t slot = lowerBoundBefore(entry.id, hint);
+    hint = slot;
+    if (slot < size_ && idAt(slot) == entry.id &&
+        chunks_[slot / kChunkSize]->visibility[slot % kChunkSize] ==
+            kPublic) {
+      result.ids.push_back(entry.id);
+    }
+  }
+  return result;
+}
+
+size_t PostMetaStore::size() const {
+  std::shared_lock lock(mutex_);
+  return size_;
+}
+
+size_t PostMetaStore::memoryBytes() const {
+  std::shared_lock lock(mutex_);
+  return chunks_.capacity() * sizeof(void *) + chunks_.size() * sizeof(Chunk) +
+         published_.size() * sizeof(Published);
+}
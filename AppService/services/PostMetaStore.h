@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace services {
+
+// Колоночное (structure-of-arrays) хранилище метаданных постов.
+// Держит только то, что нужно фильтрам ленты и поиска: id, автор,
+// created_at (epoch ms) и байт видимости. Данные лежат чанками по
+// kChunkSize строк, каждая колонка выровнена по кэш-линии, поэтому
+// фильтры сканируются векторно (AVX2) со скалярным fallback.
+//
+// Инвариант: строки упорядочены по id. id выдаются BIGSERIAL'ом вместе
+// с created_at = now(), так что порядок по id совпадает с порядком
+// по времени создания — скан "с конца" идёт от новых постов к старым.
+class PostMetaStore {
+public:
+  static constexpr size_t kChunkSize = 4096;
+
+  enum Visibility : uint8_t {
+    kPublic = 0,
+    kPrivate = 1,
+    kDeleted = 0xFF,
+  };
+
+  struct Filter {
+    bool publicOnly = true;
+    // 0 — не исключать никого
+    int64_t excludeAuthor = 0;
+    int64_t newerThanMs = std::numeric_limits<int64_t>::min();
+    // Отсортированные списки авторов; nullptr — без ограничения
+    const std::vector<int64_t> *authorsIn = nullptr;
+    const std::vector<int64_t> *authorsNotIn = nullptr;
+  };
+
+  struct ScanResult {
+    std::vector<int64_t> ids;
+    // Сколько строк подошло под фильтр до остановки скана
+    // (если ids не заполнен до limit — это полное число совпадений)
+    size_t matched = 0;
+  };
+
+  struct PublishedResult {
+    std::vector<int64_t> ids;
+    // false — курсор старше журнала публикаций (или из прошлого
+    // запуска процесса): что вышло после него, уже не восстановить
+    bool complete = true;
+    // Номер последней публикации на момент вызова — следующий курсор
+    uint64_t sequence = 0;
+  };
+
+  // Сколько последних публикаций помнит журнал для /feed/new
+  static constexpr size_t kPublishedLog = 65536;
+
+  PostMetaStore();
+
+  static PostMetaStore &instance();
+
+  static Visibility parseVisibility(const std::string &visibility);
+
+  // Начальная загрузка пачками по id через PostRepository::scanMeta
+  // (PostMetaStoreLoader.cc)
+  void load();
+
+  void reserve(size_t posts);
+  void clear();
+
+  // Пост, созданный вживую (после COMMIT); попадает и в журнал
+  // публикаций для /feed/new
+  void upsert(int64_t id, int64_t authorUserId, int64_t createdAtMs,
+              Visibility visibility);
+  // До конца загрузки изменения постов, которых ещё нет в хранилище,
+  // запоминаются и побеждают строку, прочитанную загрузчиком раньше
+  void setVisibility(int64_t id, Visibility visibility);
+  void erase(int64_t id);
+
+  // Скан от новых к старым: пропускает первые skip совпадений и
+  // возвращает не больше limit id.
+  ScanResult scan(const Filter &filter, size_t skip, size_t limit) const;
+
+  // Только подсчёт совпадений, без материализации id
+  size_t count(const Filter &filter) const;
+
+  // Курсор /feed/new: номер последней публикации. Номер выдаёт upsert,
+  // а его зовут после COMMIT, поэтому порядок номеров — порядок
+  // фиксации, а не id: пост с меньшим id, закоммиченный позже, получит
+  // больший номер и не потеряется
+  uint64_t publishedSequence() const;
+
+  // Публичные посты не от excludeAuthor, опубликованные после курсора
+  // after, от поздних к ранним; не больше limit id
+  PublishedResult publishedSince(uint64_t after, int64_t excludeAuthor,
+                                 size_t limit) const;
+
+  size_t size() const;
+  size_t memoryBytes() const;
+
+  // Пока начальная загрузка из БД не завершена, контроллеры
+  // должны идти в Postgres напрямую
+  bool loaded() const { return loaded_.load(std::memory_order_acquire); }
+  void setLoaded(bool loaded) {
+    loaded_.store(loaded, std::memory_order_release);
+  }
+
+private:
+  struct alignas(64) Chunk {
+    alignas(64) int64_t ids[kChunkSize];
+    alignas(64) int64_t authors[kChunkSize];
+    alignas(64) int64_t createdAt[kChunkSize];
+    alignas(64) uint8_t visibility[kChunkSize];
+  };
+
+  // Строка из пакета загрузки: уже вставленные вживую посты не
+  // трогает, видимость берёт из changedWhileLoading_, если там есть
+  void insertLoaded(int64_t id, int64_t authorUserId, int64_t createdAtMs,
+                    Visibility visibility);
+  void upsertLocked(int64_t id, int64_t authorUserId, int64_t createdAtMs,
+                    Visibility visibility);
+
+  // Первая строка с id >= заданного (двоичный поиск по чанкам)
+  size_t lowerBound(int64_t id) const {
+    return lowerBound(id, 0, size_);
+  }
+  size_t lowerBound(int64_t id, size_t lo, size_t hi) const;
+  // То же среди строк до hi (все строки с hi и дальше не меньше id):
+  // поиск галопом вниз от hi. Журнал публикаций идёт почти по
+  // убыванию id, так что каждый следующий пост находится в паре шагов
+  // от предыдущего
+  size_t lowerBoundBefore(int64_t id, size_t hi) const;
+  void appendSlot();
+
+  int64_t idAt(size_t slot) const {
+    return chunks_[slot / kChunkSize]->ids[slot % kChunkSize];
+  }
+  void copySlot(size_t from, size_t to);
+
+  // Обходит блоки по 64 строки от новых к старым; visitor получает
+  // чанк, индекс первой строки блока в чанке и битовую маску строк,
+  // прошедших векторную часть фильтра. false из visitor'а — стоп.
+  template <typename Visitor>
+  void scanBlocks(const Filter &filter, Visitor &&visitor) const;
+
+  mutable std::shared_mutex mutex_;
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  size_t size_ = 0;
+  // Видимость постов, изменённых во время загрузки до того, как
+  // загрузчик до них дошёл (kDeleted — удалённые)
+  std::unordered_map<int64_t, Visibility> changedWhileLoading_;
+
+  struct Published {
+    int64_t id = 0;
+    int64_t author = 0;
+  };
+  // Кольцо последних публикаций: номер n лежит в published_[n %
+  // kPublishedLog]. Нумерация начинается с микросекунд запуска, чтобы
+  // курсор прошлого процесса оказался старше журнала
+  std::vector<Published> published_ =
+      std::vector<Published>(kPublishedLog);
+  uint64_t firstSequence_ = 0;
+  uint64_t sequence_ = 0;
+  std::atomic<bool> loaded_{false};
+};
+
+} // namespace services
@@ -0,0 +1,37 @@
+#include "PostMetaStore.h"
+#include "storage/Repositories.h"
+#include <drogon/drogon.h>
+
+using namespace services;
+
+void PostMetaStore::load() {
+  constexpr size_t kBatchSize = 100000;
+  auto &posts = storage::Repositories::instance().posts();
+  int64_t lastId = 0;
+  size_t loadedRows = 0;
+
+  while (true) {
+    auto batch = posts.scanMeta(lastId, kBatchSize);
+
+    for (const auto &post : batch) {
+      lastId = post.id;
+      insertLoaded(post.id, post.authorUserId, post.createdMs,
+                   parseVisibility(post.visibility));
+    }
+    loadedRows += batch.size();
+
+    if (batch.size() < kBatchSize) {
+      break;
+    }
+  }
+
+  {
+    // Оставшиеся записи — посты, удалённые до того, как их прочитал
+    // загрузчик
+    std::unique_lock lock(mutex_);
+    changedWhileLoading_.clear();
+    setLoaded(true);
+  }
+  LOG_INFO << "Post metadata store loaded: " << loadedRows << " posts, "
+           << memoryBytes() / (1024 * 1024) << " MiB";
+}
@@ -0,0 +1,172 @@
+#include "ProfileCache.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <mutex>
+
+using namespace services;
+
+namespace {
+
+std::atomic<int64_t> &hitsCounter() {
+  static auto &hits = Metrics::instance().counter(
+      "profile_cache_hits_total", "Profile cache lookups served from memory");
+  return hits;
+}
+
+std::atomic<int64_t> &missesCounter() {
+  static auto &misses = Metrics::instance().counter(
+      "profile_cache_misses_total", "Profile cache lookups that hit Postgres");
+  return misses;
+}
+
+} // namespace
+
+ProfileCache &ProfileCache::instance() {
+  static ProfileCache cache;
+  return cache;
+}
+
+void ProfileCache::configure(bool enabled, size_t maxEntries) {
+  enabled_ = enabled;
+  maxEntriesPerShard_ = std::max<size_t>(1, maxEntries / kShards);
+
+  Metrics::instance().gauge(
+      "profile_cache_hit_ratio", "Share of profile lookups served from memory",
+      []() {
+        double hits = hitsCounter().load(std::memory_order_relaxed);
+        double misses = missesCounter().load(std::memory_order_relaxed);
+        return hits + misses > 0 ? hits / (hits + misses) : 0.0;
+      });
+}
+
+template <typename Map, typename Value>
+void ProfileCache::store(Shard &shard, Map &map, int64_t userId,
+                         Value value, uint64_t generation) {
+  if (!enabled_) {
+    return;
+  }
+  std::unique_lock lock(shard.mutex);
+  if (shard.generation != generation) {
+    return;
+  }
+  if (map.size() >= maxEntriesPerShard_ && map.find(userId) == map.end()) {
+    // Простейшее ограничение памяти: вытесняем произвольную запись
+    map.erase(map.begin());
+  }
+  map[userId] = std::move(value);
+}
+
+std::unordered_map<int64_t, ProfileCache::ProfilePtr>
+ProfileCache::getMany(std::vector<int64_t> userIds) {
+  std::sort(userIds.begin(), userIds.end());
+  userIds.erase(std::unique(userIds.begin(), userIds.end()), userIds.end());
+
+  std::unordered_map<int64_t, ProfilePtr> profiles;
+  std::vector<int64_t> missing;
+  std::vector<uint64_t> generations;
+  for (auto userId : userIds) {
+    auto &shard = shardFor(userId);
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.profiles.find(userId);
+    if (it != shard.profiles.end()) {
+      profiles.emplace(userId, it->second);
+    } else {
+      missing.push_back(userId);
+      generations.push_back(shard.generation);
+    }
+  }
+
+  hitsCounter().fetch_add(profiles.size(), std::memory_order_relaxed);
+  if (missing.empty()) {
+    return profiles;
+  }
+  missesCounter().fetch_add(missing.size(), std::memory_order_relaxed);
+
+  auto users = storage::Repositories::instance().users().findMany(missing);
+
+  for (auto &user : users) {
+    auto profile = std::make_shared<Profile>();
+    profile->exists = true;
+    profile->userId = user.userId;
+    profile->username = std::move(user.username);
+    profile->displayName = std::move(user.displayName);
+    profile->bio = std::move(user.bio);
+    profile->avatarPath = std::move(user.avatarPath);
+    profile->createdAt = std::move(user.createdAt);
+    profiles[profile->userId] = profile;
+  }
+
+  for (size_t i = 0; i < missing.size(); ++i) {
+    auto userId = missing[i];
+    auto it = profiles.find(userId);
+    if (it == profiles.end()) {
+      auto profile = std::make_shared<Profile>();
+      profile->userId = userId;
+      it = profiles.emplace(userId, std::move(profile)).first;
+    }
+    auto &shard = shardFor(userId);
+    store(shard, shard.profiles, userId, it->second, generations[i]);
+  }
+
+  return profiles;
+}
+
+ProfileCache::ProfilePtr ProfileCache::get(int64_t userId) {
+  return getMany({userId})[userId];
+}
+
+ProfileCache::FollowCounts ProfileCache::getCounts(int64_t userId) {
+  auto &shard = shardFor(userId);
+  uint64_t generation = 0;
+  {
+    std::shared_lock lock(shard.mutex);
+    auto it = shard.counts.find(userId);
+    if (it != shard.counts.end()) {
+      hitsCounter().fetch_add(1, std::memory_order_relaxed);
+      return it->second;
+    }
+    generation = shard.generation;
+  }
+  missesCounter().fetch_add(1, std::memory_order_relaxed);
+
+  auto counts = storage::Repositories::instance().follows().counts(userId);
+  store(shard, shard.counts, userId, counts, generation);
+  return counts;
+}
+
+void ProfileCache::invalidate(int64_t userId) {
+  auto &shard = shardFor(userId);
+  std::unique_lock lock(shard.mutex);
+  shard.profiles.erase(userId);
+  ++shard.generation;
+}
+
+void ProfileCache::invalidateCounts(int64_t userId) {
+  auto &shard = shardFor(userId);
+  std::unique_lock lock(shard.mutex);
+  shard.counts.erase(userId);
+  ++shard.generation;
+}
+
+void ProfileCache::fillAuthors(Json::Value &items, bool withAvatar) {
+  if (items.empty()) {
+    return;
+  }
+
+  std::vector<int64_t> authorIds;
+  authorIds.reserve(items.size());
+  for (const auto &item : items) {
+    authorIds.push_back(item["author_user_id"].asInt64());
+  }
+
+  auto profiles = getMany(std::move(authorIds));
+
+  for (auto &item : items) {
+    const auto &profile = profiles[item["author_user_id"].asInt64()];
+    bool known = profile && profile->exists;
+    item["author_username"] = known ? profile->username : "";
+    if (withAvatar) {
+      item["author_avatar_path"] = known ? profile->avatarPath : "";
+    }
+  }
+}
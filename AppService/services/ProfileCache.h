@@ -0,0 +1,84 @@
+#pragma once
+
+#include "storage/Repositories.h"
+#include <array>
+#include <cstdint>
+#include <json/value.h>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace services {
+
+// Кэш профилей пользователей для getUser и подстановки автора
+// (author_username / author_avatar_path) в списки постов и комментариев.
+//
+// Профиль хранится как неизменяемый снимок за shared_ptr: попадание в
+// кэш — это копия указателя под shared-блокировкой шарда, строки не
+// копируются до сериализации в JSON. Пользователи без строки в users
+// тоже кэшируются (exists = false), чтобы LEFT JOIN-семантика списков
+// не превращалась в промах на каждый запрос.
+class ProfileCache {
+public:
+  struct Profile {
+    bool exists = false;
+    int64_t userId = 0;
+    std::string username;
+    std::string displayName;
+    std::string bio;
+    std::string avatarPath;
+    std::string createdAt;
+  };
+  using ProfilePtr = std::shared_ptr<const Profile>;
+
+  using FollowCounts = storage::FollowCounts;
+
+  static ProfileCache &instance();
+
+  void configure(bool enabled, size_t maxEntries);
+
+  // Профили для набора id; все промахи добираются одним
+  // UserRepository::findMany
+  std::unordered_map<int64_t, ProfilePtr>
+  getMany(std::vector<int64_t> userIds);
+
+  ProfilePtr get(int64_t userId);
+
+  // Счётчики подписок; при промахе — FollowRepository::counts
+  FollowCounts getCounts(int64_t userId);
+
+  void invalidate(int64_t userId);
+  void invalidateCounts(int64_t userId);
+
+  // Заполняет author_username (и author_avatar_path, если нужно) у
+  // каждого элемента массива по полю author_user_id
+  void fillAuthors(Json::Value &items, bool withAvatar = true);
+
+private:
+  static constexpr size_t kShards = 64;
+
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<int64_t, ProfilePtr> profiles;
+    std::unordered_map<int64_t, FollowCounts> counts;
+    // Растёт при каждой инвалидации: заполнение, начатое до неё,
+    // не должно перезаписать кэш устаревшими данными
+    uint64_t generation = 0;
+  };
+
+  Shard &shardFor(int64_t userId) {
+    return shards_[static_cast<uint64_t>(userId) % kShards];
+  }
+
+  template <typename Map, typename Value>
+  void store(Shard &shard, Map &map, int64_t userId, Value value,
+             uint64_t generation);
+
+  std::array<Shard, kShards> shards_;
+  bool enabled_ = true;
+  size_t maxEntriesPerShard_ = 1000000 / kShards;
+};
+
+} // namespace services
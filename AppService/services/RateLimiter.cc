@@ -0,0 +1,236 @@
+#include "RateLimiter.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <ctime>
+
+using namespace services;
+
+namespace {
+
+// splitmix64: равномерно разносит соседние адреса и id по шардам
+uint64_t mix(uint64_t value) {
+  value += 0x9E3779B97F4A7C15ULL;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  value ^= value >> 31;
+  // 0 — пустой слот
+  return value == 0 ? 1 : value;
+}
+
+std::vector<std::string> splitPath(const std::string &path) {
+  std::vector<std::string> segments;
+  size_t start = path.empty() || path.front() != '/' ? 0 : 1;
+  while (start <= path.size()) {
+    auto end = path.find('/', start);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    segments.push_back(path.substr(start, end - start));
+    start = end + 1;
+  }
+  return segments;
+}
+
+// Имя метода (до 8 байт) одним числом: сравнение правил без memcmp
+uint64_t methodCode(std::string_view method) {
+  uint64_t code = 0;
+  for (size_t i = 0; i < method.size() && i < 8; ++i) {
+    code = code << 8 | static_cast<unsigned char>(method[i]);
+  }
+  return code;
+}
+
+bool pathMatches(const std::vector<std::string> &segments,
+                 std::string_view path) {
+  size_t start = 1;
+  for (const auto &segment : segments) {
+    if (start > path.size()) {
+      return false;
+    }
+    auto end = path.find('/', start);
+    if (end == std::string_view::npos) {
+      end = path.size();
+    }
+    auto part = path.substr(start, end - start);
+    if (segment == "*" ? part.empty() : part != segment) {
+      return false;
+    }
+    start = end + 1;
+  }
+  return start > path.size();
+}
+
+} // namespace
+
+void RateLimiter::Buckets::configure(const Tier &tier, size_t capacity) {
+  size_t shards = 1;
+  while (shards * kShardSlots < capacity) {
+    shards <<= 1;
+  }
+  slots_.reset(new Slot[shards * kShardSlots]);
+  shardMask_ = shards - 1;
+  intervalNs_ =
+      static_cast<int64_t>(1e9 / std::max(tier.ratePerSecond, 1e-3));
+  burstNs_ = static_cast<int64_t>(std::max(tier.burst, 1.0) * intervalNs_);
+}
+
+int64_t RateLimiter::Buckets::acquire(uint64_t key, uint32_t cost,
+                                      int64_t nowNs) {
+  Slot *shard = &slots_[(key & shardMask_) * kShardSlots];
+  Slot *slot = nullptr;
+  Slot *idle = nullptr;
+  int64_t idleTat = 0;
+
+  for (size_t i = 0; i < kShardSlots && !slot; ++i) {
+    auto current = shard[i].key.load(std::memory_order_acquire);
+    if (current == key) {
+      slot = &shard[i];
+    } else if (current == 0) {
+      if (shard[i].key.compare_exchange_strong(current, key,
+                                               std::memory_order_acq_rel) ||
+          current == key) {
+        slot = &shard[i];
+      }
+    } else if (!idle) {
+      // tat <= now — бакет полон, ключ можно забыть
+      auto tat = shard[i].tat.load(std::memory_order_relaxed);
+      if (tat <= nowNs) {
+        idle = &shard[i];
+        idleTat = tat;
+      }
+    }
+  }
+
+  if (!slot) {
+    if (!idle) {
+      return kUntracked;
+    }
+    auto current = idle->key.load(std::memory_order_relaxed);
+    if (!idle->key.compare_exchange_strong(current, key,
+                                           std::memory_order_acq_rel) &&
+        current != key) {
+      // Слот только что занял другой ключ
+      return kUntracked;
+    }
+    // Новый ключ начинает с полного бакета. Если прежний владелец
+    // успел потратить из него, его время остаётся
+    idle->tat.compare_exchange_strong(idleTat, 0, std::memory_order_relaxed);
+    slot = idle;
+  }
+
+  auto tat = slot->tat.load(std::memory_order_relaxed);
+  while (true) {
+    auto next = std::max(tat, nowNs) + static_cast<int64_t>(cost) * intervalNs_;
+    auto allowAt = next - burstNs_;
+    if (allowAt > nowNs) {
+      return allowAt - nowNs;
+    }
+    if (slot->tat.compare_exchange_weak(tat, next,
+                                        std::memory_order_relaxed)) {
+      return 0;
+    }
+  }
+}
+
+RateLimiter &RateLimiter::instance() {
+  static RateLimiter limiter;
+  return limiter;
+}
+
+RateLimiter::RateLimiter()
+    : rejected_(Metrics::instance().counter(
+          "rate_limit_rejected_total", "Requests answered with 429")),
+      untracked_(Metrics::instance().counter(
+          "rate_limit_untracked_total",
+          "Requests passed without a bucket: no idle slot in the shard")) {}
+
+void RateLimiter::configure(const Config &config) {
+  user_.configure(config.user, config.maxBuckets);
+  ip_.configure(config.ip, config.maxBuckets);
+  // Стоимость больше burst не пройдёт никогда
+  auto maxCost = static_cast<uint32_t>(
+      std::max(1.0, std::min(config.user.burst, config.ip.burst)));
+  routes_.clear();
+  for (const auto &route : config.routes) {
+    CompiledRoute compiled;
+    compiled.method = methodCode(route.method);
+    compiled.segments = splitPath(route.path);
+    compiled.cost = std::min(route.cost, maxCost);
+    auto wildcard = route.path.find('*');
+    compiled.exact = wildcard == std::string::npos;
+    compiled.prefix = route.path.substr(0, wildcard);
+    routes_.push_back(std::move(compiled));
+  }
+}
+
+uint32_t RateLimiter::costFor(std::string_view method,
+                              std::string_view path) const {
+  // Почти все правила отсекаются методом или длиной и префиксом без
+  // разбора пути на сегменты
+  // Роутер Drogon не различает завершающий '/', здесь тоже
+  if (path.size() > 1 && path.back() == '/') {
+    path.remove_suffix(1);
+  }
+  auto code = methodCode(method);
+  for (const auto &route : routes_) {
+    if (route.method != 0 && route.method != code) {
+      continue;
+    }
+    if (route.exact
+            ? path.size() == route.prefix.size() &&
+                  path.compare(0, path.size(), route.prefix) == 0
+            : path.size() > route.prefix.size() &&
+                  path.compare(0, route.prefix.size(), route.prefix) == 0 &&
+                  pathMatches(route.segments, path)) {
+      return route.cost;
+    }
+  }
+  return 1;
+}
+
+uint64_t RateLimiter::ipv4Key(uint32_t address) { return mix(address); }
+
+uint64_t RateLimiter::ipv6Key(const uint32_t *words) {
+  return mix((static_cast<uint64_t>(words[0]) << 32 | words[1]) ^
+             0x6000000000000000ULL);
+}
+
+RateLimiter::Decision RateLimiter::admit(const Request &request) {
+  // Грубые часы: разрешение в единицы миллисекунд лимитам не мешает,
+  // а читаются они в разы быстрее steady_clock
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return admit(request, now.tv_sec * 1000000000LL + now.tv_nsec);
+}
+
+RateLimiter::Decision RateLimiter::admit(const Request &request,
+                                         int64_t nowNs) {
+  Decision decision;
+  auto cost = costFor(request.method, request.path);
+  if (cost == 0) {
+    return decision;
+  }
+
+  // Без места в таблице запрос этим уровнем не ограничивается
+  auto charge = [&](Buckets &buckets, uint64_t key) {
+    auto waitNs = buckets.acquire(key, cost, nowNs);
+    if (waitNs == Buckets::kUntracked) {
+      untracked_.fetch_add(1, std::memory_order_relaxed);
+      return int64_t{0};
+    }
+    return waitNs;
+  };
+  int64_t waitNs = 0;
+  if (request.userId != 0) {
+    waitNs = charge(user_, mix(static_cast<uint64_t>(request.userId)));
+  }
+  if (waitNs == 0 && request.ipKey != 0) {
+    waitNs = charge(ip_, request.ipKey);
+  }
+  if (waitNs > 0) {
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    decision.allowed = false;
+    decision.retryAfterSeconds = (waitNs + 999999999) / 1000000000;
+  }
+  return decision;
+}
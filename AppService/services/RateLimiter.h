@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace services {
+
+// Ограничение частоты запросов. Уровни два: по IP и по пользователю.
+// Уровень IP проверяется в pre-routing advice (main.cpp), до роутинга
+// и AuthFilter. Уровень пользователя — в pre-handling advice, то есть
+// после AuthFilter, по проверенному им user_id: поддельный токен до
+// него не доходит, а с одним пользователем не размножается на бакеты.
+// Запросы без user_id (публичные маршруты) ограничивает только IP.
+//
+// Бакеты — GCRA (эквивалент token bucket): одно атомарное "время
+// прибытия" на ключ, обновляется CAS без блокировок. Таблица
+// фиксированного размера разбита на шарды по 8 слотов; ключ ищется
+// только в своём шарде. Если свободного слота нет, занимается
+// простаивающий: его бакет уже полон и ничем не отличается от нового.
+// Бакет, который ещё наполняется, не вытесняется никогда — иначе новый
+// ключ получил бы чужой долг, а вытесненный — полный бакет. Если
+// простаивающих в шарде нет, запрос пропускается без учёта
+// (rate_limit_untracked_total): для пользователя решает уровень IP.
+class RateLimiter {
+public:
+  struct Tier {
+    double ratePerSecond = 20;
+    // Сколько единиц стоимости можно потратить разом
+    double burst = 60;
+  };
+
+  // path — сегменты через '/', "*" — любой один сегмент
+  struct Route {
+    std::string method;
+    std::string path;
+    // 0 — не ограничивать
+    uint32_t cost = 1;
+  };
+
+  struct Config {
+    Tier user{20, 60};
+    Tier ip{100, 300};
+    // На уровень; округляется вверх до степени двойки
+    size_t maxBuckets = 262144;
+    std::vector<Route> routes;
+  };
+
+  // Проверяются только заданные уровни
+  struct Request {
+    std::string_view method;
+    std::string_view path;
+    // 0 — без уровня пользователя
+    int64_t userId = 0;
+    // ipv4Key/ipv6Key (не бывают нулём); 0 — без уровня IP
+    uint64_t ipKey = 0;
+  };
+
+  struct Decision {
+    bool allowed = true;
+    // Для Retry-After
+    int64_t retryAfterSeconds = 0;
+  };
+
+  static RateLimiter &instance();
+
+  RateLimiter();
+
+  // До первого admit(): выделяет таблицы бакетов
+  void configure(const Config &config);
+
+  Decision admit(const Request &request);
+  Decision admit(const Request &request, int64_t nowNs);
+
+  uint32_t costFor(std::string_view method, std::string_view path) const;
+
+  static uint64_t ipv4Key(uint32_t address);
+  // По /64: одному клиенту обычно выдаётся вся подсеть
+  static uint64_t ipv6Key(const uint32_t *words);
+
+private:
+  class Buckets {
+  public:
+    void configure(const Tier &tier, size_t capacity);
+    // Ключа нет в таблице, и места для него нет
+    static constexpr int64_t kUntracked = -1;
+
+    // 0 — пропустить, kUntracked, иначе через сколько наносекунд
+    // повторить
+    int64_t acquire(uint64_t key, uint32_t cost, int64_t nowNs);
+
+  private:
+    static constexpr size_t kShardSlots = 8;
+
+    struct alignas(16) Slot {
+      std::atomic<uint64_t> key{0};
+      // Theoretical arrival time, нс steady_clock
+      std::atomic<int64_t> tat{0};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t shardMask_ = 0;
+    int64_t intervalNs_ = 0;
+    int64_t burstNs_ = 0;
+  };
+
+  struct CompiledRoute {
+    // methodCode() имени; 0 — любой метод
+    uint64_t method = 0;
+    // Часть пути до первого "*"; без "*" — весь путь
+    std::string prefix;
+    bool exact = true;
+    std::vector<std::string> segments;
+    uint32_t cost = 1;
+  };
+
+  Buckets user_;
+  Buckets ip_;
+  std::vector<CompiledRoute> routes_;
+
+  std::atomic<int64_t> &rejected_;
+  std::atomic<int64_t> &untracked_;
+};
+
+} // namespace services
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "storage/Rows.h"
+#include <cstdint>
+#include <json/value.h>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// JSON строки по её описанию в storage/Rows.h: ключи — имена колонок,
+// колонки с InJson::kNo и пустые optional (NULL в базе) пропускаются.
+// Работает и для владеющих структур, и для представлений.
+namespace services {
+
+namespace detail {
+
+inline Json::Value cellJson(int64_t value) { return (Json::Int64)value; }
+inline Json::Value cellJson(int32_t value) { return value; }
+inline Json::Value cellJson(const std::string &value) { return value; }
+inline Json::Value cellJson(std::string_view value) {
+  return Json::Value(value.data(), value.data() + value.size());
+}
+
+template <typename T>
+void setMember(Json::Value &json, const char *key, const T &value) {
+  json[key] = cellJson(value);
+}
+
+template <typename T>
+void setMember(Json::Value &json, const char *key,
+               const std::optional<T> &value) {
+  if (value) {
+    json[key] = cellJson(*value);
+  }
+}
+
+} // namespace detail
+
+template <typename Row> Json::Value rowJson(const Row &row) {
+  Json::Value json(Json::objectValue);
+  storage::forEachColumn<Row>([&](const auto &column) {
+    if (column.json == storage::InJson::kYes) {
+      detail::setMember(json, column.name, row.*column.field);
+    }
+  });
+  return json;
+}
+
+} // namespace services
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Metrics.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace services {
+
+class SingleFlightTimeout : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// Таймаут ожидания чужой загрузки по умолчанию (custom_config.single_flight)
+inline std::atomic<int64_t> &singleFlightTimeoutMs() {
+  static std::atomic<int64_t> timeoutMs{5000};
+  return timeoutMs;
+}
+
+// Склейка одинаковых параллельных загрузок (single-flight).
+// Первый запрос по ключу выполняет load(), остальные, пришедшие пока
+// загрузка идёт, ждут её результата (или исключения) не дольше timeout.
+// Результат не кэшируется: после завершения загрузки ключ освобождается.
+//
+// Ожидание блокирующее — так же, как execSqlSync в контроллерах.
+template <typename Value>
+class SingleFlight {
+public:
+  using ValuePtr = std::shared_ptr<const Value>;
+
+  explicit SingleFlight(const std::string &name)
+      : loads_(Metrics::instance().counter(
+            "single_flight_" + name + "_loads_total",
+            "Loads executed for " + name)),
+        coalesced_(Metrics::instance().counter(
+            "single_flight_" + name + "_coalesced_total",
+            "Requests for " + name + " served by another in-flight load")),
+        timeouts_(Metrics::instance().counter(
+            "single_flight_" + name + "_timeouts_total",
+            "Waits for an in-flight " + name + " load that timed out")) {}
+
+  ValuePtr run(const std::string &key, const std::function<Value()> &load) {
+    return run(key,
+               std::chrono::milliseconds(
+                   singleFlightTimeoutMs().load(std::memory_order_relaxed)),
+               load);
+  }
+
+  ValuePtr run(const std::string &key, std::chrono::milliseconds timeout,
+               const std::function<Value()> &load) {
+    std::shared_future<ValuePtr> result;
+    std::shared_ptr<std::promise<ValuePtr>> leader;
+    {
+      std::lock_guard lock(mutex_);
+      auto it = inFlight_.find(key);
+      if (it != inFlight_.end()) {
+        result = it->second;
+      } else {
+        leader = std::make_shared<std::promise<ValuePtr>>();
+        result = leader->get_future().share();
+        inFlight_.emplace(key, result);
+      }
+    }
+
+    if (!leader) {
+      coalesced_.fetch_add(1, std::memory_order_relaxed);
+      if (result.wait_for(timeout) != std::future_status::ready) {
+        timeouts_.fetch_add(1, std::memory_order_relaxed);
+        throw SingleFlightTimeout("Timed out waiting for in-flight load: " +
+                                  key);
+      }
+      return result.get();
+    }
+
+    loads_.fetch_add(1, std::memory_order_relaxed);
+    try {
+      leader->set_value(std::make_shared<const Value>(load()));
+    } catch (...) {
+      leader->set_exception(std::current_exception());
+    }
+    {
+      std::lock_guard lock(mutex_);
+      inFlight_.erase(key);
+    }
+    return result.get();
+  }
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_future<ValuePtr>> inFlight_;
+  std::atomic<int64_t> &loads_;
+  std::atomic<int64_t> &coalesced_;
+  std::atomic<int64_t> &timeouts_;
+};
+
+} // namespace services
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace services {
+
+// Литерал text[] Postgres для параметров вида = ANY($1::text[]) и
+// unnest($1::text[], ...). Строки могут содержать что угодно, поэтому
+// каждый элемент в кавычках
+inline std::string textArray(const std::vector<std::string> &values) {
+  std::string list = "{";
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) {
+      list += ",";
+    }
+    list += '"';
+    for (char c : values[i]) {
+      if (c == '"' || c == '\\') {
+        list += '\\';
+      }
+      list += c;
+    }
+    list += '"';
+  }
+  list += "}";
+  return list;
+}
+
+// Литерал bigint[] для списков id
+inline std::string bigintArray(const std::vector<int64_t> &values) {
+  std::string list = "{";
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) {
+      list += ",";
+    }
+    list += std::to_string(values[i]);
+  }
+  list += "}";
+  return list;
+}
+
+} // namespace services
@@ -0,0 +1,126 @@
+#include "ThumbnailPipeline.h"
+#include "ImageVariants.h"
+#include "MediaStore.h"
+#include "Metrics.h"
+#include <chrono>
+#include <drogon/drogon.h>
+#include <json/writer.h>
+#include <thread>
+
+using namespace services;
+
+ThumbnailPipeline &ThumbnailPipeline::instance() {
+  static ThumbnailPipeline pipeline;
+  return pipeline;
+}
+
+ThumbnailPipeline::ThumbnailPipeline()
+    : processed_(Metrics::instance().counter(
+          "thumbnails_processed_total", "Photos with generated variants")),
+      failed_(Metrics::instance().counter(
+          "thumbnails_failed_total", "Photos that could not be decoded")),
+      dropped_(Metrics::instance().counter(
+          "thumbnails_dropped_total",
+          "Photos skipped because the thumbnail queue was full")),
+      micros_(Metrics::instance().counter(
+          "thumbnails_processing_microseconds_total",
+          "Time spent decoding and encoding variants")) {
+  Metrics::instance().gauge("thumbnails_queue_depth",
+                            "Photos waiting for variant generation", [this]() {
+                              std::lock_guard lock(mutex_);
+                              return static_cast<double>(queue_.size());
+                            });
+}
+
+void ThumbnailPipeline::start(size_t workers, size_t queueCapacity,
+                              std::vector<int> widths, int quality) {
+  {
+    std::lock_guard lock(mutex_);
+    if (started_) {
+      return;
+    }
+    started_ = true;
+    capacity_ = queueCapacity;
+    widths_ = std::move(widths);
+    quality_ = quality;
+  }
+  for (size_t i = 0; i < workers; ++i) {
+    std::thread([this]() { run(); }).detach();
+  }
+}
+
+bool ThumbnailPipeline::accepts(const std::string &extension) {
+  return extension == "jpg" || extension == "jpeg" || extension == "png";
+}
+
+bool ThumbnailPipeline::enqueue(const std::string &path) {
+  {
+    std::lock_guard lock(mutex_);
+    if (!started_) {
+      return false;
+    }
+    if (queue_.size() >= capacity_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    queue_.push_back(path);
+  }
+  ready_.notify_one();
+  return true;
+}
+
+void ThumbnailPipeline::run() {
+  while (true) {
+    std::string path;
+    {
+      std::unique_lock lock(mutex_);
+      ready_.wait(lock, [this]() { return !queue_.empty(); });
+      path = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    try {
+      process(path);
+    } catch (const std::exception &e) {
+      failed_.fetch_add(1, std::memory_order_relaxed);
+      LOG_ERROR << "Error generating variants for " << path << ": "
+                << e.what();
+    }
+  }
+}
+
+void ThumbnailPipeline::process(const std::string &path) {
+  auto startedAt = std::chrono::steady_clock::now();
+
+  ImageVariantSet set;
+  if (!makeImageVariants(MediaStore::instance().root(), path, widths_,
+                         quality_, set)) {
+    failed_.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN << "Could not generate variants for " << path;
+    return;
+  }
+
+  Json::Value variants(Json::arrayValue);
+  for (const auto &variant : set.variants) {
+    Json::Value item;
+    item["width"] = variant.width;
+    item["height"] = variant.height;
+    item["file_path"] = "uploads/" + variant.path;
+    item["webp_file_path"] = "uploads/" + variant.webpPath;
+    variants.append(item);
+  }
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "";
+
+  drogon::app().getDbClient()->execSqlSync(
+      "UPDATE media_objects "
+      "SET width = $1, height = $2, blurhash = $3, variants = $4::jsonb "
+      "WHERE file_path = $5",
+      set.width, set.height, set.blurhash,
+      Json::writeString(writer, variants), "uploads/" + path);
+
+  processed_.fetch_add(1, std::memory_order_relaxed);
+  micros_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - startedAt)
+                        .count(),
+                    std::memory_order_relaxed);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace services {
+
+// Фоновая генерация превью загруженных фотографий: фиксированный пул
+// потоков и ограниченная очередь. Если очередь заполнена, задача
+// отбрасывается — клиенты продолжат получать оригинал.
+// Результат (размеры, BlurHash, варианты) пишется в media_objects.
+class ThumbnailPipeline {
+public:
+  static ThumbnailPipeline &instance();
+
+  ThumbnailPipeline();
+
+  void start(size_t workers, size_t queueCapacity, std::vector<int> widths,
+             int quality);
+
+  // path — относительно корня MediaStore (MediaStore::Object::path)
+  bool enqueue(const std::string &path);
+
+  // Форматы, которые умеет декодировать ImageVariants
+  static bool accepts(const std::string &extension);
+
+private:
+  void run();
+  void process(const std::string &path);
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::string> queue_;
+  size_t capacity_ = 0;
+  bool started_ = false;
+  std::vector<int> widths_;
+  int quality_ = 80;
+
+  std::atomic<int64_t> &processed_;
+  std::atomic<int64_t> &failed_;
+  std::atomic<int64_t> &dropped_;
+  std::atomic<int64_t> &micros_;
+};
+
+} // namespace services
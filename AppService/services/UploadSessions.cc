@@ -0,0 +1,344 @@
+#include "UploadSessions.h"
+#include "Blake3.h"
+#include "MediaIo.h"
+#include "MediaSniffer.h"
+#include "Metrics.h"
+#include <cerrno>
+#include <drogon/drogon.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <openssl/evp.h>
+#include <unistd.h>
+
+using namespace services;
+
+namespace {
+
+std::atomic<int64_t> &chunksCounter() {
+  static auto &chunks = Metrics::instance().counter(
+      "upload_session_chunks_total", "Chunks appended to resumable uploads");
+  return chunks;
+}
+
+std::atomic<int64_t> &checksumFailures() {
+  static auto &failures = Metrics::instance().counter(
+      "upload_session_checksum_mismatches_total",
+      "Resumable upload chunks rejected by their checksum");
+  return failures;
+}
+
+std::atomic<int64_t> &expiredCounter() {
+  static auto &expired = Metrics::instance().counter(
+      "upload_sessions_expired_total", "Abandoned upload sessions removed");
+  return expired;
+}
+
+UploadSessions::Session sessionFromRow(const drogon::orm::Row &row,
+                                       int64_t userId) {
+  UploadSessions::Session session;
+  session.id = row["id"].as<std::string>();
+  session.userId = userId;
+  session.filename = row["filename"].as<std::string>();
+  session.extension = lowercaseExtension(session.filename);
+  session.length = row["upload_length"].as<int64_t>();
+  session.offset = row["upload_offset"].as<int64_t>();
+  session.expiresAt = row["expires_at"].as<std::string>();
+  return session;
+}
+
+// Проверка Upload-Checksum: "<алгоритм> <base64 дайджеста>"
+UploadSessions::Status verifyChecksum(const std::string &header,
+                                      std::string_view data) {
+  if (header.empty()) {
+    return UploadSessions::Status::kOk;
+  }
+  auto space = header.find(' ');
+  if (space == std::string::npos) {
+    return UploadSessions::Status::kBadChecksum;
+  }
+  auto algorithm = header.substr(0, space);
+  auto expected = drogon::utils::base64Decode(header.substr(space + 1));
+
+  std::string actual;
+  if (algorithm == "sha256") {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdLength = 0;
+    if (EVP_Digest(data.data(), data.size(), md, &mdLength, EVP_sha256(),
+                   nullptr) != 1) {
+      return UploadSessions::Status::kIoError;
+    }
+    actual.assign(reinterpret_cast<char *>(md), mdLength);
+  } else if (algorithm == "blake3") {
+    Blake3 hasher;
+    hasher.update(data.data(), data.size());
+    auto digest = hasher.finalize();
+    actual.assign(reinterpret_cast<char *>(digest.data()), digest.size());
+  } else {
+    return UploadSessions::Status::kBadChecksum;
+  }
+
+  if (actual != expected) {
+    checksumFailures().fetch_add(1, std::memory_order_relaxed);
+    return UploadSessions::Status::kChecksumMismatch;
+  }
+  return UploadSessions::Status::kOk;
+}
+
+} // namespace
+
+UploadSessions &UploadSessions::instance() {
+  static UploadSessions sessions;
+  return sessions;
+}
+
+void UploadSessions::configure(int64_t maxUploadBytes,
+                               std::chrono::seconds ttl,
+                               size_t maxActivePerUser) {
+  maxUploadBytes_ = maxUploadBytes;
+  ttl_ = ttl;
+  maxActivePerUser_ = maxActivePerUser;
+}
+
+UploadSessions::Lease::Lease(UploadSessions &owner, const std::string &id)
+    : owner_(owner), id_(id) {
+  std::lock_guard lock(owner_.busyMutex_);
+  acquired_ = owner_.busy_.insert(id_).second;
+}
+
+UploadSessions::Lease::~Lease() {
+  if (acquired_) {
+    std::lock_guard lock(owner_.busyMutex_);
+    owner_.busy_.erase(id_);
+  }
+}
+
+std::string UploadSessions::dataPath(const std::string &id) const {
+  return MediaStore::instance().incomingDir() + "/" + id + ".upload";
+}
+
+UploadSessions::Status UploadSessions::create(
+    const drogon::orm::DbClientPtr &db, int64_t userId,
+    const std::string &filename, int64_t length, Session &session) {
+  if (mediaKindForExtension(lowercaseExtension(filename)) ==
+      MediaKind::kUnknown) {
+    return Status::kBadType;
+  }
+  if (length <= 0 || length > maxUploadBytes_) {
+    return Status::kTooLarge;
+  }
+
+  auto active = db->execSqlSync(
+      "SELECT COUNT(*) AS count FROM upload_sessions "
+      "WHERE user_id = $1 AND expires_at > now()",
+      userId);
+  if (active[0]["count"].as<int64_t>() >=
+      static_cast<int64_t>(maxActivePerUser_)) {
+    return Status::kTooManySessions;
+  }
+
+  auto id = drogon::utils::getUuid();
+  auto result = db->execSqlSync(
+      "INSERT INTO upload_sessions "
+      "  (id, user_id, filename, upload_length, expires_at) "
+      "VALUES ($1, $2, $3, $4, now() + $5::bigint * interval '1 second') "
+      "RETURNING id, filename, upload_length, upload_offset, expires_at",
+      id, userId, filename, length, static_cast<int64_t>(ttl_.count()));
+
+  std::error_code ec;
+  std::filesystem::create_directories(MediaStore::instance().incomingDir(),
+                                      ec);
+  int fd = ::open(dataPath(id).c_str(),
+                  O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    db->execSqlSync("DELETE FROM upload_sessions WHERE id = $1", id);
+    return Status::kIoError;
+  }
+  ::close(fd);
+
+  session = sessionFromRow(result[0], userId);
+  return Status::kOk;
+}
+
+std::optional<UploadSessions::Session>
+UploadSessions::find(const drogon::orm::DbClientPtr &db, const std::string &id,
+                     int64_t userId) {
+  auto result = db->execSqlSync(
+      "SELECT id, filename, upload_length, upload_offset, expires_at "
+      "FROM upload_sessions "
+      "WHERE id = $1 AND user_id = $2 AND expires_at > now()",
+      id, userId);
+  if (result.empty()) {
+    return std::nullopt;
+  }
+  return sessionFromRow(result[0], userId);
+}
+
+void UploadSessions::append(const drogon::orm::DbClientPtr &db,
+                            const std::string &id, int64_t userId,
+                            int64_t offset, std::string_view data,
+                            const std::string &checksum,
+                            trantor::EventLoop *loop, AppendDone done) {
+  // Сессия занята, пока запись не подтверждена в БД
+  auto lease = std::make_shared<Lease>(*this, id);
+  if (!lease->acquired()) {
+    done(Status::kBusy, {});
+    return;
+  }
+
+  auto found = find(db, id, userId);
+  if (!found) {
+    done(Status::kNotFound, {});
+    return;
+  }
+  Session session = *found;
+  if (offset != session.offset) {
+    done(Status::kOffsetMismatch, session);
+    return;
+  }
+  if (offset + static_cast<int64_t>(data.size()) > session.length) {
+    done(Status::kTooLarge, session);
+    return;
+  }
+
+  auto verified = verifyChecksum(checksum, data);
+  if (verified != Status::kOk) {
+    done(verified, session);
+    return;
+  }
+
+  // Сигнатура проверяется по первой части, как и в обычной загрузке
+  if (offset == 0 && (data.size() >= kMediaSniffBytes ||
+                      static_cast<int64_t>(data.size()) == session.length)) {
+    if (sniffMediaKind(data.substr(0, kMediaSniffBytes)) !=
+        mediaKindForExtension(session.extension)) {
+      done(Status::kContentMismatch, session);
+      return;
+    }
+  }
+
+  int fd = ::open(dataPath(id).c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    done(Status::kIoError, session);
+    return;
+  }
+  // fdatasync (связанный с записью) до сдвига смещения в БД:
+  // подтверждённые байты не теряются и при перезапуске машины
+  int64_t size = static_cast<int64_t>(data.size());
+  MediaIo::instance().write(
+      fd, data.data(), data.size(), offset, -1, true,
+      [this, db, fd, size, lease, loop, session = std::move(session),
+       done = std::move(done)](int64_t result) mutable {
+        ::close(fd);
+        loop->queueInLoop([this, db, written = result == size, size, lease,
+                           session = std::move(session),
+                           done = std::move(done)]() mutable {
+          if (!written) {
+            done(Status::kIoError, session);
+            return;
+          }
+          try {
+            done(confirm(db, size, session), session);
+          } catch (const std::exception &e) {
+            LOG_ERROR << "Error confirming upload chunk: " << e.what();
+            done(Status::kIoError, session);
+          }
+        });
+      });
+}
+
+UploadSessions::Status
+UploadSessions::confirm(const drogon::orm::DbClientPtr &db, int64_t size,
+                        Session &session) {
+  int64_t newOffset = session.offset + size;
+  auto updated = db->execSqlSync(
+      "UPDATE upload_sessions "
+      "SET upload_offset = $2, "
+      "    expires_at = now() + $4::bigint * interval '1 second' "
+      "WHERE id = $1 AND upload_offset = $3 "
+      "RETURNING expires_at",
+      session.id, newOffset, session.offset,
+      static_cast<int64_t>(ttl_.count()));
+  if (updated.empty()) {
+    return Status::kOffsetMismatch;
+  }
+
+  session.offset = newOffset;
+  session.expiresAt = updated[0]["expires_at"].as<std::string>();
+  chunksCounter().fetch_add(1, std::memory_order_relaxed);
+  return Status::kOk;
+}
+
+UploadSessions::Status
+UploadSessions::complete(const drogon::orm::DbClientPtr &db,
+                         const std::string &id, int64_t userId,
+                         MediaStore::Object &object) {
+  Lease lease(*this, id);
+  if (!lease.acquired()) {
+    return Status::kBusy;
+  }
+
+  auto session = find(db, id, userId);
+  if (!session) {
+    return Status::kNotFound;
+  }
+  if (session->offset != session->length) {
+    return Status::kIncomplete;
+  }
+
+  auto path = dataPath(id);
+  char head[kMediaSniffBytes];
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return Status::kIoError;
+  }
+  auto headLength =
+      MediaIo::instance().readSync(fd, head, sizeof(head), 0);
+  ::close(fd);
+  if (headLength <= 0 ||
+      sniffMediaKind(std::string_view(head, headLength)) !=
+          mediaKindForExtension(session->extension)) {
+    return Status::kContentMismatch;
+  }
+
+  if (!MediaStore::instance().adopt(path, session->extension, object)) {
+    return Status::kIoError;
+  }
+  db->execSqlSync("DELETE FROM upload_sessions WHERE id = $1", id);
+  return Status::kOk;
+}
+
+UploadSessions::Status
+UploadSessions::cancel(const drogon::orm::DbClientPtr &db,
+                       const std::string &id, int64_t userId) {
+  Lease lease(*this, id);
+  if (!lease.acquired()) {
+    return Status::kBusy;
+  }
+  auto result = db->execSqlSync(
+      "DELETE FROM upload_sessions WHERE id = $1 AND user_id = $2 "
+      "RETURNING id",
+      id, userId);
+  if (result.empty()) {
+    return Status::kNotFound;
+  }
+  MediaIo::instance().unlink(dataPath(id));
+  return Status::kOk;
+}
+
+void UploadSessions::expire(const drogon::orm::DbClientPtr &db) {
+  db->execSqlAsync(
+      "DELETE FROM upload_sessions WHERE expires_at < now() RETURNING id",
+      [this](const drogon::orm::Result &result) {
+        for (const auto &row : result) {
+          MediaIo::instance().unlink(dataPath(row["id"].as<std::string>()));
+        }
+        if (!result.empty()) {
+          expiredCounter().fetch_add(result.size(),
+                                     std::memory_order_relaxed);
+          LOG_INFO << "Expired " << result.size() << " upload sessions";
+        }
+      },
+      [](const drogon::orm::DrogonDbException &e) {
+        LOG_ERROR << "Error expiring upload sessions: " << e.base().what();
+      });
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "MediaStore.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace drogon {
+namespace orm {
+class DbClient;
+using DbClientPtr = std::shared_ptr<DbClient>;
+} // namespace orm
+} // namespace drogon
+
+namespace trantor {
+class EventLoop;
+}
+
+namespace services {
+
+// Возобновляемые загрузки по частям (в духе tus): сессия хранится в
+// upload_sessions, данные — в uploads/.incoming/<id>.upload. Части
+// пишутся (MediaIo) прямо по своему смещению, смещение в БД двигается
+// только после успешной записи на диск, поэтому после перезапуска
+// клиент продолжает с подтверждённого смещения.
+class UploadSessions {
+public:
+  struct Session {
+    std::string id;
+    int64_t userId = 0;
+    std::string filename;
+    std::string extension;
+    int64_t length = 0;
+    int64_t offset = 0;
+    std::string expiresAt;
+  };
+
+  enum class Status {
+    kOk,
+    kNotFound,
+    kBadType,
+    kTooLarge,
+    kTooManySessions,
+    kOffsetMismatch,
+    kBadChecksum,
+    kChecksumMismatch,
+    kContentMismatch,
+    kIncomplete,
+    kBusy,
+    kIoError,
+  };
+
+  static UploadSessions &instance();
+
+  void configure(int64_t maxUploadBytes, std::chrono::seconds ttl,
+                 size_t maxActivePerUser);
+
+  Status create(const drogon::orm::DbClientPtr &db, int64_t userId,
+                const std::string &filename, int64_t length,
+                Session &session);
+
+  std::optional<Session> find(const drogon::orm::DbClientPtr &db,
+                              const std::string &id, int64_t userId);
+
+  using AppendDone = std::function<void(Status status, const Session &)>;
+
+  // checksum — значение заголовка Upload-Checksum ("sha256 <base64>" или
+  // "blake3 <base64>"), может быть пустым. Запись с fdatasync идёт без
+  // ожидания в IO-потоке: done вызывается в loop, data должна жить до
+  // него. session в done — текущее состояние, в том числе при ошибке
+  // смещения. Ошибка БД до записи бросается исключением, done тогда не
+  // вызывается.
+  void append(const drogon::orm::DbClientPtr &db, const std::string &id,
+              int64_t userId, int64_t offset, std::string_view data,
+              const std::string &checksum, trantor::EventLoop *loop,
+              AppendDone done);
+
+  // Переносит полностью загруженный файл в MediaStore и удаляет сессию
+  Status complete(const drogon::orm::DbClientPtr &db, const std::string &id,
+                  int64_t userId, MediaStore::Object &object);
+
+  Status cancel(const drogon::orm::DbClientPtr &db, const std::string &id,
+                int64_t userId);
+
+  // Удаляет просроченные сессии и их файлы (асинхронно)
+  void expire(const drogon::orm::DbClientPtr &db);
+
+  int64_t maxUploadBytes() const { return maxUploadBytes_; }
+
+private:
+  // Не даёт двум запросам одновременно писать в одну сессию
+  class Lease {
+  public:
+    Lease(UploadSessions &owner, const std::string &id);
+    ~Lease();
+    bool acquired() const { return acquired_; }
+
+  private:
+    UploadSessions &owner_;
+    std::string id_;
+    bool acquired_;
+  };
+
+  std::string dataPath(const std::string &id) const;
+  // Сдвигает смещение после записи size байт части
+  Status confirm(const drogon::orm::DbClientPtr &db, int64_t size,
+                 Session &session);
+
+  std::mutex busyMutex_;
+  std::unordered_set<std::string> busy_;
+
+  int64_t maxUploadBytes_ = 2LL << 30;
+  std::chrono::seconds ttl_{86400};
+  size_t maxActivePerUser_ = 5;
+};
+
+} // namespace services
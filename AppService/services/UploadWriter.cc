@@ -0,0 +1,244 @@
+#include "UploadWriter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace services;
+
+namespace {
+constexpr size_t kAlignment = 4096;
+}
+
+void UploadWriter::FreeDeleter::operator()(char *p) const { std::free(p); }
+
+UploadWriter::~UploadWriter() { abort(); }
+
+bool UploadWriter::acquireBuffers(Shared &shared) {
+  for (auto &slot : shared.slots) {
+    slot.fixed = MediaIo::instance().acquireBuffer();
+    if (slot.fixed && slot.fixed.capacity() >= kBufferSize) {
+      slot.data = slot.fixed.data();
+      slot.index = slot.fixed.index();
+      continue;
+    }
+    slot.fixed = MediaIo::Buffer();
+    slot.owned.reset(
+        static_cast<char *>(std::aligned_alloc(kAlignment, kBufferSize)));
+    slot.data = slot.owned.get();
+    slot.index = -1;
+    if (!slot.data) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool UploadWriter::closeFile(Shared &shared) {
+  bool ok = !shared.failed;
+  ok = ::close(shared.fd) == 0 && ok;
+  shared.fd = -1;
+  for (auto &slot : shared.slots) {
+    slot.fixed = MediaIo::Buffer();
+    slot.owned.reset();
+    slot.data = nullptr;
+  }
+  if (!ok) {
+    MediaIo::instance().unlink(shared.path);
+  }
+  return ok;
+}
+
+void UploadWriter::discardFile(Shared &shared) {
+  shared.failed = true;
+  closeFile(shared);
+}
+
+void UploadWriter::completed(const std::shared_ptr<Shared> &shared, int slot,
+                             bool ok) {
+  std::function<void()> drained;
+  Done committed;
+  bool result = false;
+  {
+    std::lock_guard lock(shared->mutex);
+    shared->failed = shared->failed || !ok;
+    if (slot >= 0) {
+      shared->busy[slot] = false;
+    }
+    --shared->pending;
+    drained.swap(shared->drained);
+    if (shared->pending == 0 && shared->committed) {
+      committed.swap(shared->committed);
+      result = closeFile(*shared);
+    } else if (shared->pending == 0 && shared->aborted) {
+      discardFile(*shared);
+    }
+  }
+  if (drained) {
+    drained();
+  }
+  if (committed) {
+    committed(result);
+  }
+}
+
+bool UploadWriter::open(const std::string &path) {
+  abort();
+  auto shared = std::make_shared<Shared>();
+  shared->fd =
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (shared->fd < 0) {
+    return false;
+  }
+  shared->path = path;
+  if (!acquireBuffers(*shared)) {
+    discardFile(*shared);
+    return false;
+  }
+  shared_ = std::move(shared);
+  open_ = true;
+  path_ = path;
+  current_ = 0;
+  buffered_ = 0;
+  flushed_ = 0;
+  bytesWritten_ = 0;
+  overflow_.clear();
+  return true;
+}
+
+void UploadWriter::submit() {
+  size_t slot = current_;
+  size_t length = buffered_;
+  {
+    std::lock_guard lock(shared_->mutex);
+    shared_->busy[slot] = true;
+    ++shared_->pending;
+  }
+  auto shared = shared_;
+  const auto &buffer = shared->slots[slot];
+  MediaIo::instance().write(
+      shared->fd, buffer.data, length, flushed_, buffer.index, false,
+      [shared, slot, length](int64_t result) {
+        completed(shared, static_cast<int>(slot),
+                  result == static_cast<int64_t>(length));
+      });
+  flushed_ += length;
+  buffered_ = 0;
+  current_ ^= 1;
+}
+
+// Накопленное при commit() уходит одной записью из собственной копии
+void UploadWriter::submitOverflow() {
+  auto data = std::make_shared<std::string>(std::move(overflow_));
+  overflow_.clear();
+  {
+    std::lock_guard lock(shared_->mutex);
+    ++shared_->pending;
+  }
+  auto shared = shared_;
+  MediaIo::instance().write(
+      shared->fd, data->data(), data->size(), flushed_, -1, false,
+      [shared, data](int64_t result) {
+        completed(shared, -1, result == static_cast<int64_t>(data->size()));
+      });
+  flushed_ += data->size();
+}
+
+bool UploadWriter::fill(const char *data, size_t length) {
+  while (length > 0) {
+    bool busy = false;
+    {
+      std::lock_guard lock(shared_->mutex);
+      if (shared_->failed) {
+        return false;
+      }
+      busy = shared_->busy[current_];
+    }
+    if (busy) {
+      overflow_.append(data, length);
+      return true;
+    }
+    size_t chunk = std::min(length, kBufferSize - buffered_);
+    std::memcpy(shared_->slots[current_].data + buffered_, data, chunk);
+    buffered_ += chunk;
+    data += chunk;
+    length -= chunk;
+    if (buffered_ == kBufferSize) {
+      submit();
+    }
+  }
+  return true;
+}
+
+bool UploadWriter::write(const char *data, size_t length) {
+  if (!open_) {
+    return false;
+  }
+  bytesWritten_ += length;
+  if (!overflow_.empty()) {
+    overflow_.append(data, length);
+    return true;
+  }
+  return fill(data, length);
+}
+
+void UploadWriter::whenDrained(std::function<void()> drained) {
+  if (open_) {
+    std::lock_guard lock(shared_->mutex);
+    if (shared_->busy[current_] && !shared_->failed) {
+      shared_->drained = std::move(drained);
+      return;
+    }
+  }
+  drained();
+}
+
+bool UploadWriter::resume() {
+  if (!open_) {
+    return false;
+  }
+  std::string pending;
+  pending.swap(overflow_);
+  return fill(pending.data(), pending.size());
+}
+
+void UploadWriter::commit(Done done) {
+  if (!open_) {
+    done(false);
+    return;
+  }
+  open_ = false;
+  if (buffered_ > 0) {
+    submit();
+  }
+  if (!overflow_.empty()) {
+    submitOverflow();
+  }
+  auto shared = std::move(shared_);
+  bool result = false;
+  {
+    std::lock_guard lock(shared->mutex);
+    if (shared->pending > 0) {
+      shared->committed = std::move(done);
+      return;
+    }
+    result = closeFile(*shared);
+  }
+  done(result);
+}
+
+void UploadWriter::abort() {
+  if (!open_) {
+    return;
+  }
+  open_ = false;
+  overflow_.clear();
+  auto shared = std::move(shared_);
+  // Буфер и дескриптор нужны ядру, пока запись в полёте
+  std::lock_guard lock(shared->mutex);
+  shared->aborted = true;
+  if (shared->pending == 0) {
+    discardFile(*shared);
+  }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "MediaIo.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace services {
+
+// Запись загружаемого файла прямо в итоговый путь: данные копятся в
+// выровненном по странице буфере и уходят на диск крупными записями
+// через MediaIo. Буферов два: пока один пишется, второй заполняется
+// следующей частью тела запроса. Если файл не закоммичен, деструктор
+// его удаляет.
+//
+// Ни один метод не ждёт диска: их вызывает IO-поток. Когда оба буфера
+// в записи, write() копит данные в памяти и backlogged() возвращает
+// true — вызывающий приостанавливает чтение тела и ждёт whenDrained().
+class UploadWriter {
+public:
+  static constexpr size_t kBufferSize = 1 << 20;
+  using Done = std::function<void(bool ok)>;
+
+  UploadWriter() = default;
+  ~UploadWriter();
+
+  UploadWriter(const UploadWriter &) = delete;
+  UploadWriter &operator=(const UploadWriter &) = delete;
+
+  // O_CREAT | O_EXCL: существующий файл не перезаписывается
+  bool open(const std::string &path);
+  bool write(const char *data, size_t length);
+
+  bool backlogged() const { return !overflow_.empty(); }
+  // drained вызывается один раз — из потока завершений MediaIo или
+  // сразу, — когда текущий буфер свободен или запись не удалась
+  void whenDrained(std::function<void()> drained);
+  // Переносит накопленное в освободившийся буфер
+  bool resume();
+
+  // Дописывает хвост и закрывает файл, не дожидаясь диска. done — из
+  // потока завершений MediaIo или сразу; при ошибке файл удалён
+  void commit(Done done);
+  // Записи в полёте не ждёт: файл закроет и удалит последняя из них
+  void abort();
+
+  bool isOpen() const { return open_; }
+  size_t bytesWritten() const { return bytesWritten_; }
+  const std::string &path() const { return path_; }
+
+private:
+  struct FreeDeleter {
+    void operator()(char *p) const;
+  };
+
+  // Зарегистрированный буфер MediaIo или, если пул занят, свой
+  struct Slot {
+    MediaIo::Buffer fixed;
+    std::unique_ptr<char, FreeDeleter> owned;
+    char *data = nullptr;
+    int index = -1;
+  };
+
+  // Всё, что нужно колбэкам MediaIo: они могут прийти после того, как
+  // владелец закоммитил, отменил или уничтожил запись
+  struct Shared {
+    std::mutex mutex;
+    int fd = -1;
+    std::string path;
+    std::array<Slot, 2> slots;
+    std::array<bool, 2> busy{};
+    int pending = 0;
+    bool failed = false;
+    bool aborted = false;
+    std::function<void()> drained;
+    Done committed;
+  };
+
+  static bool acquireBuffers(Shared &shared);
+  // Вызываются под mutex, когда записей в полёте не осталось
+  static bool closeFile(Shared &shared);
+  static void discardFile(Shared &shared);
+  static void completed(const std::shared_ptr<Shared> &shared, int slot,
+                        bool ok);
+
+  bool fill(const char *data, size_t length);
+  void submit();
+  void submitOverflow();
+
+  std::shared_ptr<Shared> shared_;
+  bool open_ = false;
+  std::string path_;
+  size_t current_ = 0;
+  size_t buffered_ = 0;
+  uint64_t flushed_ = 0;
+  size_t bytesWritten_ = 0;
+  // Данные, для которых пока нет свободного буфера; непусто только
+  // при buffered_ == 0
+  std::string overflow_;
+};
+
+} // namespace services
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+
+// Дедлайн текущего HTTP-запроса для вызовов хранилища. Ставится в
+// pre-handling advice (main.cpp) на время синхронной части обработчика:
+// контроллер и его запросы к базе идут в одном IO-потоке, поэтому
+// хватает thread_local. В фоновых потоках и отложенных колбэках
+// дедлайна нет — там запросы живут по общему timeout пула.
+namespace storage {
+
+// Бросается вместо запроса к базе, если дедлайн уже прошёл или истёк
+// в ожидании ответа
+class DeadlineExceeded : public std::runtime_error {
+public:
+  DeadlineExceeded() : std::runtime_error("request deadline exceeded") {}
+};
+
+class DeadlineScope {
+public:
+  // deadlineUs — микросекунды от эпохи, как deadline_us в атрибутах
+  // запроса
+  explicit DeadlineScope(int64_t deadlineUs) : previous_(current()) {
+    current() = deadlineUs;
+  }
+  ~DeadlineScope() { current() = previous_; }
+
+  DeadlineScope(const DeadlineScope &) = delete;
+  DeadlineScope &operator=(const DeadlineScope &) = delete;
+
+  // Остаток дедлайна потока; nullopt — дедлайна нет
+  static std::optional<std::chrono::microseconds> remaining() {
+    if (current() == 0) {
+      return std::nullopt;
+    }
+    auto nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+    return std::chrono::microseconds(current() - nowUs);
+  }
+
+private:
+  static int64_t &current() {
+    static thread_local int64_t deadlineUs = 0;
+    return deadlineUs;
+  }
+
+  int64_t previous_;
+};
+
+} // namespace storage
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "storage/Rows.h"
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Доступ к данным постов, лайков, комментариев, подписок, пользователей
+// и вложений. Реализация выбирается при сборке (-DAPP_STORAGE=postgres
+// или memory): контроллеры и сервисы видят только эти интерфейсы.
+//
+// Все методы синхронные и бросают исключения при ошибке хранилища, как
+// execSqlSync; Postgres-реализация после дедлайна запроса бросает
+// DeadlineExceeded (Deadline.h). Время — строки в формате Postgres
+// timestamp ("2026-01-31 12:00:00.123456"). Post, Attachment, Comment
+// и User описаны в Rows.h.
+namespace storage {
+
+#ifdef APP_STORAGE_MEMORY
+inline constexpr bool kInMemory = true;
+#else
+inline constexpr bool kInMemory = false;
+#endif
+
+struct NewAttachment {
+  std::string filePath;
+  std::string type;
+};
+
+struct LikeSummary {
+  int64_t count = 0;
+  bool likedByViewer = false;
+};
+
+struct FollowCounts {
+  int64_t followers = 0;
+  int64_t following = 0;
+};
+
+// Отсутствующее поле не меняется
+struct PostUpdate {
+  std::optional<std::string> text;
+  std::optional<std::string> visibility;
+};
+
+struct ProfileUpdate {
+  std::optional<std::string> displayName;
+  std::optional<std::string> bio;
+  std::optional<std::string> avatarPath;
+};
+
+// Вложения и счётчики страницы постов по id поста
+struct PostExtras {
+  std::unordered_map<int64_t, std::vector<Attachment>> attachments;
+  std::unordered_map<int64_t, LikeSummary> likes;
+  std::unordered_map<int64_t, int64_t> comments;
+};
+
+// Части /users/{id}/profile-page, не покрытые ProfileCache
+struct ProfileSlice {
+  std::vector<Post> posts;
+  std::vector<User> followers;
+  bool isFollowing = false;
+};
+
+// Начальные данные in-memory хранилища: пользователи 1..users,
+// подписки и посты детерминированы
+struct SeedOptions {
+  size_t users = 0;
+  size_t postsPerUser = 0;
+  size_t followsPerUser = 0;
+};
+
+class PostRepository {
+public:
+  virtual ~PostRepository() = default;
+
+  // Пост и вложения атомарно; ref_count файлов растёт вместе с ними.
+  // Вложения в порядке запроса попадают в attachments
+  virtual Post create(int64_t authorId, const std::string &text,
+                      const std::string &visibility,
+                      const std::vector<NewAttachment> &newAttachments,
+                      std::vector<Attachment> &attachments) = 0;
+
+  virtual std::optional<Post> find(int64_t id) = 0;
+  // Автор поста или nullopt, если поста нет: для проверок прав и
+  // существования
+  virtual std::optional<int64_t> author(int64_t id) = 0;
+  // Найденные посты в произвольном порядке
+  virtual std::vector<Post> findMany(const std::vector<int64_t> &ids) = 0;
+
+  // Публичные, от новых к старым
+  virtual std::vector<Post> latestPublic(int limit, int offset) = 0;
+  // Все посты автора от новых к старым; limit 0 — без ограничения
+  virtual std::vector<Post> byAuthor(int64_t authorId, int limit) = 0;
+  // Лента без PostMetaStore: публичные посты чужих авторов, сначала
+  // подписки viewerId, внутри групп от новых к старым
+  virtual std::vector<Post> feed(int64_t viewerId, int limit,
+                                 int offset) = 0;
+  // Полнотекстовый поиск по публичным постам: сначала подписки
+  // viewerId, затем по релевантности и времени
+  virtual std::vector<Post> search(const std::string &query,
+                                   int64_t viewerId, int limit,
+                                   int offset) = 0;
+
+  virtual void update(int64_t id, const PostUpdate &update) = 0;
+  // Пост вместе с вложениями (ref_count уменьшается), лайками и
+  // комментариями
+  virtual void remove(int64_t id) = 0;
+
+  // Пакеты по возрастанию id для загрузки PostMetaStore: id,
+  // authorUserId, visibility и createdMs
+  virtual std::vector<Post> scanMeta(int64_t afterId, size_t limit) = 0;
+  virtual std::vector<int64_t> scanIds(int64_t afterId, size_t limit) = 0;
+};
+
+class LikeRepository {
+public:
+  virtual ~LikeRepository() = default;
+
+  // Повторный лайк ничего не меняет
+  virtual void like(int64_t postId, int64_t userId) = 0;
+  virtual void unlike(int64_t postId, int64_t userId) = 0;
+
+  virtual int64_t count(int64_t postId) = 0;
+  virtual bool isLiked(int64_t postId, int64_t userId) = 0;
+  // viewerId 0 — аноним, likedByViewer всегда false
+  virtual LikeSummary summary(int64_t postId, int64_t viewerId) = 0;
+};
+
+class CommentRepository {
+public:
+  virtual ~CommentRepository() = default;
+
+  // По времени создания
+  virtual std::vector<Comment> byPost(int64_t postId) = 0;
+  virtual Comment create(int64_t postId, int64_t authorId,
+                         const std::string &text) = 0;
+  virtual std::optional<Comment> find(int64_t id) = 0;
+  virtual void remove(int64_t id) = 0;
+  virtual int64_t count(int64_t postId) = 0;
+};
+
+class FollowRepository {
+public:
+  virtual ~FollowRepository() = default;
+
+  // Повторная подписка ничего не меняет
+  virtual void follow(int64_t followerId, int64_t followingId) = 0;
+  virtual void unfollow(int64_t followerId, int64_t followingId) = 0;
+  virtual bool isFollowing(int64_t followerId, int64_t followingId) = 0;
+
+  // id тех, на кого подписан userId
+  virtual std::vector<int64_t> following(int64_t userId) = 0;
+  // id подписчиков без ожидания: done вызывается из потока хранилища
+  // (для FeedHub, который публикует уже после ответа клиенту)
+  virtual void
+  followerIds(int64_t userId,
+              std::function<void(std::vector<int64_t>)> done,
+              std::function<void(const std::exception &)> fail) = 0;
+
+  // Профили подписчиков и подписок, новые подписки первыми. Только
+  // пользователи со строкой в users; limit 0 — без ограничения
+  virtual std::vector<User> followerProfiles(int64_t userId, int limit) = 0;
+  virtual std::vector<User> followingProfiles(int64_t userId) = 0;
+
+  virtual FollowCounts counts(int64_t userId) = 0;
+};
+
+class UserRepository {
+public:
+  virtual ~UserRepository() = default;
+
+  virtual std::vector<User> findMany(const std::vector<int64_t> &userIds) = 0;
+  virtual bool exists(int64_t userId) = 0;
+  virtual void create(const User &user) = 0;
+  virtual void update(int64_t userId, const ProfileUpdate &update) = 0;
+
+  virtual std::vector<int64_t> scanIds(int64_t afterId, size_t limit) = 0;
+};
+
+class AttachmentRepository {
+public:
+  virtual ~AttachmentRepository() = default;
+
+  virtual std::vector<Attachment> byPost(int64_t postId) = 0;
+  // Вложение к существующему посту; ref_count файла растёт
+  virtual Attachment add(int64_t postId, const std::string &type,
+                         const std::string &filePath) = 0;
+};
+
+class Repositories {
+public:
+  virtual ~Repositories() = default;
+
+  // Реализация, выбранная при сборке
+  static Repositories &instance();
+
+  virtual PostRepository &posts() = 0;
+  virtual LikeRepository &likes() = 0;
+  virtual CommentRepository &comments() = 0;
+  virtual FollowRepository &follows() = 0;
+  virtual UserRepository &users() = 0;
+  virtual AttachmentRepository &attachments() = 0;
+
+  // Составные чтения, независимые части которых Postgres выполняет
+  // одновременно по разным соединениям пула.
+  //
+  // Вложения, лайки (с отметкой viewerId) и число комментариев
+  // страницы постов
+  virtual PostExtras extras(const std::vector<int64_t> &postIds,
+                            int64_t viewerId) = 0;
+  // postsLimit последних постов userId, followersLimit последних
+  // подписчиков и подписан ли на него viewerId
+  virtual ProfileSlice profileSlice(int64_t userId, int64_t viewerId,
+                                    int postsLimit, int followersLimit) = 0;
+
+  // Заполняет пустое хранилище синтетическими данными; есть только у
+  // in-memory реализации
+  virtual void seed(const SeedOptions &options) = 0;
+};
+
+} // namespace storage
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Строки постов, пользователей, комментариев и вложений. Каждая
+// структура — шаблон над типом текста: Post владеет строками, PostView
+// смотрит в буфер результата запроса и живёт не дольше него.
+//
+// RowDescription<Row> перечисляет колонки: имя в результате (оно же
+// ключ JSON) и поле структуры. По описанию RowDecoder сопоставляет
+// колонки результата с полями один раз, а services::rowJson строит JSON.
+// Новое поле достаточно добавить в структуру и в её описание.
+namespace storage {
+
+template <typename Text> struct BasicPost {
+  int64_t id = 0;
+  int64_t authorUserId = 0;
+  Text text;
+  Text visibility;
+  Text createdAt;
+  Text updatedAt;
+  // Заполняется только create и scanMeta
+  int64_t createdMs = 0;
+};
+
+template <typename Text> struct BasicAttachment {
+  int64_t id = 0;
+  int64_t postId = 0;
+  Text type;
+  Text filePath;
+  Text createdAt;
+  // Из media_objects; пусто, пока ThumbnailPipeline не обработал файл
+  std::optional<int32_t> width;
+  std::optional<int32_t> height;
+  std::optional<Text> blurhash;
+  // JSON-массив вариантов или пустая строка
+  Text variants;
+};
+
+template <typename Text> struct BasicComment {
+  int64_t id = 0;
+  int64_t postId = 0;
+  int64_t authorUserId = 0;
+  Text text;
+  Text createdAt;
+};
+
+template <typename Text> struct BasicUser {
+  int64_t userId = 0;
+  Text username;
+  Text displayName;
+  Text bio;
+  Text avatarPath;
+  Text createdAt;
+};
+
+using Post = BasicPost<std::string>;
+using PostView = BasicPost<std::string_view>;
+using Attachment = BasicAttachment<std::string>;
+using AttachmentView = BasicAttachment<std::string_view>;
+using Comment = BasicComment<std::string>;
+using CommentView = BasicComment<std::string_view>;
+using User = BasicUser<std::string>;
+using UserView = BasicUser<std::string_view>;
+
+// Попадает ли колонка в JSON строки
+enum class InJson { kYes, kNo };
+
+template <typename Row, typename Field> struct Column {
+  const char *name;
+  Field Row::*field;
+  InJson json;
+};
+
+template <typename Row, typename Field>
+constexpr Column<Row, Field> column(const char *name, Field Row::*field,
+                                    InJson json = InJson::kYes) {
+  return {name, field, json};
+}
+
+template <typename Row> struct RowDescription;
+
+template <typename Text> struct RowDescription<BasicPost<Text>> {
+  using R = BasicPost<Text>;
+  static constexpr auto columns = std::make_tuple(
+      column("id", &R::id), column("author_user_id", &R::authorUserId),
+      column("text", &R::text), column("visibility", &R::visibility),
+      column("created_at", &R::createdAt),
+      column("updated_at", &R::updatedAt),
+      column("created_ms", &R::createdMs, InJson::kNo));
+};
+
+template <typename Text> struct RowDescription<BasicAttachment<Text>> {
+  using R = BasicAttachment<Text>;
+  // Варианты хранятся текстом, в JSON их разбирает attachmentJson
+  static constexpr auto columns = std::make_tuple(
+      column("id", &R::id), column("post_id", &R::postId, InJson::kNo),
+      column("type", &R::type), column("file_path", &R::filePath),
+      column("created_at", &R::createdAt, InJson::kNo),
+      column("width", &R::width), column("height", &R::height),
+      column("blurhash", &R::blurhash),
+      column("variants", &R::variants, InJson::kNo));
+};
+
+template <typename Text> struct RowDescription<BasicComment<Text>> {
+  using R = BasicComment<Text>;
+  static constexpr auto columns = std::make_tuple(
+      column("id", &R::id), column("post_id", &R::postId),
+      column("author_user_id", &R::authorUserId), column("text", &R::text),
+      column("created_at", &R::createdAt));
+};
+
+template <typename Text> struct RowDescription<BasicUser<Text>> {
+  using R = BasicUser<Text>;
+  static constexpr auto columns = std::make_tuple(
+      column("user_id", &R::userId), column("username", &R::username),
+      column("display_name", &R::displayName), column("bio", &R::bio),
+      column("avatar_path", &R::avatarPath),
+      column("created_at", &R::createdAt));
+};
+
+template <typename Row>
+inline constexpr size_t kColumnCount =
+    std::tuple_size_v<decltype(RowDescription<Row>::columns)>;
+
+// f вызывается для каждой колонки описания по порядку
+template <typename Row, typename F> constexpr void forEachColumn(F &&f) {
+  std::apply([&f](const auto &...columns) { (f(columns), ...); },
+             RowDescription<Row>::columns);
+}
+
+namespace detail {
+
+inline void assignCell(std::string &to, std::string_view cell) {
+  to.assign(cell.data(), cell.size());
+}
+
+inline void assignCell(std::string_view &to, std::string_view cell) {
+  to = cell;
+}
+
+template <typename Int>
+std::enable_if_t<std::is_integral_v<Int>> assignCell(Int &to,
+                                                     std::string_view cell) {
+  auto [end, error] = std::from_chars(cell.data(), cell.data() + cell.size(),
+                                      to);
+  if (error != std::errc() || end != cell.data() + cell.size()) {
+    throw std::invalid_argument("not an integer: " + std::string(cell));
+  }
+}
+
+template <typename T>
+void assignCell(std::optional<T> &to, std::string_view cell) {
+  assignCell(to.emplace(), cell);
+}
+
+} // namespace detail
+
+// Разбирает строки одного результата в Row. Колонки ищутся по имени
+// один раз в конструкторе, дальше ячейки берутся по номеру. Поля, колонок
+// которых нет в результате, и поля с NULL остаются по умолчанию
+template <typename Row> class RowDecoder {
+public:
+  // columnName(i) — имя i-й из columns колонок результата
+  template <typename ColumnName>
+  RowDecoder(size_t columns, ColumnName &&columnName) {
+    positions_.fill(kAbsent);
+    for (size_t i = 0; i < columns; ++i) {
+      std::string_view name = columnName(i);
+      size_t index = 0;
+      forEachColumn<Row>([&](const auto &column) {
+        // Как и поиск по имени, берём первую колонку с таким именем
+        if (positions_[index] == kAbsent && name == column.name) {
+          positions_[index] = static_cast<int>(i);
+        }
+        ++index;
+      });
+    }
+  }
+
+  // cell(i) — std::optional<std::string_view> с текстом i-й колонки,
+  // nullopt для NULL
+  template <typename Cell> Row decode(Cell &&cell) const {
+    Row row;
+    size_t index = 0;
+    forEachColumn<Row>([&](const auto &column) {
+      int position = positions_[index++];
+      if (position == kAbsent) {
+        return;
+      }
+      if (std::optional<std::string_view> value = cell(position)) {
+        detail::assignCell(row.*column.field, *value);
+      }
+    });
+    return row;
+  }
+
+private:
+  static constexpr int kAbsent = -1;
+  std::array<int, kColumnCount<Row>> positions_;
+};
+
+} // namespace storage
@@ -0,0 +1,714 @@
+#include "MemoryRepositories.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+
+using namespace storage;
+using namespace storage::memory;
+
+namespace {
+
+struct Now {
+  std::string text;
+  int64_t ms = 0;
+};
+
+Now now() {
+  auto time = std::chrono::system_clock::now();
+  return {formatTimestamp(time),
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              time.time_since_epoch())
+              .count()};
+}
+
+bool isPublic(const Post &post) { return post.visibility == "public"; }
+
+// Приведение ASCII к нижнему регистру; байты UTF-8 не меняются
+std::string lowercase(std::string text) {
+  for (auto &c : text) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return text;
+}
+
+std::vector<std::string> words(const std::string &query) {
+  std::vector<std::string> result;
+  size_t start = 0;
+  while (start < query.size()) {
+    auto end = query.find(' ', start);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    if (end > start) {
+      result.push_back(lowercase(query.substr(start, end - start)));
+    }
+    start = end + 1;
+  }
+  return result;
+}
+
+// На кого подписан пользователь, для проверки авторов при проходе
+std::unordered_set<int64_t> followedBy(const Tables &tables, int64_t userId) {
+  auto ids = tables.following.get(userId);
+  if (!ids) {
+    return {};
+  }
+  return std::unordered_set<int64_t>(ids->begin(), ids->end());
+}
+
+void eraseValue(std::vector<int64_t> &values, int64_t value) {
+  values.erase(std::remove(values.begin(), values.end(), value),
+               values.end());
+}
+
+} // namespace
+
+std::string storage::memory::formatTimestamp(
+    std::chrono::system_clock::time_point time) {
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                    time.time_since_epoch())
+                    .count();
+  std::time_t seconds = micros / 1000000;
+  std::tm tm{};
+  gmtime_r(&seconds, &tm);
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d.%06d",
+                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                tm.tm_min, tm.tm_sec, static_cast<int>(micros % 1000000));
+  return buffer;
+}
+
+Repositories &Repositories::instance() {
+  static MemoryRepositories repositories;
+  return repositories;
+}
+
+// Посты
+
+template <typename Keep, typename Stop>
+void MemoryPostRepository::scanNewest(int64_t downTo, Keep &&keep,
+                                      Stop &&stop) {
+  for (auto id = tables_.lastPostId.load(std::memory_order_acquire);
+       id > downTo; --id) {
+    auto post = tables_.posts.get(id);
+    if (post && keep(*post) && stop(std::move(*post))) {
+      return;
+    }
+  }
+}
+
+Post MemoryPostRepository::create(
+    int64_t authorId, const std::string &text, const std::string &visibility,
+    const std::vector<NewAttachment> &newAttachments,
+    std::vector<Attachment> &attachments) {
+  auto created = now();
+  Post post;
+  post.id = tables_.lastPostId.fetch_add(1, std::memory_order_acq_rel) + 1;
+  post.authorUserId = authorId;
+  post.text = text;
+  post.visibility = visibility;
+  post.createdAt = created.text;
+  post.updatedAt = created.text;
+  post.createdMs = created.ms;
+
+  // Вложения раньше поста: найденный пост уже с ними
+  for (const auto &newAttachment : newAttachments) {
+    Attachment attachment;
+    attachment.id =
+        tables_.lastAttachmentId.fetch_add(1, std::memory_order_relaxed) + 1;
+    attachment.postId = post.id;
+    attachment.type = newAttachment.type;
+    attachment.filePath = newAttachment.filePath;
+    attachment.createdAt = created.text;
+    attachments.push_back(std::move(attachment));
+  }
+  if (!attachments.empty()) {
+    tables_.attachments.write(post.id, [&](auto &rows) {
+      rows[post.id] = attachments;
+    });
+  }
+
+  tables_.postsByAuthor.write(authorId, [&](auto &rows) {
+    auto &ids = rows[authorId];
+    // id выдаются до вставки, соседний create мог успеть раньше
+    ids.insert(std::upper_bound(ids.begin(), ids.end(), post.id), post.id);
+  });
+  tables_.posts.write(post.id, [&](auto &rows) { rows[post.id] = post; });
+  return post;
+}
+
+std::optional<Post> MemoryPostRepository::find(int64_t id) {
+  return tables_.posts.get(id);
+}
+
+std::optional<int64_t> MemoryPostRepository::author(int64_t id) {
+  return tables_.posts.read(id, [id](const auto &rows) {
+    auto it = rows.find(id);
+    return it == rows.end() ? std::nullopt
+                            : std::optional<int64_t>(it->second.authorUserId);
+  });
+}
+
+std::vector<Post> MemoryPostRepository::findMany(
+    const std::vector<int64_t> &ids) {
+  std::vector<Post> posts;
+  posts.reserve(ids.size());
+  for (auto id : ids) {
+    if (auto post = tables_.posts.get(id)) {
+      posts.push_back(std::move(*post));
+    }
+  }
+  return posts;
+}
+
+std::vector<Post> MemoryPostRepository::latestPublic(int limit, int offset) {
+  std::vector<Post> posts;
+  int skipped = 0;
+  scanNewest(
+      0, [](const Post &post) { return isPublic(post); },
+      [&](Post post) {
+        if (skipped < offset) {
+          ++skipped;
+          return false;
+        }
+        posts.push_back(std::move(post));
+        return posts.size() >= static_cast<size_t>(limit);
+      });
+  return posts;
+}
+
+std::vector<Post> MemoryPostRepository::byAuthor(int64_t authorId,
+                                                 int limit) {
+  auto ids = tables_.postsByAuthor.read(authorId, [authorId](const auto &rows) {
+    auto it = rows.find(authorId);
+    return it == rows.end() ? std::vector<int64_t>() : it->second;
+  });
+
+  std::vector<Post> posts;
+  for (auto it = ids.rbegin(); it != ids.rend(); ++it) {
+    if (limit != 0 && posts.size() >= static_cast<size_t>(limit)) {
+      break;
+    }
+    if (auto post = tables_.posts.get(*it)) {
+      posts.push_back(std::move(*post));
+    }
+  }
+  return posts;
+}
+
+std::vector<Post> MemoryPostRepository::feed(int64_t viewerId, int limit,
+                                             int offset) {
+  auto followed = followedBy(tables_, viewerId);
+
+  // Два прохода: сначала подписки, затем остальные авторы
+  std::vector<Post> posts;
+  int skipped = 0;
+  for (bool fromFollowed : {true, false}) {
+    if (posts.size() >= static_cast<size_t>(limit)) {
+      break;
+    }
+    scanNewest(
+        0,
+        [&](const Post &post) {
+          return isPublic(post) && post.authorUserId != viewerId &&
+                 (followed.count(post.authorUserId) > 0) == fromFollowed;
+        },
+        [&](Post post) {
+          if (skipped < offset) {
+            ++skipped;
+            return false;
+          }
+          posts.push_back(std::move(post));
+          return posts.size() >= static_cast<size_t>(limit);
+        });
+  }
+  return posts;
+}
+
+std::vector<Post> MemoryPostRepository::search(const std::string &query,
+                                               int64_t viewerId, int limit,
+                                               int offset) {
+  auto terms = words(query);
+  if (terms.empty()) {
+    return {};
+  }
+  auto followed = followedBy(tables_, viewerId);
+
+  std::vector<Post> posts;
+  int skipped = 0;
+  for (bool fromFollowed : {true, false}) {
+    if (posts.size() >= static_cast<size_t>(limit)) {
+      break;
+    }
+    scanNewest(
+        0,
+        [&](const Post &post) {
+          if (!isPublic(post) ||
+              (followed.count(post.authorUserId) > 0) != fromFollowed) {
+            return false;
+          }
+          auto text = lowercase(post.text);
+          return std::all_of(terms.begin(), terms.end(),
+                             [&text](const std::string &term) {
+                               return text.find(term) != std::string::npos;
+                             });
+        },
+        [&](Post post) {
+          if (skipped < offset) {
+            ++skipped;
+            return false;
+          }
+          posts.push_back(std::move(post));
+          return posts.size() >= static_cast<size_t>(limit);
+        });
+  }
+  return posts;
+}
+
+void MemoryPostRepository::update(int64_t id, const PostUpdate &update) {
+  if (!update.text && !update.visibility) {
+    return;
+  }
+  auto updatedAt = now().text;
+  tables_.posts.write(id, [&](auto &rows) {
+    auto it = rows.find(id);
+    if (it == rows.end()) {
+      return;
+    }
+    if (update.text) {
+      it->second.text = *update.text;
+    }
+    if (update.visibility) {
+      it->second.visibility = *update.visibility;
+    }
+    it->second.updatedAt = updatedAt;
+  });
+}
+
+void MemoryPostRepository::remove(int64_t id) {
+  auto authorId = author(id);
+
+  // Сначала сам пост: дальше его уже никто не найдёт
+  tables_.posts.write(id, [id](auto &rows) { rows.erase(id); });
+  if (authorId) {
+    tables_.postsByAuthor.write(*authorId, [&](auto &rows) {
+      auto it = rows.find(*authorId);
+      if (it != rows.end()) {
+        eraseValue(it->second, id);
+      }
+    });
+  }
+  tables_.attachments.write(id, [id](auto &rows) { rows.erase(id); });
+  tables_.likes.write(id, [id](auto &rows) { rows.erase(id); });
+
+  std::vector<int64_t> commentIds;
+  tables_.commentsByPost.write(id, [&](auto &rows) {
+    auto it = rows.find(id);
+    if (it != rows.end()) {
+      commentIds = std::move(it->second);
+      rows.erase(it);
+    }
+  });
+  for (auto commentId : commentIds) {
+    tables_.comments.write(commentId,
+                           [commentId](auto &rows) { rows.erase(commentId); });
+  }
+}
+
+std::vector<Post> MemoryPostRepository::scanMeta(int64_t afterId,
+                                                 size_t limit) {
+  std::vector<Post> posts;
+  auto lastId = tables_.lastPostId.load(std::memory_order_acquire);
+  for (auto id = afterId + 1; id <= lastId && posts.size() < limit; ++id) {
+    if (auto post = tables_.posts.get(id)) {
+      post->text.clear();
+      posts.push_back(std::move(*post));
+    }
+  }
+  return posts;
+}
+
+std::vector<int64_t> MemoryPostRepository::scanIds(int64_t afterId,
+                                                   size_t limit) {
+  std::vector<int64_t> ids;
+  auto lastId = tables_.lastPostId.load(std::memory_order_acquire);
+  for (auto id = afterId + 1; id <= lastId && ids.size() < limit; ++id) {
+    if (author(id)) {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+// Лайки
+
+void MemoryLikeRepository::like(int64_t postId, int64_t userId) {
+  tables_.likes.write(postId,
+                      [&](auto &rows) { rows[postId].insert(userId); });
+}
+
+void MemoryLikeRepository::unlike(int64_t postId, int64_t userId) {
+  tables_.likes.write(postId, [&](auto &rows) {
+    auto it = rows.find(postId);
+    if (it != rows.end()) {
+      it->second.erase(userId);
+    }
+  });
+}
+
+int64_t MemoryLikeRepository::count(int64_t postId) {
+  return summary(postId, 0).count;
+}
+
+bool MemoryLikeRepository::isLiked(int64_t postId, int64_t userId) {
+  return summary(postId, userId).likedByViewer;
+}
+
+LikeSummary MemoryLikeRepository::summary(int64_t postId, int64_t viewerId) {
+  return tables_.likes.read(postId, [&](const auto &rows) {
+    LikeSummary summary;
+    auto it = rows.find(postId);
+    if (it != rows.end()) {
+      summary.count = static_cast<int64_t>(it->second.size());
+      summary.likedByViewer = viewerId != 0 && it->second.count(viewerId) > 0;
+    }
+    return summary;
+  });
+}
+
+// Комментарии
+
+std::vector<Comment> MemoryCommentRepository::byPost(int64_t postId) {
+  auto ids = tables_.commentsByPost.read(postId, [postId](const auto &rows) {
+    auto it = rows.find(postId);
+    return it == rows.end() ? std::vector<int64_t>() : it->second;
+  });
+  std::vector<Comment> comments;
+  comments.reserve(ids.size());
+  for (auto id : ids) {
+    if (auto comment = tables_.comments.get(id)) {
+      comments.push_back(std::move(*comment));
+    }
+  }
+  return comments;
+}
+
+Comment MemoryCommentRepository::create(int64_t postId, int64_t authorId,
+                                        const std::string &text) {
+  Comment comment;
+  comment.id =
+      tables_.lastCommentId.fetch_add(1, std::memory_order_relaxed) + 1;
+  comment.postId = postId;
+  comment.authorUserId = authorId;
+  comment.text = text;
+  comment.createdAt = now().text;
+
+  tables_.comments.write(comment.id,
+                         [&](auto &rows) { rows[comment.id] = comment; });
+  tables_.commentsByPost.write(postId, [&](auto &rows) {
+    auto &ids = rows[postId];
+    ids.insert(std::upper_bound(ids.begin(), ids.end(), comment.id),
+               comment.id);
+  });
+  return comment;
+}
+
+std::optional<Comment> MemoryCommentRepository::find(int64_t id) {
+  return tables_.comments.get(id);
+}
+
+void MemoryCommentRepository::remove(int64_t id) {
+  auto comment = tables_.comments.get(id);
+  if (!comment) {
+    return;
+  }
+  tables_.commentsByPost.write(comment->postId, [&](auto &rows) {
+    auto it = rows.find(comment->postId);
+    if (it != rows.end()) {
+      eraseValue(it->second, id);
+    }
+  });
+  tables_.comments.write(id, [id](auto &rows) { rows.erase(id); });
+}
+
+int64_t MemoryCommentRepository::count(int64_t postId) {
+  return tables_.commentsByPost.read(postId, [postId](const auto &rows) {
+    auto it = rows.find(postId);
+    return it == rows.end() ? int64_t(0)
+                            : static_cast<int64_t>(it->second.size());
+  });
+}
+
+// Подписки
+
+void MemoryFollowRepository::follow(int64_t followerId,
+                                    int64_t followingId) {
+  bool added = tables_.following.write(followerId, [&](auto &rows) {
+    auto &ids = rows[followerId];
+    if (std::find(ids.begin(), ids.end(), followingId) != ids.end()) {
+      return false;
+    }
+    ids.push_back(followingId);
+    return true;
+  });
+  if (added) {
+    tables_.followers.write(followingId, [&](auto &rows) {
+      rows[followingId].push_back(followerId);
+    });
+  }
+}
+
+void MemoryFollowRepository::unfollow(int64_t followerId,
+                                      int64_t followingId) {
+  tables_.following.write(followerId, [&](auto &rows) {
+    auto it = rows.find(followerId);
+    if (it != rows.end()) {
+      eraseValue(it->second, followingId);
+    }
+  });
+  tables_.followers.write(followingId, [&](auto &rows) {
+    auto it = rows.find(followingId);
+    if (it != rows.end()) {
+      eraseValue(it->second, followerId);
+    }
+  });
+}
+
+bool MemoryFollowRepository::isFollowing(int64_t followerId,
+                                         int64_t followingId) {
+  return tables_.following.read(followerId, [&](const auto &rows) {
+    auto it = rows.find(followerId);
+    return it != rows.end() &&
+           std::find(it->second.begin(), it->second.end(), followingId) !=
+               it->second.end();
+  });
+}
+
+std::vector<int64_t> MemoryFollowRepository::following(int64_t userId) {
+  return tables_.following.read(userId, [userId](const auto &rows) {
+    auto it = rows.find(userId);
+    return it == rows.end() ? std::vector<int64_t>() : it->second;
+  });
+}
+
+void MemoryFollowRepository::followerIds(
+    int64_t userId, std::function<void(std::vector<int64_t>)> done,
+    std::function<void(const std::exception &)> fail) {
+  std::vector<int64_t> ids;
+  try {
+    ids = tables_.followers.read(userId, [userId](const auto &rows) {
+      auto it = rows.find(userId);
+      return it == rows.end() ? std::vector<int64_t>() : it->second;
+    });
+  } catch (const std::exception &e) {
+    fail(e);
+    return;
+  }
+  done(std::move(ids));
+}
+
+std::vector<User> MemoryFollowRepository::profiles(
+    const std::vector<int64_t> &ids, int limit) {
+  std::vector<User> users;
+  for (auto it = ids.rbegin(); it != ids.rend(); ++it) {
+    if (limit != 0 && users.size() >= static_cast<size_t>(limit)) {
+      break;
+    }
+    if (auto user = tables_.users.get(*it)) {
+      user->bio.clear();
+      user->createdAt.clear();
+      users.push_back(std::move(*user));
+    }
+  }
+  return users;
+}
+
+std::vector<User> MemoryFollowRepository::followerProfiles(int64_t userId,
+                                                           int limit) {
+  auto ids = tables_.followers.read(userId, [userId](const auto &rows) {
+    auto it = rows.find(userId);
+    return it == rows.end() ? std::vector<int64_t>() : it->second;
+  });
+  return profiles(ids, limit);
+}
+
+std::vector<User> MemoryFollowRepository::followingProfiles(int64_t userId) {
+  return profiles(following(userId), 0);
+}
+
+FollowCounts MemoryFollowRepository::counts(int64_t userId) {
+  auto size = [userId](const auto &rows) {
+    auto it = rows.find(userId);
+    return it == rows.end() ? int64_t(0)
+                            : static_cast<int64_t>(it->second.size());
+  };
+  FollowCounts counts;
+  counts.followers = tables_.followers.read(userId, size);
+  counts.following = tables_.following.read(userId, size);
+  return counts;
+}
+
+// Пользователи
+
+std::vector<User>
+MemoryUserRepository::findMany(const std::vector<int64_t> &userIds) {
+  std::vector<User> users;
+  users.reserve(userIds.size());
+  for (auto userId : userIds) {
+    if (auto user = tables_.users.get(userId)) {
+      users.push_back(std::move(*user));
+    }
+  }
+  return users;
+}
+
+bool MemoryUserRepository::exists(int64_t userId) {
+  return tables_.users.read(userId, [userId](const auto &rows) {
+    return rows.count(userId) > 0;
+  });
+}
+
+void MemoryUserRepository::create(const User &user) {
+  auto created = user;
+  created.createdAt = now().text;
+  bool inserted = tables_.users.write(user.userId, [&](auto &rows) {
+    return rows.emplace(user.userId, std::move(created)).second;
+  });
+  // Как UNIQUE (user_id) в Postgres
+  if (!inserted) {
+    throw std::runtime_error("user " + std::to_string(user.userId) +
+                             " already exists");
+  }
+  auto maxUserId = maxUserId_.load(std::memory_order_relaxed);
+  while (user.userId > maxUserId &&
+         !maxUserId_.compare_exchange_weak(maxUserId, user.userId)) {
+  }
+}
+
+void MemoryUserRepository::update(int64_t userId,
+                                  const ProfileUpdate &update) {
+  tables_.users.write(userId, [&](auto &rows) {
+    auto it = rows.find(userId);
+    if (it == rows.end()) {
+      return;
+    }
+    if (update.displayName) {
+      it->second.displayName = *update.displayName;
+    }
+    if (update.bio) {
+      it->second.bio = *update.bio;
+    }
+    if (update.avatarPath) {
+      it->second.avatarPath = *update.avatarPath;
+    }
+  });
+}
+
+std::vector<int64_t> MemoryUserRepository::scanIds(int64_t afterId,
+                                                   size_t limit) {
+  std::vector<int64_t> ids;
+  auto maxUserId = maxUserId_.load(std::memory_order_relaxed);
+  for (auto id = afterId + 1; id <= maxUserId && ids.size() < limit; ++id) {
+    if (exists(id)) {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+// Вложения
+
+std::vector<Attachment> MemoryAttachmentRepository::byPost(int64_t postId) {
+  return tables_.attachments.read(postId, [postId](const auto &rows) {
+    auto it = rows.find(postId);
+    return it == rows.end() ? std::vector<Attachment>() : it->second;
+  });
+}
+
+Attachment MemoryAttachmentRepository::add(int64_t postId,
+                                           const std::string &type,
+                                           const std::string &filePath) {
+  Attachment attachment;
+  attachment.id =
+      tables_.lastAttachmentId.fetch_add(1, std::memory_order_relaxed) + 1;
+  attachment.postId = postId;
+  attachment.type = type;
+  attachment.filePath = filePath;
+  attachment.createdAt = now().text;
+  tables_.attachments.write(postId, [&](auto &rows) {
+    rows[postId].push_back(attachment);
+  });
+  return attachment;
+}
+
+// Составные чтения
+
+MemoryRepositories::MemoryRepositories()
+    : posts_(tables_), likes_(tables_), comments_(tables_), follows_(tables_),
+      users_(tables_), attachments_(tables_) {}
+
+PostExtras MemoryRepositories::extras(const std::vector<int64_t> &postIds,
+                                      int64_t viewerId) {
+  PostExtras extras;
+  for (auto postId : postIds) {
+    auto attachments = attachments_.byPost(postId);
+    if (!attachments.empty()) {
+      extras.attachments[postId] = std::move(attachments);
+    }
+    auto likes = likes_.summary(postId, viewerId);
+    if (likes.count > 0) {
+      extras.likes[postId] = likes;
+    }
+    auto comments = comments_.count(postId);
+    if (comments > 0) {
+      extras.comments[postId] = comments;
+    }
+  }
+  return extras;
+}
+
+ProfileSlice MemoryRepositories::profileSlice(int64_t userId,
+                                              int64_t viewerId,
+                                              int postsLimit,
+                                              int followersLimit) {
+  ProfileSlice slice;
+  slice.posts = posts_.byAuthor(userId, postsLimit);
+  slice.followers = follows_.followerProfiles(userId, followersLimit);
+  slice.isFollowing = follows_.isFollowing(viewerId, userId);
+  return slice;
+}
+
+void MemoryRepositories::seed(const SeedOptions &options) {
+  auto users = static_cast<int64_t>(options.users);
+  for (int64_t userId = 1; userId <= users; ++userId) {
+    User user;
+    user.userId = userId;
+    user.username = "user" + std::to_string(userId);
+    user.displayName = "User " + std::to_string(userId);
+    users_.create(user);
+  }
+
+  // Подписки на следующих по кругу: у каждого одинаковое число
+  // подписчиков и подписок
+  auto follows =
+      std::min<int64_t>(static_cast<int64_t>(options.followsPerUser),
+                        users > 0 ? users - 1 : 0);
+  for (int64_t userId = 1; userId <= users; ++userId) {
+    for (int64_t k = 1; k <= follows; ++k) {
+      follows_.follow(userId, (userId - 1 + k) % users + 1);
+    }
+  }
+
+  // Посты по кругу: в любой странице ленты вперемешку разные авторы
+  std::vector<Attachment> none;
+  for (size_t n = 0; n < options.postsPerUser; ++n) {
+    for (int64_t userId = 1; userId <= users; ++userId) {
+      posts_.create(userId,
+                    "Post " + std::to_string(n + 1) + " by user" +
+                        std::to_string(userId),
+                    "public", {}, none);
+    }
+  }
+}
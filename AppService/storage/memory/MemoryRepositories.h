@@ -0,0 +1,237 @@
+#pragma once
+
+#include "storage/Repositories.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// Хранилище в памяти процесса для бенчмарков обработчиков и
+// smoke-тестов без Postgres. Ничего не сохраняет между запусками.
+//
+// Таблицы разбиты на шарды по ключу, у каждого шарда своя
+// shared_mutex (как в ProfileCache): записи в разные шарды не мешают
+// друг другу, чтения одного шарда идут параллельно. Операции над
+// несколькими таблицами не атомарны, но порядок записи выбран так,
+// чтобы читатель не видел пост без его вложений.
+//
+// id постов, комментариев и вложений выдаются по возрастанию, поэтому
+// порядок id — это и порядок создания: «от новых к старым» — проход по
+// id вниз без отдельного индекса.
+//
+// Отличия от Postgres: поиск — вхождение всех слов запроса без учёта
+// регистра кириллицы, морфологии и ранга; media_objects нет, поэтому у
+// вложений нет размеров, BlurHash и вариантов, а ref_count не ведётся.
+namespace storage::memory {
+
+template <typename Key, typename Value> class StripedTable {
+public:
+  using Rows = std::unordered_map<Key, Value>;
+
+  // f получает строки шарда ключа под общей блокировкой
+  template <typename F> auto read(const Key &key, F &&f) const {
+    const auto &shard = shardFor(key);
+    std::shared_lock lock(shard.mutex);
+    return f(shard.rows);
+  }
+
+  // То же под исключительной блокировкой
+  template <typename F> auto write(const Key &key, F &&f) {
+    auto &shard = shardFor(key);
+    std::unique_lock lock(shard.mutex);
+    return f(shard.rows);
+  }
+
+  std::optional<Value> get(const Key &key) const {
+    return read(key, [&key](const Rows &rows) -> std::optional<Value> {
+      auto it = rows.find(key);
+      if (it == rows.end()) {
+        return std::nullopt;
+      }
+      return it->second;
+    });
+  }
+
+private:
+  static constexpr size_t kShards = 64;
+
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    Rows rows;
+  };
+
+  const Shard &shardFor(const Key &key) const {
+    return shards_[std::hash<Key>{}(key) % kShards];
+  }
+  Shard &shardFor(const Key &key) {
+    return shards_[std::hash<Key>{}(key) % kShards];
+  }
+
+  std::array<Shard, kShards> shards_;
+};
+
+// Все таблицы; репозитории ниже — представления над ними
+struct Tables {
+  StripedTable<int64_t, Post> posts;
+  // Автор -> id его постов по возрастанию
+  StripedTable<int64_t, std::vector<int64_t>> postsByAuthor;
+  // Пост -> лайкнувшие пользователи
+  StripedTable<int64_t, std::unordered_set<int64_t>> likes;
+  StripedTable<int64_t, Comment> comments;
+  // Пост -> id комментариев по возрастанию
+  StripedTable<int64_t, std::vector<int64_t>> commentsByPost;
+  // Подписчик -> на кого подписан и наоборот, в порядке подписки
+  StripedTable<int64_t, std::vector<int64_t>> following;
+  StripedTable<int64_t, std::vector<int64_t>> followers;
+  StripedTable<int64_t, User> users;
+  // Пост -> вложения по возрастанию id
+  StripedTable<int64_t, std::vector<Attachment>> attachments;
+
+  std::atomic<int64_t> lastPostId{0};
+  std::atomic<int64_t> lastCommentId{0};
+  std::atomic<int64_t> lastAttachmentId{0};
+};
+
+class MemoryPostRepository : public PostRepository {
+public:
+  explicit MemoryPostRepository(Tables &tables) : tables_(tables) {}
+
+  Post create(int64_t authorId, const std::string &text,
+              const std::string &visibility,
+              const std::vector<NewAttachment> &newAttachments,
+              std::vector<Attachment> &attachments) override;
+  std::optional<Post> find(int64_t id) override;
+  std::optional<int64_t> author(int64_t id) override;
+  std::vector<Post> findMany(const std::vector<int64_t> &ids) override;
+  std::vector<Post> latestPublic(int limit, int offset) override;
+  std::vector<Post> byAuthor(int64_t authorId, int limit) override;
+  std::vector<Post> feed(int64_t viewerId, int limit, int offset) override;
+  std::vector<Post> search(const std::string &query, int64_t viewerId,
+                           int limit, int offset) override;
+  void update(int64_t id, const PostUpdate &update) override;
+  void remove(int64_t id) override;
+  std::vector<Post> scanMeta(int64_t afterId, size_t limit) override;
+  std::vector<int64_t> scanIds(int64_t afterId, size_t limit) override;
+
+private:
+  // Посты от новых к старым, для которых keep вернул true; stop
+  // вызывается после каждого принятого и прерывает проход
+  template <typename Keep, typename Stop>
+  void scanNewest(int64_t downTo, Keep &&keep, Stop &&stop);
+
+  Tables &tables_;
+};
+
+class MemoryLikeRepository : public LikeRepository {
+public:
+  explicit MemoryLikeRepository(Tables &tables) : tables_(tables) {}
+
+  void like(int64_t postId, int64_t userId) override;
+  void unlike(int64_t postId, int64_t userId) override;
+  int64_t count(int64_t postId) override;
+  bool isLiked(int64_t postId, int64_t userId) override;
+  LikeSummary summary(int64_t postId, int64_t viewerId) override;
+
+private:
+  Tables &tables_;
+};
+
+class MemoryCommentRepository : public CommentRepository {
+public:
+  explicit MemoryCommentRepository(Tables &tables) : tables_(tables) {}
+
+  std::vector<Comment> byPost(int64_t postId) override;
+  Comment create(int64_t postId, int64_t authorId,
+                 const std::string &text) override;
+  std::optional<Comment> find(int64_t id) override;
+  void remove(int64_t id) override;
+  int64_t count(int64_t postId) override;
+
+private:
+  Tables &tables_;
+};
+
+class MemoryFollowRepository : public FollowRepository {
+public:
+  explicit MemoryFollowRepository(Tables &tables) : tables_(tables) {}
+
+  void follow(int64_t followerId, int64_t followingId) override;
+  void unfollow(int64_t followerId, int64_t followingId) override;
+  bool isFollowing(int64_t followerId, int64_t followingId) override;
+  std::vector<int64_t> following(int64_t userId) override;
+  void followerIds(int64_t userId,
+                   std::function<void(std::vector<int64_t>)> done,
+                   std::function<void(const std::exception &)> fail) override;
+  std::vector<User> followerProfiles(int64_t userId, int limit) override;
+  std::vector<User> followingProfiles(int64_t userId) override;
+  FollowCounts counts(int64_t userId) override;
+
+private:
+  // Профили в обратном порядке списка; без строки в users пропускаются
+  std::vector<User> profiles(const std::vector<int64_t> &ids, int limit);
+
+  Tables &tables_;
+};
+
+class MemoryUserRepository : public UserRepository {
+public:
+  explicit MemoryUserRepository(Tables &tables) : tables_(tables) {}
+
+  std::vector<User> findMany(const std::vector<int64_t> &userIds) override;
+  bool exists(int64_t userId) override;
+  void create(const User &user) override;
+  void update(int64_t userId, const ProfileUpdate &update) override;
+  std::vector<int64_t> scanIds(int64_t afterId, size_t limit) override;
+
+private:
+  Tables &tables_;
+  // Наибольший user_id: граница прохода scanIds
+  std::atomic<int64_t> maxUserId_{0};
+};
+
+class MemoryAttachmentRepository : public AttachmentRepository {
+public:
+  explicit MemoryAttachmentRepository(Tables &tables) : tables_(tables) {}
+
+  std::vector<Attachment> byPost(int64_t postId) override;
+  Attachment add(int64_t postId, const std::string &type,
+                 const std::string &filePath) override;
+
+private:
+  Tables &tables_;
+};
+
+class MemoryRepositories : public Repositories {
+public:
+  MemoryRepositories();
+
+  PostRepository &posts() override { return posts_; }
+  LikeRepository &likes() override { return likes_; }
+  CommentRepository &comments() override { return comments_; }
+  FollowRepository &follows() override { return follows_; }
+  UserRepository &users() override { return users_; }
+  AttachmentRepository &attachments() override { return attachments_; }
+
+  PostExtras extras(const std::vector<int64_t> &postIds,
+                    int64_t viewerId) override;
+  ProfileSlice profileSlice(int64_t userId, int64_t viewerId, int postsLimit,
+                            int followersLimit) override;
+  void seed(const SeedOptions &options) override;
+
+private:
+  Tables tables_;
+  MemoryPostRepository posts_;
+  MemoryLikeRepository likes_;
+  MemoryCommentRepository comments_;
+  MemoryFollowRepository follows_;
+  MemoryUserRepository users_;
+  MemoryAttachmentRepository attachments_;
+};
+
+// "2026-01-31 12:00:00.123456" в UTC, как timestamp Postgres
+std::string formatTimestamp(std::chrono::system_clock::time_point time);
+
+} // namespace storage::memory
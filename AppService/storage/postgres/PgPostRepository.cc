@@ -0,0 +1,273 @@
+#include "PgRepositories.h"
+#include "services/SqlArrays.h"
+#include <algorithm>
+#include <drogon/HttpAppFramework.h>
+#include <future>
+#include <stdexcept>
+
+using namespace storage;
+using namespace storage::postgres;
+
+namespace {
+
+drogon::orm::DbClientPtr db() { return drogon::app().getDbClient(); }
+
+} // namespace
+
+Post PgPostRepository::create(int64_t authorId, const std::string &text,
+                              const std::string &visibility,
+                              const std::vector<NewAttachment> &newAttachments,
+                              std::vector<Attachment> &attachments) {
+  // Результат COMMIT приходит в колбэк из потока базы; promise живёт,
+  // пока жив колбэк, даже если мы уже вышли по исключению
+  auto committed = std::make_shared<std::promise<bool>>();
+  auto commitResult = committed->get_future();
+
+  // Дедлайн уже прошёл — транзакцию не открываем
+  auto remaining = remainingDeadline();
+
+  Post post;
+  {
+    // Пост и все вложения — одна транзакция: при ошибке любого запроса
+    // Drogon откатывает её сам
+    auto transaction = db()->newTransaction(
+        [committed](bool ok) { committed->set_value(ok); });
+    if (remaining) {
+      // Бросить ожидание посреди транзакции нельзя — COMMIT ушёл бы
+      // без нас. Поэтому остаток дедлайна получает сервер: запрос
+      // транзакции, который его переживёт, он прервёт сам, и
+      // транзакция откатится
+      auto timeoutMs = std::max<int64_t>(
+          1, std::chrono::duration_cast<std::chrono::milliseconds>(*remaining)
+                 .count());
+      transaction->execSqlSync(
+          "SELECT set_config('statement_timeout', $1, true)",
+          std::to_string(timeoutMs));
+    }
+    auto result = transaction->execSqlSync(
+        "INSERT INTO posts (author_user_id, text, visibility) VALUES ($1, $2, "
+        "$3) RETURNING id, created_at, updated_at, "
+        "(extract(epoch FROM created_at) * 1000)::bigint AS created_ms",
+        authorId, text, visibility);
+    post = std::move(rowsFrom<Post>(result).front());
+    post.authorUserId = authorId;
+    post.text = text;
+    post.visibility = visibility;
+
+    if (!newAttachments.empty()) {
+      std::vector<std::string> paths, types;
+      for (const auto &attachment : newAttachments) {
+        paths.push_back(attachment.filePath);
+        types.push_back(attachment.type);
+      }
+      // Один многострочный INSERT; ref_count тем же запросом, как
+      // в remove
+      auto rows = transaction->execSqlSync(
+          "WITH added AS ( "
+          "  INSERT INTO attachments (post_id, type, file_path) "
+          "  SELECT $1, a.type, a.file_path "
+          "  FROM unnest($2::text[], $3::text[]) WITH ORDINALITY "
+          "       AS a(file_path, type, n) "
+          "  ORDER BY a.n "
+          "  RETURNING id, type, file_path "
+          "), counted AS ( "
+          "  UPDATE media_objects m SET ref_count = m.ref_count + r.refs "
+          "  FROM (SELECT file_path, COUNT(*) AS refs FROM added "
+          "        GROUP BY file_path) r "
+          "  WHERE m.file_path = r.file_path "
+          ") "
+          "SELECT a.id, a.type, a.file_path, "
+          "       m.width, m.height, m.blurhash, m.variants::text AS variants "
+          "FROM added a "
+          "LEFT JOIN media_objects m ON m.file_path = a.file_path "
+          "ORDER BY a.id",
+          post.id, services::textArray(paths), services::textArray(types));
+      for (auto &attachment : rowsFrom<Attachment>(rows)) {
+        attachment.postId = post.id;
+        attachments.push_back(std::move(attachment));
+      }
+    }
+  }
+
+  // COMMIT уходит, когда отпущена последняя ссылка на транзакцию
+  if (!commitResult.get()) {
+    throw std::runtime_error("commit of post " + std::to_string(post.id) +
+                             " failed");
+  }
+  return post;
+}
+
+std::optional<Post> PgPostRepository::find(int64_t id) {
+  auto result = execSync(
+      db(),
+      "SELECT id, author_user_id, text, visibility, created_at, updated_at "
+      "FROM posts WHERE id = $1",
+      id);
+  if (result.empty()) {
+    return std::nullopt;
+  }
+  return std::move(rowsFrom<Post>(result).front());
+}
+
+std::optional<int64_t> PgPostRepository::author(int64_t id) {
+  auto result = execSync(
+      db(), "SELECT author_user_id FROM posts WHERE id = $1", id);
+  if (result.empty()) {
+    return std::nullopt;
+  }
+  return result[0]["author_user_id"].as<int64_t>();
+}
+
+std::vector<Post> PgPostRepository::findMany(const std::vector<int64_t> &ids) {
+  if (ids.empty()) {
+    return {};
+  }
+  return rowsFrom<Post>(execSync(
+      db(),
+      "SELECT id, author_user_id, text, visibility, created_at, "
+      "updated_at FROM posts WHERE id = ANY($1::bigint[])",
+      services::bigintArray(ids)));
+}
+
+std::vector<Post> PgPostRepository::latestPublic(int limit, int offset) {
+  return rowsFrom<Post>(execSync(
+      db(),
+      "SELECT id, author_user_id, text, visibility, created_at, "
+      "updated_at FROM posts WHERE visibility = 'public' "
+      "ORDER BY created_at DESC LIMIT $1 OFFSET $2",
+      (int64_t)limit, (int64_t)offset));
+}
+
+std::vector<Post> PgPostRepository::byAuthor(int64_t authorId, int limit) {
+  if (limit == 0) {
+    return rowsFrom<Post>(
+        execSync(db(), "SELECT id, author_user_id, text, visibility, "
+                       "created_at, updated_at "
+                       "FROM posts "
+                       "WHERE author_user_id = $1 "
+                       "ORDER BY created_at DESC",
+                 authorId));
+  }
+  return rowsFrom<Post>(execSync(
+      db(),
+      "SELECT id, author_user_id, text, visibility, created_at, updated_at "
+      "FROM posts "
+      "WHERE author_user_id = $1 "
+      "ORDER BY created_at DESC "
+      "LIMIT $2",
+      authorId, (int64_t)limit));
+}
+
+std::vector<Post> PgPostRepository::feed(int64_t viewerId, int limit,
+                                         int offset) {
+  std::string sql =
+      "SELECT p.id, p.author_user_id, p.text, p.visibility, p.created_at, "
+      "p.updated_at, "
+      "       CASE WHEN p.author_user_id IN ( "
+      "            SELECT following_user_id FROM follows WHERE "
+      "follower_user_id = $1 "
+      "       ) THEN 0 ELSE 1 END AS follow_priority "
+      "FROM posts p "
+      "WHERE p.visibility = 'public' "
+      "  AND p.author_user_id <> $1 "
+      "ORDER BY follow_priority ASC, p.created_at DESC "
+      "LIMIT " +
+      std::to_string(limit) + " OFFSET " + std::to_string(offset);
+  return rowsFrom<Post>(execSync(db(), sql, viewerId));
+}
+
+std::vector<Post> PgPostRepository::search(const std::string &query,
+                                           int64_t viewerId, int limit,
+                                           int offset) {
+  std::string sql =
+      "SELECT p.id, p.author_user_id, p.text, p.visibility, p.created_at, "
+      "p.updated_at, "
+      "       ts_rank(to_tsvector('russian', coalesce(p.text, '')), "
+      "               websearch_to_tsquery('russian', $2)) as rank, "
+      "       CASE WHEN p.author_user_id IN ( "
+      "            SELECT following_user_id FROM follows WHERE "
+      "follower_user_id = $1 "
+      "       ) THEN 0 ELSE 1 END AS follow_priority "
+      "FROM posts p "
+      "WHERE p.visibility = 'public' "
+      "  AND to_tsvector('russian', coalesce(p.text, '')) @@ "
+      "websearch_to_tsquery('russian', $2) "
+      "ORDER BY follow_priority ASC, rank DESC, p.created_at DESC "
+      "LIMIT " +
+      std::to_string(limit) + " OFFSET " + std::to_string(offset);
+  return rowsFrom<Post>(execSync(db(), sql, viewerId, query));
+}
+
+void PgPostRepository::update(int64_t id, const PostUpdate &update) {
+  std::vector<std::string> updates;
+  std::vector<std::string> params;
+  int paramIndex = 1;
+
+  if (update.text) {
+    updates.push_back("text = $" + std::to_string(paramIndex++));
+    params.push_back(*update.text);
+  }
+  if (update.visibility) {
+    updates.push_back("visibility = $" + std::to_string(paramIndex++));
+    params.push_back(*update.visibility);
+  }
+  if (updates.empty()) {
+    return;
+  }
+  updates.push_back("updated_at = now()");
+
+  std::string sql = "UPDATE posts SET ";
+  for (size_t i = 0; i < updates.size(); ++i) {
+    sql += updates[i];
+    if (i < updates.size() - 1)
+      sql += ", ";
+  }
+  sql += " WHERE id = $" + std::to_string(paramIndex);
+
+  if (params.size() == 1) {
+    execSync(db(), sql, params[0], id);
+  } else if (params.size() == 2) {
+    execSync(db(), sql, params[0], params[1], id);
+  }
+}
+
+void PgPostRepository::remove(int64_t id) {
+  auto client = db();
+  execSync(
+      client,
+      "WITH removed AS ( "
+      "  DELETE FROM attachments WHERE post_id = $1 RETURNING file_path "
+      ") "
+      "UPDATE media_objects m SET ref_count = m.ref_count - r.refs "
+      "FROM (SELECT file_path, COUNT(*) AS refs FROM removed "
+      "      GROUP BY file_path) r "
+      "WHERE m.file_path = r.file_path",
+      id);
+  execSync(client, "DELETE FROM likes WHERE post_id = $1", id);
+  execSync(client, "DELETE FROM comments WHERE post_id = $1", id);
+  execSync(client, "DELETE FROM posts WHERE id = $1", id);
+}
+
+std::vector<Post> PgPostRepository::scanMeta(int64_t afterId, size_t limit) {
+  return rowsFrom<Post>(execSync(
+      db(),
+      "SELECT id, author_user_id, visibility, "
+      "       (extract(epoch FROM created_at) * 1000)::bigint AS created_ms "
+      "FROM posts WHERE id > $1 ORDER BY id LIMIT " +
+          std::to_string(limit),
+      afterId));
+}
+
+std::vector<int64_t> PgPostRepository::scanIds(int64_t afterId,
+                                               size_t limit) {
+  auto result = execSync(db(), "SELECT id FROM posts WHERE id > $1 "
+                               "ORDER BY id LIMIT " +
+                                   std::to_string(limit),
+                         afterId);
+  std::vector<int64_t> ids;
+  ids.reserve(result.size());
+  for (const auto &row : result) {
+    ids.push_back(row["id"].as<int64_t>());
+  }
+  return ids;
+}
@@ -0,0 +1,466 @@
+#include "PgRepositories.h"
+#include "services/Metrics.h"
+#include "services/SqlArrays.h"
+#include <drogon/HttpAppFramework.h>
+#include <stdexcept>
+
+using namespace storage;
+using namespace storage::postgres;
+
+const char *const storage::postgres::kAttachmentsByPostSql =
+    "SELECT a.id, a.type, a.file_path, "
+    "       m.width, m.height, m.blurhash, m.variants::text AS variants "
+    "FROM attachments a "
+    "LEFT JOIN media_objects m ON m.file_path = a.file_path "
+    "WHERE a.post_id = $1";
+
+const char *const storage::postgres::kAttachmentsByPostsSql =
+    "SELECT a.post_id, a.id, a.type, a.file_path, "
+    "       m.width, m.height, m.blurhash, m.variants::text AS variants "
+    "FROM attachments a "
+    "LEFT JOIN media_objects m ON m.file_path = a.file_path "
+    "WHERE a.post_id = ANY($1::bigint[]) "
+    "ORDER BY a.post_id, a.id";
+
+namespace {
+
+drogon::orm::DbClientPtr db() { return drogon::app().getDbClient(); }
+
+} // namespace
+
+void storage::postgres::deadlineExceeded() {
+  static auto &exceeded = services::Metrics::instance().counter(
+      "db_deadline_exceeded_total",
+      "Database calls skipped or abandoned after the request deadline");
+  exceeded.fetch_add(1, std::memory_order_relaxed);
+  throw DeadlineExceeded();
+}
+
+std::optional<std::chrono::microseconds>
+storage::postgres::remainingDeadline() {
+  auto remaining = DeadlineScope::remaining();
+  if (remaining && remaining->count() <= 0) {
+    deadlineExceeded();
+  }
+  return remaining;
+}
+
+drogon::orm::Result
+storage::postgres::awaitResult(std::future<drogon::orm::Result> &&result) {
+  auto remaining = DeadlineScope::remaining();
+  if (remaining &&
+      result.wait_for(std::max(*remaining, std::chrono::microseconds(0))) !=
+          std::future_status::ready) {
+    deadlineExceeded();
+  }
+  return result.get();
+}
+
+Repositories &Repositories::instance() {
+  static PgRepositories repositories;
+  return repositories;
+}
+
+// Лайки
+
+void PgLikeRepository::like(int64_t postId, int64_t userId) {
+  execSync(db(), "INSERT INTO likes (post_id, user_id) VALUES ($1, $2) ON "
+                 "CONFLICT DO NOTHING",
+           postId, userId);
+}
+
+void PgLikeRepository::unlike(int64_t postId, int64_t userId) {
+  execSync(db(), "DELETE FROM likes WHERE post_id = $1 AND user_id = $2",
+           postId, userId);
+}
+
+int64_t PgLikeRepository::count(int64_t postId) {
+  auto result = execSync(
+      db(), "SELECT COUNT(*) as count FROM likes WHERE post_id = $1", postId);
+  return result[0]["count"].as<int64_t>();
+}
+
+bool PgLikeRepository::isLiked(int64_t postId, int64_t userId) {
+  return !execSync(db(),
+                   "SELECT 1 FROM likes WHERE post_id = $1 AND user_id = $2",
+                   postId, userId)
+              .empty();
+}
+
+LikeSummary PgLikeRepository::summary(int64_t postId, int64_t viewerId) {
+  auto result =
+      viewerId != 0
+          ? execSync(db(), "SELECT COUNT(*) as count, "
+                           "       SUM(CASE WHEN user_id = $1 THEN 1 ELSE "
+                           "0 END) as liked_by_me "
+                           "FROM likes WHERE post_id = $2",
+                     viewerId, postId)
+          : execSync(db(), "SELECT COUNT(*) as count, 0 as liked_by_me "
+                           "FROM likes WHERE post_id = $1",
+                     postId);
+  LikeSummary summary;
+  summary.count = result[0]["count"].as<int64_t>();
+  summary.likedByViewer = !result[0]["liked_by_me"].isNull() &&
+                          result[0]["liked_by_me"].as<int64_t>() > 0;
+  return summary;
+}
+
+// Комментарии
+
+std::vector<Comment> PgCommentRepository::byPost(int64_t postId) {
+  auto comments = rowsFrom<Comment>(
+      execSync(db(), "SELECT id, author_user_id, text, created_at "
+                     "FROM comments "
+                     "WHERE post_id = $1 ORDER BY created_at ASC",
+               postId));
+  for (auto &comment : comments) {
+    comment.postId = postId;
+  }
+  return comments;
+}
+
+Comment PgCommentRepository::create(int64_t postId, int64_t authorId,
+                                    const std::string &text) {
+  auto result =
+      execSync(db(), "INSERT INTO comments (post_id, author_user_id, text) "
+                     "VALUES ($1, $2, $3) RETURNING id, created_at",
+               postId, authorId, text);
+  auto comment = std::move(rowsFrom<Comment>(result).front());
+  comment.postId = postId;
+  comment.authorUserId = authorId;
+  comment.text = text;
+  return comment;
+}
+
+std::optional<Comment> PgCommentRepository::find(int64_t id) {
+  auto result = execSync(
+      db(), "SELECT author_user_id FROM comments WHERE id = $1", id);
+  if (result.empty()) {
+    return std::nullopt;
+  }
+  // Пока нужен только автор: проверка прав перед удалением
+  auto comment = std::move(rowsFrom<Comment>(result).front());
+  comment.id = id;
+  return comment;
+}
+
+void PgCommentRepository::remove(int64_t id) {
+  execSync(db(), "DELETE FROM comments WHERE id = $1", id);
+}
+
+int64_t PgCommentRepository::count(int64_t postId) {
+  auto result = execSync(
+      db(),
+      "SELECT COUNT(*) as count FROM comments WHERE post_id = $1", postId);
+  return result[0]["count"].as<int64_t>();
+}
+
+// Подписки
+
+void PgFollowRepository::follow(int64_t followerId, int64_t followingId) {
+  execSync(
+    db(),
+    "INSERT INTO follows (follower_user_id, following_user_id) "
+    "VALUES ($1, $2) ON CONFLICT DO NOTHING",
+    followerId, followingId
+  );
+}
+
+void PgFollowRepository::unfollow(int64_t followerId, int64_t followingId) {
+  execSync(
+    db(),
+    "DELETE FROM follows "
+    "WHERE follower_user_id = $1 AND following_user_id = $2",
+    followerId, followingId
+  );
+}
+
+bool PgFollowRepository::isFollowing(int64_t followerId,
+                                     int64_t followingId) {
+  return !execSync(db(),
+                   "SELECT 1 FROM follows WHERE follower_user_id = $1 AND "
+                   "following_user_id = $2",
+                   followerId, followingId)
+              .empty();
+}
+
+std::vector<int64_t> PgFollowRepository::following(int64_t userId) {
+  auto result = execSync(
+    db(), "SELECT following_user_id FROM follows WHERE follower_user_id = $1",
+    userId
+  );
+  std::vector<int64_t> ids;
+  ids.reserve(result.size());
+  for (const auto &row : result) {
+    ids.push_back(row["following_user_id"].as<int64_t>());
+  }
+  return ids;
+}
+
+void PgFollowRepository::followerIds(
+    int64_t userId, std::function<void(std::vector<int64_t>)> done,
+    std::function<void(const std::exception &)> fail) {
+  db()->execSqlAsync(
+      "SELECT follower_user_id FROM follows WHERE following_user_id = $1",
+      [done = std::move(done)](const drogon::orm::Result &result) {
+        std::vector<int64_t> ids;
+        ids.reserve(result.size());
+        for (const auto &row : result) {
+          ids.push_back(row["follower_user_id"].as<int64_t>());
+        }
+        done(std::move(ids));
+      },
+      [fail = std::move(fail)](const drogon::orm::DrogonDbException &e) {
+        fail(e.base());
+      },
+      userId);
+}
+
+std::vector<User> PgFollowRepository::followerProfiles(int64_t userId,
+                                                       int limit) {
+  if (limit == 0) {
+    return rowsFrom<User>(execSync(
+      db(),
+      "SELECT u.user_id, u.username, u.display_name, u.avatar_path "
+      "FROM users u "
+      "INNER JOIN follows f ON f.follower_user_id = u.user_id "
+      "WHERE f.following_user_id = $1 "
+      "ORDER BY f.created_at DESC",
+      userId
+    ));
+  }
+  return rowsFrom<User>(execSync(
+    db(),
+    "SELECT u.user_id, u.username, u.display_name, u.avatar_path "
+    "FROM users u "
+    "INNER JOIN follows f ON f.follower_user_id = u.user_id "
+    "WHERE f.following_user_id = $1 "
+    "ORDER BY f.created_at DESC "
+    "LIMIT $2",
+    userId, (int64_t)limit
+  ));
+}
+
+std::vector<User> PgFollowRepository::followingProfiles(int64_t userId) {
+  return rowsFrom<User>(execSync(
+    db(),
+    "SELECT u.user_id, u.username, u.display_name, u.avatar_path "
+    "FROM users u "
+    "INNER JOIN follows f ON f.following_user_id = u.user_id "
+    "WHERE f.follower_user_id = $1 "
+    "ORDER BY f.created_at DESC",
+    userId
+  ));
+}
+
+FollowCounts PgFollowRepository::counts(int64_t userId) {
+  auto result = execSync(
+      db(),
+      "SELECT "
+      "  (SELECT COUNT(*) FROM follows WHERE following_user_id = $1) "
+      "    AS followers_count, "
+      "  (SELECT COUNT(*) FROM follows WHERE follower_user_id = $1) "
+      "    AS following_count",
+      userId);
+
+  FollowCounts counts;
+  counts.followers = result[0]["followers_count"].as<int64_t>();
+  counts.following = result[0]["following_count"].as<int64_t>();
+  return counts;
+}
+
+// Пользователи
+
+std::vector<User>
+PgUserRepository::findMany(const std::vector<int64_t> &userIds) {
+  return rowsFrom<User>(execSync(
+      db(),
+      "SELECT user_id, username, display_name, bio, avatar_path, created_at "
+      "FROM users WHERE user_id = ANY($1::bigint[])",
+      services::bigintArray(userIds)));
+}
+
+bool PgUserRepository::exists(int64_t userId) {
+  return !execSync(
+      db(), "SELECT id FROM users WHERE user_id = $1",
+      userId
+    ).empty();
+}
+
+void PgUserRepository::create(const User &user) {
+  execSync(
+    db(),
+    "INSERT INTO users (user_id, username, display_name, bio) "
+    "VALUES ($1, $2, $3, $4)",
+    user.userId, user.username, user.displayName, user.bio
+  );
+}
+
+void PgUserRepository::update(int64_t userId, const ProfileUpdate &update) {
+  std::vector<std::string> updates;
+  std::vector<std::string> params;
+  int paramIndex = 1;
+
+  if (update.displayName) {
+    updates.push_back("display_name = $" + std::to_string(paramIndex++));
+    params.push_back(*update.displayName);
+  }
+  if (update.bio) {
+    updates.push_back("bio = $" + std::to_string(paramIndex++));
+    params.push_back(*update.bio);
+  }
+  if (update.avatarPath) {
+    updates.push_back("avatar_path = $" + std::to_string(paramIndex++));
+    params.push_back(*update.avatarPath);
+  }
+  if (updates.empty()) {
+    return;
+  }
+
+  std::string sql = "UPDATE users SET ";
+  for (size_t i = 0; i < updates.size(); ++i) {
+    sql += updates[i];
+    if (i < updates.size() - 1) sql += ", ";
+  }
+  sql += " WHERE user_id = $" + std::to_string(paramIndex);
+
+  if (params.size() == 1) {
+    execSync(db(), sql, params[0], userId);
+  } else if (params.size() == 2) {
+    execSync(db(), sql, params[0], params[1], userId);
+  } else if (params.size() == 3) {
+    execSync(db(), sql, params[0], params[1], params[2], userId);
+  }
+}
+
+std::vector<int64_t> PgUserRepository::scanIds(int64_t afterId,
+                                               size_t limit) {
+  auto result = execSync(db(), "SELECT user_id AS id FROM users "
+                               "WHERE user_id > $1 "
+                               "ORDER BY user_id LIMIT " +
+                                   std::to_string(limit),
+                         afterId);
+  std::vector<int64_t> ids;
+  ids.reserve(result.size());
+  for (const auto &row : result) {
+    ids.push_back(row["id"].as<int64_t>());
+  }
+  return ids;
+}
+
+// Вложения
+
+std::vector<Attachment> PgAttachmentRepository::byPost(int64_t postId) {
+  auto attachments =
+      rowsFrom<Attachment>(execSync(db(), kAttachmentsByPostSql, postId));
+  for (auto &attachment : attachments) {
+    attachment.postId = postId;
+  }
+  return attachments;
+}
+
+Attachment PgAttachmentRepository::add(int64_t postId, const std::string &type,
+                                       const std::string &filePath) {
+  // Вложение и ref_count одним запросом, как в PgPostRepository::create
+  auto result = execSync(
+      db(),
+      "WITH added AS ( "
+      "  INSERT INTO attachments (post_id, type, file_path) "
+      "  VALUES ($1, $2, $3) RETURNING id, created_at, file_path "
+      "), counted AS ( "
+      "  UPDATE media_objects m SET ref_count = m.ref_count + 1 "
+      "  FROM added a WHERE m.file_path = a.file_path "
+      ") "
+      "SELECT id, created_at FROM added",
+      postId, type, filePath);
+
+  auto attachment = std::move(rowsFrom<Attachment>(result).front());
+  attachment.postId = postId;
+  attachment.type = type;
+  attachment.filePath = filePath;
+  return attachment;
+}
+
+// Составные чтения
+
+PostExtras PgRepositories::extras(const std::vector<int64_t> &postIds,
+                                  int64_t viewerId) {
+  PostExtras extras;
+  if (postIds.empty()) {
+    return extras;
+  }
+  // Дедлайн уже прошёл — в пул не идём
+  remainingDeadline();
+  auto client = db();
+  auto idList = services::bigintArray(postIds);
+
+  // Три независимых запроса идут по разным соединениям пула
+  auto attachmentsFuture =
+      client->execSqlAsyncFuture(kAttachmentsByPostsSql, idList);
+  auto likesFuture = client->execSqlAsyncFuture(
+      "SELECT post_id, COUNT(*) AS count, "
+      "       COUNT(*) FILTER (WHERE user_id = $2) AS liked_by_me "
+      "FROM likes WHERE post_id = ANY($1::bigint[]) "
+      "GROUP BY post_id",
+      idList, viewerId);
+  auto commentsFuture = client->execSqlAsyncFuture(
+      "SELECT post_id, COUNT(*) AS count "
+      "FROM comments WHERE post_id = ANY($1::bigint[]) "
+      "GROUP BY post_id",
+      idList);
+
+  for (auto &attachment :
+       rowsFrom<Attachment>(awaitResult(std::move(attachmentsFuture)))) {
+    extras.attachments[attachment.postId].push_back(std::move(attachment));
+  }
+  for (const auto &row : awaitResult(std::move(likesFuture))) {
+    auto &likes = extras.likes[row["post_id"].as<int64_t>()];
+    likes.count = row["count"].as<int64_t>();
+    likes.likedByViewer = viewerId != 0 && row["liked_by_me"].as<int64_t>() > 0;
+  }
+  for (const auto &row : awaitResult(std::move(commentsFuture))) {
+    extras.comments[row["post_id"].as<int64_t>()] = row["count"].as<int64_t>();
+  }
+  return extras;
+}
+
+ProfileSlice PgRepositories::profileSlice(int64_t userId, int64_t viewerId,
+                                          int postsLimit,
+                                          int followersLimit) {
+  // Дедлайн уже прошёл — в пул не идём
+  remainingDeadline();
+  auto client = db();
+  auto postsFuture = client->execSqlAsyncFuture(
+    "SELECT id, author_user_id, text, visibility, created_at, updated_at "
+    "FROM posts "
+    "WHERE author_user_id = $1 "
+    "ORDER BY created_at DESC "
+    "LIMIT $2",
+    userId, (int64_t)postsLimit
+  );
+  auto followersFuture = client->execSqlAsyncFuture(
+    "SELECT u.user_id, u.username, u.display_name, u.avatar_path "
+    "FROM users u "
+    "INNER JOIN follows f ON f.follower_user_id = u.user_id "
+    "WHERE f.following_user_id = $1 "
+    "ORDER BY f.created_at DESC "
+    "LIMIT $2",
+    userId, (int64_t)followersLimit
+  );
+  auto followingFuture = client->execSqlAsyncFuture(
+    "SELECT 1 FROM follows "
+    "WHERE follower_user_id = $1 AND following_user_id = $2",
+    viewerId, userId
+  );
+
+  ProfileSlice slice;
+  slice.posts = rowsFrom<Post>(awaitResult(std::move(postsFuture)));
+  slice.followers = rowsFrom<User>(awaitResult(std::move(followersFuture)));
+  slice.isFollowing = !awaitResult(std::move(followingFuture)).empty();
+  return slice;
+}
+
+void PgRepositories::seed(const SeedOptions &) {
+  // Базу заполняет tools/datagen
+  throw std::logic_error("seeding is only supported by in-memory storage");
+}
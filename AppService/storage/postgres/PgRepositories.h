@@ -0,0 +1,167 @@
+#pragma once
+
+#include "storage/Deadline.h"
+#include "storage/Repositories.h"
+#include <chrono>
+#include <drogon/orm/DbClient.h>
+#include <future>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Репозитории поверх пула drogon::orm::DbClient (db_clients в
+// config.json). Запросы — те же, что раньше были в контроллерах;
+// их копии для проверки планов — в tests/plans/queries.json.
+namespace storage::postgres {
+
+// Вложения поста вместе с размерами, BlurHash и уменьшенными
+// вариантами из media_objects. Параметр $1 — id поста
+extern const char *const kAttachmentsByPostSql;
+// То же для страницы постов: $1 — bigint[] id постов, в строках есть
+// post_id, порядок — по посту, затем по id вложения
+extern const char *const kAttachmentsByPostsSql;
+
+// Строки результата как Row (Post, Attachment, ...): имена колонок
+// сопоставляются с описанием Row один раз на результат, ячейки дальше
+// читаются по номеру без копии в промежуточную std::string
+template <typename Row>
+std::vector<Row> rowsFrom(const drogon::orm::Result &result) {
+  std::vector<Row> rows;
+  if (result.empty()) {
+    return rows;
+  }
+  rows.reserve(result.size());
+  RowDecoder<Row> decoder(result.columns(), [&result](size_t i) {
+    return std::string_view(result.columnName(i));
+  });
+  for (const auto &row : result) {
+    rows.push_back(decoder.decode(
+        [&row](int i) -> std::optional<std::string_view> {
+          auto field = row[i];
+          if (field.isNull()) {
+            return std::nullopt;
+          }
+          return std::string_view(field.c_str(), field.length());
+        }));
+  }
+  return rows;
+}
+
+// Считает отказ в db_deadline_exceeded_total и бросает DeadlineExceeded
+[[noreturn]] void deadlineExceeded();
+
+// Остаток дедлайна запроса (storage/Deadline.h); если он уже прошёл —
+// deadlineExceeded(), и работа в пул не уходит. nullopt — дедлайна нет
+std::optional<std::chrono::microseconds> remainingDeadline();
+
+// Ответ пула, но не дольше остатка дедлайна. Отозвать из очереди пула
+// уже отправленный запрос drogon не даёт: он доработает или снимется
+// по timeout пула, а ответа уже никто не ждёт
+drogon::orm::Result awaitResult(std::future<drogon::orm::Result> &&result);
+
+// execSqlSync с дедлайном запроса; без дедлайна — по общему timeout
+// пула, как раньше
+template <typename... Args>
+drogon::orm::Result execSync(const drogon::orm::DbClientPtr &client,
+                             const std::string &sql, Args &&...args) {
+  if (!remainingDeadline()) {
+    return client->execSqlSync(sql, std::forward<Args>(args)...);
+  }
+  return awaitResult(
+      client->execSqlAsyncFuture(sql, std::forward<Args>(args)...));
+}
+
+class PgPostRepository : public PostRepository {
+public:
+  Post create(int64_t authorId, const std::string &text,
+              const std::string &visibility,
+              const std::vector<NewAttachment> &newAttachments,
+              std::vector<Attachment> &attachments) override;
+  std::optional<Post> find(int64_t id) override;
+  std::optional<int64_t> author(int64_t id) override;
+  std::vector<Post> findMany(const std::vector<int64_t> &ids) override;
+  std::vector<Post> latestPublic(int limit, int offset) override;
+  std::vector<Post> byAuthor(int64_t authorId, int limit) override;
+  std::vector<Post> feed(int64_t viewerId, int limit, int offset) override;
+  std::vector<Post> search(const std::string &query, int64_t viewerId,
+                           int limit, int offset) override;
+  void update(int64_t id, const PostUpdate &update) override;
+  void remove(int64_t id) override;
+  std::vector<Post> scanMeta(int64_t afterId, size_t limit) override;
+  std::vector<int64_t> scanIds(int64_t afterId, size_t limit) override;
+};
+
+class PgLikeRepository : public LikeRepository {
+public:
+  void like(int64_t postId, int64_t userId) override;
+  void unlike(int64_t postId, int64_t userId) override;
+  int64_t count(int64_t postId) override;
+  bool isLiked(int64_t postId, int64_t userId) override;
+  LikeSummary summary(int64_t postId, int64_t viewerId) override;
+};
+
+class PgCommentRepository : public CommentRepository {
+public:
+  std::vector<Comment> byPost(int64_t postId) override;
+  Comment create(int64_t postId, int64_t authorId,
+                 const std::string &text) override;
+  std::optional<Comment> find(int64_t id) override;
+  void remove(int64_t id) override;
+  int64_t count(int64_t postId) override;
+};
+
+class PgFollowRepository : public FollowRepository {
+public:
+  void follow(int64_t followerId, int64_t followingId) override;
+  void unfollow(int64_t followerId, int64_t followingId) override;
+  bool isFollowing(int64_t followerId, int64_t followingId) override;
+  std::vector<int64_t> following(int64_t userId) override;
+  void followerIds(int64_t userId,
+                   std::function<void(std::vector<int64_t>)> done,
+                   std::function<void(const std::exception &)> fail) override;
+  std::vector<User> followerProfiles(int64_t userId, int limit) override;
+  std::vector<User> followingProfiles(int64_t userId) override;
+  FollowCounts counts(int64_t userId) override;
+};
+
+class PgUserRepository : public UserRepository {
+public:
+  std::vector<User> findMany(const std::vector<int64_t> &userIds) override;
+  bool exists(int64_t userId) override;
+  void create(const User &user) override;
+  void update(int64_t userId, const ProfileUpdate &update) override;
+  std::vector<int64_t> scanIds(int64_t afterId, size_t limit) override;
+};
+
+class PgAttachmentRepository : public AttachmentRepository {
+public:
+  std::vector<Attachment> byPost(int64_t postId) override;
+  Attachment add(int64_t postId, const std::string &type,
+                 const std::string &filePath) override;
+};
+
+class PgRepositories : public Repositories {
+public:
+  PostRepository &posts() override { return posts_; }
+  LikeRepository &likes() override { return likes_; }
+  CommentRepository &comments() override { return comments_; }
+  FollowRepository &follows() override { return follows_; }
+  UserRepository &users() override { return users_; }
+  AttachmentRepository &attachments() override { return attachments_; }
+
+  PostExtras extras(const std::vector<int64_t> &postIds,
+                    int64_t viewerId) override;
+  ProfileSlice profileSlice(int64_t userId, int64_t viewerId, int postsLimit,
+                            int followersLimit) override;
+  void seed(const SeedOptions &options) override;
+
+private:
+  PgPostRepository posts_;
+  PgLikeRepository likes_;
+  PgCommentRepository comments_;
+  PgFollowRepository follows_;
+  PgUserRepository users_;
+  PgAttachmentRepository attachments_;
+};
+
+} // namespace storage::postgres
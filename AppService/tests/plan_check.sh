@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+# Проверка планов запросов на локальном Postgres: пересоздаёт базу
+# PLAN_DB, применяет миграции, заполняет её datagen с фиксированным
+# seed и запускает plancheck против tests/plans/baseline.json.
+# Аргументы передаются plancheck: --update, --only TEXT, --verbose.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BUILD_DIR="${BUILD_DIR:-${ROOT}/build}"
+PLAN_DB="${PLAN_DB:-app_service_plans}"
+PLAN_USERS="${PLAN_USERS:-20k}"
+# 1 — не пересоздавать базу, если она уже заполнена
+PLAN_REUSE_DB="${PLAN_REUSE_DB:-0}"
+
+export PGHOST="${PGHOST:-127.0.0.1}"
+export PGPORT="${PGPORT:-5433}"
+export PGUSER="${PGUSER:-root}"
+export PGPASSWORD="${PGPASSWORD:-12341234}"
+
+CONNINFO="host=${PGHOST} port=${PGPORT} dbname=${PLAN_DB} user=${PGUSER} password=${PGPASSWORD}"
+BASELINE="${ROOT}/tests/plans/baseline.json"
+
+for tool in datagen plancheck; do
+  if [ ! -x "${BUILD_DIR}/${tool}" ]; then
+    echo "${BUILD_DIR}/${tool} not found, build it first:"
+    echo "  cmake -S . -B build -DAPP_BUILD_TOOLS=ON && cmake --build build --target ${tool}"
+    exit 2
+  fi
+done
+
+exists=$(psql -d postgres -tAc "SELECT 1 FROM pg_database WHERE datname = '${PLAN_DB}'")
+if [ "${PLAN_REUSE_DB}" != "1" ] || [ "${exists}" != "1" ]; then
+  echo "Seeding ${PLAN_DB} (${PLAN_USERS} users, seed 1)"
+  psql -d postgres -v ON_ERROR_STOP=1 -q \
+    -c "DROP DATABASE IF EXISTS ${PLAN_DB}" \
+    -c "CREATE DATABASE ${PLAN_DB}"
+  for migration in "${ROOT}"/migrations/*.sql; do
+    psql -d "${PLAN_DB}" -v ON_ERROR_STOP=1 -q -f "${migration}"
+  done
+  # Один поток: порядок строк, а с ним id и физическое размещение,
+  # не зависит от числа ядер
+  "${BUILD_DIR}/datagen" --users "${PLAN_USERS}" --seed 1 --threads 1 \
+    --app-db "${CONNINFO}"
+  # Выборка ANALYZE случайна; с большей выборкой статистика, а с ней
+  # и планы, от прогона к прогону не меняются
+  psql -d "${PLAN_DB}" -v ON_ERROR_STOP=1 -q \
+    -c "SET default_statistics_target = 1000" -c "VACUUM ANALYZE"
+fi
+
+if [ ! -f "${BASELINE}" ] && [[ " $* " != *" --update "* ]]; then
+  echo "No baseline yet, writing ${BASELINE}"
+  set -- "$@" --update
+fi
+
+"${BUILD_DIR}/plancheck" "${ROOT}/tests/plans/queries.json" \
+  --db "${CONNINFO}" --baseline "${BASELINE}" "$@"
@@ -71,5 +71,31 @@ if [ "${status}" -ne 200 ] && [ "${status}" -ne 204 ]; then
   fail "expected CORS status 200/204, got ${status}"
 fi
 
+echo "9) GET /metrics (Prometheus text format)"
+body=$(curl -s "${BASE_URL}/metrics") || fail "request to /metrics failed"
+if ! grep -q "profile_cache_hits_total" <<< "${body}"; then
+  fail "expected profile_cache_hits_total in /metrics output"
+fi
+
+echo "10) GET /media/... for a missing file and a path escaping uploads/"
+status=$(curl -s -o /dev/null -w "%{http_code}" "${BASE_URL}/media/00/00/missing.jpg") || fail "request to /media failed"
+echo "   HTTP status: ${status}"
+if [ "${status}" -ne 404 ]; then
+  fail "expected status 404 for a missing media file, got ${status}"
+fi
+status=$(curl -s -o /dev/null -w "%{http_code}" --path-as-is "${BASE_URL}/media/../config.json") || fail "request to /media failed"
+echo "   HTTP status: ${status}"
+if [ "${status}" -ne 404 ]; then
+  fail "expected status 404 for a path outside uploads/, got ${status}"
+fi
+
+echo "11) POST /media/uploads without token (resumable upload requires auth)"
+status=$(curl -s -o /dev/null -w "%{http_code}" -X POST "${BASE_URL}/media/uploads" \
+  -H "Upload-Length: 10") || fail "request to /media/uploads failed"
+echo "   HTTP status: ${status}"
+if [ "${status}" -ne 401 ]; then
+  fail "expected status 401 for POST /media/uploads without token, got ${status}"
+fi
+
 echo
 echo "All smoke tests passed ✔"
@@ -0,0 +1,188 @@
+#include "CopyWriter.h"
+#include <libpq-fe.h>
+#include <stdexcept>
+
+using namespace datagen;
+
+namespace {
+
+constexpr size_t kFlushBytes = 1 << 20;
+
+// 2000-01-01 — эпоха timestamp в Postgres
+constexpr int64_t kPostgresEpochUs = 946684800LL * 1000000;
+
+std::string lastError(PGconn *conn) {
+  std::string message = PQerrorMessage(conn);
+  while (!message.empty() && message.back() == '\n') {
+    message.pop_back();
+  }
+  return message;
+}
+
+} // namespace
+
+Connection::Connection(const std::string &conninfo)
+    : conn_(PQconnectdb(conninfo.c_str())) {
+  if (PQstatus(conn_) != CONNECTION_OK) {
+    auto message = lastError(conn_);
+    PQfinish(conn_);
+    throw std::runtime_error("connect failed: " + message);
+  }
+}
+
+Connection::~Connection() { PQfinish(conn_); }
+
+void Connection::exec(const std::string &sql) {
+  PGresult *result = PQexec(conn_, sql.c_str());
+  auto status = PQresultStatus(result);
+  PQclear(result);
+  if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+    throw std::runtime_error(sql + ": " + lastError(conn_));
+  }
+}
+
+std::vector<std::vector<std::string>>
+Connection::query(const std::string &sql) {
+  PGresult *result = PQexec(conn_, sql.c_str());
+  if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+    PQclear(result);
+    throw std::runtime_error(sql + ": " + lastError(conn_));
+  }
+  std::vector<std::vector<std::string>> rows(PQntuples(result));
+  for (int i = 0; i < PQntuples(result); ++i) {
+    for (int j = 0; j < PQnfields(result); ++j) {
+      rows[i].emplace_back(PQgetvalue(result, i, j),
+                           PQgetlength(result, i, j));
+    }
+  }
+  PQclear(result);
+  return rows;
+}
+
+CopySink::CopySink(Connection &conn, const std::string &statement)
+    : conn_(conn) {
+  PGresult *result = PQexec(conn_.raw(), statement.c_str());
+  auto status = PQresultStatus(result);
+  PQclear(result);
+  if (status != PGRES_COPY_IN) {
+    throw std::runtime_error(statement + ": " + lastError(conn_.raw()));
+  }
+}
+
+void CopySink::write(const char *data, size_t size) {
+  if (PQputCopyData(conn_.raw(), data, static_cast<int>(size)) != 1) {
+    throw std::runtime_error("COPY: " + lastError(conn_.raw()));
+  }
+}
+
+void CopySink::finish() {
+  if (PQputCopyEnd(conn_.raw(), nullptr) != 1) {
+    throw std::runtime_error("COPY: " + lastError(conn_.raw()));
+  }
+  std::string error;
+  while (PGresult *result = PQgetResult(conn_.raw())) {
+    if (PQresultStatus(result) != PGRES_COMMAND_OK && error.empty()) {
+      error = lastError(conn_.raw());
+    }
+    PQclear(result);
+  }
+  if (!error.empty()) {
+    throw std::runtime_error("COPY: " + error);
+  }
+}
+
+FileSink::FileSink(const std::string &path)
+    : path_(path), file_(std::fopen(path.c_str(), "wb")) {
+  if (!file_) {
+    throw std::runtime_error("cannot open " + path);
+  }
+}
+
+FileSink::~FileSink() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+void FileSink::write(const char *data, size_t size) {
+  if (std::fwrite(data, 1, size, file_) != size) {
+    throw std::runtime_error("write failed: " + path_);
+  }
+}
+
+void FileSink::finish() {
+  bool failed = std::fclose(file_) != 0;
+  file_ = nullptr;
+  if (failed) {
+    throw std::runtime_error("write failed: " + path_);
+  }
+}
+
+CopyWriter::CopyWriter(Sink &sink) : sink_(sink) {
+  buffer_.reserve(kFlushBytes + 64 * 1024);
+  buffer_.append("PGCOPY\n\377\r\n\0", 11);
+  // Флаги и длина расширения заголовка
+  put32(0);
+  put32(0);
+}
+
+void CopyWriter::row(uint16_t fields) {
+  maybeFlush();
+  put16(fields);
+}
+
+void CopyWriter::int32(int32_t value) {
+  put32(4);
+  put32(static_cast<uint32_t>(value));
+}
+
+void CopyWriter::int64(int64_t value) {
+  put32(8);
+  put64(static_cast<uint64_t>(value));
+}
+
+void CopyWriter::text(std::string_view value) {
+  put32(static_cast<uint32_t>(value.size()));
+  buffer_.append(value);
+}
+
+void CopyWriter::null() { put32(0xFFFFFFFF); }
+
+void CopyWriter::timestamp(int64_t unixMicros) {
+  int64(unixMicros - kPostgresEpochUs);
+}
+
+void CopyWriter::finish() {
+  put16(0xFFFF);
+  sink_.write(buffer_.data(), buffer_.size());
+  buffer_.clear();
+  sink_.finish();
+}
+
+void CopyWriter::put16(uint16_t value) {
+  char bytes[2] = {static_cast<char>(value >> 8), static_cast<char>(value)};
+  buffer_.append(bytes, 2);
+}
+
+void CopyWriter::put32(uint32_t value) {
+  char bytes[4];
+  for (int i = 0; i < 4; ++i) {
+    bytes[i] = static_cast<char>(value >> (24 - 8 * i));
+  }
+  buffer_.append(bytes, 4);
+}
+
+void CopyWriter::put64(uint64_t value) {
+  char bytes[8];
+  for (int i = 0; i < 8; ++i) {
+    bytes[i] = static_cast<char>(value >> (56 - 8 * i));
+  }
+  buffer_.append(bytes, 8);
+}
+
+void CopyWriter::maybeFlush() {
+  if (buffer_.size() >= kFlushBytes) {
+    sink_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+}
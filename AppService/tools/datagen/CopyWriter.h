@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct pg_conn;
+
+namespace datagen {
+
+// Соединение libpq; ошибки — исключения std::runtime_error
+class Connection {
+public:
+  explicit Connection(const std::string &conninfo);
+  ~Connection();
+  Connection(const Connection &) = delete;
+  Connection &operator=(const Connection &) = delete;
+
+  void exec(const std::string &sql);
+  std::vector<std::vector<std::string>> query(const std::string &sql);
+
+  pg_conn *raw() { return conn_; }
+
+private:
+  pg_conn *conn_;
+};
+
+// Куда уходят байты COPY: в открытый COPY FROM STDIN или в файл
+class Sink {
+public:
+  virtual ~Sink() = default;
+  virtual void write(const char *data, size_t size) = 0;
+  virtual void finish() = 0;
+};
+
+class CopySink : public Sink {
+public:
+  // statement — "COPY t (cols) FROM STDIN (FORMAT binary)"
+  CopySink(Connection &conn, const std::string &statement);
+  void write(const char *data, size_t size) override;
+  void finish() override;
+
+private:
+  Connection &conn_;
+};
+
+class FileSink : public Sink {
+public:
+  explicit FileSink(const std::string &path);
+  ~FileSink() override;
+  void write(const char *data, size_t size) override;
+  void finish() override;
+
+private:
+  std::string path_;
+  FILE *file_;
+};
+
+// Бинарный формат COPY: заголовок, строки (число полей, затем длина и
+// байты каждого поля в сетевом порядке), завершающий -1
+class CopyWriter {
+public:
+  explicit CopyWriter(Sink &sink);
+
+  void row(uint16_t fields);
+  void int32(int32_t value);
+  void int64(int64_t value);
+  void text(std::string_view value);
+  void null();
+  // Микросекунды Unix-времени; timestamp без часового пояса
+  void timestamp(int64_t unixMicros);
+
+  void finish();
+
+private:
+  void put16(uint16_t value);
+  void put32(uint32_t value);
+  void put64(uint64_t value);
+  void maybeFlush();
+
+  Sink &sink_;
+  std::string buffer_;
+};
+
+} // namespace datagen
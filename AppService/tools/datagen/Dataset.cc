@@ -0,0 +1,404 @@
+#include "Dataset.h"
+#include "Random.h"
+#include "Text.h"
+
+using namespace datagen;
+
+uint64_t Scale::posts() const {
+  return static_cast<uint64_t>(users * postsPerUser + 0.5);
+}
+
+namespace {
+
+// Независимые потоки случайных чисел (Rng stream)
+enum Stream : uint64_t {
+  kPersonStream = 1,
+  kPostStream,
+  kFollowStream,
+  kLikeStream,
+  kCommentStream,
+  kAttachmentStream,
+};
+
+constexpr int64_t kDayUs = 86400LL * 1000000;
+
+// Всё, что нужно таблицам для согласованных между собой строк: автор
+// поста в posts и его же пост в likes выводятся из одних формул
+class Model {
+public:
+  explicit Model(const Scale &scale)
+      : scale(scale), users(scale.users), posts(scale.posts()),
+        windowUs(scale.days * kDayUs), startUs(scale.untilUs - windowUs),
+        userRanks(users, scale.seed ^ kPersonStream),
+        postRanks(posts, scale.seed ^ kPostStream),
+        authors(std::max<uint64_t>(users, 1), scale.skew),
+        followers(users, scale.skew, scale.followsPerUser * users),
+        likes(posts, scale.skew, scale.likesPerPost * posts),
+        comments(posts, scale.skew, scale.commentsPerPost * posts) {}
+
+  // Пользователи с id 1..users
+  int64_t userCreatedUs(uint64_t user) const {
+    return startUs - windowUs +
+           static_cast<int64_t>(static_cast<double>(user) / users * windowUs);
+  }
+
+  // Порядок id постов совпадает с порядком created_at
+  int64_t postCreatedUs(uint64_t post) const {
+    return startUs + static_cast<int64_t>((post + 0.5) * windowUs / posts);
+  }
+
+  // Реакции в основном в первые часы после поста
+  int64_t reactionUs(Rng &rng, uint64_t post) const {
+    auto createdUs = postCreatedUs(post);
+    double u = rng.uniform();
+    return createdUs +
+           static_cast<int64_t>((scale.untilUs - createdUs) * u * u * u);
+  }
+
+  uint64_t postAuthor(Rng &rng) const {
+    return userRanks(authors(rng) - 1) + 1;
+  }
+
+  // Сколько лайков (комментариев) у поста: по рангу его популярности
+  double meanLikes(uint64_t post) const {
+    return likes.mean(postRanks(post) + 1);
+  }
+  double meanComments(uint64_t post) const {
+    return comments.mean(postRanks(post) + 1);
+  }
+
+  Scale scale;
+  uint64_t users;
+  uint64_t posts;
+  int64_t windowUs;
+  int64_t startUs;
+  Permutation userRanks;
+  Permutation postRanks;
+  ZipfSampler authors;
+  ZipfCounts followers;
+  ZipfCounts likes;
+  ZipfCounts comments;
+};
+
+class ModelTable : public Table {
+public:
+  explicit ModelTable(std::shared_ptr<const Model> model)
+      : model_(std::move(model)) {}
+
+protected:
+  template <typename Row>
+  uint64_t forChunk(uint64_t chunk, Row &&row) const {
+    uint64_t rows = 0;
+    auto end = std::min(parents(), (chunk + 1) * kChunk);
+    for (uint64_t i = chunk * kChunk; i < end; ++i) {
+      rows += row(i);
+    }
+    return rows;
+  }
+
+  std::shared_ptr<const Model> model_;
+};
+
+class AuthUsers : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "users"; }
+  Database database() const override { return Database::kAuth; }
+  const char *columns() const override {
+    return "(id, name, login, password, created_at)";
+  }
+  uint64_t parents() const override { return model_->users; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    return forChunk(chunk, [&](uint64_t i) {
+      Rng rng(model_->scale.seed, kPersonStream, i);
+      auto person = makePerson(rng, i + 1);
+      out.row(5);
+      // В AuthService id — serial (int4)
+      out.int32(static_cast<int32_t>(i + 1));
+      out.text(person.name);
+      out.text(person.login);
+      out.text(model_->scale.passwordHash);
+      out.timestamp(model_->userCreatedUs(i));
+      return 1;
+    });
+  }
+};
+
+class AppUsers : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "users"; }
+  Database database() const override { return Database::kApp; }
+  const char *columns() const override {
+    return "(id, user_id, username, display_name, bio, avatar_path, "
+           "created_at)";
+  }
+  uint64_t parents() const override { return model_->users; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    return forChunk(chunk, [&](uint64_t i) {
+      // Тот же поток, что у AuthUsers: имя и логин совпадают
+      Rng rng(model_->scale.seed, kPersonStream, i);
+      auto person = makePerson(rng, i + 1);
+      auto bio = makeBio(rng);
+      out.row(7);
+      out.int64(static_cast<int64_t>(i + 1));
+      out.int64(static_cast<int64_t>(i + 1));
+      out.text(person.login);
+      out.text(person.name);
+      if (bio.empty()) {
+        out.null();
+      } else {
+        out.text(bio);
+      }
+      out.null();
+      out.timestamp(model_->userCreatedUs(i));
+      return 1;
+    });
+  }
+};
+
+class Posts : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "posts"; }
+  Database database() const override { return Database::kApp; }
+  const char *columns() const override {
+    return "(id, author_user_id, text, visibility, created_at, updated_at)";
+  }
+  uint64_t parents() const override { return model_->posts; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    std::string text;
+    return forChunk(chunk, [&](uint64_t i) {
+      Rng rng(model_->scale.seed, kPostStream, i);
+      auto author = model_->postAuthor(rng);
+      bool isPrivate = rng.chance(model_->scale.privateShare);
+      text.clear();
+      makePostText(rng, text);
+      auto createdUs = model_->postCreatedUs(i);
+      out.row(6);
+      out.int64(static_cast<int64_t>(i + 1));
+      out.int64(static_cast<int64_t>(author));
+      out.text(text);
+      out.text(isPrivate ? "private" : "public");
+      out.timestamp(createdUs);
+      out.timestamp(createdUs);
+      return 1;
+    });
+  }
+};
+
+// Пачки по рангу популярности того, на кого подписываются: число
+// подписчиков — по Ципфу, сами подписчики — случайные без повторов
+class Follows : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "follows"; }
+  Database database() const override { return Database::kApp; }
+  const char *columns() const override {
+    return "(follower_user_id, following_user_id, created_at)";
+  }
+  uint64_t parents() const override { return model_->users; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    return forChunk(chunk, [&](uint64_t rank) {
+      Rng rng(model_->scale.seed, kFollowStream, rank);
+      auto following = model_->userRanks(rank);
+      auto others = model_->users - 1;
+      uint64_t rows = 0;
+      sampleSorted(rng, others, model_->followers.mean(rank + 1),
+                   [&](uint64_t i) {
+                     auto follower = i < following ? i : i + 1;
+                     out.row(3);
+                     out.int64(static_cast<int64_t>(follower + 1));
+                     out.int64(static_cast<int64_t>(following + 1));
+                     out.timestamp(model_->startUs +
+                                   static_cast<int64_t>(rng.uniform() *
+                                                        model_->windowUs));
+                     ++rows;
+                   });
+      return rows;
+    });
+  }
+};
+
+class Likes : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "likes"; }
+  Database database() const override { return Database::kApp; }
+  const char *columns() const override {
+    return "(post_id, user_id, created_at)";
+  }
+  uint64_t parents() const override { return model_->posts; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    return forChunk(chunk, [&](uint64_t post) {
+      Rng rng(model_->scale.seed, kLikeStream, post);
+      uint64_t rows = 0;
+      sampleSorted(rng, model_->users, model_->meanLikes(post),
+                   [&](uint64_t user) {
+                     out.row(3);
+                     out.int64(static_cast<int64_t>(post + 1));
+                     out.int64(static_cast<int64_t>(user + 1));
+                     out.timestamp(model_->reactionUs(rng, post));
+                     ++rows;
+                   });
+      return rows;
+    });
+  }
+};
+
+class Comments : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "comments"; }
+  Database database() const override { return Database::kApp; }
+  const char *columns() const override {
+    return "(post_id, author_user_id, text, created_at)";
+  }
+  uint64_t parents() const override { return model_->posts; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    std::string text;
+    return forChunk(chunk, [&](uint64_t post) {
+      Rng rng(model_->scale.seed, kCommentStream, post);
+      auto count = rng.round(model_->meanComments(post));
+      for (uint64_t i = 0; i < count; ++i) {
+        text.clear();
+        makeCommentText(rng, text);
+        out.row(4);
+        out.int64(static_cast<int64_t>(post + 1));
+        out.int64(static_cast<int64_t>(rng.below(model_->users) + 1));
+        out.text(text);
+        out.timestamp(model_->reactionUs(rng, post));
+      }
+      return count;
+    });
+  }
+};
+
+struct Attachment {
+  bool video;
+  std::string digest;
+  std::string filePath;
+  int64_t sizeBytes;
+  int width;
+  int height;
+};
+
+// Вложения поста для attachments и media_objects — одна и та же
+// последовательность; у каждого вложения свой файл
+template <typename Visit>
+void forAttachments(const Model &model, uint64_t post, Visit &&visit) {
+  Rng rng(model.scale.seed, kAttachmentStream, post);
+  if (!rng.chance(model.scale.attachmentShare)) {
+    return;
+  }
+  auto count = rng.chance(0.7) ? 1 : 2 + rng.below(3);
+  static const char kHex[] = "0123456789abcdef";
+  for (uint64_t i = 0; i < count; ++i) {
+    Attachment attachment;
+    attachment.video = rng.chance(0.15);
+    attachment.digest.resize(64);
+    for (size_t j = 0; j < 64; j += 16) {
+      auto bits = rng.next();
+      for (size_t k = 0; k < 16; ++k) {
+        attachment.digest[j + k] = kHex[(bits >> (4 * k)) & 15];
+      }
+    }
+    // Как MediaStore::objectPath
+    attachment.filePath = "uploads/" + attachment.digest.substr(0, 2) + "/" +
+                          attachment.digest.substr(2, 2) + "/" +
+                          attachment.digest +
+                          (attachment.video ? ".mp4" : ".jpg");
+    attachment.sizeBytes = static_cast<int64_t>(
+        rng.lognormal(attachment.video ? 8e6 : 4e5, 0.8));
+    bool portrait = rng.chance(0.4);
+    attachment.width = portrait ? 1080 : 1920;
+    attachment.height = portrait ? 1920 : 1080;
+    visit(attachment);
+  }
+}
+
+class Attachments : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "attachments"; }
+  Database database() const override { return Database::kApp; }
+  const char *columns() const override {
+    return "(post_id, type, file_path, created_at)";
+  }
+  uint64_t parents() const override { return model_->posts; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    return forChunk(chunk, [&](uint64_t post) {
+      uint64_t rows = 0;
+      forAttachments(*model_, post, [&](const Attachment &attachment) {
+        out.row(4);
+        out.int64(static_cast<int64_t>(post + 1));
+        out.text(attachment.video ? "video" : "photo");
+        out.text(attachment.filePath);
+        out.timestamp(model_->postCreatedUs(post));
+        ++rows;
+      });
+      return rows;
+    });
+  }
+};
+
+// Самих файлов нет: строки нужны, чтобы запросы с JOIN media_objects
+// работали на реалистичных объёмах
+class MediaObjects : public ModelTable {
+public:
+  using ModelTable::ModelTable;
+  const char *name() const override { return "media_objects"; }
+  Database database() const override { return Database::kApp; }
+  const char *columns() const override {
+    return "(file_path, digest, size_bytes, ref_count, created_at, width, "
+           "height)";
+  }
+  const char *sequenceColumn() const override { return nullptr; }
+  uint64_t parents() const override { return model_->posts; }
+
+  uint64_t emit(uint64_t chunk, CopyWriter &out) const override {
+    return forChunk(chunk, [&](uint64_t post) {
+      uint64_t rows = 0;
+      forAttachments(*model_, post, [&](const Attachment &attachment) {
+        out.row(7);
+        out.text(attachment.filePath);
+        out.text(attachment.digest);
+        out.int64(attachment.sizeBytes);
+        out.int32(1);
+        out.timestamp(model_->postCreatedUs(post));
+        if (attachment.video) {
+          out.null();
+          out.null();
+        } else {
+          out.int32(attachment.width);
+          out.int32(attachment.height);
+        }
+        ++rows;
+      });
+      return rows;
+    });
+  }
+};
+
+} // namespace
+
+std::vector<std::unique_ptr<Table>> datagen::makeTables(const Scale &scale) {
+  auto model = std::make_shared<const Model>(scale);
+  std::vector<std::unique_ptr<Table>> tables;
+  tables.push_back(std::make_unique<AuthUsers>(model));
+  tables.push_back(std::make_unique<AppUsers>(model));
+  tables.push_back(std::make_unique<Posts>(model));
+  tables.push_back(std::make_unique<Follows>(model));
+  tables.push_back(std::make_unique<Likes>(model));
+  tables.push_back(std::make_unique<Comments>(model));
+  tables.push_back(std::make_unique<Attachments>(model));
+  tables.push_back(std::make_unique<MediaObjects>(model));
+  return tables;
+}
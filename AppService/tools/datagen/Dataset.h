@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CopyWriter.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datagen {
+
+struct Scale {
+  uint64_t users = 10000;
+  double postsPerUser = 10;
+  // Средние по всем; у популярных (по закону Ципфа) на порядки больше
+  double followsPerUser = 30;
+  double likesPerPost = 5;
+  double commentsPerPost = 1;
+  double attachmentShare = 0.2;
+  double privateShare = 0.05;
+  // Показатель закона Ципфа для подписчиков, лайков, комментариев и
+  // авторства постов
+  double skew = 0.9;
+  // Посты распределены по последним days дням до until, пользователи
+  // зарегистрированы за такой же срок до первого поста
+  int days = 365;
+  int64_t untilUs = 0;
+  uint64_t seed = 1;
+  // Один хэш на всех: bcrypt на каждую строку занял бы часы
+  std::string passwordHash;
+
+  uint64_t posts() const;
+};
+
+enum class Database { kApp, kAuth };
+
+// Таблица делится на пачки по номерам «родительских» сущностей: для
+// follows — пользователей, для likes и comments — постов. Пачки
+// независимы, и их можно грузить параллельно в любом порядке.
+//
+// id задаются явно у users (оба сервиса) и posts — на них ссылаются
+// остальные таблицы. У follows, likes, comments и attachments id
+// берутся из последовательности: содержимое строк воспроизводимо, а
+// нумерация зависит от того, как переплелись параллельные COPY.
+class Table {
+public:
+  virtual ~Table() = default;
+
+  virtual const char *name() const = 0;
+  virtual Database database() const = 0;
+  // "(col, col, ...)" для COPY
+  virtual const char *columns() const = 0;
+  // Столбец id, которому после загрузки нужен setval; nullptr — нет
+  virtual const char *sequenceColumn() const { return "id"; }
+
+  // Сколько родительских сущностей
+  virtual uint64_t parents() const = 0;
+  uint64_t chunks() const { return (parents() + kChunk - 1) / kChunk; }
+  // Возвращает число записанных строк
+  virtual uint64_t emit(uint64_t chunk, CopyWriter &out) const = 0;
+
+protected:
+  static constexpr uint64_t kChunk = 16384;
+};
+
+// В порядке загрузки
+std::vector<std::unique_ptr<Table>> makeTables(const Scale &scale);
+
+} // namespace datagen
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace datagen {
+
+inline uint64_t splitmix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Поток случайных чисел конкретной сущности: (seed, поток, номер).
+// Строка зависит только от своего номера, а не от порядка генерации,
+// поэтому результат не меняется от числа потоков и размера пачек.
+class Rng {
+public:
+  Rng(uint64_t seed, uint64_t stream, uint64_t index)
+      : state_(splitmix64(splitmix64(seed ^ (stream << 56)) ^ index)) {}
+
+  uint64_t next() {
+    state_ += 0x9E3779B97F4A7C15ULL;
+    uint64_t x = state_;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  // [0, 1)
+  double uniform() { return (next() >> 11) * 0x1.0p-53; }
+
+  // (0, 1] — для логарифмов
+  double positive() { return ((next() >> 11) + 1) * 0x1.0p-53; }
+
+  uint64_t below(uint64_t n) {
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(next()) * n) >>
+                                 64);
+  }
+
+  bool chance(double p) { return uniform() < p; }
+
+  double normal() {
+    return std::sqrt(-2 * std::log(positive())) *
+           std::cos(6.283185307179586 * uniform());
+  }
+
+  // Логнормальное с медианой median
+  double lognormal(double median, double sigma) {
+    return median * std::exp(sigma * normal());
+  }
+
+  // Вещественное x -> floor(x) или floor(x) + 1 с нужным средним
+  uint64_t round(double x) {
+    auto whole = std::floor(x);
+    return static_cast<uint64_t>(whole) + chance(x - whole);
+  }
+
+private:
+  uint64_t state_;
+};
+
+// Обобщённое гармоническое число sum_{k=1..n} k^-s: первые слагаемые
+// точно, хвост — интегралом (Эйлер — Маклорен)
+inline double harmonic(uint64_t n, double s) {
+  constexpr uint64_t kExact = 1 << 20;
+  double sum = 0;
+  for (uint64_t k = 1; k <= std::min(n, kExact); ++k) {
+    sum += std::pow(static_cast<double>(k), -s);
+  }
+  if (n > kExact) {
+    double a = kExact + 0.5, b = n + 0.5;
+    sum += std::abs(s - 1) < 1e-9
+               ? std::log(b / a)
+               : (std::pow(b, 1 - s) - std::pow(a, 1 - s)) / (1 - s);
+  }
+  return sum;
+}
+
+// Закон Ципфа для количеств: у элемента ранга r (с 1) в среднем
+// total / H(n, s) / r^s, суммарно total
+class ZipfCounts {
+public:
+  ZipfCounts(uint64_t n, double s, double total)
+      : s_(s), scale_(n ? total / harmonic(n, s) : 0) {}
+
+  double mean(uint64_t rank) const {
+    return scale_ * std::pow(static_cast<double>(rank), -s_);
+  }
+
+private:
+  double s_;
+  double scale_;
+};
+
+// Выборка ранга 1..n по закону Ципфа за O(1): rejection-inversion
+// (Hörmann, Derflinger, 1996)
+class ZipfSampler {
+public:
+  ZipfSampler(uint64_t n, double s) : n_(n), s_(s) {
+    hIntegralX1_ = hIntegral(1.5) - 1;
+    hIntegralN_ = hIntegral(n + 0.5);
+    threshold_ = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+  }
+
+  uint64_t operator()(Rng &rng) const {
+    while (true) {
+      double u = hIntegralN_ + rng.uniform() * (hIntegralX1_ - hIntegralN_);
+      double x = hIntegralInverse(u);
+      auto k = static_cast<uint64_t>(std::clamp(x + 0.5, 1.0,
+                                                static_cast<double>(n_)));
+      if (k - x <= threshold_ || u >= hIntegral(k + 0.5) - h(k)) {
+        return k;
+      }
+    }
+  }
+
+private:
+  double h(double x) const { return std::exp(-s_ * std::log(x)); }
+
+  double hIntegral(double x) const {
+    double logX = std::log(x);
+    return helper2((1 - s_) * logX) * logX;
+  }
+
+  double hIntegralInverse(double x) const {
+    double t = std::max(x * (1 - s_), -1.0);
+    return std::exp(helper1(t) * x);
+  }
+
+  // log1p(x) / x и expm1(x) / x без потери точности около нуля
+  static double helper1(double x) {
+    return std::abs(x) > 1e-8 ? std::log1p(x) / x
+                              : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+  }
+
+  static double helper2(double x) {
+    return std::abs(x) > 1e-8 ? std::expm1(x) / x
+                              : 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x));
+  }
+
+  uint64_t n_;
+  double s_;
+  double hIntegralX1_;
+  double hIntegralN_;
+  double threshold_;
+};
+
+// Биекция 0..n-1 -> 0..n-1: ранг популярности -> номер сущности, чтобы
+// популярные пользователи и посты не были просто первыми по id
+class Permutation {
+public:
+  Permutation(uint64_t n, uint64_t seed) : n_(std::max<uint64_t>(n, 1)) {
+    multiplier_ = (splitmix64(seed) % n_) | 1;
+    while (gcd(multiplier_, n_) != 1) {
+      multiplier_ += 2;
+    }
+    offset_ = splitmix64(seed + 1) % n_;
+  }
+
+  uint64_t operator()(uint64_t i) const {
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(i) * multiplier_ + offset_) % n_);
+  }
+
+private:
+  static uint64_t gcd(uint64_t a, uint64_t b) {
+    while (b) {
+      a %= b;
+      std::swap(a, b);
+    }
+    return a;
+  }
+
+  uint64_t n_;
+  uint64_t multiplier_;
+  uint64_t offset_;
+};
+
+// Случайное подмножество 0..n-1 без повторов, по возрастанию, в среднем
+// k элементов: пропуски между выбранными геометрические, O(k)
+template <typename Emit>
+void sampleSorted(Rng &rng, uint64_t n, double k, Emit &&emit) {
+  if (k <= 0 || n == 0) {
+    return;
+  }
+  if (k >= n) {
+    for (uint64_t i = 0; i < n; ++i) {
+      emit(i);
+    }
+    return;
+  }
+  double logQ = std::log1p(-k / n);
+  double position = -1;
+  while (true) {
+    position += 1 + std::floor(std::log(rng.positive()) / logQ);
+    if (position >= n) {
+      return;
+    }
+    emit(static_cast<uint64_t>(position));
+  }
+}
+
+} // namespace datagen
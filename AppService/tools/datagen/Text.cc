@@ -0,0 +1,188 @@
+#include "Text.h"
+#include <cctype>
+#include <string_view>
+
+using namespace datagen;
+
+namespace {
+
+const std::string_view kRussianWords[] = {
+    "и",         "в",          "не",        "на",        "я",
+    "что",       "он",         "с",         "это",       "как",
+    "а",         "по",         "но",        "мы",        "все",
+    "так",       "у",          "же",        "вот",       "из",
+    "за",        "уже",        "сегодня",   "вчера",     "завтра",
+    "день",      "время",      "город",     "работа",    "дом",
+    "друзья",    "жизнь",      "проект",    "код",       "книга",
+    "фильм",     "музыка",     "погода",    "утро",      "вечер",
+    "новый",     "хороший",    "большой",   "последний", "интересный",
+    "думаю",     "кажется",    "наконец",   "снова",     "очень",
+    "просто",    "сделал",     "прочитал",  "посмотрел", "написал",
+    "поехали",   "встретил",   "получилось", "нравится", "люблю",
+    "кофе",      "чай",        "море",      "лес",       "дорога",
+    "поезд",     "выходные",   "отпуск",    "фотография", "история",
+    "вопрос",    "ответ",      "идея",      "задача",    "релиз",
+    "сервер",    "база",       "данных",    "запрос",    "ошибка",
+    "команда",   "встреча",    "конференция", "доклад",  "статья",
+    "спасибо",   "всем",       "кто",       "пришёл",    "рекомендую",
+    "осень",     "зима",       "весна",     "лето",      "снег",
+    "солнце",    "дождь",      "кот",       "собака",    "парк",
+};
+
+const std::string_view kEnglishWords[] = {
+    "the",      "a",         "and",       "to",        "of",
+    "in",       "is",        "it",        "that",      "for",
+    "on",       "with",      "this",      "was",       "just",
+    "my",       "we",        "you",       "at",        "so",
+    "today",    "yesterday", "finally",   "again",     "really",
+    "new",      "great",     "little",    "first",     "last",
+    "day",      "week",      "time",      "city",      "home",
+    "work",     "project",   "code",      "release",   "server",
+    "book",     "movie",     "music",     "coffee",    "morning",
+    "evening",  "weekend",   "trip",      "train",     "photo",
+    "friends",  "team",      "meeting",   "talk",      "article",
+    "think",    "love",      "shipped",   "wrote",     "read",
+    "watched",  "started",   "learned",   "fixed",     "broke",
+    "database", "query",     "bug",       "feature",   "deploy",
+    "thanks",   "everyone",  "who",       "came",      "recommend",
+    "autumn",   "winter",    "spring",    "summer",    "rain",
+    "sun",      "cat",       "dog",       "park",      "beach",
+};
+
+// Сначала женские: у них фамилия с окончанием "а"
+constexpr size_t kRussianFemaleNames = 9;
+const std::string_view kRussianFirstNames[] = {
+    "Анна",   "Мария",   "Елена", "Ольга",  "Наталья", "Ирина",
+    "Екатерина", "Татьяна", "Юлия", "Алексей", "Дмитрий", "Иван",
+    "Сергей", "Андрей",  "Михаил", "Павел", "Никита",  "Артём",
+};
+const std::string_view kRussianFirstLatin[] = {
+    "anna",   "maria",   "elena", "olga",   "natalia", "irina",
+    "ekaterina", "tatiana", "iulia", "aleksei", "dmitrii", "ivan",
+    "sergei", "andrei",  "mikhail", "pavel", "nikita",  "artem",
+};
+const std::string_view kRussianLastNames[] = {
+    "Иванов",  "Смирнов", "Кузнецов", "Попов",   "Соколов", "Лебедев",
+    "Козлов",  "Новиков", "Морозов",  "Петров",  "Волков",  "Соловьёв",
+};
+const std::string_view kRussianLastLatin[] = {
+    "ivanov",  "smirnov", "kuznetsov", "popov",  "sokolov", "lebedev",
+    "kozlov",  "novikov", "morozov",   "petrov", "volkov",  "solovev",
+};
+const std::string_view kEnglishFirstNames[] = {
+    "Emma", "Olivia", "James", "Liam", "Noah", "Ava",
+    "Mia",  "Lucas",  "Ethan", "Grace", "Jack", "Chloe",
+};
+const std::string_view kEnglishLastNames[] = {
+    "Smith", "Johnson", "Brown", "Taylor", "Wilson", "Davies",
+    "Evans", "Clarke",  "Walker", "Wright", "Green", "Baker",
+};
+
+const std::string_view kBios[] = {
+    "Пишу код и иногда тексты",
+    "Фотограф-любитель",
+    "Backend developer. Coffee first.",
+    "Люблю горы и длинные поезда",
+    "Reading, running, repeat",
+    "Здесь про книги и кино",
+    "Product manager by day, musician by night",
+    "Учусь, путешествую, делюсь",
+};
+
+template <size_t N>
+std::string_view pick(Rng &rng, const std::string_view (&words)[N]) {
+  return words[rng.below(N)];
+}
+
+size_t utf8Length(std::string_view text) {
+  size_t length = 0;
+  for (unsigned char c : text) {
+    length += (c & 0xC0) != 0x80;
+  }
+  return length;
+}
+
+template <size_t N>
+void appendWords(Rng &rng, const std::string_view (&words)[N], size_t chars,
+                 std::string &out) {
+  size_t written = 0;
+  size_t sentence = 0;
+  while (written < chars) {
+    auto word = pick(rng, words);
+    if (sentence > 0) {
+      out += ' ';
+      ++written;
+    }
+    out += word;
+    written += utf8Length(word);
+    // Предложения не короче 4 слов
+    if (++sentence >= 4 && rng.chance(0.15)) {
+      static const char kEnds[] = {'.', '.', '.', '!', '?'};
+      out += kEnds[rng.below(sizeof(kEnds))];
+      ++written;
+      sentence = 0;
+      if (written < chars) {
+        out += ' ';
+        ++written;
+      }
+    }
+  }
+  if (sentence > 0) {
+    out += '.';
+  }
+}
+
+void appendText(Rng &rng, double median, double sigma, size_t maxChars,
+                std::string &out) {
+  auto chars = static_cast<size_t>(
+      std::clamp(rng.lognormal(median, sigma), 2.0,
+                 static_cast<double>(maxChars)));
+  if (rng.chance(0.7)) {
+    appendWords(rng, kRussianWords, chars, out);
+  } else {
+    appendWords(rng, kEnglishWords, chars, out);
+  }
+}
+
+} // namespace
+
+Person datagen::makePerson(Rng &rng, uint64_t userId) {
+  Person person;
+  std::string suffix = "_" + std::to_string(userId);
+  if (rng.chance(0.7)) {
+    auto first = rng.below(std::size(kRussianFirstNames));
+    auto last = rng.below(std::size(kRussianLastNames));
+    person.name.append(kRussianFirstNames[first])
+        .append(" ")
+        .append(kRussianLastNames[last]);
+    person.login.append(kRussianFirstLatin[first])
+        .append(".")
+        .append(kRussianLastLatin[last]);
+    if (first < kRussianFemaleNames) {
+      person.name += "а";
+      person.login += "a";
+    }
+  } else {
+    auto first = pick(rng, kEnglishFirstNames);
+    auto last = pick(rng, kEnglishLastNames);
+    person.name.append(first).append(" ").append(last);
+    person.login.append(first).append(".").append(last);
+    for (auto &c : person.login) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+  }
+  person.login += suffix;
+  return person;
+}
+
+std::string datagen::makeBio(Rng &rng) {
+  return rng.chance(0.5) ? std::string(pick(rng, kBios)) : std::string();
+}
+
+void datagen::makePostText(Rng &rng, std::string &out) {
+  appendText(rng, 120, 1.0, 5000, out);
+}
+
+void datagen::makeCommentText(Rng &rng, std::string &out) {
+  appendText(rng, 50, 0.8, 1000, out);
+}
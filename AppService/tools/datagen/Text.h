@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Random.h"
+#include <string>
+
+namespace datagen {
+
+struct Person {
+  // Для Users.name (AuthService) и users.display_name
+  std::string name;
+  // Уникален: в нём id пользователя
+  std::string login;
+};
+
+Person makePerson(Rng &rng, uint64_t userId);
+
+// Пусто примерно у половины пользователей
+std::string makeBio(Rng &rng);
+
+// Посты на русском и английском (примерно 70 на 30); длина в символах
+// логнормальная: медиана около 120, редкие лонгриды до 5000
+void makePostText(Rng &rng, std::string &out);
+
+// Медиана около 50 символов
+void makeCommentText(Rng &rng, std::string &out);
+
+} // namespace datagen
@@ -0,0 +1,457 @@
+// Генератор синтетических данных для нагрузочных тестов: пользователи
+// (в базах AppService и AuthService), подписки, посты, лайки,
+// комментарии и вложения. Одинаковые параметры и seed дают одинаковые
+// данные. Строки уходят бинарным COPY параллельно из --threads
+// соединений; вторичные индексы на время загрузки удаляются и потом
+// строятся заново (--keep-indexes — не трогать).
+//
+// Все пользователи входят с паролем "password" (логин — users.username).
+//
+// Запуск:
+//   datagen --users 1M --app-db "host=127.0.0.1 port=5433 dbname=app_service
+//           user=root password=..." --auth-db "... dbname=auth_service"
+//           [--truncate]
+//   datagen --users 10k --out dump/   — файлы COPY и load_*.sql для psql
+//
+// Остальные параметры — в usage().
+#include "Dataset.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+using namespace datagen;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// bcrypt("password"), cost 10
+const char *const kDefaultPasswordHash =
+    "$2a$10$6bQ6/Pm9sMAn78vUc7oZvuGbrMmQdTasg5iRvwL8hIib3i.S/AeHm";
+
+const char *const kAppTables[] = {"users",    "follows",     "posts",
+                                  "likes",    "comments",    "attachments",
+                                  "media_objects"};
+
+struct Options {
+  Scale scale;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string appDb;
+  std::string authDb;
+  std::string outDir;
+  bool truncate = false;
+  bool keepIndexes = false;
+};
+
+void usage(const char *program) {
+  std::fprintf(
+      stderr,
+      "usage: %s --users N (--app-db CONNINFO [--auth-db CONNINFO] | --out "
+      "DIR)\n"
+      "  --seed N                  1\n"
+      "  --threads N               число ядер\n"
+      "  --posts-per-user X        10\n"
+      "  --follows-per-user X      30\n"
+      "  --likes-per-post X        5\n"
+      "  --comments-per-post X     1\n"
+      "  --attachment-share X      0.2   доля постов с вложениями\n"
+      "  --private-share X         0.05\n"
+      "  --skew X                  0.9   показатель закона Ципфа\n"
+      "  --days N                  365\n"
+      "  --until YYYY-MM-DD        2026-01-01\n"
+      "  --password-hash HASH      bcrypt(\"password\")\n"
+      "  --truncate                очистить таблицы перед загрузкой\n"
+      "  --keep-indexes            не удалять вторичные индексы\n"
+      "N принимает суффиксы k и M: 10k, 100M\n",
+      program);
+}
+
+uint64_t parseCount(const std::string &value) {
+  char *end = nullptr;
+  double number = std::strtod(value.c_str(), &end);
+  if (*end == 'k' || *end == 'K') {
+    number *= 1e3;
+  } else if (*end == 'M' || *end == 'm') {
+    number *= 1e6;
+  }
+  return static_cast<uint64_t>(number);
+}
+
+int64_t parseDate(const std::string &value) {
+  std::tm tm{};
+  if (!strptime(value.c_str(), "%Y-%m-%d", &tm)) {
+    throw std::runtime_error("bad date: " + value);
+  }
+  return static_cast<int64_t>(timegm(&tm)) * 1000000;
+}
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  options.scale.untilUs = parseDate("2026-01-01");
+  options.scale.passwordHash = kDefaultPasswordHash;
+  for (int i = 1; i < argc; ++i) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      usage(argv[0]);
+      std::exit(0);
+    }
+    if (name == "--truncate") {
+      options.truncate = true;
+      continue;
+    }
+    if (name == "--keep-indexes") {
+      options.keepIndexes = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      throw std::runtime_error("missing value for " + name);
+    }
+    std::string value = argv[++i];
+    auto &scale = options.scale;
+    if (name == "--users") {
+      scale.users = parseCount(value);
+    } else if (name == "--seed") {
+      scale.seed = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--threads") {
+      options.threads = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "--posts-per-user") {
+      scale.postsPerUser = std::atof(value.c_str());
+    } else if (name == "--follows-per-user") {
+      scale.followsPerUser = std::atof(value.c_str());
+    } else if (name == "--likes-per-post") {
+      scale.likesPerPost = std::atof(value.c_str());
+    } else if (name == "--comments-per-post") {
+      scale.commentsPerPost = std::atof(value.c_str());
+    } else if (name == "--attachment-share") {
+      scale.attachmentShare = std::atof(value.c_str());
+    } else if (name == "--private-share") {
+      scale.privateShare = std::atof(value.c_str());
+    } else if (name == "--skew") {
+      scale.skew = std::atof(value.c_str());
+    } else if (name == "--days") {
+      scale.days = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "--until") {
+      scale.untilUs = parseDate(value);
+    } else if (name == "--password-hash") {
+      scale.passwordHash = value;
+    } else if (name == "--app-db") {
+      options.appDb = value;
+    } else if (name == "--auth-db") {
+      options.authDb = value;
+    } else if (name == "--out") {
+      options.outDir = value;
+    } else {
+      throw std::runtime_error("unknown option " + name);
+    }
+  }
+  if (options.scale.users < 2) {
+    throw std::runtime_error("--users must be at least 2");
+  }
+  // В AuthService id — serial
+  if (options.scale.users > 2147483647) {
+    throw std::runtime_error("--users must fit in int4");
+  }
+  if (options.appDb.empty() == options.outDir.empty()) {
+    throw std::runtime_error("exactly one of --app-db and --out is required");
+  }
+  return options;
+}
+
+std::string copyStatement(const Table &table) {
+  return std::string("COPY ") + table.name() + " " + table.columns() +
+         " FROM STDIN (FORMAT binary)";
+}
+
+std::string setvalStatement(const Table &table) {
+  std::string name = table.name();
+  std::string column = table.sequenceColumn();
+  return "SELECT setval(pg_get_serial_sequence('" + name + "', '" + column +
+         "'), (SELECT COALESCE(MAX(" + column + "), 0) + 1 FROM " + name +
+         "), false)";
+}
+
+// Куда пишет поток: свой COPY в базу или свой файл
+class Target {
+public:
+  virtual ~Target() = default;
+  virtual std::unique_ptr<Sink> open(const Table &table, unsigned worker) = 0;
+};
+
+class DatabaseTarget : public Target {
+public:
+  DatabaseTarget(const Options &options, unsigned workers) {
+    for (unsigned i = 0; i < workers; ++i) {
+      app_.push_back(std::make_unique<Connection>(options.appDb));
+      app_.back()->exec("SET synchronous_commit = off");
+      if (!options.authDb.empty()) {
+        auth_.push_back(std::make_unique<Connection>(options.authDb));
+        auth_.back()->exec("SET synchronous_commit = off");
+      }
+    }
+  }
+
+  std::unique_ptr<Sink> open(const Table &table, unsigned worker) override {
+    auto &conn = table.database() == Database::kApp ? *app_[worker]
+                                                    : *auth_[worker];
+    return std::make_unique<CopySink>(conn, copyStatement(table));
+  }
+
+private:
+  std::vector<std::unique_ptr<Connection>> app_;
+  std::vector<std::unique_ptr<Connection>> auth_;
+};
+
+class FileTarget : public Target {
+public:
+  explicit FileTarget(std::string dir) : dir_(std::move(dir)) {}
+
+  static std::string fileName(const Table &table, unsigned worker) {
+    return std::string(table.database() == Database::kApp ? "app" : "auth") +
+           "." + table.name() + "." + std::to_string(worker) + ".bin";
+  }
+
+  std::unique_ptr<Sink> open(const Table &table, unsigned worker) override {
+    return std::make_unique<FileSink>(dir_ + "/" + fileName(table, worker));
+  }
+
+private:
+  std::string dir_;
+};
+
+uint64_t loadTable(const Table &table, Target &target, unsigned workers) {
+  std::atomic<uint64_t> nextChunk{0};
+  std::atomic<uint64_t> rows{0};
+  std::mutex errorMutex;
+  std::string error;
+  std::vector<std::thread> threads;
+  for (unsigned worker = 0; worker < workers; ++worker) {
+    threads.emplace_back([&, worker]() {
+      try {
+        auto sink = target.open(table, worker);
+        CopyWriter out(*sink);
+        uint64_t written = 0;
+        for (auto chunk = nextChunk++; chunk < table.chunks();
+             chunk = nextChunk++) {
+          written += table.emit(chunk, out);
+        }
+        out.finish();
+        rows += written;
+      } catch (const std::exception &e) {
+        std::lock_guard lock(errorMutex);
+        error = e.what();
+        // Остальные потоки дорабатывают свои пачки и выходят
+        nextChunk = table.chunks();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (!error.empty()) {
+    throw std::runtime_error(std::string(table.name()) + ": " + error);
+  }
+  return rows;
+}
+
+// Вторичные индексы (не ограничения: PRIMARY KEY и UNIQUE остаются)
+std::vector<std::string> dropIndexes(Connection &conn) {
+  std::string tables;
+  for (const char *table : kAppTables) {
+    tables += std::string(tables.empty() ? "'" : ",'") + table + "'";
+  }
+  auto rows = conn.query(
+      "SELECT i.indexname, i.indexdef FROM pg_indexes i "
+      "WHERE i.schemaname = current_schema() AND i.tablename IN (" +
+      tables +
+      ") AND NOT EXISTS (SELECT 1 FROM pg_constraint c "
+      "WHERE c.conname = i.indexname)");
+  std::vector<std::string> definitions;
+  for (const auto &row : rows) {
+    // Если загрузка упадёт, индексы вернут миграции (CREATE INDEX IF
+    // NOT EXISTS) или эти строки
+    std::fprintf(stderr, "dropping %s: %s\n", row[0].c_str(), row[1].c_str());
+    conn.exec("DROP INDEX " + row[0]);
+    definitions.push_back(row[1]);
+  }
+  return definitions;
+}
+
+void createIndexes(const std::string &conninfo,
+                   const std::vector<std::string> &definitions,
+                   unsigned workers) {
+  std::atomic<size_t> next{0};
+  std::mutex errorMutex;
+  std::string error;
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < std::min<size_t>(workers, definitions.size());
+       ++i) {
+    threads.emplace_back([&]() {
+      try {
+        Connection conn(conninfo);
+        conn.exec("SET maintenance_work_mem = '1GB'");
+        for (auto index = next++; index < definitions.size();
+             index = next++) {
+          conn.exec(definitions[index]);
+        }
+      } catch (const std::exception &e) {
+        std::lock_guard lock(errorMutex);
+        error = e.what();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (!error.empty()) {
+    throw std::runtime_error(error);
+  }
+}
+
+void prepare(Connection &conn, const std::vector<std::string> &tables,
+             bool truncate) {
+  std::string list;
+  for (const auto &table : tables) {
+    list += (list.empty() ? "" : ", ") + table;
+  }
+  if (truncate) {
+    conn.exec("TRUNCATE " + list + " RESTART IDENTITY");
+    return;
+  }
+  for (const auto &table : tables) {
+    if (conn.query("SELECT 1 FROM " + table + " LIMIT 1").size()) {
+      throw std::runtime_error("table " + table +
+                               " is not empty (use --truncate)");
+    }
+  }
+}
+
+// psql -f load_app.sql из каталога с файлами
+void writeScripts(const Options &options,
+                  const std::vector<std::unique_ptr<Table>> &tables,
+                  unsigned workers) {
+  std::map<Database, std::ofstream> scripts;
+  scripts[Database::kApp].open(options.outDir + "/load_app.sql");
+  scripts[Database::kAuth].open(options.outDir + "/load_auth.sql");
+  for (const auto &table : tables) {
+    auto &script = scripts[table->database()];
+    for (unsigned worker = 0; worker < workers; ++worker) {
+      script << "\\copy " << table->name() << " " << table->columns()
+             << " FROM '" << FileTarget::fileName(*table, worker)
+             << "' WITH (FORMAT binary)\n";
+    }
+  }
+  for (const auto &table : tables) {
+    if (table->sequenceColumn()) {
+      scripts[table->database()] << setvalStatement(*table) << ";\n";
+    }
+  }
+  scripts[Database::kApp] << "ANALYZE;\n";
+  scripts[Database::kAuth] << "ANALYZE;\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = parseOptions(argc, argv);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    usage(argv[0]);
+    return 2;
+  }
+  const auto &scale = options.scale;
+  std::printf("users %llu, posts %llu, seed %llu, %u threads\n",
+              static_cast<unsigned long long>(scale.users),
+              static_cast<unsigned long long>(scale.posts()),
+              static_cast<unsigned long long>(scale.seed), options.threads);
+
+  auto tables = makeTables(scale);
+  try {
+    std::unique_ptr<Target> target;
+    std::unique_ptr<Connection> app;
+    std::vector<std::string> indexes;
+    bool withAuth = !options.authDb.empty();
+    if (!options.outDir.empty()) {
+      mkdir(options.outDir.c_str(), 0755);
+      target = std::make_unique<FileTarget>(options.outDir);
+      withAuth = true;
+    } else {
+      app = std::make_unique<Connection>(options.appDb);
+      prepare(*app, {std::begin(kAppTables), std::end(kAppTables)},
+              options.truncate);
+      if (withAuth) {
+        Connection auth(options.authDb);
+        prepare(auth, {"users"}, options.truncate);
+      }
+      if (!options.keepIndexes) {
+        indexes = dropIndexes(*app);
+      }
+      target = std::make_unique<DatabaseTarget>(options, options.threads);
+    }
+
+    uint64_t totalRows = 0;
+    auto loadStart = Clock::now();
+    for (const auto &table : tables) {
+      if (table->database() == Database::kAuth && !withAuth) {
+        continue;
+      }
+      auto start = Clock::now();
+      auto rows = loadTable(*table, *target, options.threads);
+      double seconds =
+          std::chrono::duration<double>(Clock::now() - start).count();
+      totalRows += rows;
+      std::printf("%-5s %-14s %12llu rows %8.1f s %10.0f rows/s\n",
+                  table->database() == Database::kApp ? "app" : "auth",
+                  table->name(), static_cast<unsigned long long>(rows),
+                  seconds, rows / std::max(seconds, 1e-9));
+      std::fflush(stdout);
+    }
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - loadStart).count();
+    std::printf("total %llu rows in %.1f s, %.0f rows/s\n",
+                static_cast<unsigned long long>(totalRows), seconds,
+                totalRows / std::max(seconds, 1e-9));
+
+    if (!options.outDir.empty()) {
+      writeScripts(options, tables, options.threads);
+      return 0;
+    }
+
+    auto start = Clock::now();
+    target.reset();
+    createIndexes(options.appDb, indexes, options.threads);
+    std::unique_ptr<Connection> auth;
+    if (withAuth) {
+      auth = std::make_unique<Connection>(options.authDb);
+    }
+    for (const auto &table : tables) {
+      if (!table->sequenceColumn() ||
+          (table->database() == Database::kAuth && !auth)) {
+        continue;
+      }
+      (table->database() == Database::kApp ? *app : *auth)
+          .query(setvalStatement(*table));
+    }
+    app->exec("ANALYZE");
+    if (auth) {
+      auth->exec("ANALYZE users");
+    }
+    std::printf("indexes and ANALYZE: %.1f s\n",
+                std::chrono::duration<double>(Clock::now() - start).count());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include "Histogram.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace loadgen;
+
+namespace {
+
+constexpr int64_t kSubCount = 1 << 10;
+
+} // namespace
+
+Histogram::Histogram() : counts_(indexOf(kMaxUs) + 1) {}
+
+size_t Histogram::indexOf(int64_t us) {
+  // Меньше kSubCount — точно, дальше — по kSubCount корзин на степень
+  if (us < kSubCount) {
+    return static_cast<size_t>(us);
+  }
+  int magnitude = 63 - __builtin_clzll(static_cast<uint64_t>(us)) - kSubBits;
+  int64_t sub = (us >> magnitude) - kSubCount;
+  return static_cast<size_t>((magnitude + 1) * kSubCount + sub);
+}
+
+int64_t Histogram::valueAt(size_t index) {
+  auto i = static_cast<int64_t>(index);
+  if (i < kSubCount) {
+    return i;
+  }
+  int magnitude = static_cast<int>(i / kSubCount) - 1;
+  int64_t sub = i % kSubCount + kSubCount;
+  // Верхняя граница корзины: перцентиль не занижается
+  return ((sub + 1) << magnitude) - 1;
+}
+
+void Histogram::record(int64_t us) {
+  us = std::clamp<int64_t>(us, 0, kMaxUs);
+  ++counts_[indexOf(us)];
+  ++count_;
+  max_ = std::max(max_, us);
+  sum_ += static_cast<double>(us);
+}
+
+void Histogram::recordCorrected(int64_t us, int64_t expectedIntervalUs) {
+  record(us);
+  if (expectedIntervalUs <= 0) {
+    return;
+  }
+  for (int64_t missing = us - expectedIntervalUs; missing >= expectedIntervalUs;
+       missing -= expectedIntervalUs) {
+    record(missing);
+  }
+}
+
+void Histogram::merge(const Histogram &other) {
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+double Histogram::mean() const { return count_ ? sum_ / count_ : 0; }
+
+int64_t Histogram::percentile(double p) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(p / 100 * count_));
+  rank = std::clamp<uint64_t>(rank, 1, count_);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(valueAt(i), max_);
+    }
+  }
+  return max_;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace loadgen {
+
+// Гистограмма задержек в микросекундах, как HdrHistogram: внутри
+// каждой степени двойки 1024 равных корзины, то есть ошибка любого
+// перцентиля меньше 0.1%. Значения больше часа обрезаются.
+class Histogram {
+public:
+  Histogram();
+
+  void record(int64_t us);
+
+  // Поправка на coordinated omission: если задержка больше ожидаемого
+  // интервала между запросами, клиент в это время не отправил бы
+  // latency / interval запросов. Их задержки (latency - interval,
+  // latency - 2 * interval, ...) дописываются, как если бы они ждали.
+  void recordCorrected(int64_t us, int64_t expectedIntervalUs);
+
+  void merge(const Histogram &other);
+
+  uint64_t count() const { return count_; }
+  int64_t max() const { return max_; }
+  double mean() const;
+  // p от 0 до 100
+  int64_t percentile(double p) const;
+
+private:
+  static constexpr int kSubBits = 10;
+  static constexpr int64_t kMaxUs = 3600LL * 1000000;
+
+  static size_t indexOf(int64_t us);
+  static int64_t valueAt(size_t index);
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+  int64_t max_ = 0;
+  double sum_ = 0;
+};
+
+} // namespace loadgen
@@ -0,0 +1,460 @@
+#include "HttpClient.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+using namespace loadgen;
+
+namespace {
+
+enum class Parse { kIncomplete, kComplete, kBad };
+
+std::string lowercase(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return text;
+}
+
+// Тело в chunked-кодировке; false — ещё не всё
+bool decodeChunked(const std::string &in, size_t from, std::string &body,
+                   size_t &end) {
+  body.clear();
+  size_t pos = from;
+  while (true) {
+    auto lineEnd = in.find("\r\n", pos);
+    if (lineEnd == std::string::npos) {
+      return false;
+    }
+    size_t size = std::strtoull(in.c_str() + pos, nullptr, 16);
+    pos = lineEnd + 2;
+    if (size == 0) {
+      auto trailerEnd = in.compare(pos, 2, "\r\n") == 0
+                            ? pos
+                            : in.find("\r\n\r\n", pos);
+      if (trailerEnd == std::string::npos || in.size() < trailerEnd + 2) {
+        return false;
+      }
+      end = trailerEnd + (trailerEnd == pos ? 2 : 4);
+      return true;
+    }
+    if (in.size() < pos + size + 2) {
+      return false;
+    }
+    body.append(in, pos, size);
+    pos += size + 2;
+  }
+}
+
+// length — сколько байт буфера занял ответ; eof — соединение закрыто
+Parse parseResponse(const std::string &in, bool eof, Response &response,
+                    bool &keepAlive, size_t &length) {
+  auto headerEnd = in.find("\r\n\r\n");
+  if (headerEnd == std::string::npos) {
+    return eof ? Parse::kBad : Parse::kIncomplete;
+  }
+  if (in.compare(0, 5, "HTTP/") != 0 || in.size() < 12) {
+    return Parse::kBad;
+  }
+  response.status = std::atoi(in.c_str() + 9);
+  auto headers = lowercase(in.substr(0, headerEnd));
+  keepAlive = headers.find("\r\nconnection: close") == std::string::npos;
+  size_t bodyStart = headerEnd + 4;
+
+  auto contentLength = headers.find("\r\ncontent-length:");
+  if (contentLength != std::string::npos) {
+    size_t size = std::strtoull(headers.c_str() + contentLength + 17,
+                                nullptr, 10);
+    if (in.size() < bodyStart + size) {
+      return eof ? Parse::kBad : Parse::kIncomplete;
+    }
+    response.body.assign(in, bodyStart, size);
+    length = bodyStart + size;
+    return Parse::kComplete;
+  }
+  if (headers.find("\r\ntransfer-encoding: chunked") != std::string::npos) {
+    if (!decodeChunked(in, bodyStart, response.body, length)) {
+      return eof ? Parse::kBad : Parse::kIncomplete;
+    }
+    return Parse::kComplete;
+  }
+  // Ни длины, ни chunked: тело до закрытия соединения
+  if (response.status == 204 || response.status == 304) {
+    length = bodyStart;
+    return Parse::kComplete;
+  }
+  if (!eof) {
+    return Parse::kIncomplete;
+  }
+  response.body.assign(in, bodyStart);
+  length = in.size();
+  keepAlive = false;
+  return Parse::kComplete;
+}
+
+} // namespace
+
+HttpClient::HttpClient(size_t maxConnections, Clock::duration timeout)
+    : maxConnections_(std::max<size_t>(maxConnections, 1)), timeout_(timeout),
+      epoll_(epoll_create1(EPOLL_CLOEXEC)) {
+  if (epoll_ < 0) {
+    throw std::runtime_error("epoll_create1 failed");
+  }
+}
+
+HttpClient::~HttpClient() {
+  for (auto &conn : connections_) {
+    if (conn->fd >= 0) {
+      close(conn->fd);
+    }
+  }
+  close(epoll_);
+}
+
+int HttpClient::addTarget(const std::string &url) {
+  std::string rest = url;
+  if (rest.rfind("http://", 0) == 0) {
+    rest.erase(0, 7);
+  } else if (rest.find("://") != std::string::npos) {
+    throw std::runtime_error("only http:// is supported: " + url);
+  }
+  rest = rest.substr(0, rest.find('/'));
+  std::string host = rest, port = "80";
+  auto colon = rest.rfind(':');
+  if (colon != std::string::npos) {
+    host = rest.substr(0, colon);
+    port = rest.substr(colon + 1);
+  }
+
+  addrinfo hints{};
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *result = nullptr;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 ||
+      !result) {
+    throw std::runtime_error("cannot resolve " + url);
+  }
+  Target target;
+  target.host = rest;
+  std::memcpy(&target.address, result->ai_addr, result->ai_addrlen);
+  target.addressLength = result->ai_addrlen;
+  freeaddrinfo(result);
+  targets_.push_back(std::move(target));
+  return static_cast<int>(targets_.size() - 1);
+}
+
+void HttpClient::send(int targetIndex, const Request &request,
+                      Callback callback) {
+  auto &target = targets_[targetIndex];
+  Pending pending;
+  auto &wire = pending.wire;
+  wire.reserve(request.path.size() + request.body.size() + 256);
+  wire.append(request.method)
+      .append(" ")
+      .append(request.path)
+      .append(" HTTP/1.1\r\nHost: ")
+      .append(target.host)
+      .append("\r\n");
+  for (const auto &[name, value] : request.headers) {
+    wire.append(name).append(": ").append(value).append("\r\n");
+  }
+  if (!request.body.empty() || request.method == "POST" ||
+      request.method == "PUT" || request.method == "PATCH") {
+    wire.append("Content-Length: ")
+        .append(std::to_string(request.body.size()))
+        .append("\r\n");
+  }
+  wire.append("\r\n").append(request.body);
+  pending.callback = std::move(callback);
+  ++inFlight_;
+
+  if (!target.idle.empty()) {
+    auto *conn = target.idle.back();
+    target.idle.pop_back();
+    dispatch(*conn, std::move(pending));
+  } else if (target.open < maxConnections_) {
+    ++target.open;
+    dispatch(newConnection(targetIndex), std::move(pending));
+  } else {
+    target.pending.push_back(std::move(pending));
+  }
+}
+
+void HttpClient::runAt(Clock::time_point when, std::function<void()> task) {
+  timers_.push({when, timerSequence_++, std::move(task)});
+}
+
+void HttpClient::run() {
+  epoll_event events[256];
+  while (!stopped_) {
+    fireTimers();
+    if (stopped_) {
+      break;
+    }
+    int timeoutMs = 100;
+    if (!timers_.empty()) {
+      auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      timers_.top().when - Clock::now())
+                      .count();
+      timeoutMs = static_cast<int>(std::clamp<int64_t>(wait, 0, 100));
+    }
+    int ready = epoll_wait(epoll_, events, 256, timeoutMs);
+    for (int i = 0; i < ready; ++i) {
+      auto *conn = static_cast<Connection *>(events[i].data.ptr);
+      if (conn->fd < 0) {
+        continue;
+      }
+      if (events[i].events & EPOLLOUT) {
+        onWritable(*conn);
+      }
+      if (conn->fd >= 0 &&
+          (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP))) {
+        onReadable(*conn);
+      }
+    }
+  }
+}
+
+void HttpClient::fireTimers() {
+  auto now = Clock::now();
+  // Пачками: отставший от расписания генератор не должен перестать
+  // читать ответы
+  for (int fired = 0; fired < 1024 && !timers_.empty() &&
+                      timers_.top().when <= now;
+       ++fired) {
+    auto task = std::move(const_cast<Timer &>(timers_.top()).task);
+    timers_.pop();
+    task();
+  }
+}
+
+HttpClient::Connection &HttpClient::newConnection(int target) {
+  Connection *conn;
+  if (!freeConnections_.empty()) {
+    conn = freeConnections_.back();
+    freeConnections_.pop_back();
+  } else {
+    connections_.push_back(std::make_unique<Connection>());
+    conn = connections_.back().get();
+  }
+  conn->target = target;
+  conn->reused = false;
+  conn->state = State::kClosed;
+  return *conn;
+}
+
+void HttpClient::dispatch(Connection &conn, Pending &&pending) {
+  conn.out = std::move(pending.wire);
+  conn.written = 0;
+  conn.in.clear();
+  conn.callback = std::move(pending.callback);
+  conn.retried = false;
+  auto generation = ++conn.generation;
+  runAt(Clock::now() + timeout_, [this, &conn, generation]() {
+    if (conn.generation == generation &&
+        (conn.state == State::kBusy || conn.state == State::kConnecting)) {
+      conn.reused = false;
+      fail(conn, "timeout");
+    }
+  });
+  if (conn.fd < 0) {
+    connect(conn);
+  } else {
+    conn.state = State::kBusy;
+    startWrite(conn);
+  }
+}
+
+void HttpClient::connect(Connection &conn) {
+  const auto &target = targets_[conn.target];
+  conn.fd = socket(target.address.ss_family,
+                   SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (conn.fd < 0) {
+    fail(conn, std::string("socket: ") + std::strerror(errno));
+    return;
+  }
+  int one = 1;
+  setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  conn.state = State::kConnecting;
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+  event.data.ptr = &conn;
+  epoll_ctl(epoll_, EPOLL_CTL_ADD, conn.fd, &event);
+  if (::connect(conn.fd, reinterpret_cast<const sockaddr *>(&target.address),
+                target.addressLength) != 0 &&
+      errno != EINPROGRESS) {
+    fail(conn, std::string("connect: ") + std::strerror(errno));
+  }
+}
+
+void HttpClient::startWrite(Connection &conn) {
+  onWritable(conn);
+  if (conn.fd >= 0 && conn.written < conn.out.size()) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    event.data.ptr = &conn;
+    epoll_ctl(epoll_, EPOLL_CTL_MOD, conn.fd, &event);
+  }
+}
+
+void HttpClient::onWritable(Connection &conn) {
+  if (conn.state == State::kConnecting) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+      fail(conn, std::string("connect: ") + std::strerror(error));
+      return;
+    }
+    conn.state = State::kBusy;
+  }
+  if (conn.state != State::kBusy) {
+    return;
+  }
+  while (conn.written < conn.out.size()) {
+    auto n = ::send(conn.fd, conn.out.data() + conn.written,
+                    conn.out.size() - conn.written, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EINTR) {
+        fail(conn, std::string("send: ") + std::strerror(errno));
+      }
+      return;
+    }
+    conn.written += static_cast<size_t>(n);
+  }
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLRDHUP;
+  event.data.ptr = &conn;
+  epoll_ctl(epoll_, EPOLL_CTL_MOD, conn.fd, &event);
+}
+
+void HttpClient::onReadable(Connection &conn) {
+  char buffer[65536];
+  bool eof = false;
+  while (true) {
+    auto n = recv(conn.fd, buffer, sizeof(buffer), 0);
+    if (n > 0) {
+      conn.in.append(buffer, static_cast<size_t>(n));
+      continue;
+    }
+    if (n == 0) {
+      eof = true;
+    } else if (errno != EAGAIN && errno != EINTR) {
+      eof = true;
+    }
+    break;
+  }
+
+  if (conn.state == State::kIdle) {
+    // Сервер закрыл простаивающее соединение
+    if (eof) {
+      auto &idle = targets_[conn.target].idle;
+      idle.erase(std::remove(idle.begin(), idle.end(), &conn), idle.end());
+      closeSocket(conn);
+      --targets_[conn.target].open;
+      freeConnections_.push_back(&conn);
+    }
+    return;
+  }
+  if (conn.state != State::kBusy) {
+    if (eof) {
+      fail(conn, "connection closed");
+    }
+    return;
+  }
+
+  Response response;
+  bool keepAlive = true;
+  size_t length = 0;
+  switch (parseResponse(conn.in, eof, response, keepAlive, length)) {
+  case Parse::kIncomplete:
+    return;
+  case Parse::kBad:
+    fail(conn, conn.in.empty() ? "connection closed" : "bad response");
+    return;
+  case Parse::kComplete:
+    complete(conn, std::move(response), keepAlive && !eof &&
+                                            length == conn.in.size());
+    return;
+  }
+}
+
+void HttpClient::complete(Connection &conn, Response &&response,
+                          bool keepAlive) {
+  auto callback = std::move(conn.callback);
+  ++conn.generation;
+  if (keepAlive) {
+    conn.reused = true;
+    release(conn);
+  } else {
+    closeSocket(conn);
+    --targets_[conn.target].open;
+    freeConnections_.push_back(&conn);
+    release(conn);
+  }
+  --inFlight_;
+  callback(std::move(response));
+}
+
+void HttpClient::fail(Connection &conn, const std::string &error) {
+  if (conn.reused && !conn.retried && conn.in.empty() &&
+      error != "timeout") {
+    // Гонка с закрытием по простою: запрос до сервера не дошёл
+    closeSocket(conn);
+    conn.reused = false;
+    conn.retried = true;
+    conn.written = 0;
+    connect(conn);
+    return;
+  }
+  auto callback = std::move(conn.callback);
+  ++conn.generation;
+  closeSocket(conn);
+  --targets_[conn.target].open;
+  freeConnections_.push_back(&conn);
+  // Очередь ждёт свободного места
+  auto &target = targets_[conn.target];
+  if (!target.pending.empty() && target.open < maxConnections_) {
+    ++target.open;
+    auto pending = std::move(target.pending.front());
+    target.pending.pop_front();
+    dispatch(newConnection(conn.target), std::move(pending));
+  }
+  --inFlight_;
+  Response response;
+  response.error = error;
+  callback(std::move(response));
+}
+
+// Соединение свободно (или закрыто и место свободно): следующий из очереди
+void HttpClient::release(Connection &conn) {
+  auto &target = targets_[conn.target];
+  if (conn.fd >= 0) {
+    conn.state = State::kIdle;
+    if (!target.pending.empty()) {
+      auto pending = std::move(target.pending.front());
+      target.pending.pop_front();
+      dispatch(conn, std::move(pending));
+    } else {
+      target.idle.push_back(&conn);
+    }
+  } else if (!target.pending.empty() && target.open < maxConnections_) {
+    ++target.open;
+    auto pending = std::move(target.pending.front());
+    target.pending.pop_front();
+    dispatch(newConnection(conn.target), std::move(pending));
+  }
+}
+
+void HttpClient::closeSocket(Connection &conn) {
+  if (conn.fd >= 0) {
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, conn.fd, nullptr);
+    close(conn.fd);
+    conn.fd = -1;
+  }
+  conn.state = State::kClosed;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+namespace loadgen {
+
+using Clock = std::chrono::steady_clock;
+
+struct Request {
+  std::string method = "GET";
+  std::string path;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+};
+
+struct Response {
+  // 0 — ответа нет: ошибка соединения или таймаут (см. error)
+  int status = 0;
+  std::string error;
+  std::string body;
+};
+
+// Однопоточный HTTP/1.1-клиент на epoll: keep-alive соединения к
+// нескольким серверам и таймеры. Сверх maxConnections на сервер
+// запросы ждут в очереди — это ожидание тоже входит в их задержку.
+class HttpClient {
+public:
+  using Callback = std::function<void(Response &&)>;
+
+  HttpClient(size_t maxConnections, Clock::duration timeout);
+  ~HttpClient();
+  HttpClient(const HttpClient &) = delete;
+  HttpClient &operator=(const HttpClient &) = delete;
+
+  // "http://host:port"; возвращает номер сервера для send()
+  int addTarget(const std::string &url);
+
+  void send(int target, const Request &request, Callback callback);
+  void runAt(Clock::time_point when, std::function<void()> task);
+
+  // До stop()
+  void run();
+  void stop() { stopped_ = true; }
+
+  size_t inFlight() const { return inFlight_; }
+
+private:
+  enum class State { kIdle, kConnecting, kBusy, kClosed };
+
+  struct Pending {
+    std::string wire;
+    Callback callback;
+  };
+
+  struct Connection {
+    int fd = -1;
+    int target = 0;
+    State state = State::kClosed;
+    // Соединение уже отработало запрос: сервер мог закрыть его по
+    // простою, и тогда запрос повторяется на новом
+    bool reused = false;
+    bool retried = false;
+    std::string out;
+    size_t written = 0;
+    std::string in;
+    Callback callback;
+    // Чтобы таймаут старого запроса не сработал на новом
+    uint64_t generation = 0;
+  };
+
+  struct Target {
+    std::string host;
+    sockaddr_storage address{};
+    socklen_t addressLength = 0;
+    size_t open = 0;
+    std::vector<Connection *> idle;
+    std::deque<Pending> pending;
+  };
+
+  struct Timer {
+    Clock::time_point when;
+    uint64_t sequence;
+    std::function<void()> task;
+    bool operator>(const Timer &other) const {
+      return when != other.when ? when > other.when
+                                : sequence > other.sequence;
+    }
+  };
+
+  void dispatch(Connection &conn, Pending &&pending);
+  void connect(Connection &conn);
+  void startWrite(Connection &conn);
+  void onWritable(Connection &conn);
+  void onReadable(Connection &conn);
+  // Закрыть и ответить ошибкой (или повторить на новом соединении)
+  void fail(Connection &conn, const std::string &error);
+  void complete(Connection &conn, Response &&response, bool keepAlive);
+  void release(Connection &conn);
+  void closeSocket(Connection &conn);
+  Connection &newConnection(int target);
+  void fireTimers();
+
+  size_t maxConnections_;
+  Clock::duration timeout_;
+  int epoll_;
+  bool stopped_ = false;
+  size_t inFlight_ = 0;
+  uint64_t timerSequence_ = 0;
+  std::vector<Target> targets_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::vector<Connection *> freeConnections_;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+};
+
+} // namespace loadgen
@@ -0,0 +1,193 @@
+#include "Report.h"
+#include <cmath>
+#include <cstdio>
+
+using namespace loadgen;
+
+namespace {
+
+double round(double value, double scale) {
+  return std::round(value * scale) / scale;
+}
+
+double ms(int64_t us) { return round(us / 1000.0, 1000); }
+
+Json::Value latencyJson(const Histogram &latency) {
+  Json::Value json(Json::objectValue);
+  json["p50"] = ms(latency.percentile(50));
+  json["p90"] = ms(latency.percentile(90));
+  json["p99"] = ms(latency.percentile(99));
+  json["p99_9"] = ms(latency.percentile(99.9));
+  json["max"] = ms(latency.max());
+  json["mean"] = round(latency.mean() / 1000.0, 1000);
+  return json;
+}
+
+double errorRate(const Json::Value &endpoint) {
+  auto requests = endpoint["requests"].asDouble();
+  return requests > 0 ? endpoint["errors"].asDouble() / requests : 0;
+}
+
+struct Comparison {
+  int regressions = 0;
+  double tolerance = 0;
+
+  // higherIsWorse: задержки и ошибки; для rps — наоборот
+  void row(const std::string &endpoint, const char *metric, double base,
+           double now, bool higherIsWorse, double slack) {
+    double change = base != 0 ? (now - base) / base * 100 : 0;
+    bool regressed =
+        higherIsWorse
+            ? now > base * (1 + tolerance) && now - base > slack
+            : now < base * (1 - tolerance) && base - now > slack;
+    regressions += regressed;
+    std::printf("%-30s %-10s %12.3f %12.3f %+8.1f%%%s\n", endpoint.c_str(),
+                metric, base, now, change, regressed ? "  REGRESSION" : "");
+  }
+};
+
+} // namespace
+
+Json::Value loadgen::toJson(const Results &results) {
+  Json::Value json(Json::objectValue);
+  json["scenario"] = results.scenario;
+  json["mode"] = results.load.mode == Load::Mode::kOpen ? "open" : "closed";
+  json["users"] = results.load.users;
+  if (results.load.mode == Load::Mode::kOpen) {
+    json["rate"] = results.load.rate;
+  } else {
+    json["think_ms"] = results.load.thinkMs;
+  }
+  json["duration_s"] = results.load.durationSeconds;
+  json["warmup_s"] = results.load.warmupSeconds;
+  json["measured_s"] = results.measuredSeconds;
+  json["correction"] = results.correction;
+  json["sessions"] = Json::UInt64(results.sessions);
+  json["failed_setups"] = Json::UInt64(results.failedSetups);
+
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  Histogram all;
+  auto &endpoints = json["endpoints"] = Json::Value(Json::objectValue);
+  for (const auto &[name, stats] : results.endpoints) {
+    auto &endpoint = endpoints[name];
+    endpoint["requests"] = Json::UInt64(stats.requests);
+    endpoint["errors"] = Json::UInt64(stats.errors);
+    endpoint["skipped"] = Json::UInt64(stats.skipped);
+    endpoint["bytes"] = Json::UInt64(stats.bytes);
+    endpoint["error_rate"] = round(errorRate(endpoint), 10000);
+    endpoint["throughput_rps"] =
+        results.measuredSeconds > 0
+            ? round(stats.requests / results.measuredSeconds, 100)
+            : 0.0;
+    endpoint["latency_ms"] = latencyJson(stats.latency);
+    auto &statuses = endpoint["statuses"] = Json::Value(Json::objectValue);
+    for (const auto &[status, count] : stats.statuses) {
+      statuses[status] = Json::UInt64(count);
+    }
+    requests += stats.requests;
+    errors += stats.errors;
+    all.merge(stats.latency);
+  }
+
+  auto &total = json["total"];
+  total["requests"] = Json::UInt64(requests);
+  total["errors"] = Json::UInt64(errors);
+  total["error_rate"] = round(errorRate(total), 10000);
+  total["throughput_rps"] =
+      results.measuredSeconds > 0 ? round(requests / results.measuredSeconds,
+                                          100)
+                                  : 0.0;
+  total["latency_ms"] = latencyJson(all);
+  return json;
+}
+
+void loadgen::printSummary(const Json::Value &results) {
+  std::printf("\n%-30s %9s %7s %9s %9s %9s %9s %9s\n", "endpoint",
+              "requests", "errors", "rps", "p50 ms", "p90 ms", "p99 ms",
+              "max ms");
+  auto line = [](const std::string &name, const Json::Value &endpoint) {
+    const auto &latency = endpoint["latency_ms"];
+    std::printf("%-30s %9llu %7llu %9.1f %9.2f %9.2f %9.2f %9.2f\n",
+                name.c_str(),
+                static_cast<unsigned long long>(
+                    endpoint["requests"].asUInt64()),
+                static_cast<unsigned long long>(endpoint["errors"].asUInt64()),
+                endpoint["throughput_rps"].asDouble(),
+                latency["p50"].asDouble(), latency["p90"].asDouble(),
+                latency["p99"].asDouble(), latency["max"].asDouble());
+  };
+  const auto &endpoints = results["endpoints"];
+  for (const auto &name : endpoints.getMemberNames()) {
+    line(name, endpoints[name]);
+  }
+  line("total", results["total"]);
+
+  for (const auto &name : endpoints.getMemberNames()) {
+    const auto &endpoint = endpoints[name];
+    if (endpoint["errors"].asUInt64() == 0 &&
+        endpoint["skipped"].asUInt64() == 0) {
+      continue;
+    }
+    std::printf("%s:", name.c_str());
+    for (const auto &status : endpoint["statuses"].getMemberNames()) {
+      std::printf(" %s=%llu", status.c_str(),
+                  static_cast<unsigned long long>(
+                      endpoint["statuses"][status].asUInt64()));
+    }
+    std::printf(" skipped=%llu\n", static_cast<unsigned long long>(
+                                        endpoint["skipped"].asUInt64()));
+  }
+  std::printf("sessions %llu, measured %.0f s, correction %s\n",
+              static_cast<unsigned long long>(results["sessions"].asUInt64()),
+              results["measured_s"].asDouble(),
+              results["correction"].asCString());
+}
+
+int loadgen::compare(const Json::Value &results, const Json::Value &baseline,
+                     double tolerance) {
+  if (results["mode"] != baseline["mode"] ||
+      results["users"] != baseline["users"]) {
+    std::printf("\nbaseline was run with a different load (%s, %d users)\n",
+                baseline["mode"].asCString(), baseline["users"].asInt());
+  }
+  std::printf("\n%-30s %-10s %12s %12s %9s\n", "endpoint", "metric",
+              "baseline", "now", "change");
+  Comparison comparison;
+  comparison.tolerance = tolerance;
+
+  const auto &endpoints = results["endpoints"];
+  const auto &baseEndpoints = baseline["endpoints"];
+  auto names = baseEndpoints.getMemberNames();
+  names.push_back("total");
+  for (const auto &name : names) {
+    const auto &base =
+        name == "total" ? baseline["total"] : baseEndpoints[name];
+    if (name != "total" && !endpoints.isMember(name)) {
+      std::printf("%-30s missing  REGRESSION\n", name.c_str());
+      ++comparison.regressions;
+      continue;
+    }
+    const auto &now = name == "total" ? results["total"] : endpoints[name];
+    for (const char *metric : {"p50", "p99"}) {
+      comparison.row(name, metric, base["latency_ms"][metric].asDouble(),
+                     now["latency_ms"][metric].asDouble(), true, 1.0);
+    }
+    comparison.row(name, "rps", base["throughput_rps"].asDouble(),
+                   now["throughput_rps"].asDouble(), false, 0.0);
+    // Доля ошибок — в процентах, допуск абсолютный: 1 пункт
+    double baseErrors = errorRate(base) * 100;
+    double nowErrors = errorRate(now) * 100;
+    bool regressed = nowErrors - baseErrors > 1.0;
+    comparison.regressions += regressed;
+    std::printf("%-30s %-10s %11.2f%% %11.2f%% %+8.2fpp%s\n", name.c_str(),
+                "errors", baseErrors, nowErrors, nowErrors - baseErrors,
+                regressed ? "  REGRESSION" : "");
+  }
+  for (const auto &name : endpoints.getMemberNames()) {
+    if (!baseEndpoints.isMember(name)) {
+      std::printf("%-30s new endpoint, not in baseline\n", name.c_str());
+    }
+  }
+  return comparison.regressions;
+}
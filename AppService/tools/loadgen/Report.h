@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Runner.h"
+#include <json/json.h>
+
+namespace loadgen {
+
+// Результаты в JSON: по строке на endpoint (запросы, ошибки, rps,
+// перцентили в миллисекундах, статусы) и сводка. Ключи сортированы,
+// числа округлены — файлы удобно хранить и сравнивать diff'ом.
+Json::Value toJson(const Results &results);
+
+void printSummary(const Json::Value &results);
+
+// Сравнение с сохранённым прогоном. Регрессия — если p50 или p99
+// выросли больше чем на tolerance (и больше чем на 1 мс), rps упал
+// больше чем на tolerance или доля ошибок выросла больше чем на 1
+// процентный пункт. Печатает таблицу; возвращает число регрессий.
+int compare(const Json::Value &results, const Json::Value &baseline,
+            double tolerance);
+
+} // namespace loadgen
@@ -0,0 +1,417 @@
+#include "Runner.h"
+#include <algorithm>
+#include <cstdio>
+#include <json/json.h>
+#include <stdexcept>
+
+using namespace loadgen;
+
+namespace {
+
+std::chrono::microseconds toMicros(Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration);
+}
+
+Clock::duration fromMillis(double ms) {
+  return std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::milli>(ms));
+}
+
+// "posts[*].id": поле, элемент массива ([n] или [*] — случайный)
+bool capture(const Json::Value &root, const std::string &path,
+             std::mt19937_64 &rng, std::string &out) {
+  const Json::Value *value = &root;
+  size_t pos = 0;
+  while (pos <= path.size()) {
+    auto dot = path.find('.', pos);
+    auto segment = path.substr(pos, dot == std::string::npos
+                                        ? std::string::npos
+                                        : dot - pos);
+    pos = dot == std::string::npos ? path.size() + 1 : dot + 1;
+
+    auto bracket = segment.find('[');
+    auto name = segment.substr(0, bracket);
+    if (!name.empty()) {
+      if (!value->isObject() || !value->isMember(name)) {
+        return false;
+      }
+      value = &(*value)[name];
+    }
+    while (bracket != std::string::npos) {
+      auto close = segment.find(']', bracket);
+      if (close == std::string::npos || !value->isArray() ||
+          value->empty()) {
+        return false;
+      }
+      auto index = segment.substr(bracket + 1, close - bracket - 1);
+      Json::ArrayIndex i =
+          index == "*" ? static_cast<Json::ArrayIndex>(rng() % value->size())
+                       : static_cast<Json::ArrayIndex>(std::stoul(index));
+      if (i >= value->size()) {
+        return false;
+      }
+      value = &(*value)[i];
+      bracket = segment.find('[', close);
+    }
+  }
+  if (value->isNull() || value->isObject() || value->isArray()) {
+    return false;
+  }
+  out = value->asString();
+  return true;
+}
+
+// Сигнатура, по которой MediaSniffer узнаёт формат
+const std::string &magic(const std::string &format) {
+  static const std::string mp4("\x00\x00\x00\x18" "ftypmp42", 12);
+  static const std::string jpeg("\xFF\xD8\xFF\xE0", 4);
+  return format == "jpeg" ? jpeg : mp4;
+}
+
+} // namespace
+
+Runner::Runner(const Scenario &scenario)
+    : scenario_(scenario),
+      client_(scenario.load.maxConnections,
+              fromMillis(scenario.load.timeoutMs)) {
+  for (const auto &[name, url] : scenario.targets) {
+    targets_[name] = client_.addTarget(url);
+  }
+  auto checkTarget = [this](const Step &step) {
+    if (!targets_.count(step.target)) {
+      throw std::runtime_error("unknown target " + step.target + " in " +
+                               step.endpoint);
+    }
+  };
+  for (const auto &step : scenario.setup) {
+    checkTarget(step);
+  }
+  for (const auto &flow : scenario.flows) {
+    totalWeight_ += flow.weight;
+    for (const auto &step : flow.steps) {
+      checkTarget(step);
+    }
+  }
+  for (int i = 0; i < std::max(1, scenario.load.users); ++i) {
+    auto user = std::make_unique<User>();
+    user->id = i + 1;
+    user->vars["vu"] = std::to_string(i + 1);
+    user->rng.seed(static_cast<uint64_t>(i) * 7919 + 17);
+    users_.push_back(std::move(user));
+  }
+  results_.scenario = scenario.name;
+  results_.load = scenario.load;
+  if (scenario.load.mode == Load::Mode::kOpen) {
+    results_.correction = "intended_time";
+  } else {
+    results_.correction =
+        scenario.load.thinkMs > 0 ? "intended_time+expected_interval"
+                                  : "intended_time";
+  }
+}
+
+Results Runner::run() {
+  auto now = Clock::now();
+  if (scenario_.setup.empty()) {
+    startMain();
+  } else {
+    setupsLeft_ = users_.size();
+    std::printf("setup: %zu users\n", users_.size());
+    std::fflush(stdout);
+    // Регистрация (bcrypt) дорогая: пользователи заходят по очереди
+    // в течение секунды, а не одной пачкой
+    for (size_t i = 0; i < users_.size(); ++i) {
+      auto session = std::make_shared<Session>();
+      session->user = users_[i].get();
+      session->steps = &scenario_.setup;
+      session->setup = true;
+      session->intended =
+          now + std::chrono::milliseconds(1000) * i / users_.size();
+      client_.runAt(session->intended,
+                    [this, session]() { runStep(session); });
+    }
+  }
+  client_.run();
+  results_.measuredSeconds =
+      std::max(0.0, scenario_.load.durationSeconds -
+                        scenario_.load.warmupSeconds);
+  return std::move(results_);
+}
+
+void Runner::startMain() {
+  start_ = Clock::now();
+  measureFrom_ = start_ + fromMillis(scenario_.load.warmupSeconds * 1000);
+  end_ = start_ + fromMillis(scenario_.load.durationSeconds * 1000);
+  std::printf("load: %s, %.0f s (warmup %.0f s)\n",
+              scenario_.load.mode == Load::Mode::kOpen ? "open" : "closed",
+              scenario_.load.durationSeconds, scenario_.load.warmupSeconds);
+  std::fflush(stdout);
+
+  if (scenario_.load.mode == Load::Mode::kOpen) {
+    nextArrival(start_);
+  } else {
+    for (size_t i = 0; i < users_.size(); ++i) {
+      startFlow(*users_[i],
+                start_ + fromMillis(scenario_.load.thinkMs) * i /
+                             users_.size());
+    }
+  }
+  client_.runAt(end_, [this]() { finishIfDrained(); });
+}
+
+// Расписание приходов не зависит от того, когда сработал таймер:
+// следующий отсчитывается от запланированного, а не от текущего
+void Runner::nextArrival(Clock::time_point previous) {
+  std::exponential_distribution<double> gap(scenario_.load.rate);
+  auto at = previous + fromMillis(gap(rng_) * 1000);
+  if (at >= end_) {
+    return;
+  }
+  client_.runAt(at, [this, at]() {
+    auto &user = *users_[arrivals_++ % users_.size()];
+    startFlow(user, at);
+    nextArrival(at);
+  });
+}
+
+void Runner::startFlow(User &user, Clock::time_point intended) {
+  auto session = std::make_shared<Session>();
+  session->user = &user;
+  session->steps = &pickFlow(user).steps;
+  session->intended = intended;
+  ++results_.sessions;
+  client_.runAt(intended, [this, session]() { runStep(session); });
+}
+
+const Flow &Runner::pickFlow(User &user) {
+  double point =
+      std::uniform_real_distribution<double>(0, totalWeight_)(user.rng);
+  for (const auto &flow : scenario_.flows) {
+    point -= flow.weight;
+    if (point <= 0) {
+      return flow;
+    }
+  }
+  return scenario_.flows.back();
+}
+
+Clock::duration Runner::thinkTime(User &user) {
+  return fromMillis(scenario_.load.thinkMs *
+                    std::uniform_real_distribution<double>(0.5, 1.5)(
+                        user.rng));
+}
+
+void Runner::runStep(std::shared_ptr<Session> session) {
+  if (session->step >= session->steps->size()) {
+    finishSession(session);
+    return;
+  }
+  if (!session->setup && Clock::now() >= end_) {
+    return;
+  }
+  const auto &step = (*session->steps)[session->step];
+  Request request;
+  if (!buildRequest(step, *session->user, request)) {
+    if (session->setup || session->intended >= measureFrom_) {
+      ++results_.endpoints[step.endpoint].skipped;
+    }
+    session->step = session->steps->size();
+    finishSession(session);
+    return;
+  }
+  client_.send(targets_.at(step.target), request,
+               [this, session, &step](Response &&response) {
+                 onResponse(session, step, std::move(response));
+               });
+}
+
+void Runner::onResponse(std::shared_ptr<Session> session, const Step &step,
+                        Response &&response) {
+  auto now = Clock::now();
+  bool ok = response.status != 0 &&
+            (step.expect.empty()
+                 ? response.status >= 200 && response.status < 300
+                 : std::find(step.expect.begin(), step.expect.end(),
+                             response.status) != step.expect.end());
+
+  if (session->setup || session->intended >= measureFrom_) {
+    auto &stats = results_.endpoints[step.endpoint];
+    ++stats.requests;
+    stats.bytes += response.body.size();
+    ++stats.statuses[response.status ? std::to_string(response.status)
+                                     : response.error];
+    if (!ok) {
+      ++stats.errors;
+    } else {
+      auto latency = toMicros(now - session->intended).count();
+      if (!session->setup && scenario_.load.mode == Load::Mode::kClosed) {
+        stats.latency.recordCorrected(
+            latency, static_cast<int64_t>(scenario_.load.thinkMs * 1000));
+      } else {
+        stats.latency.record(latency);
+      }
+    }
+  }
+
+  if (ok && !step.captures.empty()) {
+    Json::Value body;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string errors;
+    if (reader->parse(response.body.data(),
+                      response.body.data() + response.body.size(), &body,
+                      &errors)) {
+      for (const auto &[name, path] : step.captures) {
+        std::string value;
+        if (capture(body, path, session->user->rng, value)) {
+          session->user->vars[name] = value;
+        } else {
+          session->user->vars.erase(name);
+        }
+      }
+    }
+  }
+  if (!ok && session->setup) {
+    ++results_.failedSetups;
+    session->step = session->steps->size();
+    finishSession(session);
+    return;
+  }
+
+  ++session->step;
+  if (session->step >= session->steps->size()) {
+    finishSession(session);
+    return;
+  }
+  session->intended = session->setup ? now : now + thinkTime(*session->user);
+  client_.runAt(session->intended, [this, session]() { runStep(session); });
+}
+
+void Runner::finishSession(const std::shared_ptr<Session> &session) {
+  if (session->setup) {
+    if (--setupsLeft_ == 0) {
+      if (results_.failedSetups > 0) {
+        std::printf("setup failed for %llu users\n",
+                    static_cast<unsigned long long>(results_.failedSetups));
+      }
+      startMain();
+    }
+    return;
+  }
+  if (scenario_.load.mode == Load::Mode::kClosed) {
+    auto next = Clock::now() + thinkTime(*session->user);
+    if (next < end_) {
+      startFlow(*session->user, next);
+    }
+  }
+}
+
+void Runner::finishIfDrained() {
+  auto deadline = end_ + fromMillis(scenario_.load.timeoutMs);
+  if (client_.inFlight() == 0 || Clock::now() >= deadline) {
+    client_.stop();
+    return;
+  }
+  client_.runAt(Clock::now() + std::chrono::milliseconds(50),
+                [this]() { finishIfDrained(); });
+}
+
+bool Runner::expand(const std::string &text, User &user, std::string &out) {
+  out.clear();
+  size_t pos = 0;
+  while (true) {
+    auto open = text.find("${", pos);
+    if (open == std::string::npos) {
+      out.append(text, pos);
+      return true;
+    }
+    auto close = text.find('}', open);
+    if (close == std::string::npos) {
+      out.append(text, pos);
+      return true;
+    }
+    out.append(text, pos, open - pos);
+    auto name = text.substr(open + 2, close - open - 2);
+    pos = close + 1;
+
+    if (name == "seq") {
+      out += std::to_string(++sequence_);
+      continue;
+    }
+    if (name.rfind("rand:", 0) == 0) {
+      auto bound = name.substr(5);
+      auto var = scenario_.vars.find(bound);
+      if (var != scenario_.vars.end()) {
+        bound = var->second;
+      }
+      uint64_t n = std::strtoull(bound.c_str(), nullptr, 10);
+      if (n == 0) {
+        return false;
+      }
+      out += std::to_string(user.rng() % n + 1);
+      continue;
+    }
+    auto userVar = user.vars.find(name);
+    if (userVar != user.vars.end()) {
+      out += userVar->second;
+      continue;
+    }
+    auto var = scenario_.vars.find(name);
+    if (var == scenario_.vars.end()) {
+      return false;
+    }
+    out += var->second;
+  }
+}
+
+bool Runner::buildRequest(const Step &step, User &user, Request &request) {
+  request.method = step.method;
+  if (!expand(step.path, user, request.path)) {
+    return false;
+  }
+  for (const auto &[name, value] : step.headers) {
+    std::string expanded;
+    if (!expand(value, user, expanded)) {
+      return false;
+    }
+    request.headers.emplace_back(name, std::move(expanded));
+  }
+  auto token = user.vars.find("token");
+  if (step.auth && token != user.vars.end()) {
+    request.headers.emplace_back("Authorization", "Bearer " + token->second);
+  }
+
+  if (step.upload) {
+    const auto &upload = *step.upload;
+    auto boundary = "loadgen" + std::to_string(user.rng());
+    request.headers.emplace_back("Content-Type",
+                                 "multipart/form-data; boundary=" + boundary);
+    auto &body = request.body;
+    body.reserve(upload.bytes + 512);
+    body.append("--")
+        .append(boundary)
+        .append("\r\nContent-Disposition: form-data; name=\"")
+        .append(upload.field)
+        .append("\"; filename=\"")
+        .append(upload.filename)
+        .append("\"\r\nContent-Type: ")
+        .append(upload.contentType)
+        .append("\r\n\r\n");
+    const auto &signature = magic(upload.format);
+    body.append(signature);
+    for (size_t i = signature.size(); i < upload.bytes; i += 8) {
+      uint64_t bits = user.rng();
+      body.append(reinterpret_cast<const char *>(&bits),
+                  std::min<size_t>(8, upload.bytes - i));
+    }
+    body.append("\r\n--").append(boundary).append("--\r\n");
+    return true;
+  }
+  if (!expand(step.body, user, request.body)) {
+    return false;
+  }
+  if (step.json) {
+    request.headers.emplace_back("Content-Type", "application/json");
+  }
+  return true;
+}
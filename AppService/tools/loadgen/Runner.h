@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Histogram.h"
+#include "HttpClient.h"
+#include "Scenario.h"
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace loadgen {
+
+struct EndpointStats {
+  Histogram latency;
+  uint64_t requests = 0;
+  // Статус не из expect или ответа нет вовсе
+  uint64_t errors = 0;
+  // Шаг не выполнялся: не хватило переменной
+  uint64_t skipped = 0;
+  // "200", "503", "timeout", "connect: ..." -> сколько раз
+  std::map<std::string, uint64_t> statuses;
+  uint64_t bytes = 0;
+};
+
+struct Results {
+  std::string scenario;
+  Load load;
+  // Окно измерения: от конца разогрева до конца нагрузки
+  double measuredSeconds = 0;
+  std::string correction;
+  uint64_t sessions = 0;
+  uint64_t failedSetups = 0;
+  std::map<std::string, EndpointStats> endpoints;
+};
+
+// Прогон сценария. Задержка запроса считается от момента, когда его
+// следовало отправить (intended time), а не от фактической отправки:
+// если генератор или очередь соединений отстали, это видно в задержке.
+// В открытой модели сессии приходят по расписанию независимо от
+// ответов — задержки честные сами по себе. В закрытой пользователь
+// ждёт ответа, поэтому медленные ответы дополнительно разворачиваются
+// в пропущенные запросы (Histogram::recordCorrected с интервалом
+// think_ms).
+class Runner {
+public:
+  explicit Runner(const Scenario &scenario);
+  Results run();
+
+private:
+  struct User {
+    int id = 0;
+    std::map<std::string, std::string> vars;
+    std::mt19937_64 rng;
+  };
+
+  struct Session {
+    User *user = nullptr;
+    const std::vector<Step> *steps = nullptr;
+    size_t step = 0;
+    Clock::time_point intended;
+    bool setup = false;
+  };
+
+  void startMain();
+  void nextArrival(Clock::time_point previous);
+  void startFlow(User &user, Clock::time_point intended);
+  void runStep(std::shared_ptr<Session> session);
+  void onResponse(std::shared_ptr<Session> session, const Step &step,
+                  Response &&response);
+  void finishSession(const std::shared_ptr<Session> &session);
+  void finishIfDrained();
+
+  bool expand(const std::string &text, User &user, std::string &out);
+  bool buildRequest(const Step &step, User &user, Request &request);
+  const Flow &pickFlow(User &user);
+  Clock::duration thinkTime(User &user);
+
+  const Scenario &scenario_;
+  HttpClient client_;
+  std::map<std::string, int> targets_;
+  std::vector<std::unique_ptr<User>> users_;
+  double totalWeight_ = 0;
+  uint64_t sequence_ = 0;
+  size_t setupsLeft_ = 0;
+  uint64_t arrivals_ = 0;
+  std::mt19937_64 rng_{1};
+
+  Clock::time_point start_;
+  Clock::time_point measureFrom_;
+  Clock::time_point end_;
+  Results results_;
+};
+
+} // namespace loadgen
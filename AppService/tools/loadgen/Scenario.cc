@@ -0,0 +1,125 @@
+#include "Scenario.h"
+#include <fstream>
+#include <json/json.h>
+#include <stdexcept>
+
+using namespace loadgen;
+
+namespace {
+
+std::string scalar(const Json::Value &value) {
+  if (value.isString()) {
+    return value.asString();
+  }
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, value);
+}
+
+Step parseStep(const Json::Value &json, const std::string &flowName) {
+  Step step;
+  step.endpoint = json.get("endpoint", flowName).asString();
+  step.target = json.get("target", "app").asString();
+  step.method = json.get("method", "GET").asString();
+  step.path = json["path"].asString();
+  if (step.path.empty()) {
+    throw std::runtime_error("step " + step.endpoint + " has no path");
+  }
+  step.auth = json.get("auth", true).asBool();
+  for (const auto &name : json["headers"].getMemberNames()) {
+    step.headers.emplace_back(name, json["headers"][name].asString());
+  }
+  if (json.isMember("json")) {
+    step.body = scalar(json["json"]);
+    step.json = true;
+  } else {
+    step.body = json.get("body", "").asString();
+  }
+  if (json.isMember("upload")) {
+    const auto &upload = json["upload"];
+    Upload parsed;
+    parsed.field = upload.get("field", parsed.field).asString();
+    parsed.format = upload.get("format", parsed.format).asString();
+    if (parsed.format == "jpeg") {
+      parsed.filename = "loadgen.jpg";
+      parsed.contentType = "image/jpeg";
+    } else if (parsed.format != "mp4") {
+      throw std::runtime_error("upload format must be mp4 or jpeg");
+    }
+    parsed.filename = upload.get("filename", parsed.filename).asString();
+    parsed.contentType =
+        upload.get("content_type", parsed.contentType).asString();
+    parsed.bytes = upload.get("bytes", Json::UInt64(parsed.bytes)).asUInt64();
+    step.upload = parsed;
+  }
+  for (const auto &name : json["capture"].getMemberNames()) {
+    step.captures.emplace_back(name, json["capture"][name].asString());
+  }
+  for (const auto &status : json["expect"]) {
+    step.expect.push_back(status.asInt());
+  }
+  return step;
+}
+
+} // namespace
+
+Scenario Scenario::fromFile(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  Json::Value json;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  if (!Json::parseFromStream(builder, in, &json, &errors)) {
+    throw std::runtime_error(path + ": " + errors);
+  }
+
+  Scenario scenario;
+  scenario.name = json.get("name", path).asString();
+  for (const auto &name : json["targets"].getMemberNames()) {
+    scenario.targets[name] = json["targets"][name].asString();
+  }
+  for (const auto &name : json["vars"].getMemberNames()) {
+    scenario.vars[name] = scalar(json["vars"][name]);
+  }
+
+  const auto &load = json["load"];
+  auto mode = load.get("mode", "closed").asString();
+  if (mode != "closed" && mode != "open") {
+    throw std::runtime_error("load.mode must be closed or open");
+  }
+  auto &config = scenario.load;
+  config.mode = mode == "open" ? Load::Mode::kOpen : Load::Mode::kClosed;
+  config.users = load.get("users", config.users).asInt();
+  config.rate = load.get("rate", config.rate).asDouble();
+  config.durationSeconds =
+      load.get("duration_s", config.durationSeconds).asDouble();
+  config.warmupSeconds = load.get("warmup_s", config.warmupSeconds).asDouble();
+  config.thinkMs = load.get("think_ms", config.thinkMs).asDouble();
+  config.timeoutMs = load.get("timeout_ms", config.timeoutMs).asDouble();
+  config.maxConnections =
+      load.get("max_connections", Json::UInt64(config.maxConnections))
+          .asUInt64();
+
+  for (const auto &step : json["setup"]) {
+    scenario.setup.push_back(parseStep(step, "setup"));
+  }
+  for (const auto &flowJson : json["flows"]) {
+    Flow flow;
+    flow.name = flowJson["name"].asString();
+    flow.weight = flowJson.get("weight", 1.0).asDouble();
+    for (const auto &step : flowJson["steps"]) {
+      flow.steps.push_back(parseStep(step, flow.name));
+    }
+    if (flow.steps.empty() || flow.weight <= 0) {
+      throw std::runtime_error("flow " + flow.name +
+                               " needs steps and a positive weight");
+    }
+    scenario.flows.push_back(std::move(flow));
+  }
+  if (scenario.flows.empty()) {
+    throw std::runtime_error(path + ": no flows");
+  }
+  return scenario;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace loadgen {
+
+// Тело multipart/form-data: сигнатура формата и случайные байты, чтобы
+// дедупликация загрузок не превращала их в один файл
+struct Upload {
+  std::string field = "file";
+  std::string filename = "loadgen.mp4";
+  std::string contentType = "video/mp4";
+  // mp4 или jpeg
+  std::string format = "mp4";
+  size_t bytes = 256 * 1024;
+};
+
+// Строки path, body, заголовков и json — шаблоны: ${имя} подставляется
+// из переменных виртуального пользователя (vu, token, захваченные
+// значения), затем из vars сценария. Встроенные:
+//   ${seq}        — сквозной счётчик запросов;
+//   ${rand:N}     — случайное 1..N, N — число или имя переменной.
+// Если переменной нет (например, лента пуста и id не захватился),
+// оставшиеся шаги этого прохода пропускаются.
+struct Step {
+  // Имя в отчёте; одинаковые имена — одна строка отчёта
+  std::string endpoint;
+  // Ключ targets
+  std::string target = "app";
+  std::string method = "GET";
+  std::string path;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  bool json = false;
+  std::optional<Upload> upload;
+  // Переменная -> путь в JSON ответа: "token", "posts[*].id" (случайный
+  // элемент), "files[0].file_path"
+  std::vector<std::pair<std::string, std::string>> captures;
+  // Какие статусы — успех; пусто — любой 2xx
+  std::vector<int> expect;
+  // Добавлять Authorization: Bearer ${token}, если токен есть
+  bool auth = true;
+};
+
+struct Flow {
+  std::string name;
+  double weight = 1;
+  std::vector<Step> steps;
+};
+
+struct Load {
+  enum class Mode { kClosed, kOpen };
+  Mode mode = Mode::kClosed;
+  // closed — столько пользователей работают без перерыва; open — столько
+  // учётных записей делят между собой приходящие сессии
+  int users = 20;
+  // open: новых сессий в секунду (пуассоновский поток)
+  double rate = 20;
+  double durationSeconds = 60;
+  double warmupSeconds = 5;
+  // Пауза между шагами; равномерно от половины до полутора
+  double thinkMs = 500;
+  double timeoutMs = 10000;
+  size_t maxConnections = 1024;
+};
+
+struct Scenario {
+  std::string name;
+  std::map<std::string, std::string> targets;
+  Load load;
+  std::map<std::string, std::string> vars;
+  // Один раз на пользователя перед основной нагрузкой: регистрация и
+  // вход; в отчёт попадают всегда, без разогрева
+  std::vector<Step> setup;
+  std::vector<Flow> flows;
+
+  // Ошибки — std::runtime_error
+  static Scenario fromFile(const std::string &path);
+};
+
+} // namespace loadgen
@@ -0,0 +1,197 @@
+// Нагрузочный генератор по сценарию: виртуальные пользователи
+// регистрируются и входят через AuthService, затем проходят потоки из
+// сценария (лента, поиск, лайк, комментарий, загрузка, профиль) в
+// заданной пропорции. Закрытая модель — фиксированное число
+// пользователей с паузами; открытая — сессии приходят с заданной
+// частотой независимо от ответов сервера.
+//
+// Запуск против локальных сервисов:
+//   loadgen tools/loadgen/scenarios/user_flow.json --out results.json
+//   loadgen tools/loadgen/scenarios/user_flow.json --mode open --rate 50
+//           --baseline results.json
+//
+// С --baseline код возврата 3, если есть регрессии (см. Report.h).
+#include "Report.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace loadgen;
+
+namespace {
+
+struct Options {
+  std::string scenario;
+  std::vector<std::string> overrides;
+  std::string out;
+  std::string baseline;
+  double tolerance = 0.1;
+};
+
+void usage(const char *program) {
+  std::fprintf(
+      stderr,
+      "usage: %s SCENARIO.json [options]\n"
+      "  --mode closed|open\n"
+      "  --users N\n"
+      "  --rate X                  сессий в секунду (open)\n"
+      "  --duration S\n"
+      "  --warmup S\n"
+      "  --think MS\n"
+      "  --timeout MS\n"
+      "  --var NAME=VALUE          переопределить vars сценария\n"
+      "  --target NAME=URL         переопределить targets сценария\n"
+      "  --out FILE                результаты в JSON\n"
+      "  --baseline FILE           сравнить с прошлым прогоном\n"
+      "  --tolerance X             0.1   допустимое ухудшение\n",
+      program);
+}
+
+std::pair<std::string, std::string> keyValue(const std::string &value) {
+  auto eq = value.find('=');
+  if (eq == std::string::npos || eq == 0) {
+    throw std::runtime_error("expected NAME=VALUE: " + value);
+  }
+  return {value.substr(0, eq), value.substr(eq + 1)};
+}
+
+Options parseOptions(int argc, char **argv, Scenario &scenario) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      usage(argv[0]);
+      std::exit(0);
+    }
+    if (name.rfind("--", 0) != 0) {
+      if (!options.scenario.empty()) {
+        throw std::runtime_error("unexpected argument " + name);
+      }
+      options.scenario = name;
+      scenario = Scenario::fromFile(name);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      throw std::runtime_error("missing value for " + name);
+    }
+    std::string value = argv[++i];
+    if (name == "--out") {
+      options.out = value;
+    } else if (name == "--baseline") {
+      options.baseline = value;
+    } else if (name == "--tolerance") {
+      options.tolerance = std::atof(value.c_str());
+    } else {
+      // Применяются после чтения сценария
+      options.overrides.push_back(name);
+      options.overrides.push_back(value);
+    }
+  }
+  if (options.scenario.empty()) {
+    throw std::runtime_error("scenario file is required");
+  }
+
+  auto &load = scenario.load;
+  for (size_t i = 0; i < options.overrides.size(); i += 2) {
+    const auto &name = options.overrides[i];
+    const auto &value = options.overrides[i + 1];
+    if (name == "--mode") {
+      if (value != "closed" && value != "open") {
+        throw std::runtime_error("--mode must be closed or open");
+      }
+      load.mode = value == "open" ? Load::Mode::kOpen : Load::Mode::kClosed;
+    } else if (name == "--users") {
+      load.users = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "--rate") {
+      load.rate = std::atof(value.c_str());
+    } else if (name == "--duration") {
+      load.durationSeconds = std::atof(value.c_str());
+    } else if (name == "--warmup") {
+      load.warmupSeconds = std::atof(value.c_str());
+    } else if (name == "--think") {
+      load.thinkMs = std::atof(value.c_str());
+    } else if (name == "--timeout") {
+      load.timeoutMs = std::atof(value.c_str());
+    } else if (name == "--var") {
+      auto [key, var] = keyValue(value);
+      scenario.vars[key] = var;
+    } else if (name == "--target") {
+      auto [key, url] = keyValue(value);
+      scenario.targets[key] = url;
+    } else {
+      throw std::runtime_error("unknown option " + name);
+    }
+  }
+  if (load.mode == Load::Mode::kOpen && load.rate <= 0) {
+    throw std::runtime_error("--rate must be positive");
+  }
+  if (load.durationSeconds <= load.warmupSeconds) {
+    throw std::runtime_error("--duration must be longer than --warmup");
+  }
+  return options;
+}
+
+Json::Value readJson(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  Json::Value json;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  if (!Json::parseFromStream(builder, in, &json, &errors)) {
+    throw std::runtime_error(path + ": " + errors);
+  }
+  return json;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Scenario scenario;
+  Options options;
+  try {
+    options = parseOptions(argc, argv, scenario);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    usage(argv[0]);
+    return 2;
+  }
+
+  try {
+    // Читаем заранее: опечатка в пути не должна всплыть после прогона
+    Json::Value baseline;
+    if (!options.baseline.empty()) {
+      baseline = readJson(options.baseline);
+    }
+
+    Runner runner(scenario);
+    auto results = toJson(runner.run());
+    printSummary(results);
+
+    if (!options.out.empty()) {
+      Json::StreamWriterBuilder builder;
+      builder["indentation"] = "  ";
+      std::ofstream out(options.out);
+      out << Json::writeString(builder, results) << "\n";
+      if (!out) {
+        throw std::runtime_error("cannot write " + options.out);
+      }
+    }
+    if (!options.baseline.empty()) {
+      int regressions = compare(results, baseline, options.tolerance);
+      std::printf("%d regressions (tolerance %.0f%%)\n", regressions,
+                  options.tolerance * 100);
+      if (regressions > 0) {
+        return 3;
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
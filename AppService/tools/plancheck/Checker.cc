@@ -0,0 +1,375 @@
+#include "Checker.h"
+#include <libpq-fe.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+using namespace plancheck;
+
+namespace {
+
+constexpr unsigned kInt8Oid = 20;
+
+// Меньшие изменения — шум: подсказки видимости, соседние страницы
+// индекса
+constexpr int64_t kBufferSlack = 16;
+// Ошибка оценки ниже этого порога планы не ломает
+constexpr double kMisestimateFloor = 10;
+
+std::string lastError(PGconn *conn) {
+  std::string message = PQerrorMessage(conn);
+  while (!message.empty() && message.back() == '\n') {
+    message.pop_back();
+  }
+  return message;
+}
+
+using ResultPtr = std::unique_ptr<PGresult, decltype(&PQclear)>;
+
+std::vector<std::string> stringList(const Json::Value &json,
+                                    const std::string &what) {
+  std::vector<std::string> values;
+  if (json.isNull()) {
+    return values;
+  }
+  if (!json.isArray()) {
+    throw std::runtime_error(what + ": expected an array");
+  }
+  for (const auto &value : json) {
+    values.push_back(value.asString());
+  }
+  return values;
+}
+
+std::string joinSql(const Json::Value &sql) {
+  // Длинный запрос можно записать массивом строк
+  if (!sql.isArray()) {
+    return sql.asString();
+  }
+  std::string text;
+  for (const auto &line : sql) {
+    if (!text.empty()) {
+      text += ' ';
+    }
+    text += line.asString();
+  }
+  return text;
+}
+
+Expect parseExpect(const Json::Value &json, const Expect &defaults,
+                   const std::string &name) {
+  Expect expect = defaults;
+  if (json.isNull()) {
+    return expect;
+  }
+  expect.indexes = stringList(json["indexes"], name + ".indexes");
+  expect.noSeqScan = stringList(json["no_seq_scan"], name + ".no_seq_scan");
+  expect.maxMisestimate =
+      json.get("max_misestimate", defaults.maxMisestimate).asDouble();
+  expect.maxBuffers =
+      json.get("max_buffers", Json::Int64(defaults.maxBuffers)).asInt64();
+  expect.xfail = json.get("xfail", "").asString();
+  return expect;
+}
+
+bool isInteger(const std::string &value) {
+  size_t start = !value.empty() && value[0] == '-' ? 1 : 0;
+  return value.size() > start &&
+         std::all_of(value.begin() + start, value.end(),
+                     [](char c) { return c >= '0' && c <= '9'; });
+}
+
+std::string percent(double now, double before) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%+.0f%%",
+                before > 0 ? (now / before - 1) * 100 : 100.0);
+  return buffer;
+}
+
+std::string number(double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.1f", value);
+  return buffer;
+}
+
+} // namespace
+
+Catalogue Catalogue::fromFile(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  Json::Value json;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  if (!Json::parseFromStream(builder, in, &json, &errors)) {
+    throw std::runtime_error(path + ": " + errors);
+  }
+
+  Catalogue catalogue;
+  catalogue.session = stringList(json["session"], "session");
+  const auto &fixtures = json["fixtures"];
+  for (const auto &name : fixtures.getMemberNames()) {
+    catalogue.fixtures.emplace_back(name, joinSql(fixtures[name]));
+  }
+  Expect defaults = parseExpect(json["defaults"], Expect{}, "defaults");
+
+  for (const auto &entry : json["queries"]) {
+    Query query;
+    query.name = entry["name"].asString();
+    if (query.name.empty()) {
+      throw std::runtime_error(path + ": query without a name");
+    }
+    query.sources = stringList(entry["sources"], query.name + ".sources");
+    query.sql = joinSql(entry["sql"]);
+    if (query.sql.empty()) {
+      throw std::runtime_error(path + ": " + query.name + " has no sql");
+    }
+    query.params = entry.get("params", Json::Value(Json::arrayValue));
+    if (!query.params.isArray()) {
+      throw std::runtime_error(query.name + ".params: expected an array");
+    }
+    query.expect = parseExpect(entry["expect"], defaults, query.name);
+    catalogue.queries.push_back(std::move(query));
+  }
+  return catalogue;
+}
+
+Connection::Connection(const std::string &conninfo)
+    : conn_(PQconnectdb(conninfo.c_str())) {
+  if (PQstatus(conn_) != CONNECTION_OK) {
+    auto message = lastError(conn_);
+    PQfinish(conn_);
+    throw std::runtime_error("connect failed: " + message);
+  }
+}
+
+Connection::~Connection() { PQfinish(conn_); }
+
+void Connection::exec(const std::string &sql) {
+  ResultPtr result(PQexec(conn_, sql.c_str()), PQclear);
+  auto status = PQresultStatus(result.get());
+  if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+    throw std::runtime_error(sql + ": " + lastError(conn_));
+  }
+}
+
+std::string Connection::value(const std::string &sql) {
+  ResultPtr result(PQexec(conn_, sql.c_str()), PQclear);
+  if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+    throw std::runtime_error(sql + ": " + lastError(conn_));
+  }
+  if (PQntuples(result.get()) == 0 || PQgetisnull(result.get(), 0, 0)) {
+    throw std::runtime_error(sql + ": no value");
+  }
+  return std::string(PQgetvalue(result.get(), 0, 0),
+                     PQgetlength(result.get(), 0, 0));
+}
+
+Json::Value Connection::explain(const std::string &sql,
+                                const std::vector<std::string> &params,
+                                const std::vector<bool> &isNull,
+                                const std::vector<unsigned> &types) {
+  std::vector<const char *> values(params.size());
+  for (size_t i = 0; i < params.size(); ++i) {
+    values[i] = isNull[i] ? nullptr : params[i].c_str();
+  }
+  auto statement = "EXPLAIN (ANALYZE, BUFFERS, FORMAT JSON) " + sql;
+
+  exec("BEGIN");
+  ResultPtr result(PQexecParams(conn_, statement.c_str(),
+                                static_cast<int>(params.size()),
+                                types.data(), values.data(), nullptr,
+                                nullptr, 0),
+                   PQclear);
+  if (PQresultStatus(result.get()) != PGRES_TUPLES_OK) {
+    auto message = lastError(conn_);
+    exec("ROLLBACK");
+    throw std::runtime_error(message);
+  }
+  std::string text(PQgetvalue(result.get(), 0, 0),
+                   PQgetlength(result.get(), 0, 0));
+  exec("ROLLBACK");
+
+  Json::Value json;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  if (!reader->parse(text.data(), text.data() + text.size(), &json,
+                     &errors)) {
+    throw std::runtime_error("EXPLAIN output: " + errors);
+  }
+  return json;
+}
+
+Checker::Checker(const Catalogue &catalogue, Connection &conn)
+    : catalogue_(catalogue), conn_(conn) {}
+
+void Checker::prepare() {
+  for (const auto &statement : catalogue_.session) {
+    conn_.exec(statement);
+  }
+  values_.clear();
+  for (const auto &[name, sql] : catalogue_.fixtures) {
+    try {
+      values_.emplace_back(name, conn_.value(sql));
+    } catch (const std::exception &e) {
+      throw std::runtime_error("fixture " + name + ": " + e.what());
+    }
+  }
+}
+
+std::string Checker::substitute(const std::string &text) const {
+  std::string out;
+  size_t pos = 0;
+  while (true) {
+    auto open = text.find("${", pos);
+    if (open == std::string::npos) {
+      return out + text.substr(pos);
+    }
+    auto close = text.find('}', open);
+    if (close == std::string::npos) {
+      throw std::runtime_error("unterminated ${ in " + text);
+    }
+    auto name = text.substr(open + 2, close - open - 2);
+    const std::string *value = nullptr;
+    for (const auto &[fixture, fixtureValue] : values_) {
+      if (fixture == name) {
+        value = &fixtureValue;
+      }
+    }
+    if (!value) {
+      throw std::runtime_error("unknown fixture ${" + name + "}");
+    }
+    out += text.substr(pos, open - pos) + *value;
+    pos = close + 1;
+  }
+}
+
+Result Checker::check(const Query &query, const Json::Value &baseline,
+                      double tolerance) {
+  std::vector<std::string> params;
+  std::vector<bool> isNull;
+  std::vector<unsigned> types;
+  for (const auto &param : query.params) {
+    isNull.push_back(param.isNull());
+    if (param.isNull()) {
+      params.emplace_back();
+      types.push_back(0);
+      continue;
+    }
+    auto value = param.isIntegral() ? std::to_string(param.asInt64())
+                                    : substitute(param.asString());
+    types.push_back(isInteger(value) ? kInt8Oid : 0);
+    params.push_back(std::move(value));
+  }
+
+  Result result;
+  result.query = &query;
+  conn_.explain(query.sql, params, isNull, types);
+  result.plan = parsePlan(conn_.explain(query.sql, params, isNull, types));
+  const auto &root = result.plan.root;
+  result.misestimate = misestimate(root);
+
+  const auto &expect = query.expect;
+  for (const auto &index : expect.indexes) {
+    if (!usesIndex(root, index)) {
+      result.failures.push_back("index " + index + " is not used");
+    }
+  }
+  for (const auto &relation : expect.noSeqScan) {
+    if (seqScans(root, relation)) {
+      result.failures.push_back("seq scan on " + relation);
+    }
+  }
+  if (result.misestimate > expect.maxMisestimate) {
+    result.failures.push_back("row estimate off by x" +
+                              number(result.misestimate) + ", limit x" +
+                              number(expect.maxMisestimate));
+  }
+  if (expect.maxBuffers > 0 && root.buffers > expect.maxBuffers) {
+    result.failures.push_back("buffers " + std::to_string(root.buffers) +
+                              ", limit " +
+                              std::to_string(expect.maxBuffers));
+  }
+
+  if (baseline.isNull()) {
+    return result;
+  }
+  result.inBaseline = true;
+
+  std::vector<std::string> before;
+  for (const auto &line : baseline["shape"]) {
+    before.push_back(line.asString());
+  }
+  auto after = shape(root);
+  if (before != after) {
+    result.regressions.push_back("plan changed");
+    result.diff = diffLines(before, after);
+  }
+
+  auto baseBuffers = baseline["buffers"].asInt64();
+  if (root.buffers > baseBuffers * (1 + tolerance) &&
+      root.buffers - baseBuffers > kBufferSlack) {
+    result.regressions.push_back(
+        "buffers " + std::to_string(root.buffers) + ", baseline " +
+        std::to_string(baseBuffers) + " (" +
+        percent(root.buffers, baseBuffers) + ")");
+  }
+
+  auto baseError = baseline["misestimate"].asDouble();
+  if (result.misestimate > baseError * (1 + tolerance) &&
+      result.misestimate > kMisestimateFloor) {
+    result.regressions.push_back("row estimate off by x" +
+                                 number(result.misestimate) +
+                                 ", baseline x" + number(baseError));
+  }
+  return result;
+}
+
+Json::Value plancheck::baselineEntry(const Result &result) {
+  Json::Value entry;
+  for (const auto &line : shape(result.plan.root)) {
+    entry["shape"].append(line);
+  }
+  entry["buffers"] = Json::Int64(result.plan.root.buffers);
+  entry["misestimate"] = std::round(result.misestimate * 10) / 10;
+  // Для сведения: время не сравнивается, оно зависит от машины
+  entry["execution_ms"] = std::round(result.plan.executionMs * 100) / 100;
+  return entry;
+}
+
+std::vector<std::string>
+plancheck::diffLines(const std::vector<std::string> &before,
+                     const std::vector<std::string> &after) {
+  size_t n = before.size();
+  size_t m = after.size();
+  // common[i][j] — длина общей подпоследовательности хвостов
+  std::vector<std::vector<size_t>> common(n + 1,
+                                          std::vector<size_t>(m + 1, 0));
+  for (size_t i = n; i-- > 0;) {
+    for (size_t j = m; j-- > 0;) {
+      common[i][j] = before[i] == after[j]
+                         ? common[i + 1][j + 1] + 1
+                         : std::max(common[i + 1][j], common[i][j + 1]);
+    }
+  }
+
+  std::vector<std::string> lines;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < n || j < m) {
+    if (i < n && j < m && before[i] == after[j]) {
+      lines.push_back("  " + before[i++]);
+      ++j;
+    } else if (i < n && (j == m || common[i + 1][j] >= common[i][j + 1])) {
+      lines.push_back("- " + before[i++]);
+    } else {
+      lines.push_back("+ " + after[j++]);
+    }
+  }
+  return lines;
+}
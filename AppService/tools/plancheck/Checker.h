@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Plan.h"
+#include <json/json.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct pg_conn;
+
+namespace plancheck {
+
+// Ожидания из каталога (tests/plans/queries.json)
+struct Expect {
+  // Индексы, которые план обязан использовать
+  std::vector<std::string> indexes;
+  // Таблицы, которые нельзя читать Seq Scan
+  std::vector<std::string> noSeqScan;
+  double maxMisestimate = 100;
+  // shared hit + read; 0 — без предела
+  int64_t maxBuffers = 0;
+  // Известная проблема: нарушения ожиданий выводятся, но не считаются
+  // ошибкой. Сравнение с эталоном действует как обычно.
+  std::string xfail;
+};
+
+struct Query {
+  // "<Контроллер или сервис>.<метод>[.<вариант>]"
+  std::string name;
+  // Где в коде выполняется запрос
+  std::vector<std::string> sources;
+  std::string sql;
+  // ${fixture} в строках заменяется значением фикстуры. Целые (и
+  // строки из одних цифр) уходят как bigint, как int64_t у drogon,
+  // остальное — без типа, его выводит сервер.
+  Json::Value params;
+  Expect expect;
+};
+
+struct Catalogue {
+  // Выполняются один раз после подключения (SET ...)
+  std::vector<std::string> session;
+  // Имя -> запрос, возвращающий одно значение (id пользователя, поста)
+  std::vector<std::pair<std::string, std::string>> fixtures;
+  std::vector<Query> queries;
+
+  // Ошибки — std::runtime_error
+  static Catalogue fromFile(const std::string &path);
+};
+
+class Connection {
+public:
+  explicit Connection(const std::string &conninfo);
+  ~Connection();
+  Connection(const Connection &) = delete;
+  Connection &operator=(const Connection &) = delete;
+
+  void exec(const std::string &sql);
+  // Первое поле первой строки; пустая выборка или NULL — ошибка
+  std::string value(const std::string &sql);
+  // EXPLAIN (ANALYZE, BUFFERS, FORMAT JSON) в транзакции, которая
+  // затем откатывается: запросы на запись ничего не меняют
+  Json::Value explain(const std::string &sql,
+                      const std::vector<std::string> &params,
+                      const std::vector<bool> &isNull,
+                      const std::vector<unsigned> &types);
+
+private:
+  pg_conn *conn_;
+};
+
+struct Result {
+  const Query *query = nullptr;
+  Plan plan;
+  double misestimate = 1;
+  // Нарушенные ожидания каталога
+  std::vector<std::string> failures;
+  // Ухудшения относительно эталона
+  std::vector<std::string> regressions;
+  // Построчная разница формы плана с эталоном: "  ", "- ", "+ "
+  std::vector<std::string> diff;
+  bool inBaseline = false;
+};
+
+class Checker {
+public:
+  Checker(const Catalogue &catalogue, Connection &conn);
+
+  // Вычисляет фикстуры; вызвать один раз до check()
+  void prepare();
+
+  // baseline — запись эталона для этого запроса или null. Первое
+  // выполнение прогревает кэш и не учитывается.
+  Result check(const Query &query, const Json::Value &baseline,
+               double tolerance);
+
+  const std::vector<std::pair<std::string, std::string>> &fixtures() const {
+    return values_;
+  }
+
+private:
+  std::string substitute(const std::string &text) const;
+
+  const Catalogue &catalogue_;
+  Connection &conn_;
+  std::vector<std::pair<std::string, std::string>> values_;
+};
+
+// Запись эталона: форма плана, буферы, ошибка оценки, время
+Json::Value baselineEntry(const Result &result);
+
+// Разница по наибольшей общей подпоследовательности строк
+std::vector<std::string> diffLines(const std::vector<std::string> &before,
+                                   const std::vector<std::string> &after);
+
+} // namespace plancheck
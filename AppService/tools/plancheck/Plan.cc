@@ -0,0 +1,149 @@
+#include "Plan.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace plancheck;
+
+namespace {
+
+Node parseNode(const Json::Value &json) {
+  if (!json.isObject() || !json.isMember("Node Type")) {
+    throw std::runtime_error("unexpected EXPLAIN output: no Node Type");
+  }
+  Node node;
+  node.type = json["Node Type"].asString();
+  node.joinType = json.get("Join Type", "").asString();
+  node.relation = json.get("Relation Name", "").asString();
+  node.index = json.get("Index Name", "").asString();
+  node.planRows = json.get("Plan Rows", 0).asDouble();
+  node.actualRows = json.get("Actual Rows", 0).asDouble();
+  node.loops = json.get("Actual Loops", 0).asDouble();
+  node.buffers = json.get("Shared Hit Blocks", 0).asInt64() +
+                 json.get("Shared Read Blocks", 0).asInt64();
+  for (const auto &child : json["Plans"]) {
+    node.children.push_back(parseNode(child));
+  }
+  return node;
+}
+
+void walkShape(const Node &node, int depth, std::vector<std::string> &out) {
+  out.push_back(std::string(depth * 2, ' ') + node.label());
+  for (const auto &child : node.children) {
+    walkShape(child, depth + 1, out);
+  }
+}
+
+std::string formatRows(double rows) {
+  char buffer[32];
+  if (rows == static_cast<double>(static_cast<int64_t>(rows))) {
+    std::snprintf(buffer, sizeof(buffer), "%lld",
+                  static_cast<long long>(rows));
+  } else {
+    std::snprintf(buffer, sizeof(buffer), "%.1f", rows);
+  }
+  return buffer;
+}
+
+void walkRender(const Node &node, int depth, std::vector<std::string> &out) {
+  std::string line = std::string(depth * 2, ' ') + node.label() + "  (";
+  if (node.loops == 0) {
+    line += "est " + formatRows(node.planRows) + ", never executed";
+  } else {
+    line += "rows " + formatRows(node.actualRows) + " est " +
+            formatRows(node.planRows);
+    if (node.loops > 1) {
+      line += " x" + formatRows(node.loops) + " loops";
+    }
+    line += ", buffers " + std::to_string(node.buffers);
+  }
+  out.push_back(line + ")");
+  for (const auto &child : node.children) {
+    walkRender(child, depth + 1, out);
+  }
+}
+
+double nodeError(const Node &node) {
+  double estimated = std::max(node.planRows, 1.0);
+  double actual = std::max(node.actualRows, 1.0);
+  return std::max(estimated, actual) / std::min(estimated, actual);
+}
+
+double walkError(const Node &node) {
+  if (node.loops == 0) {
+    return 1;
+  }
+  double worst = nodeError(node);
+  if (node.type == "Limit") {
+    return worst;
+  }
+  bool stopsEarly = node.joinType == "Semi" || node.joinType == "Anti";
+  for (size_t i = 0; i < node.children.size(); ++i) {
+    if (stopsEarly && i == 1) {
+      continue;
+    }
+    worst = std::max(worst, walkError(node.children[i]));
+  }
+  return worst;
+}
+
+} // namespace
+
+std::string Node::label() const {
+  std::string text = type;
+  if (!joinType.empty() && joinType != "Inner") {
+    text += " (" + joinType + ")";
+  }
+  if (!index.empty()) {
+    text += " using " + index;
+  }
+  if (!relation.empty()) {
+    text += " on " + relation;
+  }
+  return text;
+}
+
+Plan plancheck::parsePlan(const Json::Value &explain) {
+  if (!explain.isArray() || explain.empty() ||
+      !explain[0].isMember("Plan")) {
+    throw std::runtime_error("unexpected EXPLAIN output");
+  }
+  const auto &top = explain[0];
+  Plan plan;
+  plan.root = parseNode(top["Plan"]);
+  plan.planningMs = top.get("Planning Time", 0).asDouble();
+  plan.executionMs = top.get("Execution Time", 0).asDouble();
+  return plan;
+}
+
+std::vector<std::string> plancheck::shape(const Node &root) {
+  std::vector<std::string> lines;
+  walkShape(root, 0, lines);
+  return lines;
+}
+
+std::vector<std::string> plancheck::render(const Node &root) {
+  std::vector<std::string> lines;
+  walkRender(root, 0, lines);
+  return lines;
+}
+
+double plancheck::misestimate(const Node &root) { return walkError(root); }
+
+bool plancheck::usesIndex(const Node &root, const std::string &index) {
+  if (root.index == index) {
+    return true;
+  }
+  return std::any_of(
+      root.children.begin(), root.children.end(),
+      [&](const Node &child) { return usesIndex(child, index); });
+}
+
+bool plancheck::seqScans(const Node &root, const std::string &relation) {
+  if (root.type == "Seq Scan" && root.relation == relation) {
+    return true;
+  }
+  return std::any_of(
+      root.children.begin(), root.children.end(),
+      [&](const Node &child) { return seqScans(child, relation); });
+}
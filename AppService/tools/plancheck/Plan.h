@@ -0,0 +1,56 @@
+#pragma once
+
+#include <json/json.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace plancheck {
+
+// Узел EXPLAIN (ANALYZE, BUFFERS, FORMAT JSON) — только то, что
+// проверяется
+struct Node {
+  std::string type;
+  // "Inner", "Semi", "Anti"... для соединений
+  std::string joinType;
+  std::string relation;
+  std::string index;
+  // Строки на один проход: оценка и среднее фактическое
+  double planRows = 0;
+  double actualRows = 0;
+  double loops = 0;
+  // shared hit + read, вместе с дочерними узлами
+  int64_t buffers = 0;
+  std::vector<Node> children;
+
+  // "Index Scan using idx_author on posts"
+  std::string label() const;
+};
+
+struct Plan {
+  Node root;
+  double planningMs = 0;
+  double executionMs = 0;
+};
+
+// Вход — массив, который возвращает EXPLAIN (FORMAT JSON); ошибки —
+// std::runtime_error
+Plan parsePlan(const Json::Value &explain);
+
+// Форма плана: узлы с отступами, без чисел. По ней план сравнивается
+// с эталоном.
+std::vector<std::string> shape(const Node &root);
+
+// То же с оценками, фактическими строками и буферами — для вывода
+std::vector<std::string> render(const Node &root);
+
+// Наибольшая ошибка оценки строк, max(оценка, факт) / min(...), по
+// выполненным узлам. Узлы под Limit и внутренняя сторона Semi/Anti
+// Join останавливаются раньше, чем предполагает оценка, и не
+// учитываются.
+double misestimate(const Node &root);
+
+bool usesIndex(const Node &root, const std::string &index);
+bool seqScans(const Node &root, const std::string &relation);
+
+} // namespace plancheck
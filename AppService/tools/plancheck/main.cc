@@ -0,0 +1,245 @@
+// Проверка планов запросов: каждый запрос контроллеров и сервисов из
+// каталога (tests/plans/queries.json) выполняется через
+// EXPLAIN (ANALYZE, BUFFERS) на заранее заполненной базе. Проверяются
+// ожидания каталога (какие индексы используются, где нельзя Seq Scan,
+// ошибка оценки строк, буферы) и отличия от эталона: форма плана,
+// буферы и ошибка оценки с допуском. Изменившийся план выводится
+// построчной разницей с эталоном.
+//
+// Базу готовит tests/plan_check.sh (миграции и datagen с фиксированным
+// seed). Запуск вручную:
+//   plancheck tests/plans/queries.json --db "host=... dbname=..."
+//             --baseline tests/plans/baseline.json
+//   plancheck ... --update      — записать эталон заново
+//
+// Код возврата 3 — нарушены ожидания или есть регрессии.
+#include "Checker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace plancheck;
+
+namespace {
+
+struct Options {
+  std::string catalogue;
+  std::string db = "host=127.0.0.1 port=5433 dbname=app_service_plans "
+                   "user=root password=12341234";
+  std::string baseline;
+  bool update = false;
+  double tolerance = 0.2;
+  // Только запросы, в имени которых есть эта строка
+  std::string only;
+  bool verbose = false;
+};
+
+void usage(const char *program) {
+  std::fprintf(
+      stderr,
+      "usage: %s CATALOGUE.json [options]\n"
+      "  --db CONNINFO             host=127.0.0.1 port=5433\n"
+      "                            dbname=app_service_plans ...\n"
+      "  --baseline FILE           эталон планов\n"
+      "  --update                  записать эталон по этому прогону\n"
+      "  --tolerance X             0.2   допуск для буферов и оценок\n"
+      "  --only TEXT               только запросы с TEXT в имени\n"
+      "  --verbose                 выводить планы всех запросов\n",
+      program);
+}
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      usage(argv[0]);
+      std::exit(0);
+    }
+    if (name.rfind("--", 0) != 0) {
+      if (!options.catalogue.empty()) {
+        throw std::runtime_error("unexpected argument " + name);
+      }
+      options.catalogue = name;
+      continue;
+    }
+    if (name == "--update") {
+      options.update = true;
+      continue;
+    }
+    if (name == "--verbose") {
+      options.verbose = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      throw std::runtime_error("missing value for " + name);
+    }
+    std::string value = argv[++i];
+    if (name == "--db") {
+      options.db = value;
+    } else if (name == "--baseline") {
+      options.baseline = value;
+    } else if (name == "--tolerance") {
+      options.tolerance = std::atof(value.c_str());
+    } else if (name == "--only") {
+      options.only = value;
+    } else {
+      throw std::runtime_error("unknown option " + name);
+    }
+  }
+  if (options.catalogue.empty()) {
+    throw std::runtime_error("catalogue file is required");
+  }
+  if (options.update && options.baseline.empty()) {
+    throw std::runtime_error("--update requires --baseline");
+  }
+  return options;
+}
+
+// Отсутствующий эталон — пустой: все запросы новые
+Json::Value readBaseline(const std::string &path) {
+  Json::Value json(Json::objectValue);
+  std::ifstream in(path);
+  if (!in) {
+    return json;
+  }
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  if (!Json::parseFromStream(builder, in, &json, &errors)) {
+    throw std::runtime_error(path + ": " + errors);
+  }
+  return json;
+}
+
+void writeBaseline(const std::string &path, const Json::Value &json) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "  ";
+  std::ofstream out(path);
+  out << Json::writeString(builder, json) << "\n";
+  if (!out) {
+    throw std::runtime_error("cannot write " + path);
+  }
+}
+
+void printLines(const std::vector<std::string> &lines) {
+  for (const auto &line : lines) {
+    std::printf("         %s\n", line.c_str());
+  }
+}
+
+// Возвращает true, если запрос считается проваленным
+bool report(const Result &result, bool update, bool verbose) {
+  const auto &expect = result.query->expect;
+  bool xfail = !expect.xfail.empty();
+  bool failed = (!result.failures.empty() && !xfail) ||
+                (!update && !result.regressions.empty());
+
+  const char *status = "ok";
+  if (failed) {
+    status = "FAIL";
+  } else if (xfail) {
+    status = result.failures.empty() ? "XPASS" : "XFAIL";
+  } else if (!result.inBaseline && !update) {
+    status = "NEW";
+  }
+  std::printf("%-6s %-46s buffers %7lld  rows x%-7.1f %9.2f ms\n", status,
+              result.query->name.c_str(),
+              static_cast<long long>(result.plan.root.buffers),
+              result.misestimate, result.plan.executionMs);
+
+  for (const auto &failure : result.failures) {
+    std::printf("         %s\n", failure.c_str());
+  }
+  if (xfail) {
+    std::printf("         known issue: %s\n", expect.xfail.c_str());
+    if (result.failures.empty()) {
+      std::printf("         expectations hold now, drop \"xfail\"\n");
+    }
+  }
+  if (!update) {
+    for (const auto &regression : result.regressions) {
+      std::printf("         %s\n", regression.c_str());
+    }
+  }
+  if (!update && !result.diff.empty()) {
+    std::printf("         plan (- baseline, + now):\n");
+    printLines(result.diff);
+  }
+  if (failed || verbose) {
+    std::printf("         plan:\n");
+    printLines(render(result.plan.root));
+  }
+  return failed;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = parseOptions(argc, argv);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    usage(argv[0]);
+    return 2;
+  }
+
+  try {
+    auto catalogue = Catalogue::fromFile(options.catalogue);
+    Json::Value baseline(Json::objectValue);
+    if (!options.baseline.empty()) {
+      baseline = readBaseline(options.baseline);
+    }
+
+    Connection conn(options.db);
+    Checker checker(catalogue, conn);
+    checker.prepare();
+    for (const auto &[name, value] : checker.fixtures()) {
+      std::printf("fixture %s = %s\n", name.c_str(), value.c_str());
+    }
+
+    int checked = 0;
+    int failed = 0;
+    const Json::Value &entries = baseline["queries"];
+    // Полный --update переписывает эталон целиком: записи удалённых из
+    // каталога запросов пропадают
+    Json::Value updated =
+        options.only.empty() ? Json::Value(Json::objectValue) : entries;
+    for (const auto &query : catalogue.queries) {
+      if (!options.only.empty() &&
+          query.name.find(options.only) == std::string::npos) {
+        continue;
+      }
+      ++checked;
+      const Json::Value none;
+      const auto &expected = entries.isMember(query.name)
+                                 ? entries[query.name]
+                                 : none;
+      try {
+        auto result = checker.check(query, expected, options.tolerance);
+        failed += report(result, options.update, options.verbose);
+        if (options.update) {
+          updated[query.name] = baselineEntry(result);
+        }
+      } catch (const std::exception &e) {
+        ++failed;
+        std::printf("%-6s %s\n         %s\n", "ERROR", query.name.c_str(),
+                    e.what());
+      }
+    }
+
+    if (options.update) {
+      baseline["queries"] = updated;
+      writeBaseline(options.baseline, baseline);
+      std::printf("baseline written to %s\n", options.baseline.c_str());
+    }
+    std::printf("%d queries, %d failed (tolerance %.0f%%)\n", checked,
+                failed, options.tolerance * 100);
+    return failed > 0 ? 3 : 0;
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+}
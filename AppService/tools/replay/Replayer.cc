@@ -0,0 +1,380 @@
+#include "Replayer.h"
+#include <algorithm>
+#include <cstdio>
+#include <json/json.h>
+#include <stdexcept>
+
+using namespace replay;
+using loadgen::Clock;
+using Record = services::TrafficCapture::Record;
+using Body = services::TrafficCapture::Body;
+
+namespace {
+
+Clock::duration fromMillis(double ms) {
+  return std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::milli>(ms));
+}
+
+std::string jsonBody(const Json::Value &value) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, value);
+}
+
+// Текст длиной около size байт
+std::string filler(size_t size) {
+  static const std::string kWords =
+      "replay text of the captured request with the original size ";
+  std::string out;
+  out.reserve(size);
+  while (out.size() < size) {
+    out.append(kWords, 0, std::min(kWords.size(), size - out.size()));
+  }
+  return out;
+}
+
+std::string multipartMp4(size_t size, uint64_t seed, std::string &boundary) {
+  static const std::string kMagic("\x00\x00\x00\x18" "ftypmp42", 12);
+  boundary = "replay" + std::to_string(seed);
+  std::string body = "--" + boundary +
+                     "\r\nContent-Disposition: form-data; name=\"file\"; "
+                     "filename=\"replay.mp4\"\r\nContent-Type: video/mp4"
+                     "\r\n\r\n";
+  auto tail = "\r\n--" + boundary + "--\r\n";
+  size_t payload = size > body.size() + tail.size() + kMagic.size()
+                       ? size - body.size() - tail.size()
+                       : kMagic.size() + 64;
+  body += kMagic;
+  // Разные байты: иначе дедупликация сведёт все загрузки к одному файлу
+  uint64_t state = seed * 0x9e3779b97f4a7c15ULL + 1;
+  for (size_t i = kMagic.size(); i < payload; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    body.push_back(static_cast<char>(state));
+  }
+  return body + tail;
+}
+
+bool isKey(const std::string &segment) {
+  if (segment.empty()) {
+    return false;
+  }
+  if (segment.find_first_not_of("0123456789") == std::string::npos) {
+    return true;
+  }
+  return segment.size() >= 16 &&
+         segment.find_first_of("0123456789") != std::string::npos;
+}
+
+} // namespace
+
+std::string replay::endpointName(const std::string &method,
+                                 const std::string &path) {
+  std::string out = method + " ";
+  size_t pos = 0;
+  while (pos < path.size()) {
+    auto slash = path.find('/', pos + 1);
+    auto segment = path.substr(pos + 1, slash == std::string::npos
+                                            ? std::string::npos
+                                            : slash - pos - 1);
+    out += "/";
+    out += isKey(segment) ? (segment.find_first_not_of("0123456789") ==
+                                     std::string::npos
+                                 ? "{id}"
+                                 : "{key}")
+                          : segment;
+    if (slash == std::string::npos) {
+      break;
+    }
+    pos = slash;
+  }
+  return path.empty() ? out + "/" : out;
+}
+
+Replayer::Replayer(const Options &options)
+    : options_(options),
+      client_(options.concurrency, fromMillis(options.timeoutMs)) {
+  std::map<std::string, int> targets;
+  for (const auto &[service, url] : options_.targets) {
+    targets[service] = client_.addTarget(url);
+  }
+  for (const auto &path : options_.captures) {
+    Source source;
+    source.reader = std::make_unique<services::TrafficCapture::Reader>(path);
+    auto target = targets.find(source.reader->service());
+    if (target == targets.end()) {
+      throw std::runtime_error(path + ": no target for service " +
+                               source.reader->service());
+    }
+    source.target = target->second;
+    source.done = !source.reader->next(source.next);
+    std::printf("%s: %s, sample rate %g\n", path.c_str(),
+                source.reader->service().c_str(),
+                source.reader->sampleRate());
+    sources_.push_back(std::move(source));
+  }
+  authTarget_ = targets.at("auth_service");
+  runTag_ = std::to_string(
+      std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+
+  results_.scenario = "replay";
+  results_.load.mode = loadgen::Load::Mode::kOpen;
+  results_.load.users = options_.users;
+  results_.load.warmupSeconds = 0;
+  results_.correction =
+      options_.speed > 0 ? "intended_time" : "none (as fast as possible)";
+}
+
+loadgen::Results Replayer::run() {
+  setup();
+  client_.run();
+  auto seconds =
+      std::chrono::duration<double>(lastResponse_ - start_).count();
+  results_.measuredSeconds = std::max(seconds, 1e-3);
+  results_.load.durationSeconds = results_.measuredSeconds;
+  results_.load.rate = sent_ / results_.measuredSeconds;
+  results_.sessions = clients_.size();
+  return std::move(results_);
+}
+
+void Replayer::setup() {
+  tokens_.resize(std::max(1, options_.users));
+  setupsLeft_ = tokens_.size();
+  std::printf("setup: %zu users\n", tokens_.size());
+  std::fflush(stdout);
+  auto now = Clock::now();
+  for (size_t i = 0; i < tokens_.size(); ++i) {
+    // Регистрация дорогая (bcrypt): растягиваем на секунду
+    client_.runAt(
+        now + std::chrono::milliseconds(1000) * i / tokens_.size(),
+        [this, i]() { login(i); });
+  }
+}
+
+// Регистрация (400, если учётная запись осталась с прошлого раза, —
+// тоже годится) и вход
+void Replayer::login(size_t user) {
+  Json::Value account;
+  account["login"] = "replay_" + std::to_string(user + 1);
+  account["password"] = options_.password;
+  loadgen::Request login{"POST", "/v1/Auth/login",
+                         {{"Content-Type", "application/json"}},
+                         jsonBody(account)};
+  account["name"] = "Replay " + std::to_string(user + 1);
+  loadgen::Request reg{"POST", "/v1/Auth/reg",
+                       {{"Content-Type", "application/json"}},
+                       jsonBody(account)};
+
+  auto onLogin = [this, user](loadgen::Response &&response) {
+    Json::Value body;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    const auto &text = response.body;
+    if (response.status == 200 &&
+        reader->parse(text.data(), text.data() + text.size(), &body,
+                      nullptr)) {
+      tokens_[user] = body["token"].asString();
+    } else {
+      ++results_.failedSetups;
+    }
+    if (--setupsLeft_ == 0) {
+      start();
+    }
+  };
+  client_.send(authTarget_, reg,
+               [this, login, onLogin](loadgen::Response &&) {
+                 client_.send(authTarget_, login, onLogin);
+               });
+}
+
+void Replayer::start() {
+  if (results_.failedSetups > 0) {
+    std::printf("login failed for %llu users\n",
+                static_cast<unsigned long long>(results_.failedSetups));
+  }
+  auto first = std::min_element(
+      sources_.begin(), sources_.end(), [](const Source &a, const Source &b) {
+        return !a.done && (b.done || a.next.arrivalUs < b.next.arrivalUs);
+      });
+  if (first == sources_.end() || first->done) {
+    client_.stop();
+    return;
+  }
+  firstArrivalUs_ = first->next.arrivalUs;
+  start_ = Clock::now();
+  lastResponse_ = start_;
+  if (options_.speed > 0) {
+    std::printf("replaying at %gx\n", options_.speed);
+    scheduleNext();
+  } else {
+    std::printf("replaying as fast as possible, %zu in flight\n",
+                options_.concurrency);
+    for (size_t i = 0; i < options_.concurrency && !exhausted_; ++i) {
+      scheduleNext();
+    }
+  }
+  std::fflush(stdout);
+}
+
+bool Replayer::pop(Record &record, int &target) {
+  if (options_.limit > 0 && sent_ >= options_.limit) {
+    return false;
+  }
+  Source *earliest = nullptr;
+  for (auto &source : sources_) {
+    if (!source.done &&
+        (!earliest || source.next.arrivalUs < earliest->next.arrivalUs)) {
+      earliest = &source;
+    }
+  }
+  if (!earliest) {
+    return false;
+  }
+  record = std::move(earliest->next);
+  target = earliest->target;
+  earliest->done = !earliest->reader->next(earliest->next);
+  return true;
+}
+
+// Журнал читается по одной записи: следующая планируется, когда
+// отправлена текущая, так что память не зависит от его длины
+void Replayer::scheduleNext() {
+  auto record = std::make_shared<Record>();
+  int target = 0;
+  if (!pop(*record, target)) {
+    if (!exhausted_) {
+      exhausted_ = true;
+      finishIfDrained();
+    }
+    return;
+  }
+  ++sent_;
+  if (options_.speed <= 0) {
+    send(*record, target, Clock::now());
+    return;
+  }
+  auto offsetUs = std::max<int64_t>(record->arrivalUs - firstArrivalUs_, 0);
+  auto intended =
+      start_ + std::chrono::duration_cast<Clock::duration>(
+                   std::chrono::duration<double, std::micro>(offsetUs /
+                                                             options_.speed));
+  client_.runAt(intended, [this, record, target, intended]() {
+    send(*record, target, intended);
+    scheduleNext();
+  });
+}
+
+void Replayer::send(const Record &record, int target,
+                    Clock::time_point intended) {
+  auto endpoint = endpointName(record.method, record.path);
+  auto request = buildRequest(record, endpoint);
+  client_.send(target, request, [this, endpoint,
+                                 intended](loadgen::Response &&response) {
+    auto now = Clock::now();
+    lastResponse_ = now;
+    auto &stats = results_.endpoints[endpoint];
+    ++stats.requests;
+    stats.bytes += response.body.size();
+    ++stats.statuses[response.status ? std::to_string(response.status)
+                                     : response.error];
+    // Ошибка — только отказ сервера или сети: 4xx в журнале бывают и
+    // в оригинале (чужой id, повторный лайк)
+    if (response.status == 0 || response.status >= 500) {
+      ++stats.errors;
+    } else {
+      stats.latency.record(
+          std::chrono::duration_cast<std::chrono::microseconds>(now - intended)
+              .count());
+    }
+    if (options_.speed <= 0) {
+      scheduleNext();
+    }
+  });
+}
+
+void Replayer::finishIfDrained() {
+  if (client_.inFlight() == 0) {
+    client_.stop();
+    return;
+  }
+  client_.runAt(Clock::now() + std::chrono::milliseconds(50),
+                [this]() { finishIfDrained(); });
+}
+
+const std::string *Replayer::tokenFor(uint32_t client) {
+  if (client == 0) {
+    return nullptr;
+  }
+  auto it = clients_.find(client);
+  if (it == clients_.end()) {
+    it = clients_.emplace(client, clients_.size() % tokens_.size()).first;
+  }
+  const auto &token = tokens_[it->second];
+  return token.empty() ? nullptr : &token;
+}
+
+loadgen::Request Replayer::buildRequest(const Record &record,
+                                        const std::string &endpoint) {
+  loadgen::Request request;
+  request.method = record.method;
+  request.path = record.path;
+  for (size_t i = 0; i < record.params.size(); ++i) {
+    request.path += i == 0 ? "?" : "&";
+    request.path += record.params[i].first + "=" + record.params[i].second;
+  }
+  if (const auto *token = tokenFor(record.client)) {
+    request.headers.emplace_back("Authorization", "Bearer " + *token);
+  }
+
+  if (endpoint == "POST /v1/Auth/reg" || endpoint == "POST /v1/Auth/login") {
+    Json::Value account;
+    if (endpoint == "POST /v1/Auth/reg") {
+      auto n = std::to_string(++registrations_);
+      account["login"] = "replay_" + runTag_ + "_" + n;
+      account["name"] = "Replay " + n;
+    } else {
+      account["login"] =
+          "replay_" + std::to_string(sent_ % tokens_.size() + 1);
+    }
+    account["password"] = options_.password;
+    request.headers.emplace_back("Content-Type", "application/json");
+    request.body = jsonBody(account);
+    return request;
+  }
+
+  switch (record.body) {
+  case Body::kNone:
+    break;
+  case Body::kMultipart: {
+    std::string boundary;
+    request.body = multipartMp4(record.bodyBytes, sent_, boundary);
+    request.headers.emplace_back("Content-Type",
+                                 "multipart/form-data; boundary=" + boundary);
+    break;
+  }
+  case Body::kJson: {
+    Json::Value body;
+    auto text = filler(record.bodyBytes > 48 ? record.bodyBytes - 48 : 16);
+    if (endpoint == "PUT /users/me") {
+      body["bio"] = text;
+    } else {
+      body["text"] = text;
+    }
+    if (endpoint == "POST /posts") {
+      body["visibility"] = "public";
+    }
+    request.headers.emplace_back("Content-Type", "application/json");
+    request.body = jsonBody(body);
+    break;
+  }
+  case Body::kOther:
+    request.headers.emplace_back("Content-Type", "application/octet-stream");
+    request.body.assign(record.bodyBytes, 'r');
+    break;
+  }
+  return request;
+}
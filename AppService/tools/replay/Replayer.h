@@ -0,0 +1,90 @@
+#pragma once
+
+#include "capture/TrafficCapture.h"
+#include "tools/loadgen/HttpClient.h"
+#include "tools/loadgen/Runner.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace replay {
+
+struct Options {
+  std::vector<std::string> captures;
+  // Имя сервиса из журнала -> "http://host:port"
+  std::map<std::string, std::string> targets{
+      {"app_service", "http://127.0.0.1:3001"},
+      {"auth_service", "http://127.0.0.1:3000"}};
+  // Во сколько раз быстрее оригинала; 0 — без пауз, окном concurrency.
+  // В обычном режиме concurrency — предел соединений на сервис
+  double speed = 1;
+  size_t concurrency = 256;
+  // Учётные записи replay_<n>, между которыми делятся клиенты журнала
+  int users = 50;
+  std::string password = "password";
+  double timeoutMs = 10000;
+  // 0 — весь журнал
+  uint64_t limit = 0;
+};
+
+// Воспроизведение журналов TrafficCapture. Несколько журналов (обычно
+// AppService и AuthService за одно время) сливаются по времени
+// прихода. Интервалы между запросами сохраняются, делённые на speed;
+// задержка считается от момента, когда запрос следовало отправить.
+//
+// Клиенты журнала — псевдонимы, поэтому перед стартом регистрируются
+// и входят users учётных записей, и каждый новый клиент получает
+// следующую из них по кругу. Тела запросов в журнале нет: по маршруту
+// и виду тела собирается тело того же размера (текст поста или
+// комментария, multipart с mp4, логин и пароль для AuthService).
+class Replayer {
+public:
+  explicit Replayer(const Options &options);
+  loadgen::Results run();
+
+private:
+  struct Source {
+    std::unique_ptr<services::TrafficCapture::Reader> reader;
+    int target = 0;
+    services::TrafficCapture::Record next;
+    bool done = false;
+  };
+
+  void setup();
+  void login(size_t user);
+  void start();
+  bool pop(services::TrafficCapture::Record &record, int &target);
+  void scheduleNext();
+  void send(const services::TrafficCapture::Record &record, int target,
+            loadgen::Clock::time_point intended);
+  void finishIfDrained();
+
+  loadgen::Request buildRequest(const services::TrafficCapture::Record &record,
+                                const std::string &endpoint);
+  const std::string *tokenFor(uint32_t client);
+
+  Options options_;
+  loadgen::HttpClient client_;
+  std::vector<Source> sources_;
+  int authTarget_ = -1;
+  std::vector<std::string> tokens_;
+  size_t setupsLeft_ = 0;
+  std::unordered_map<uint32_t, size_t> clients_;
+  uint64_t sent_ = 0;
+  uint64_t registrations_ = 0;
+  std::string runTag_;
+  bool exhausted_ = false;
+
+  int64_t firstArrivalUs_ = 0;
+  loadgen::Clock::time_point start_;
+  loadgen::Clock::time_point lastResponse_;
+  loadgen::Results results_;
+};
+
+// "GET /posts/123/like" -> "GET /posts/{id}/like": числа и длинные
+// ключи (id загрузок, дайджесты) сворачиваются
+std::string endpointName(const std::string &method, const std::string &path);
+
+} // namespace replay
@@ -0,0 +1,163 @@
+// Воспроизведение записанного трафика (shared/capture/TrafficCapture) против
+// тестового стенда: с исходными интервалами, ускоренно или без пауз.
+// Отчёт — тот же, что у loadgen, и так же сравнивается с прошлым
+// прогоном.
+//
+// Запуск:
+//   replay captures/app_service-*.tcap captures/auth_service-*.tcap
+//          --speed 10 --out replay.json
+//   replay captures/app_service-*.tcap --speed max --baseline replay.json
+//
+// С --baseline код возврата 3, если есть регрессии.
+#include "Replayer.h"
+#include "tools/loadgen/Report.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace replay;
+
+namespace {
+
+struct Output {
+  std::string out;
+  std::string baseline;
+  double tolerance = 0.1;
+};
+
+void usage(const char *program) {
+  std::fprintf(
+      stderr,
+      "usage: %s CAPTURE.tcap... [options]\n"
+      "  --speed X|max             1     во сколько раз быстрее записи\n"
+      "  --concurrency N           256   соединений на сервис; для max —\n"
+      "                                  запросов в полёте\n"
+      "  --users N                 50    учётных записей replay_<n>\n"
+      "  --password P              password\n"
+      "  --target SERVICE=URL      app_service=http://127.0.0.1:3001,\n"
+      "                            auth_service=http://127.0.0.1:3000\n"
+      "  --limit N                 только первые N запросов\n"
+      "  --timeout MS              10000\n"
+      "  --out FILE                результаты в JSON\n"
+      "  --baseline FILE           сравнить с прошлым прогоном\n"
+      "  --tolerance X             0.1\n",
+      program);
+}
+
+Options parseOptions(int argc, char **argv, Output &output) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      usage(argv[0]);
+      std::exit(0);
+    }
+    if (name.rfind("--", 0) != 0) {
+      options.captures.push_back(name);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      throw std::runtime_error("missing value for " + name);
+    }
+    std::string value = argv[++i];
+    if (name == "--speed") {
+      options.speed = value == "max" ? 0 : std::atof(value.c_str());
+      if (value != "max" && options.speed <= 0) {
+        throw std::runtime_error("--speed must be positive or max");
+      }
+    } else if (name == "--concurrency") {
+      options.concurrency = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "--users") {
+      options.users = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "--password") {
+      options.password = value;
+    } else if (name == "--target") {
+      auto eq = value.find('=');
+      if (eq == std::string::npos || eq == 0) {
+        throw std::runtime_error("expected SERVICE=URL: " + value);
+      }
+      options.targets[value.substr(0, eq)] = value.substr(eq + 1);
+    } else if (name == "--limit") {
+      options.limit = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--timeout") {
+      options.timeoutMs = std::atof(value.c_str());
+    } else if (name == "--out") {
+      output.out = value;
+    } else if (name == "--baseline") {
+      output.baseline = value;
+    } else if (name == "--tolerance") {
+      output.tolerance = std::atof(value.c_str());
+    } else {
+      throw std::runtime_error("unknown option " + name);
+    }
+  }
+  if (options.captures.empty()) {
+    throw std::runtime_error("at least one capture file is required");
+  }
+  return options;
+}
+
+Json::Value readJson(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  Json::Value json;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  if (!Json::parseFromStream(builder, in, &json, &errors)) {
+    throw std::runtime_error(path + ": " + errors);
+  }
+  return json;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  Output output;
+  try {
+    options = parseOptions(argc, argv, output);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    usage(argv[0]);
+    return 2;
+  }
+
+  try {
+    Json::Value baseline;
+    if (!output.baseline.empty()) {
+      baseline = readJson(output.baseline);
+    }
+
+    Replayer replayer(options);
+    auto results = loadgen::toJson(replayer.run());
+    results["speed"] = options.speed > 0 ? Json::Value(options.speed)
+                                         : Json::Value("max");
+    loadgen::printSummary(results);
+
+    if (!output.out.empty()) {
+      Json::StreamWriterBuilder builder;
+      builder["indentation"] = "  ";
+      std::ofstream out(output.out);
+      out << Json::writeString(builder, results) << "\n";
+      if (!out) {
+        throw std::runtime_error("cannot write " + output.out);
+      }
+    }
+    if (!output.baseline.empty()) {
+      int regressions = loadgen::compare(results, baseline, output.tolerance);
+      std::printf("%d regressions (tolerance %.0f%%)\n", regressions,
+                  output.tolerance * 100);
+      if (regressions > 0) {
+        return 3;
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
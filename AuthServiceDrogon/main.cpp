@@ -1,9 +1,15 @@
+#include "capture/CaptureAdvice.h"
 #include <drogon/drogon.h>
 
 int main() {
   LOG_DEBUG << "Load config file";
   drogon::app().loadConfigFile("config.json");
 
+  // Запись выборки трафика для AppService/tools/replay (формат — в
+  // shared/capture/TrafficCapture.cc). Первой, до CORS
+  services::startTrafficCapture(
+      drogon::app().getCustomConfig()["traffic_capture"], "auth_service");
+
   // Add CORS support for frontend
   drogon::app().registerPreRoutingAdvice(
       [](const drogon::HttpRequestPtr &req, drogon::AdviceCallback &&acb,
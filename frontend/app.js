@@ -12,7 +12,13 @@ const state = {
     posts: [],
     searchQuery: '',
     isSearchMode: false,
-    avatarCrop: null
+    avatarCrop: null,
+    feedStream: null,
+    newPostIds: new Set(),
+    newPostsCursor: null,
+    newPostsPoll: null,
+    newPostsPolled: 0,
+    newPostsMore: false
 };
 
 function saveAuth(token, identifier, options = {}) {
@@ -89,7 +95,9 @@ function updateUI() {
         welcomeScreen.style.display = 'none';
         feedScreen.style.display = 'block';
         userName.textContent = state.user.username;
+        startFeedStream();
     } else {
+        stopFeedStream();
         authButtons.style.display = 'flex';
         userMenu.style.display = 'none';
         welcomeScreen.style.display = 'flex';
@@ -182,8 +190,10 @@ async function loadFeed() {
     try {
         const data = await apiCall(`${CONFIG.APP_API_URL}/feed`);
         state.posts = data.posts || [];
+        state.newPostsCursor = data.new_posts_cursor ?? null;
         state.isSearchMode = false;
         state.searchQuery = '';
+        resetNewPosts();
         updateFeedSearchInfo();
         renderPosts(state.posts);
     } catch (error) {
@@ -207,11 +217,192 @@ async function loadFeed() {
     }
 }
 
-async function createPost(title, content) {
+// ==================== Feed Stream ====================
+// Новые посты подписок по SSE (GET /feed/stream). EventSource не умеет
+// заголовок Authorization, поэтому поток читается через fetch. Лента не
+// перезагружается сама: показывается кнопка с числом новых постов
+async function startFeedStream() {
+    if (state.feedStream || !state.token) {
+        return;
+    }
+    const controller = new AbortController();
+    state.feedStream = controller;
+    let retryMs = 5000;
+
+    while (!controller.signal.aborted) {
+        try {
+            const response = await fetch(`${CONFIG.APP_API_URL}/feed/stream`, {
+                headers: {
+                    'Authorization': `Bearer ${state.token}`,
+                    'Accept': 'text/event-stream'
+                },
+                signal: controller.signal
+            });
+            if (response.status === 404) {
+                // Push выключен на сервере — опрашиваем счётчик
+                startNewPostsPolling();
+                break;
+            }
+            if (response.status === 401) {
+                break;
+            }
+            if (!response.ok || !response.body) {
+                throw new Error(`HTTP ${response.status}`);
+            }
+
+            const reader = response.body.pipeThrough(new TextDecoderStream()).getReader();
+            let buffer = '';
+            while (true) {
+                const { value, done } = await reader.read();
+                if (done) {
+                    break;
+                }
+                buffer += value;
+                let end;
+                while ((end = buffer.indexOf('\n\n')) !== -1) {
+                    const message = buffer.slice(0, end);
+                    buffer = buffer.slice(end + 2);
+                    retryMs = handleFeedStreamMessage(message, retryMs);
+                }
+            }
+        } catch (error) {
+            if (controller.signal.aborted) {
+                break;
+            }
+            console.warn('Поток ленты прервался:', error);
+        }
+        await new Promise(resolve => setTimeout(resolve, retryMs));
+    }
+
+    if (state.feedStream === controller) {
+        state.feedStream = null;
+    }
+}
+
+function stopFeedStream() {
+    if (state.feedStream) {
+        state.feedStream.abort();
+        state.feedStream = null;
+    }
+    if (state.newPostsPoll) {
+        clearInterval(state.newPostsPoll);
+        state.newPostsPoll = null;
+    }
+    resetNewPosts();
+}
+
+// Только счётчик (count_only): сервер не собирает посты целиком
+function startNewPostsPolling() {
+    if (state.newPostsPoll) {
+        return;
+    }
+    state.newPostsPoll = setInterval(async () => {
+        const since = state.newPostsCursor;
+        if (!state.token || state.isSearchMode || since === null) {
+            return;
+        }
+        try {
+            const data = await apiCall(
+                `${CONFIG.APP_API_URL}/feed/new?since=${since}&count_only=1`);
+            state.newPostsPolled = data.count || 0;
+            state.newPostsMore = data.has_more === true;
+            updateNewPostsButton();
+        } catch (error) {
+            console.warn('Не удалось проверить новые посты:', error);
+        }
+    }, 10000);
+}
+
+// Догружает только новые посты поверх ленты; если их слишком много —
+// обычная перезагрузка. Курсор — номер публикации на сервере, а не id,
+// поэтому пост, уже показанный в ленте, может прийти ещё раз
+async function loadNewPosts() {
+    const since = state.newPostsCursor;
+    if (state.isSearchMode || since === null) {
+        loadFeed();
+        return;
+    }
     try {
+        const data = await apiCall(
+            `${CONFIG.APP_API_URL}/feed/new?since=${since}&limit=50`);
+        if (data.has_more) {
+            loadFeed();
+            return;
+        }
+        const known = new Set(state.posts.map(p => p.id));
+        const fresh = (data.posts || []).filter(p => !known.has(p.id));
+        state.posts = [...fresh, ...state.posts];
+        state.newPostsCursor = data.cursor;
+        resetNewPosts();
+        renderPosts(state.posts);
+    } catch (error) {
+        console.error('Error loading new posts:', error);
+        loadFeed();
+    }
+}
+
+function resetNewPosts() {
+    state.newPostIds.clear();
+    state.newPostsPolled = 0;
+    state.newPostsMore = false;
+    updateNewPostsButton();
+}
+
+// Одно сообщение SSE; возвращает задержку переподключения
+function handleFeedStreamMessage(message, retryMs) {
+    let event = 'message';
+    let data = '';
+    for (const line of message.split('\n')) {
+        if (line.startsWith(':')) {
+            continue;
+        }
+        const colon = line.indexOf(':');
+        const field = colon === -1 ? line : line.slice(0, colon);
+        const value = colon === -1 ? '' : line.slice(colon + 1).replace(/^ /, '');
+        if (field === 'event') {
+            event = value;
+        } else if (field === 'data') {
+            data += value;
+        } else if (field === 'retry' && /^\d+$/.test(value)) {
+            retryMs = Number(value);
+        }
+    }
+
+    if (event === 'post' && data) {
+        try {
+            const post = JSON.parse(data);
+            if (!state.posts.some(p => p.id === post.id)) {
+                state.newPostIds.add(post.id);
+                updateNewPostsButton();
+            }
+        } catch (error) {
+            console.warn('Некорректное событие ленты:', error);
+        }
+    }
+    return retryMs;
+}
+
+function updateNewPostsButton() {
+    const button = document.getElementById('feedNewPosts');
+    if (!button) {
+        return;
+    }
+    const count = Math.max(state.newPostIds.size, state.newPostsPolled);
+    button.style.display = count > 0 && !state.isSearchMode ? 'block' : 'none';
+    button.textContent = `Новые посты: ${count}${state.newPostsMore ? '+' : ''} — показать`;
+}
+
+// attachments — [{ file_path, type }] из uploadMediaFiles: пост и вложения
+// создаются одним запросом
+async function createPost(title, content, attachments = []) {
+    try {
+        const body = { title, content };
+        if (attachments.length > 0) {
+            body.attachments = attachments;
+        }
         const data = await apiCall(`${CONFIG.APP_API_URL}/posts`, {
             method: 'POST',
-            body: JSON.stringify({ title, content })
+            body: JSON.stringify(body)
         });
         return data;
     } catch (error) {
@@ -255,7 +446,103 @@ async function toggleLike(postId, isLiked) {
     }
 }
 
+// Большие файлы (видео) грузятся частями через /media/uploads: при обрыве
+// связи загрузка продолжается с последнего подтверждённого смещения
+const RESUMABLE_UPLOAD_THRESHOLD = 8 * 1024 * 1024;
+const RESUMABLE_CHUNK_SIZE = 4 * 1024 * 1024;
+const RESUMABLE_MAX_RETRIES = 5;
+
+function base64FromBytes(bytes) {
+    let binary = '';
+    const view = new Uint8Array(bytes);
+    for (let i = 0; i < view.length; i++) {
+        binary += String.fromCharCode(view[i]);
+    }
+    return btoa(binary);
+}
+
+async function uploadMediaFileResumable(file) {
+    const headers = {};
+    if (state.token) {
+        headers['Authorization'] = `Bearer ${state.token}`;
+    }
+    const filenameMeta = base64FromBytes(new TextEncoder().encode(file.name));
+
+    const created = await fetch(`${CONFIG.APP_API_URL}/media/uploads`, {
+        method: 'POST',
+        headers: {
+            ...headers,
+            'Tus-Resumable': '1.0.0',
+            'Upload-Length': String(file.size),
+            'Upload-Metadata': `filename ${filenameMeta}`
+        }
+    });
+    const session = await created.json().catch(() => ({}));
+    if (!created.ok) {
+        throw new Error(session.error || `Upload failed: ${created.status}`);
+    }
+
+    const uploadUrl = `${CONFIG.APP_API_URL}/media/uploads/${session.upload_id}`;
+    let offset = 0;
+    let retries = 0;
+    while (offset < file.size) {
+        const chunk = await file.slice(offset, offset + RESUMABLE_CHUNK_SIZE).arrayBuffer();
+        const checksumHeaders = {};
+        if (window.crypto && crypto.subtle) {
+            const digest = await crypto.subtle.digest('SHA-256', chunk);
+            checksumHeaders['Upload-Checksum'] = `sha256 ${base64FromBytes(digest)}`;
+        }
+        try {
+            const response = await fetch(uploadUrl, {
+                method: 'PATCH',
+                headers: {
+                    ...headers,
+                    ...checksumHeaders,
+                    'Tus-Resumable': '1.0.0',
+                    'Upload-Offset': String(offset),
+                    'Content-Type': 'application/offset+octet-stream'
+                },
+                body: chunk
+            });
+            // 409 — сервер знает другое смещение, продолжаем с него
+            if (!response.ok && response.status !== 409) {
+                const data = await response.json().catch(() => ({}));
+                throw new Error(data.error || `Upload failed: ${response.status}`);
+            }
+            if (response.ok) {
+                retries = 0;
+            }
+            offset = Number(response.headers.get('Upload-Offset') || offset);
+        } catch (error) {
+            if (++retries > RESUMABLE_MAX_RETRIES) {
+                throw error;
+            }
+            await new Promise(resolve => setTimeout(resolve, 1000 * retries));
+            const status = await fetch(uploadUrl, { method: 'HEAD', headers });
+            if (status.ok) {
+                offset = Number(status.headers.get('Upload-Offset') || offset);
+            }
+        }
+    }
+
+    const completed = await fetch(`${uploadUrl}/complete`, { method: 'POST', headers });
+    const data = await completed.json().catch(() => ({}));
+    if (!completed.ok) {
+        throw new Error(data.error || `Upload failed: ${completed.status}`);
+    }
+    return data;
+}
+
 async function uploadMediaFile(file) {
+    if (file.size > RESUMABLE_UPLOAD_THRESHOLD) {
+        try {
+            return await uploadMediaFileResumable(file);
+        } catch (error) {
+            console.error('Ошибка загрузки файла:', error);
+            throw error;
+        }
+    }
+
     try {
         const formData = new FormData();
         formData.append('file', file);
@@ -282,6 +569,60 @@ async function uploadMediaFile(file) {
     }
 }
 
+// Сколько файлов сервер принимает в одном /media/upload
+const MAX_FILES_PER_UPLOAD = 20;
+
+// Несколько файлов: небольшие уходят одним multipart-запросом (по
+// MAX_FILES_PER_UPLOAD), большие — параллельно через возобновляемую
+// загрузку. Результат в порядке files: [{ file_path, type }]
+async function uploadMediaFiles(files) {
+    const results = new Array(files.length);
+    const small = [];
+    const uploads = [];
+
+    files.forEach((file, index) => {
+        if (file.size > RESUMABLE_UPLOAD_THRESHOLD) {
+            uploads.push(uploadMediaFile(file).then(media => {
+                results[index] = media;
+            }));
+        } else {
+            small.push(index);
+        }
+    });
+
+    const headers = {};
+    if (state.token) {
+        headers['Authorization'] = `Bearer ${state.token}`;
+    }
+    for (let start = 0; start < small.length; start += MAX_FILES_PER_UPLOAD) {
+        const batch = small.slice(start, start + MAX_FILES_PER_UPLOAD);
+        const formData = new FormData();
+        batch.forEach(index => formData.append('file', files[index]));
+        uploads.push(fetch(`${CONFIG.APP_API_URL}/media/upload`, {
+            method: 'POST',
+            headers,
+            body: formData
+        }).then(async response => {
+            const data = await response.json().catch(() => ({}));
+            if (!response.ok) {
+                throw new Error(data.error || `Upload failed: ${response.status}`);
+            }
+            const uploaded = data.files || [data];
+            batch.forEach((index, i) => {
+                results[index] = uploaded[i];
+            });
+        }));
+    }
+
+    try {
+        await Promise.all(uploads);
+    } catch (error) {
+        console.error('Ошибка загрузки файлов:', error);
+        throw error;
+    }
+    return results.map(media => ({ file_path: media.file_path, type: media.type }));
+}
+
 // ==================== Comments API ====================
 async function loadComments(postId) {
     try {
@@ -570,7 +911,27 @@ function createPostCard(post) {
 
             if (photo) {
                 const url = `${CONFIG.APP_API_URL}/${photo.file_path}`;
-                mediaHtml = `<div class="post-media"><img src="${url}" alt=""></div>`;
+                // Уменьшенные варианты: браузер сам выберет подходящий размер,
+                // а WebP — если умеет его показывать
+                const sizes = '(max-width: 700px) 100vw, 700px';
+                let srcsetAttrs = '';
+                let webpSource = '';
+                if (photo.variants && photo.variants.length > 0 && photo.width) {
+                    const srcset = photo.variants
+                        .map(v => `${CONFIG.APP_API_URL}/${v.file_path} ${v.width}w`)
+                        .concat(`${url} ${photo.width}w`)
+                        .join(', ');
+                    srcsetAttrs = ` srcset="${srcset}" sizes="${sizes}"`;
+                    if (photo.variants.every(v => v.webp_file_path)) {
+                        const webpSrcset = photo.variants
+                            .map(v => `${CONFIG.APP_API_URL}/${v.webp_file_path} ${v.width}w`)
+                            .concat(`${url} ${photo.width}w`)
+                            .join(', ');
+                        webpSource = `<source type="image/webp" srcset="${webpSrcset}" sizes="${sizes}">`;
+                    }
+                }
+                const sizeAttrs = photo.width ? ` width="${photo.width}" height="${photo.height}"` : '';
+                mediaHtml = `<div class="post-media"><picture>${webpSource}<img src="${url}"${srcsetAttrs}${sizeAttrs} loading="lazy" alt=""></picture></div>`;
             } else if (video) {
                 const url = `${CONFIG.APP_API_URL}/${video.file_path}`;
                 mediaHtml = `
@@ -699,17 +1060,14 @@ async function showUserProfile(userId) {
             return;
         }
 
-        const [user, posts, followers] = await Promise.all([
-            apiCall(`${CONFIG.APP_API_URL}/users/${userId}`),
-            apiCall(`${CONFIG.APP_API_URL}/users/${userId}/posts`),
-            apiCall(`${CONFIG.APP_API_URL}/users/${userId}/followers`)
-        ]);
+        // Профиль, первая страница постов и подписка — одним запросом
+        const page = await apiCall(`${CONFIG.APP_API_URL}/users/${userId}/profile-page`);
+        const user = page.user;
+        const posts = page.posts;
 
         const currentId = state.token ? getUserIdFromToken(state.token) : null;
         const isSelf = currentId && user.user_id && currentId === user.user_id;
-        const isFollowing = !isSelf && Array.isArray(followers)
-            ? followers.some(f => f.user_id === currentId)
-            : false;
+        const isFollowing = !isSelf && page.is_following === true;
 
         renderUserProfile(user, posts, { isSelf, isFollowing });
         showModal('profileModal');
@@ -1074,22 +1432,13 @@ document.addEventListener('DOMContentLoaded', () => {
                 const title = document.getElementById('postTitle').value;
                 const content = document.getElementById('postContent').value;
                 const mediaInput = document.getElementById('postMedia');
-                const file = mediaInput && mediaInput.files && mediaInput.files[0] ? mediaInput.files[0] : null;
+                const files = mediaInput && mediaInput.files ? Array.from(mediaInput.files) : [];
 
                 try {
-                    const post = await createPost(title, content);
-
-                    if (file && post && post.id) {
-                        try {
-                            const media = await uploadMediaFile(file);
-                            await apiCall(`${CONFIG.APP_API_URL}/posts/${post.id}/attach`, {
-                                method: 'POST',
-                                body: JSON.stringify({ file_path: media.file_path, type: media.type })
-                            });
-                        } catch (mediaError) {
-                            console.warn('Не удалось прикрепить медиа:', mediaError);
-                        }
-                    }
+                    // Сначала файлы, затем пост со всеми вложениями сразу:
+                    // 10 фотографий — два запроса вместо 21
+                    const attachments = files.length > 0 ? await uploadMediaFiles(files) : [];
+                    await createPost(title, content, attachments);
 
                     closeModal('createPostModal');
                     showSuccess('Пост успешно создан!');
@@ -1132,6 +1481,14 @@ document.addEventListener('DOMContentLoaded', () => {
             }
         }
 
+        const feedNewPosts = document.getElementById('feedNewPosts');
+        if (feedNewPosts) {
+            feedNewPosts.addEventListener('click', (e) => {
+                e.preventDefault();
+                loadNewPosts();
+            });
+        }
+
         if (feedSearchButton && feedSearchInput) {
             feedSearchButton.addEventListener('click', (e) => {
                 e.preventDefault();
@@ -0,0 +1,41 @@
+#include "CaptureAdvice.h"
+#include "TrafficCapture.h"
+#include <cstdlib>
+#include <drogon/drogon.h>
+
+using namespace services;
+
+bool services::startTrafficCapture(const Json::Value &config,
+                                   const std::string &service) {
+  if (!config.get("enabled", false).asBool()) {
+    return false;
+  }
+  try {
+    LOG_INFO << "Capturing traffic to "
+             << TrafficCapture::instance().start(
+                    TrafficCapture::Config::fromJson(config, service));
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Traffic capture disabled: " << e.what();
+    return false;
+  }
+
+  drogon::app().registerPreRoutingAdvice(
+      [](const drogon::HttpRequestPtr &req, drogon::AdviceCallback &&,
+         drogon::AdviceChainCallback &&accb) {
+        TrafficCapture::Request request;
+        request.method = req->methodString();
+        request.path = req->path();
+        request.query = req->query();
+        request.authorization = req->getHeader("authorization");
+        request.contentType = req->getHeader("content-type");
+        // Потоковые загрузки здесь ещё без тела
+        const auto &length = req->getHeader("content-length");
+        request.bodyBytes = length.empty()
+                                ? req->body().size()
+                                : std::strtoull(length.c_str(), nullptr, 10);
+        request.arrivalUs = req->creationDate().microSecondsSinceEpoch();
+        TrafficCapture::instance().record(request);
+        accb();
+      });
+  return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <json/value.h>
+#include <string>
+
+namespace services {
+
+// Если в config (custom_config.traffic_capture) enabled, запускает
+// TrafficCapture и регистрирует pre-routing advice, которая пишет в неё
+// каждый запрос. Вызывать до остальных advice, чтобы видеть и
+// preflight, и то, что отклонят лимиты. false — запись выключена или не
+// запустилась (причина в логе).
+bool startTrafficCapture(const Json::Value &config,
+                         const std::string &service);
+
+} // namespace services
@@ -0,0 +1,553 @@
+#include "TrafficCapture.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <stdexcept>
+#include <sys/stat.h>
+
+using namespace services;
+
+// Формат журнала (все целые — varint, знаковые — zigzag):
+//   заголовок: "TCAP", версия (1 байт), имя сервиса (длина + байты),
+//              начало записи в мкс от эпохи (8 байт LE), доля выборки
+//              в миллионных;
+//   запись:    длина записи, приращение времени прихода к предыдущей
+//              записи (мкс, zigzag: потоки пишут не строго по порядку),
+//              метод (1 байт, 0 — дальше строкой), путь, число
+//              параметров и пары имя/значение, размер тела, вид тела
+//              (1 байт), клиент.
+// Поля, добавленные в конец записи в следующих версиях, старый Reader
+// пропускает по длине.
+
+namespace {
+
+constexpr char kMagic[4] = {'T', 'C', 'A', 'P'};
+constexpr uint8_t kVersion = 1;
+constexpr size_t kMaxPath = 1024;
+constexpr size_t kMaxParams = 32;
+constexpr size_t kMaxParamBytes = 256;
+
+const char *const kMethods[] = {"",       "GET",  "POST",   "PUT",
+                                "PATCH",  "DELETE", "HEAD", "OPTIONS"};
+constexpr size_t kMethodCount = sizeof(kMethods) / sizeof(kMethods[0]);
+
+uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+// SipHash-2-4
+uint64_t sipHash(const uint64_t key[2], std::string_view data) {
+  uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+  uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+  uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+  uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+  auto round = [&]() {
+    v0 += v1;
+    v1 = rotl(v1, 13);
+    v1 ^= v0;
+    v0 = rotl(v0, 32);
+    v2 += v3;
+    v3 = rotl(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotl(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotl(v1, 17);
+    v1 ^= v2;
+    v2 = rotl(v2, 32);
+  };
+
+  size_t full = data.size() / 8 * 8;
+  for (size_t i = 0; i < full; i += 8) {
+    uint64_t m;
+    std::memcpy(&m, data.data() + i, 8);
+    v3 ^= m;
+    round();
+    round();
+    v0 ^= m;
+  }
+  uint64_t last = static_cast<uint64_t>(data.size()) << 56;
+  for (size_t i = full; i < data.size(); ++i) {
+    last |= static_cast<uint64_t>(static_cast<uint8_t>(data[i]))
+            << (8 * (i - full));
+  }
+  v3 ^= last;
+  round();
+  round();
+  v0 ^= last;
+  v2 ^= 0xff;
+  round();
+  round();
+  round();
+  round();
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint64_t splitmix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+void putVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void putString(std::string &out, std::string_view value) {
+  putVarint(out, value.size());
+  out.append(value);
+}
+
+uint64_t zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+struct Cursor {
+  const char *pos;
+  const char *end;
+  bool ok = true;
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos == end) {
+        ok = false;
+        return 0;
+      }
+      auto byte = static_cast<uint8_t>(*pos++);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return value;
+      }
+    }
+    ok = false;
+    return 0;
+  }
+
+  uint8_t byte() {
+    if (pos == end) {
+      ok = false;
+      return 0;
+    }
+    return static_cast<uint8_t>(*pos++);
+  }
+
+  std::string string() {
+    auto size = varint();
+    if (!ok || size > static_cast<uint64_t>(end - pos)) {
+      ok = false;
+      return {};
+    }
+    std::string value(pos, size);
+    pos += size;
+    return value;
+  }
+};
+
+bool readVarint(std::FILE *file, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = std::fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+std::string percentDecode(std::string_view value) {
+  std::string out;
+  out.reserve(value.size());
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (value[i] == '+') {
+      out.push_back(' ');
+    } else if (value[i] == '%' && i + 2 < value.size() &&
+               hexValue(value[i + 1]) >= 0 && hexValue(value[i + 2]) >= 0) {
+      out.push_back(static_cast<char>(hexValue(value[i + 1]) * 16 +
+                                      hexValue(value[i + 2])));
+      i += 2;
+    } else {
+      out.push_back(value[i]);
+    }
+  }
+  return out;
+}
+
+// Параметры-курсоры и размеры страниц: их значения не персональные
+// данные, а от них зависит план запроса
+constexpr std::string_view kVerbatimParams[] = {
+    "id",     "ids",         "since",       "cursor",
+    "offset", "limit",       "posts_limit", "followers_limit",
+    "page",   "count_only"};
+
+// Целое или список целых через запятую: "42", "-1", "1,2,3"
+bool isIdList(std::string_view value) {
+  if (value.size() > 1 && value[0] == '-') {
+    value.remove_prefix(1);
+  }
+  bool digit = false;
+  for (char c : value) {
+    if (c >= '0' && c <= '9') {
+      digit = true;
+    } else if (c == ',' && digit) {
+      digit = false;
+    } else {
+      return false;
+    }
+  }
+  return digit;
+}
+
+// Всё, что не курсор и не id, заменяется: в строке поиска из одних
+// цифр и пробелов может быть телефон или дата рождения
+bool keepAsIs(std::string_view name, const std::string &value) {
+  return value.empty() || isIdList(value) ||
+         std::find(std::begin(kVerbatimParams), std::end(kVerbatimParams),
+                   name) != std::end(kVerbatimParams);
+}
+
+std::string pseudonym(const uint64_t key[2], const std::string &value) {
+  size_t length = std::min<size_t>(std::max<size_t>(value.size(), 1),
+                                   kMaxParamBytes);
+  std::string out(length, 'a');
+  uint64_t bits = sipHash(key, value);
+  for (size_t i = 0; i < length; ++i) {
+    if (i % 8 == 0) {
+      bits = splitmix(bits + i);
+    }
+    out[i] = static_cast<char>('a' + (bits & 0xff) % 26);
+    bits >>= 8;
+  }
+  return out;
+}
+
+TrafficCapture::Body bodyKind(std::string_view contentType, uint64_t bytes) {
+  if (contentType.find("json") != std::string_view::npos) {
+    return TrafficCapture::Body::kJson;
+  }
+  if (contentType.find("multipart") != std::string_view::npos) {
+    return TrafficCapture::Body::kMultipart;
+  }
+  return contentType.empty() && bytes == 0 ? TrafficCapture::Body::kNone
+                                           : TrafficCapture::Body::kOther;
+}
+
+} // namespace
+
+TrafficCapture::Config TrafficCapture::Config::fromJson(const Json::Value &json,
+                                                       std::string service) {
+  Config config;
+  config.directory = json.get("directory", config.directory).asString();
+  config.service = std::move(service);
+  config.sampleRate = json.get("sample_rate", config.sampleRate).asDouble();
+  config.salt = json.get("salt", "").asString();
+  config.maxBytes =
+      json.get("max_bytes", Json::UInt64(config.maxBytes)).asUInt64();
+  config.bufferBytes =
+      json.get("buffer_bytes", Json::UInt64(config.bufferBytes)).asUInt64();
+  config.flushInterval = std::chrono::milliseconds(
+      json.get("flush_interval_ms", Json::Int64(config.flushInterval.count()))
+          .asInt64());
+  return config;
+}
+
+TrafficCapture &TrafficCapture::instance() {
+  static TrafficCapture capture;
+  return capture;
+}
+
+TrafficCapture::~TrafficCapture() { stop(); }
+
+std::string TrafficCapture::start(const Config &config) {
+  stop();
+  config_ = config;
+  if (config_.salt.empty()) {
+    std::random_device random;
+    for (auto &word : key_) {
+      word = (static_cast<uint64_t>(random()) << 32) | random();
+    }
+  } else {
+    const uint64_t fixed[2] = {0x5472616666696321ULL, 0x43617074757265ULL};
+    key_[0] = sipHash(fixed, config_.salt);
+    key_[1] = splitmix(key_[0]);
+  }
+  double rate = std::min(std::max(config_.sampleRate, 0.0), 1.0);
+  threshold_ = rate >= 1 ? UINT64_MAX
+                         : static_cast<uint64_t>(rate * 18446744073709551616.0);
+
+  if (::mkdir(config_.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    throw std::runtime_error("cannot create " + config_.directory + ": " +
+                             std::strerror(errno));
+  }
+  auto startUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  auto path = config_.directory + "/" + config_.service + "-" +
+              std::to_string(startUs / 1000000) + ".tcap";
+  file_ = std::fopen(path.c_str(), "wbx");
+  if (!file_) {
+    throw std::runtime_error("cannot create " + path + ": " +
+                             std::strerror(errno));
+  }
+
+  std::string header(kMagic, sizeof(kMagic));
+  header.push_back(static_cast<char>(kVersion));
+  putString(header, config_.service);
+  for (int i = 0; i < 8; ++i) {
+    header.push_back(static_cast<char>(static_cast<uint64_t>(startUs) >>
+                                       (8 * i)));
+  }
+  putVarint(header, static_cast<uint64_t>(rate * 1000000));
+  std::fwrite(header.data(), 1, header.size(), file_);
+
+  lastUs_ = startUs;
+  buffer_.reserve(config_.bufferBytes);
+  stopping_ = false;
+  written_ = header.size();
+  flusher_ = std::thread([this]() { flushLoop(); });
+  enabled_ = true;
+  return path;
+}
+
+void TrafficCapture::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_) {
+      return;
+    }
+    enabled_ = false;
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  flusher_.join();
+  std::fclose(file_);
+  file_ = nullptr;
+}
+
+bool TrafficCapture::sampled(uint64_t clientHash) {
+  if (threshold_ == UINT64_MAX) {
+    return true;
+  }
+  if (clientHash == 0) {
+    thread_local uint64_t state =
+        splitmix(reinterpret_cast<uintptr_t>(&state) ^
+                 static_cast<uint64_t>(
+                     std::chrono::steady_clock::now().time_since_epoch()
+                         .count()));
+    clientHash = splitmix(state++);
+  }
+  return clientHash < threshold_;
+}
+
+void TrafficCapture::encode(const Request &request, uint32_t client,
+                            std::string &out) {
+  size_t method = 1;
+  while (method < kMethodCount && request.method != kMethods[method]) {
+    ++method;
+  }
+  if (method < kMethodCount) {
+    out.push_back(static_cast<char>(method));
+  } else {
+    out.push_back(0);
+    putString(out, request.method.substr(0, 16));
+  }
+  putString(out, request.path.substr(0, kMaxPath));
+
+  std::vector<std::pair<std::string_view, std::string>> params;
+  std::string_view query = request.query;
+  while (!query.empty() && params.size() < kMaxParams) {
+    auto amp = query.find('&');
+    auto pair = query.substr(0, amp);
+    query = amp == std::string_view::npos ? std::string_view()
+                                          : query.substr(amp + 1);
+    if (pair.empty()) {
+      continue;
+    }
+    auto eq = pair.find('=');
+    auto name = pair.substr(0, std::min(eq, kMaxParamBytes));
+    auto raw = eq == std::string_view::npos ? std::string_view()
+                                            : pair.substr(eq + 1);
+    auto value = percentDecode(raw);
+    params.emplace_back(name, keepAsIs(name, value)
+                                  ? std::string(raw.substr(0, kMaxParamBytes))
+                                  : pseudonym(key_, value));
+  }
+  putVarint(out, params.size());
+  for (const auto &[name, value] : params) {
+    putString(out, name);
+    putString(out, value);
+  }
+
+  putVarint(out, request.bodyBytes);
+  out.push_back(
+      static_cast<char>(bodyKind(request.contentType, request.bodyBytes)));
+  putVarint(out, client);
+}
+
+void TrafficCapture::record(const Request &request) {
+  if (!enabled()) {
+    return;
+  }
+  uint64_t clientHash = 0;
+  uint32_t client = 0;
+  if (!request.authorization.empty()) {
+    clientHash = sipHash(key_, request.authorization);
+    client = static_cast<uint32_t>(clientHash >> 32);
+    client += client == 0;
+  }
+  if (!sampled(clientHash)) {
+    return;
+  }
+
+  thread_local std::string payload;
+  payload.clear();
+  encode(request, client, payload);
+
+  std::string prefix;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled()) {
+      return;
+    }
+    auto delta = zigzag(request.arrivalUs - lastUs_);
+    std::string deltaBytes;
+    putVarint(deltaBytes, delta);
+    putVarint(prefix, deltaBytes.size() + payload.size());
+    prefix += deltaBytes;
+
+    size_t size = prefix.size() + payload.size();
+    if (buffer_.size() + size > config_.bufferBytes) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if (written_.load(std::memory_order_relaxed) + buffer_.size() + size >
+        config_.maxBytes) {
+      enabled_ = false;
+      return;
+    }
+    buffer_ += prefix;
+    buffer_ += payload;
+    lastUs_ = request.arrivalUs;
+    captured_.fetch_add(1, std::memory_order_relaxed);
+    if (buffer_.size() < config_.bufferBytes / 2) {
+      return;
+    }
+  }
+  wake_.notify_one();
+}
+
+void TrafficCapture::flushLoop() {
+  std::string out;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait_for(lock, config_.flushInterval, [this]() {
+      return stopping_ || buffer_.size() >= config_.bufferBytes / 2;
+    });
+    out.swap(buffer_);
+    bool stop = stopping_;
+    lock.unlock();
+    if (!out.empty()) {
+      std::fwrite(out.data(), 1, out.size(), file_);
+      std::fflush(file_);
+      written_.fetch_add(out.size(), std::memory_order_relaxed);
+      out.clear();
+    }
+    lock.lock();
+    if (stop) {
+      return;
+    }
+  }
+}
+
+TrafficCapture::Reader::Reader(const std::string &path)
+    : file_(std::fopen(path.c_str(), "rb")) {
+  if (!file_) {
+    throw std::runtime_error("cannot open " + path + ": " +
+                             std::strerror(errno));
+  }
+  char magic[sizeof(kMagic)];
+  uint64_t nameSize = 0;
+  if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+      std::memcmp(magic, kMagic, sizeof(magic)) != 0) {
+    std::fclose(file_);
+    throw std::runtime_error(path + ": not a capture file");
+  }
+  if (std::fgetc(file_) != kVersion || !readVarint(file_, nameSize) ||
+      nameSize > 256) {
+    std::fclose(file_);
+    throw std::runtime_error(path + ": unsupported capture version");
+  }
+  service_.resize(nameSize);
+  unsigned char start[8];
+  uint64_t ppm = 0;
+  if (std::fread(service_.data(), 1, nameSize, file_) != nameSize ||
+      std::fread(start, 1, 8, file_) != 8 || !readVarint(file_, ppm)) {
+    std::fclose(file_);
+    throw std::runtime_error(path + ": truncated header");
+  }
+  uint64_t startUs = 0;
+  for (int i = 0; i < 8; ++i) {
+    startUs |= static_cast<uint64_t>(start[i]) << (8 * i);
+  }
+  startUs_ = static_cast<int64_t>(startUs);
+  lastUs_ = startUs_;
+  sampleRate_ = ppm / 1e6;
+}
+
+TrafficCapture::Reader::~Reader() { std::fclose(file_); }
+
+bool TrafficCapture::Reader::next(Record &record) {
+  uint64_t size = 0;
+  if (!readVarint(file_, size) || size > (1 << 20)) {
+    return false;
+  }
+  buffer_.resize(size);
+  if (std::fread(buffer_.data(), 1, size, file_) != size) {
+    return false;
+  }
+  Cursor cursor{buffer_.data(), buffer_.data() + size};
+  lastUs_ += unzigzag(cursor.varint());
+  record.arrivalUs = lastUs_;
+  auto method = cursor.byte();
+  record.method = method == 0 ? cursor.string()
+                              : method < kMethodCount ? kMethods[method] : "";
+  record.path = cursor.string();
+  record.params.clear();
+  auto count = cursor.varint();
+  for (uint64_t i = 0; i < count && cursor.ok; ++i) {
+    auto name = cursor.string();
+    record.params.emplace_back(std::move(name), cursor.string());
+  }
+  record.bodyBytes = cursor.varint();
+  record.body = static_cast<Body>(cursor.byte());
+  record.client = static_cast<uint32_t>(cursor.varint());
+  return cursor.ok;
+}
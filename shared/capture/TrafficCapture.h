@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <json/value.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace services {
+
+// Запись выборки входящих запросов для воспроизведения
+// (tools/replay). Вызывается из первой pre-routing advice, то есть
+// видит и то, что потом отклонят лимиты. Пишутся только метаданные:
+// метод, путь, параметры запроса, размер и вид тела, время прихода и
+// псевдоним клиента. Тела, заголовки и токены не пишутся.
+//
+// Анонимизация — SipHash с секретом (config.salt, по умолчанию
+// случайный на процесс):
+//   - клиент — хэш Authorization, одинаковый для всех его запросов;
+//   - значение параметра, кроме целых, списков id и курсоров
+//     (offset, limit, since...), заменяется строкой из букв той же
+//     длины. Одно и то же значение даёт одну и ту же замену, поэтому
+//     повторы (и попадания в кэши) сохраняются.
+// Выборка — по клиенту: если клиент попал в выборку, пишутся все его
+// запросы, и сессии воспроизводятся целиком. Анонимные запросы
+// выбираются по одному.
+//
+// Журнал бинарный, без внешних зависимостей (заголовок и формат
+// записи — в TrafficCapture.cc). Запись идёт в буфер под мьютексом,
+// в файл его сбрасывает фоновый поток; если поток не успевает и буфер
+// полон, записи отбрасываются, а не задерживают запрос.
+//
+// Без drogon и без реестра метрик: файл общий для AppService,
+// AuthServiceDrogon и tools/replay (shared/ рядом с ними). Запуск по
+// custom_config и advice для drogon — в CaptureAdvice.h.
+class TrafficCapture {
+public:
+  struct Config {
+    // Файл: <directory>/<service>-<unix time>.tcap
+    std::string directory = "captures";
+    std::string service = "app_service";
+    double sampleRate = 0.01;
+    // Пусто — случайный ключ на процесс
+    std::string salt;
+    // После стольких байт запись прекращается
+    uint64_t maxBytes = 1ULL << 30;
+    size_t bufferBytes = 4 << 20;
+    std::chrono::milliseconds flushInterval{1000};
+
+    // Из custom_config.traffic_capture; отсутствующие поля — по
+    // умолчанию
+    static Config fromJson(const Json::Value &json, std::string service);
+  };
+
+  enum class Body : uint8_t { kNone, kJson, kMultipart, kOther };
+
+  struct Request {
+    std::string_view method;
+    std::string_view path;
+    // Без '?', как пришла: percent-encoded
+    std::string_view query;
+    // Целиком, со схемой; пусто — анонимный
+    std::string_view authorization;
+    std::string_view contentType;
+    uint64_t bodyBytes = 0;
+    // Время прихода, мкс от эпохи
+    int64_t arrivalUs = 0;
+  };
+
+  // Запись журнала после чтения
+  struct Record {
+    int64_t arrivalUs = 0;
+    std::string method;
+    std::string path;
+    // Значения — после анонимизации, percent-encoded
+    std::vector<std::pair<std::string, std::string>> params;
+    uint64_t bodyBytes = 0;
+    Body body = Body::kNone;
+    // 0 — без Authorization
+    uint32_t client = 0;
+  };
+
+  class Reader {
+  public:
+    // Ошибки — std::runtime_error
+    explicit Reader(const std::string &path);
+    ~Reader();
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    const std::string &service() const { return service_; }
+    int64_t startUs() const { return startUs_; }
+    double sampleRate() const { return sampleRate_; }
+
+    // false — конец файла (оборванная последняя запись тоже конец)
+    bool next(Record &record);
+
+  private:
+    std::FILE *file_ = nullptr;
+    std::string service_;
+    int64_t startUs_ = 0;
+    double sampleRate_ = 0;
+    int64_t lastUs_ = 0;
+    std::string buffer_;
+  };
+
+  static TrafficCapture &instance();
+
+  ~TrafficCapture();
+
+  // Открывает журнал и запускает поток записи; ошибки —
+  // std::runtime_error. Возвращает путь к файлу.
+  std::string start(const Config &config);
+  // Сбрасывает буфер и закрывает файл
+  void stop();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void record(const Request &request);
+
+  uint64_t captured() const { return captured_.load(); }
+  uint64_t dropped() const { return dropped_.load(); }
+  uint64_t bytesWritten() const { return written_.load(); }
+
+private:
+  bool sampled(uint64_t clientHash);
+  void encode(const Request &request, uint32_t client, std::string &out);
+  void flushLoop();
+
+  Config config_;
+  uint64_t key_[2] = {0, 0};
+  uint64_t threshold_ = 0;
+  std::atomic<bool> enabled_{false};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::string buffer_;
+  int64_t lastUs_ = 0;
+  bool stopping_ = false;
+  std::FILE *file_ = nullptr;
+  std::thread flusher_;
+
+  std::atomic<uint64_t> captured_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> written_{0};
+};
+
+} // namespace services